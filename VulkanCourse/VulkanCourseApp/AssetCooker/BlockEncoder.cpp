@@ -0,0 +1,423 @@
+#include "BlockEncoder.h"
+
+#include <emmintrin.h>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// Interpolation weights (out of 64) for BC7 4 bit indices, matching the decoder.
+static const uint32_t BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Block pixels split into one array per channel, so 4 pixels fit a register.
+struct BlockChannels
+{
+   alignas(16) float values[4][16];
+};
+
+/***********************************************************
+** Helper Functions.
+***********************************************************/
+static float Clamp(float value, float low, float high)
+{
+   return value < low ? low : (value > high ? high : value);
+}
+
+static void LoadBlock(const uint8_t* pixels, BlockChannels* channels)
+{
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+         channels->values[c][i] = pixels[i * 4 + c];
+      }
+   }
+}
+
+// Line through the block's colors along its principal axis, trimmed to the furthest pixels either side.
+static void FindEndpoints(const BlockChannels& channels, uint32_t channelCount, float* endpoint0, float* endpoint1)
+{
+   float mean[4] = {};
+   for (uint32_t c = 0; c < channelCount; c++)
+   {
+      for (uint32_t i = 0; i < 16; i++)
+      {
+         mean[c] += channels.values[c][i];
+      }
+      mean[c] /= 16.0f;
+   }
+
+   float covariance[4][4] = {};
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      for (uint32_t a = 0; a < channelCount; a++)
+      {
+         for (uint32_t b = 0; b < channelCount; b++)
+         {
+            covariance[a][b] += (channels.values[a][i] - mean[a]) * (channels.values[b][i] - mean[b]);
+         }
+      }
+   }
+
+   // Power iteration, a handful of steps is plenty for a 4x4 block.
+   float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+   for (uint32_t step = 0; step < 8; step++)
+   {
+      float next[4] = {};
+      float length = 0.0f;
+      for (uint32_t a = 0; a < channelCount; a++)
+      {
+         for (uint32_t b = 0; b < channelCount; b++)
+         {
+            next[a] += covariance[a][b] * axis[b];
+         }
+         length += next[a] * next[a];
+      }
+
+      // Flat block, every pixel is the mean.
+      if (length < 1e-12f)
+      {
+         memcpy(endpoint0, mean, sizeof(mean));
+         memcpy(endpoint1, mean, sizeof(mean));
+         return;
+      }
+
+      length = sqrtf(length);
+      for (uint32_t a = 0; a < channelCount; a++)
+      {
+         axis[a] = next[a] / length;
+      }
+   }
+
+   float minT = FLT_MAX;
+   float maxT = -FLT_MAX;
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      float t = 0.0f;
+      for (uint32_t c = 0; c < channelCount; c++)
+      {
+         t += (channels.values[c][i] - mean[c]) * axis[c];
+      }
+      minT = t < minT ? t : minT;
+      maxT = t > maxT ? t : maxT;
+   }
+
+   for (uint32_t c = 0; c < 4; c++)
+   {
+      endpoint0[c] = c < channelCount ? Clamp(mean[c] + minT * axis[c], 0.0f, 255.0f) : 255.0f;
+      endpoint1[c] = c < channelCount ? Clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f) : 255.0f;
+   }
+}
+
+// Closest palette entry for each pixel, 4 pixels at a time. Returns the block's total squared error.
+static float SelectIndices(const BlockChannels& channels, uint32_t channelCount, const float (*palette)[4], uint32_t paletteSize, uint32_t* indices)
+{
+   __m128 total = _mm_setzero_ps();
+   for (uint32_t group = 0; group < 4; group++)
+   {
+      __m128 bestError = _mm_set1_ps(FLT_MAX);
+      __m128i bestIndex = _mm_setzero_si128();
+
+      for (uint32_t k = 0; k < paletteSize; k++)
+      {
+         __m128 error = _mm_setzero_ps();
+         for (uint32_t c = 0; c < channelCount; c++)
+         {
+            __m128 diff = _mm_sub_ps(_mm_load_ps(&channels.values[c][group * 4]), _mm_set1_ps(palette[k][c]));
+            error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+         }
+
+         // Keep k wherever it beats the best so far.
+         __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+         bestError = _mm_min_ps(error, bestError);
+         bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(k))), _mm_andnot_si128(closer, bestIndex));
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&indices[group * 4]), bestIndex);
+      total = _mm_add_ps(total, bestError);
+   }
+
+   alignas(16) float sums[4];
+   _mm_store_ps(sums, total);
+   return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+// Least squares endpoints for a fixed set of indices. weights[k] is how far palette entry k sits towards endpoint1.
+static bool RefineEndpoints(const BlockChannels& channels, uint32_t channelCount, const uint32_t* indices, const float* weights,
+   float* endpoint0, float* endpoint1)
+{
+   float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+   float ax[4] = {}, bx[4] = {};
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      float b = weights[indices[i]];
+      float a = 1.0f - b;
+      aa += a * a;
+      bb += b * b;
+      ab += a * b;
+      for (uint32_t c = 0; c < channelCount; c++)
+      {
+         ax[c] += a * channels.values[c][i];
+         bx[c] += b * channels.values[c][i];
+      }
+   }
+
+   // Every pixel on the same index, nothing to solve.
+   float determinant = aa * bb - ab * ab;
+   if (fabsf(determinant) < 1e-6f)
+   {
+      return false;
+   }
+
+   for (uint32_t c = 0; c < channelCount; c++)
+   {
+      endpoint0[c] = Clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+      endpoint1[c] = Clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+   }
+   return true;
+}
+
+// Writes fields LSB first into a block.
+struct BlockBitWriter
+{
+   uint8_t* data;
+   uint32_t position;
+
+   void Write(uint32_t value, uint32_t count)
+   {
+      for (uint32_t i = 0; i < count; i++)
+      {
+         if ((value >> i) & 1)
+         {
+            data[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+         }
+         position++;
+      }
+   }
+};
+
+/***********************************************************
+** BC1.
+***********************************************************/
+static uint16_t Quantize565(const float* color)
+{
+   uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+   uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+   uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+   return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void Expand565(uint16_t color, uint32_t* rgb)
+{
+   uint32_t r = (color >> 11) & 0x1F;
+   uint32_t g = (color >> 5) & 0x3F;
+   uint32_t b = color & 0x1F;
+   rgb[0] = (r << 3) | (r >> 2);
+   rgb[1] = (g << 2) | (g >> 4);
+   rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Palette exactly as the 4 color mode decoder builds it, in index order.
+static void BuildBC1Palette(uint16_t color0, uint16_t color1, float (*palette)[4])
+{
+   uint32_t rgb0[3], rgb1[3];
+   Expand565(color0, rgb0);
+   Expand565(color1, rgb1);
+   for (uint32_t c = 0; c < 3; c++)
+   {
+      palette[0][c] = static_cast<float>(rgb0[c]);
+      palette[1][c] = static_cast<float>(rgb1[c]);
+      palette[2][c] = static_cast<float>((2 * rgb0[c] + rgb1[c]) / 3);
+      palette[3][c] = static_cast<float>((rgb0[c] + 2 * rgb1[c]) / 3);
+   }
+}
+
+// Quantize a pair of endpoints and pick indices for them. Returns the squared error.
+static float FitBC1(const BlockChannels& channels, const float* endpoint0, const float* endpoint1,
+   uint16_t* color0, uint16_t* color1, uint32_t* indices)
+{
+   *color0 = Quantize565(endpoint0);
+   *color1 = Quantize565(endpoint1);
+
+   // 4 color mode needs color0 > color1. Equal endpoints decode in 3 color mode, where only index 0 is safe.
+   if (*color0 < *color1)
+   {
+      uint16_t swap = *color0;
+      *color0 = *color1;
+      *color1 = swap;
+   }
+   float palette[4][4];
+   BuildBC1Palette(*color0, *color1, palette);
+   return SelectIndices(channels, 3, palette, *color0 == *color1 ? 1 : 4, indices);
+}
+
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block)
+{
+   BlockChannels channels;
+   LoadBlock(pixels, &channels);
+
+   float endpoint0[4], endpoint1[4];
+   FindEndpoints(channels, 3, endpoint0, endpoint1);
+
+   uint16_t color0, color1;
+   uint32_t indices[16];
+   float error = FitBC1(channels, endpoint0, endpoint1, &color0, &color1, indices);
+
+   // One least squares pass over the chosen indices, kept only if it helps.
+   static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+   if (color0 != color1)
+   {
+      float refined0[4], refined1[4];
+      uint32_t rgb0[3], rgb1[3];
+      Expand565(color0, rgb0);
+      Expand565(color1, rgb1);
+      for (uint32_t c = 0; c < 3; c++)
+      {
+         refined0[c] = static_cast<float>(rgb0[c]);
+         refined1[c] = static_cast<float>(rgb1[c]);
+      }
+
+      if (RefineEndpoints(channels, 3, indices, weights, refined0, refined1))
+      {
+         uint16_t refinedColor0, refinedColor1;
+         uint32_t refinedIndices[16];
+         float refinedError = FitBC1(channels, refined0, refined1, &refinedColor0, &refinedColor1, refinedIndices);
+         if (refinedError < error)
+         {
+            color0 = refinedColor0;
+            color1 = refinedColor1;
+            memcpy(indices, refinedIndices, sizeof(indices));
+         }
+      }
+   }
+
+   uint32_t packedIndices = 0;
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      packedIndices |= indices[i] << (i * 2);
+   }
+
+   block[0] = static_cast<uint8_t>(color0);
+   block[1] = static_cast<uint8_t>(color0 >> 8);
+   block[2] = static_cast<uint8_t>(color1);
+   block[3] = static_cast<uint8_t>(color1 >> 8);
+   memcpy(&block[4], &packedIndices, 4);
+}
+
+/***********************************************************
+** BC7.
+***********************************************************/
+// 7 bit endpoint plus the p-bit that best matches it. Stored value is (quantized << 1) | pBit.
+static void QuantizeBC7Endpoint(const float* endpoint, uint32_t* quantized, uint32_t* pBit)
+{
+   float bestError = FLT_MAX;
+   for (uint32_t p = 0; p < 2; p++)
+   {
+      uint32_t candidate[4];
+      float error = 0.0f;
+      for (uint32_t c = 0; c < 4; c++)
+      {
+         float value = Clamp(roundf((endpoint[c] - p) / 2.0f), 0.0f, 127.0f);
+         candidate[c] = static_cast<uint32_t>(value);
+         float diff = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+         error += diff * diff;
+      }
+
+      if (error < bestError)
+      {
+         bestError = error;
+         memcpy(quantized, candidate, sizeof(candidate));
+         *pBit = p;
+      }
+   }
+}
+
+static float FitBC7(const BlockChannels& channels, const float* endpoint0, const float* endpoint1,
+   uint32_t (*quantized)[4], uint32_t* pBits, uint32_t* indices)
+{
+   QuantizeBC7Endpoint(endpoint0, quantized[0], &pBits[0]);
+   QuantizeBC7Endpoint(endpoint1, quantized[1], &pBits[1]);
+
+   // Palette exactly as the decoder interpolates it.
+   float palette[16][4];
+   for (uint32_t k = 0; k < 16; k++)
+   {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+         uint32_t value0 = (quantized[0][c] << 1) | pBits[0];
+         uint32_t value1 = (quantized[1][c] << 1) | pBits[1];
+         palette[k][c] = static_cast<float>(((64 - BC7_WEIGHTS_4[k]) * value0 + BC7_WEIGHTS_4[k] * value1 + 32) >> 6);
+      }
+   }
+
+   return SelectIndices(channels, 4, palette, 16, indices);
+}
+
+void EncodeBC7Block(const uint8_t* pixels, uint8_t* block)
+{
+   BlockChannels channels;
+   LoadBlock(pixels, &channels);
+
+   float endpoint0[4], endpoint1[4];
+   FindEndpoints(channels, 4, endpoint0, endpoint1);
+
+   uint32_t quantized[2][4];
+   uint32_t pBits[2];
+   uint32_t indices[16];
+   float error = FitBC7(channels, endpoint0, endpoint1, quantized, pBits, indices);
+
+   // One least squares pass over the chosen indices, kept only if it helps.
+   float weights[16];
+   for (uint32_t k = 0; k < 16; k++)
+   {
+      weights[k] = BC7_WEIGHTS_4[k] / 64.0f;
+   }
+   if (RefineEndpoints(channels, 4, indices, weights, endpoint0, endpoint1))
+   {
+      uint32_t refinedQuantized[2][4];
+      uint32_t refinedPBits[2];
+      uint32_t refinedIndices[16];
+      float refinedError = FitBC7(channels, endpoint0, endpoint1, refinedQuantized, refinedPBits, refinedIndices);
+      if (refinedError < error)
+      {
+         memcpy(quantized, refinedQuantized, sizeof(quantized));
+         memcpy(pBits, refinedPBits, sizeof(pBits));
+         memcpy(indices, refinedIndices, sizeof(indices));
+      }
+   }
+
+   // Pixel 0 is stored with 3 bits, so its index must be below 8. Swapping the endpoints mirrors every index.
+   if (indices[0] >= 8)
+   {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+         uint32_t swap = quantized[0][c];
+         quantized[0][c] = quantized[1][c];
+         quantized[1][c] = swap;
+      }
+      uint32_t swap = pBits[0];
+      pBits[0] = pBits[1];
+      pBits[1] = swap;
+
+      for (uint32_t i = 0; i < 16; i++)
+      {
+         indices[i] = 15 - indices[i];
+      }
+   }
+
+   memset(block, 0, 16);
+   BlockBitWriter writer = { block, 0 };
+   writer.Write(1 << 6, 7);
+
+   // Endpoints channel by channel, then p-bits, then indices.
+   for (uint32_t c = 0; c < 4; c++)
+   {
+      writer.Write(quantized[0][c], 7);
+      writer.Write(quantized[1][c], 7);
+   }
+   writer.Write(pBits[0], 1);
+   writer.Write(pBits[1], 1);
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      writer.Write(indices[i], i == 0 ? 3 : 4);
+   }
+}
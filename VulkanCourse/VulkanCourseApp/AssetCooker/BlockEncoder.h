@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// Encode one 4x4 block of RGBA8 pixels (row by row) into the block layout the GPU samples.
+
+// 4 color mode BC1, alpha is ignored. 8 bytes written.
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block);
+
+// BC7 mode 6, one RGBA subset with 7 bit endpoints, a p-bit each and 4 bit indices. 16 bytes written.
+void EncodeBC7Block(const uint8_t* pixels, uint8_t* block);
@@ -0,0 +1,99 @@
+#include "LzEncoder.h"
+
+#include <cstring>
+
+#include "LzCompression.h"
+
+// Positions of recent 4 byte sequences, indexed by their hash.
+const uint32_t LZ_HASH_BITS = 16;
+
+static uint32_t HashSequence(const uint8_t* p)
+{
+   uint32_t sequence;
+   memcpy(&sequence, p, sizeof(sequence));
+   return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Write a length that didn't fit in its nibble as extra bytes.
+static void WriteExtraLength(std::vector<uint8_t>* out, size_t length)
+{
+   while (length >= 255)
+   {
+      out->push_back(255);
+      length -= 255;
+   }
+   out->push_back(static_cast<uint8_t>(length));
+}
+
+static void WriteSequence(std::vector<uint8_t>* out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+   // Match length is stored minus the minimum, a literal only sequence writes no match at all.
+   size_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+   uint8_t token = static_cast<uint8_t>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+   out->push_back(token);
+
+   if (literalLength >= 15)
+   {
+      WriteExtraLength(out, literalLength - 15);
+   }
+   out->insert(out->end(), literals, literals + literalLength);
+
+   if (matchLength)
+   {
+      out->push_back(static_cast<uint8_t>(offset));
+      out->push_back(static_cast<uint8_t>(offset >> 8));
+      if (matchCode >= 15)
+      {
+         WriteExtraLength(out, matchCode - 15);
+      }
+   }
+}
+
+std::vector<uint8_t> LzCompress(const uint8_t* src, size_t size)
+{
+   std::vector<uint8_t> out;
+   out.reserve(size / 2 + 16);
+
+   // Position + 1 of the last sequence with each hash, 0 for none.
+   std::vector<uint32_t> table(static_cast<size_t>(1) << LZ_HASH_BITS, 0);
+
+   size_t literalStart = 0;
+   size_t pos = 0;
+
+   // A match needs 4 bytes to hash, the tail always goes out as literals.
+   while (size >= LZ_MIN_MATCH && pos <= size - LZ_MIN_MATCH)
+   {
+      uint32_t hash = HashSequence(src + pos);
+      size_t candidate = table[hash];
+      table[hash] = static_cast<uint32_t>(pos + 1);
+
+      if (candidate == 0 || pos - (candidate - 1) > LZ_MAX_OFFSET || memcmp(src + candidate - 1, src + pos, LZ_MIN_MATCH) != 0)
+      {
+         pos++;
+         continue;
+      }
+      candidate--;
+
+      size_t matchLength = LZ_MIN_MATCH;
+      while (pos + matchLength < size && src[candidate + matchLength] == src[pos + matchLength])
+      {
+         matchLength++;
+      }
+
+      WriteSequence(&out, src + literalStart, pos - literalStart, pos - candidate, matchLength);
+
+      // Keep the table warm inside long matches without hashing every byte.
+      size_t matchEnd = pos + matchLength;
+      for (size_t i = pos + 1; i < matchEnd && i + LZ_MIN_MATCH <= size; i += 4)
+      {
+         table[HashSequence(src + i)] = static_cast<uint32_t>(i + 1);
+      }
+
+      pos = matchEnd;
+      literalStart = pos;
+   }
+
+   WriteSequence(&out, src + literalStart, size - literalStart, 0, 0);
+
+   return out;
+}
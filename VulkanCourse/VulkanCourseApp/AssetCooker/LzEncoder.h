@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Compress size bytes into one LZ block as described in LzCompression.h, greedy single probe match finder.
+// The block may come out larger than the input, callers store such data uncompressed instead.
+std::vector<uint8_t> LzCompress(const uint8_t* src, size_t size);
@@ -0,0 +1,174 @@
+#include "PackWriter.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "PackFormat.h"
+#include "LzEncoder.h"
+#include "LzCompression.h"
+
+// Compressed files must save at least 1/16th of their size, otherwise unpacking costs more than the read it saves.
+const uint64_t MIN_SAVING_SHIFT = 4;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+static std::vector<char> ReadWholeFile(const std::string& filePath)
+{
+   std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to open " + filePath + " for packing!");
+   }
+
+   std::vector<char> data(static_cast<size_t>(file.tellg()));
+   file.seekg(0);
+   file.read(data.data(), data.size());
+   if (!file)
+   {
+      throw std::runtime_error("Failed to read " + filePath + " for packing!");
+   }
+
+   return data;
+}
+
+static void WritePadding(std::ofstream* file, uint64_t from, uint64_t to)
+{
+   file->write(std::string(static_cast<size_t>(to - from), '\0').data(), to - from);
+}
+
+// Compress data chunk by chunk. Returns false (and leaves chunks empty) if the file isn't worth compressing.
+static bool CompressChunks(const std::vector<char>& data, std::vector<std::vector<uint8_t>>* chunks)
+{
+   const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+   uint64_t storedSize = 0;
+   for (size_t start = 0; start < data.size(); start += PACK_CHUNK_SIZE)
+   {
+      size_t chunkSize = std::min<size_t>(PACK_CHUNK_SIZE, data.size() - start);
+      std::vector<uint8_t> compressed = LzCompress(bytes + start, chunkSize);
+
+      // Round trip each chunk, a bad encode should fail the cook rather than a load.
+      std::vector<uint8_t> check(chunkSize);
+      if (!LzDecompress(compressed.data(), compressed.size(), check.data(), chunkSize) || memcmp(check.data(), bytes + start, chunkSize) != 0)
+      {
+         throw std::runtime_error("LZ round trip failed!");
+      }
+
+      // A chunk that grew is stored as is, the reader tells by its size.
+      if (compressed.size() >= chunkSize)
+      {
+         compressed.assign(bytes + start, bytes + start + chunkSize);
+      }
+      storedSize += compressed.size();
+      chunks->push_back(std::move(compressed));
+   }
+
+   if (storedSize > data.size() - (data.size() >> MIN_SAVING_SHIFT))
+   {
+      chunks->clear();
+      return false;
+   }
+   return true;
+}
+
+void WritePack(const std::string& packPath, const std::vector<PackSource>& sources, bool compress)
+{
+   std::ofstream file(packPath, std::ios::binary | std::ios::trunc);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to create " + packPath + "!");
+   }
+
+   std::vector<PackEntry> entries;
+   std::vector<PackChunk> chunkTable;
+   std::string stringTable;
+
+   // Payloads go straight after the header, so only one file is held in memory at a time.
+   // The header is filled in last, once the table of contents has a place.
+   PackHeader header = {};
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   uint64_t offset = sizeof(PackHeader);
+   for (auto& source : sources)
+   {
+      // The app always asks with forward slashes.
+      std::string assetPath = source.assetPath;
+      std::replace(assetPath.begin(), assetPath.end(), '\\', '/');
+
+      PackEntry entry = {};
+      entry.nameHash = HashAssetName(assetPath.data(), assetPath.size());
+      for (auto& existing : entries)
+      {
+         if (existing.nameHash == entry.nameHash && stringTable.compare(existing.nameOffset, existing.nameLength, assetPath) == 0)
+         {
+            throw std::runtime_error(assetPath + " was added to the pack twice!");
+         }
+      }
+
+      std::vector<char> data = ReadWholeFile(source.filePath);
+
+      uint64_t aligned = AlignUp(offset, PACK_ALIGNMENT);
+      WritePadding(&file, offset, aligned);
+      offset = aligned;
+
+      entry.offset = aligned;
+      entry.size = data.size();
+      entry.nameOffset = static_cast<uint32_t>(stringTable.size());
+      entry.nameLength = static_cast<uint32_t>(assetPath.size());
+
+      // Compressed chunks go back to back, each one is found through the chunk table.
+      std::vector<std::vector<uint8_t>> chunks;
+      if (compress && CompressChunks(data, &chunks))
+      {
+         entry.firstChunk = static_cast<uint32_t>(chunkTable.size());
+         entry.chunkCount = static_cast<uint32_t>(chunks.size());
+         for (auto& chunk : chunks)
+         {
+            PackChunk packChunk = {};
+            packChunk.offset = offset;
+            packChunk.storedSize = static_cast<uint32_t>(chunk.size());
+            chunkTable.push_back(packChunk);
+
+            file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+            offset += chunk.size();
+         }
+      }
+      else
+      {
+         file.write(data.data(), data.size());
+         offset += data.size();
+      }
+
+      entries.push_back(entry);
+      stringTable += assetPath;
+   }
+
+   // Table of contents sorted by hash, the app binary searches it in place.
+   std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.nameHash < b.nameHash; });
+
+   memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+   header.version = PACK_VERSION;
+   header.entryCount = static_cast<uint32_t>(entries.size());
+   header.stringTableSize = static_cast<uint32_t>(stringTable.size());
+   header.tocOffset = AlignUp(offset, alignof(PackEntry));
+   header.chunkTableOffset = header.tocOffset + entries.size() * sizeof(PackEntry);
+   header.chunkCount = static_cast<uint32_t>(chunkTable.size());
+   header.chunkSize = PACK_CHUNK_SIZE;
+   header.stringTableOffset = header.chunkTableOffset + chunkTable.size() * sizeof(PackChunk);
+
+   WritePadding(&file, offset, header.tocOffset);
+   file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackEntry));
+   file.write(reinterpret_cast<const char*>(chunkTable.data()), chunkTable.size() * sizeof(PackChunk));
+   file.write(stringTable.data(), stringTable.size());
+
+   file.seekp(0);
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+   if (!file)
+   {
+      throw std::runtime_error("Failed to write " + packPath + "!");
+   }
+}
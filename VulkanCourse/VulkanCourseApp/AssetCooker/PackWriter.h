@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// One file to put in a pack. The asset path is what the app asks for, e.g. "Textures/giraffe.ktx2".
+struct PackSource
+{
+   std::string filePath;      // Where the file is read from now.
+   std::string assetPath;     // Name it is stored under in the pack.
+};
+
+// Write every source into a single asset pack laid out as described in PackFormat.h.
+// With compress set each file is LZ compressed in chunks, files that barely shrink are still stored as they are.
+// Throws std::runtime_error on failure.
+void WritePack(const std::string& packPath, const std::vector<PackSource>& sources, bool compress);
@@ -0,0 +1,306 @@
+#include "TextureCooker.h"
+
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "BlockEncoder.h"
+
+// VkFormat values from vulkan_core.h, the cooker doesn't depend on the Vulkan SDK.
+const uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+const uint32_t VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132;
+const uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+const uint32_t VK_FORMAT_BC7_SRGB_BLOCK = 146;
+
+// Khronos data format descriptor values for the two formats. (KTX2 requires a descriptor)
+const uint32_t KHR_DF_MODEL_BC1A = 128;
+const uint32_t KHR_DF_MODEL_BC7 = 134;
+const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const size_t KTX2_HEADER_SIZE = 80;
+
+// Entries in the linear -> sRGB table. Fine enough that the steepest part of the curve (near black) is under a quarter of a code.
+static const uint32_t LINEAR_TABLE_SIZE = 16384;
+
+// Tables for moving between the 8 bit sRGB encoded source and linear light, where filtering happens.
+struct GammaTables
+{
+   float srgbToLinear[256];
+   uint8_t linearToSrgb[LINEAR_TABLE_SIZE];
+
+   GammaTables()
+   {
+      for (uint32_t i = 0; i < 256; i++)
+      {
+         float value = i / 255.0f;
+         srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+      }
+      for (uint32_t i = 0; i < LINEAR_TABLE_SIZE; i++)
+      {
+         float value = i / static_cast<float>(LINEAR_TABLE_SIZE - 1);
+         float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+         linearToSrgb[i] = static_cast<uint8_t>(encoded * 255.0f + 0.5f);
+      }
+   }
+};
+
+static const GammaTables& GetGammaTables()
+{
+   static GammaTables tables;
+   return tables;
+}
+
+// Level in linear light, 4 floats (RGBA) per pixel.
+struct LinearImage
+{
+   uint32_t width;
+   uint32_t height;
+   std::vector<float> pixels;
+};
+
+/***********************************************************
+** Helper Functions.
+***********************************************************/
+static LinearImage ToLinear(const stbi_uc* image, uint32_t width, uint32_t height)
+{
+   const GammaTables& tables = GetGammaTables();
+
+   LinearImage linear = { width, height, std::vector<float>(static_cast<size_t>(width) * height * 4) };
+   for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+   {
+      // Color is sRGB encoded, alpha is already linear.
+      const stbi_uc* pixel = &image[i * 4];
+      float* out = &linear.pixels[i * 4];
+      out[0] = tables.srgbToLinear[pixel[0]];
+      out[1] = tables.srgbToLinear[pixel[1]];
+      out[2] = tables.srgbToLinear[pixel[2]];
+      out[3] = pixel[3] / 255.0f;
+   }
+
+   return linear;
+}
+
+// 2x2 box filter in linear light, one pixel per register. Odd edges reuse the last row / column.
+static LinearImage Downsample(const LinearImage& src)
+{
+   uint32_t width = src.width > 1 ? src.width / 2 : 1;
+   uint32_t height = src.height > 1 ? src.height / 2 : 1;
+   LinearImage dst = { width, height, std::vector<float>(static_cast<size_t>(width) * height * 4) };
+
+   const __m128 quarter = _mm_set1_ps(0.25f);
+   for (uint32_t y = 0; y < height; y++)
+   {
+      uint32_t y0 = y * 2 < src.height ? y * 2 : src.height - 1;
+      uint32_t y1 = y * 2 + 1 < src.height ? y * 2 + 1 : src.height - 1;
+      const float* row0 = &src.pixels[static_cast<size_t>(y0) * src.width * 4];
+      const float* row1 = &src.pixels[static_cast<size_t>(y1) * src.width * 4];
+
+      for (uint32_t x = 0; x < width; x++)
+      {
+         uint32_t x0 = x * 2 < src.width ? x * 2 : src.width - 1;
+         uint32_t x1 = x * 2 + 1 < src.width ? x * 2 + 1 : src.width - 1;
+
+         __m128 sum = _mm_add_ps(_mm_loadu_ps(&row0[x0 * 4]), _mm_loadu_ps(&row0[x1 * 4]));
+         sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(&row1[x0 * 4]), _mm_loadu_ps(&row1[x1 * 4])));
+         _mm_storeu_ps(&dst.pixels[(static_cast<size_t>(y) * width + x) * 4], _mm_mul_ps(sum, quarter));
+      }
+   }
+
+   return dst;
+}
+
+// Back to 8 bit, color re-encoded as sRGB so the cooked texture samples the same as the source image.
+static std::vector<uint8_t> ToSrgb8(const LinearImage& linear)
+{
+   const GammaTables& tables = GetGammaTables();
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 scale = _mm_set1_ps(static_cast<float>(LINEAR_TABLE_SIZE - 1));
+   const __m128 half = _mm_set1_ps(0.5f);
+
+   size_t pixelCount = static_cast<size_t>(linear.width) * linear.height;
+   std::vector<uint8_t> image(pixelCount * 4);
+   for (size_t i = 0; i < pixelCount; i++)
+   {
+      // Clamp and scale all 4 channels to table positions at once.
+      __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&linear.pixels[i * 4]), zero), one);
+      alignas(16) int32_t positions[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(positions), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half)));
+
+      image[i * 4 + 0] = tables.linearToSrgb[positions[0]];
+      image[i * 4 + 1] = tables.linearToSrgb[positions[1]];
+      image[i * 4 + 2] = tables.linearToSrgb[positions[2]];
+      image[i * 4 + 3] = static_cast<uint8_t>((positions[3] * 255 + (LINEAR_TABLE_SIZE - 1) / 2) / (LINEAR_TABLE_SIZE - 1));
+   }
+
+   return image;
+}
+
+static std::vector<uint8_t> EncodeLevel(const std::vector<uint8_t>& image, uint32_t width, uint32_t height, CookFormat format)
+{
+   uint32_t blocksX = (width + 3) / 4;
+   uint32_t blocksY = (height + 3) / 4;
+   uint32_t blockBytes = format == COOK_FORMAT_BC1 ? 8 : 16;
+
+   std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+   uint8_t pixels[16 * 4];
+   for (uint32_t by = 0; by < blocksY; by++)
+   {
+      for (uint32_t bx = 0; bx < blocksX; bx++)
+      {
+         // Blocks hanging over the edge repeat the last pixel, so they don't pull the endpoints off.
+         for (uint32_t y = 0; y < 4; y++)
+         {
+            uint32_t sy = by * 4 + y < height ? by * 4 + y : height - 1;
+            for (uint32_t x = 0; x < 4; x++)
+            {
+               uint32_t sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+               memcpy(&pixels[(y * 4 + x) * 4], &image[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+            }
+         }
+
+         uint8_t* block = &blocks[(static_cast<size_t>(by) * blocksX + bx) * blockBytes];
+         if (format == COOK_FORMAT_BC1)
+         {
+            EncodeBC1Block(pixels, block);
+         }
+         else
+         {
+            EncodeBC7Block(pixels, block);
+         }
+      }
+   }
+
+   return blocks;
+}
+
+static void WriteU32(std::vector<uint8_t>* data, size_t offset, uint32_t value)
+{
+   for (uint32_t i = 0; i < 4; i++)
+   {
+      (*data)[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+   }
+}
+
+static void WriteU64(std::vector<uint8_t>* data, size_t offset, uint64_t value)
+{
+   WriteU32(data, offset, static_cast<uint32_t>(value));
+   WriteU32(data, offset + 4, static_cast<uint32_t>(value >> 32));
+}
+
+static void WriteKtx2(const std::string& dstPath, CookFormat format, bool srgb, uint32_t width, uint32_t height,
+   const std::vector<std::vector<uint8_t>>& levels)
+{
+   // The descriptor's transfer function has to agree with the format, KTX2 readers check one against the other.
+   uint32_t vkFormat = format == COOK_FORMAT_BC1 ? (srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK) :
+      (srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK);
+   uint32_t transfer = srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+   uint32_t blockBytes = format == COOK_FORMAT_BC1 ? 8 : 16;
+   uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+   // Header, level index, then the data format descriptor. (one basic block with one sample)
+   size_t levelIndexSize = levelCount * 24;
+   size_t dfdOffset = KTX2_HEADER_SIZE + levelIndexSize;
+   size_t dfdSize = 4 + 24 + 16;
+
+   std::vector<uint8_t> header(dfdOffset + dfdSize, 0);
+   memcpy(header.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+   WriteU32(&header, 12, vkFormat);
+   WriteU32(&header, 16, 1);              // typeSize, 1 for block formats.
+   WriteU32(&header, 20, width);
+   WriteU32(&header, 24, height);
+   WriteU32(&header, 28, 0);              // pixelDepth, 0 for 2D.
+   WriteU32(&header, 32, 0);              // layerCount, 0 for no array.
+   WriteU32(&header, 36, 1);              // faceCount.
+   WriteU32(&header, 40, levelCount);
+   WriteU32(&header, 44, 0);              // No supercompression.
+   WriteU32(&header, 48, static_cast<uint32_t>(dfdOffset));
+   WriteU32(&header, 52, static_cast<uint32_t>(dfdSize));
+
+   size_t dfd = dfdOffset;
+   WriteU32(&header, dfd, static_cast<uint32_t>(dfdSize));
+   WriteU32(&header, dfd + 4, 0);                                         // Vendor Khronos, basic descriptor type.
+   WriteU32(&header, dfd + 8, 2 | (40 << 16));                             // Version 2, block size 24 + 16 per sample.
+   WriteU32(&header, dfd + 12, (format == COOK_FORMAT_BC1 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_BC7) |
+      (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+   WriteU32(&header, dfd + 16, 3 | (3 << 8));                              // 4x4x1x1 texel blocks. (stored minus 1)
+   WriteU32(&header, dfd + 20, blockBytes);                                // Bytes in plane 0.
+   WriteU32(&header, dfd + 28, (blockBytes * 8 - 1) << 16);                // Sample: whole block, color channel.
+   WriteU32(&header, dfd + 40, 0xFFFFFFFF);                                // Sample upper.
+
+   // Level data goes smallest first, each aligned to a whole block. The index still lists level 0 first.
+   std::vector<uint64_t> offsets(levelCount);
+   uint64_t offset = header.size();
+   for (uint32_t i = levelCount; i-- > 0;)
+   {
+      offset = (offset + blockBytes - 1) / blockBytes * blockBytes;
+      offsets[i] = offset;
+      offset += levels[i].size();
+   }
+   for (uint32_t i = 0; i < levelCount; i++)
+   {
+      WriteU64(&header, KTX2_HEADER_SIZE + i * 24, offsets[i]);
+      WriteU64(&header, KTX2_HEADER_SIZE + i * 24 + 8, levels[i].size());
+      WriteU64(&header, KTX2_HEADER_SIZE + i * 24 + 16, levels[i].size());
+   }
+
+   std::ofstream file(dstPath, std::ios::binary);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to open " + dstPath + " for writing!");
+   }
+
+   file.write(reinterpret_cast<const char*>(header.data()), header.size());
+   uint64_t written = header.size();
+   for (uint32_t i = levelCount; i-- > 0;)
+   {
+      static const char padding[16] = {};
+      file.write(padding, static_cast<std::streamsize>(offsets[i] - written));
+      file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+      written = offsets[i] + levels[i].size();
+   }
+
+   if (!file)
+   {
+      throw std::runtime_error("Failed to write " + dstPath + "!");
+   }
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+void CookTexture(const std::string& srcPath, const std::string& dstPath, CookFormat format, bool srgb)
+{
+   int width, height, channels;
+   stbi_uc* image = stbi_load(srcPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+   if (!image)
+   {
+      throw std::runtime_error("Failed to load " + srcPath + "!");
+   }
+
+   LinearImage linear = ToLinear(image, width, height);
+   stbi_image_free(image);
+
+   // Each level is filtered from the previous one in float, so rounding never builds up down the chain.
+   std::vector<std::vector<uint8_t>> levels;
+   while (true)
+   {
+      levels.push_back(EncodeLevel(ToSrgb8(linear), linear.width, linear.height, format));
+      if (linear.width == 1 && linear.height == 1)
+      {
+         break;
+      }
+      linear = Downsample(linear);
+   }
+
+   WriteKtx2(dstPath, format, srgb, width, height, levels);
+}
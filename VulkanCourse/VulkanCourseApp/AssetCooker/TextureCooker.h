@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+// Block format the cooked levels are stored in.
+enum CookFormat
+{
+   COOK_FORMAT_BC1,           // Opaque RGB, 8 bytes per block.
+   COOK_FORMAT_BC7            // RGBA, 16 bytes per block.
+};
+
+// Load an image, build its gamma correct mip chain, block compress every level and write it as a KTX2 file.
+// The texels are sRGB encoded either way. With srgb the file says so (_SRGB format) and the sampler decodes them, without it
+// they're tagged UNORM and sampled as stored, the way the renderer treats images it decodes itself.
+// Throws std::runtime_error on failure.
+void CookTexture(const std::string& srcPath, const std::string& dstPath, CookFormat format, bool srgb);
@@ -0,0 +1,285 @@
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "ThreadPool.h"
+#include "CookedName.h"
+#include "TextureCooker.h"
+#include "PackWriter.h"
+
+// Usage: AssetCooker [-bc1 | -bc7] [-srgb] [-o outputDir] [files...]
+// With no files every .jpg / .png in Textures/ is cooked. Output goes beside each source unless -o is given, the directory
+// is created if it doesn't exist. -srgb writes _SRGB formats so the sampler linearizes the texels.
+//
+// Usage: AssetCooker -pack assets.pak [-store]
+// Packs Textures/, Models/ and Shaders/*.spv as they are on disk, run it after cooking. Cooked textures replace their sources.
+// Files are LZ compressed in chunks unless -store is given.
+
+static std::string FileExtension(const std::string& fileName)
+{
+   size_t dot = fileName.find_last_of('.');
+   return dot == std::string::npos ? std::string() : fileName.substr(dot + 1);
+}
+
+static bool IsSourceImage(const std::string& fileName)
+{
+   std::string extension = FileExtension(fileName);
+   return extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "JPG" || extension == "PNG";
+}
+
+static bool IsCookedTexture(const std::string& fileName)
+{
+   std::string extension = FileExtension(fileName);
+   return extension == "ktx2" || extension == "dds" || extension == "KTX2" || extension == "DDS";
+}
+
+static bool IsShaderBinary(const std::string& fileName)
+{
+   return FileExtension(fileName) == "spv";
+}
+
+static bool IsModelFile(const std::string& fileName)
+{
+   // Geometry plus the material libraries and buffers it references.
+   std::string extension = FileExtension(fileName);
+   return extension == "obj" || extension == "mtl" || extension == "gltf" || extension == "glb" || extension == "bin" ||
+      extension == "OBJ" || extension == "MTL" || extension == "GLTF" || extension == "GLB" || extension == "BIN";
+}
+
+static std::vector<std::string> ListFiles(const std::string& directory, bool (*filter)(const std::string&))
+{
+   std::vector<std::string> files;
+
+#ifdef _WIN32
+   _finddata_t entry;
+   intptr_t handle = _findfirst((directory + "/*").c_str(), &entry);
+   if (handle != -1)
+   {
+      do
+      {
+         if (!(entry.attrib & _A_SUBDIR) && filter(entry.name))
+         {
+            files.push_back(directory + "/" + entry.name);
+         }
+      } while (_findnext(handle, &entry) == 0);
+      _findclose(handle);
+   }
+#else
+   DIR* dir = opendir(directory.c_str());
+   if (dir)
+   {
+      while (dirent* entry = readdir(dir))
+      {
+         if (filter(entry->d_name))
+         {
+            files.push_back(directory + "/" + entry->d_name);
+         }
+      }
+      closedir(dir);
+   }
+#endif
+
+   return files;
+}
+
+static bool FileExists(const std::string& filePath)
+{
+   return std::ifstream(filePath).is_open();
+}
+
+// Create a directory and any parents it's missing. False if one of them can't be created.
+static bool CreateDirectories(const std::string& directory)
+{
+   for (size_t end = 0; end != std::string::npos;)
+   {
+      end = directory.find_first_of("/\\", end + 1);
+      std::string path = directory.substr(0, end);
+      if (path.empty() || path.back() == ':')
+      {
+         continue;
+      }
+
+#ifdef _WIN32
+      bool created = _mkdir(path.c_str()) == 0;
+#else
+      bool created = mkdir(path.c_str(), 0755) == 0;
+#endif
+      if (!created && errno != EEXIST)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static int PackAssets(const std::string& packPath, bool compress)
+{
+   std::vector<PackSource> sources;
+
+   // Pre-compressed files first, then any source image that was never cooked so the app can still decode it.
+   for (auto& file : ListFiles("Textures", IsCookedTexture))
+   {
+      sources.push_back({ file, file });
+   }
+   for (auto& file : ListFiles("Textures", IsSourceImage))
+   {
+      if (!FileExists(CookedFileName(file)))
+      {
+         sources.push_back({ file, file });
+      }
+   }
+   for (auto& file : ListFiles("Models", IsModelFile))
+   {
+      sources.push_back({ file, file });
+   }
+   for (auto& file : ListFiles("Shaders", IsShaderBinary))
+   {
+      sources.push_back({ file, file });
+   }
+
+   try
+   {
+      WritePack(packPath, sources, compress);
+   }
+   catch (const std::runtime_error& e)
+   {
+      std::cout << "ERROR: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   for (auto& source : sources)
+   {
+      std::cout << source.assetPath << std::endl;
+   }
+   std::cout << "Packed " << sources.size() << " files into " << packPath << "." << std::endl;
+
+   return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+   CookFormat format = COOK_FORMAT_BC7;
+   bool srgb = false;
+   std::string outputDir;
+   std::string packPath;
+   bool compress = true;
+   std::vector<std::string> sources;
+
+   for (int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if (arg == "-bc1")
+      {
+         format = COOK_FORMAT_BC1;
+      }
+      else if (arg == "-bc7")
+      {
+         format = COOK_FORMAT_BC7;
+      }
+      else if (arg == "-srgb")
+      {
+         srgb = true;
+      }
+      else if (arg == "-o" && i + 1 < argc)
+      {
+         outputDir = argv[++i];
+      }
+      else if (arg == "-store")
+      {
+         compress = false;
+      }
+      else if (arg == "-pack" && i + 1 < argc)
+      {
+         packPath = argv[++i];
+      }
+      else
+      {
+         sources.push_back(arg);
+      }
+   }
+
+   // Flags are all read first, so -store counts wherever it is on the command line.
+   if (!packPath.empty())
+   {
+      return PackAssets(packPath, compress);
+   }
+
+   if (sources.empty())
+   {
+      sources = ListFiles("Textures", IsSourceImage);
+   }
+
+   if (!outputDir.empty() && !CreateDirectories(outputDir))
+   {
+      std::cout << "ERROR: Failed to create output directory " << outputDir << "!" << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   // Main thread only waits, so every core gets a worker. One texture per job keeps them all busy on big batches.
+   ThreadPool threadPool;
+   threadPool.Init(std::thread::hardware_concurrency());
+
+   std::mutex mtxDone;
+   std::condition_variable cvDone;
+   size_t remaining = sources.size();
+   std::atomic<uint32_t> failures(0);
+
+   auto start = std::chrono::high_resolution_clock::now();
+   for (auto& source : sources)
+   {
+      std::string destination = CookedFileName(source);
+      if (!outputDir.empty())
+      {
+         size_t slash = destination.find_last_of("/\\");
+         destination = outputDir + "/" + (slash == std::string::npos ? destination : destination.substr(slash + 1));
+      }
+
+      threadPool.Submit([source, destination, format, srgb, &mtxDone, &cvDone, &remaining, &failures]()
+      {
+         std::string message;
+         try
+         {
+            CookTexture(source, destination, format, srgb);
+            message = source + " -> " + destination;
+         }
+         catch (const std::runtime_error& e)
+         {
+            message = std::string("ERROR: ") + e.what();
+            failures++;
+         }
+
+         std::lock_guard<std::mutex> lock(mtxDone);
+         std::cout << message << std::endl;
+         remaining--;
+         cvDone.notify_one();
+      });
+   }
+
+   {
+      std::unique_lock<std::mutex> lock(mtxDone);
+      cvDone.wait(lock, [&remaining] { return remaining == 0; });
+   }
+   threadPool.Deinit();
+
+   auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+   std::cout << "Cooked " << sources.size() - failures << " of " << sources.size() << " textures in " << elapsed.count() << " ms on "
+      << std::thread::hardware_concurrency() << " threads." << std::endl;
+
+   return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
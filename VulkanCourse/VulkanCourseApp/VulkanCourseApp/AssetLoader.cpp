@@ -0,0 +1,883 @@
+#include <cstdlib>
+#include <cstring>
+
+// stb_image is compiled here so its allocations can be routed into staging memory.
+static void* DecodeMalloc(size_t size);
+static void* DecodeRealloc(void* ptr, size_t newSize);
+static void DecodeFree(void* ptr);
+
+#define STBI_MALLOC(sz)          DecodeMalloc(sz)
+#define STBI_REALLOC(p, newsz)   DecodeRealloc(p, newsz)
+#define STBI_FREE(p)             DecodeFree(p)
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "CookedName.h"
+
+#include <stdexcept>
+#include <exception>
+#include <fstream>
+#include <chrono>
+#include <unordered_map>
+#include <condition_variable>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+// xxHash64 primes.
+static const uint64_t HASH_PRIME_1 = 11400714785074694791ull;
+static const uint64_t HASH_PRIME_2 = 14029467366897019727ull;
+static const uint64_t HASH_PRIME_3 = 1609587929392839161ull;
+
+static uint64_t RotateLeft(uint64_t value, int bits)
+{
+   return (value << bits) | (value >> (64 - bits));
+}
+
+// xxHash64's avalanche, every input bit reaches every output bit.
+static uint64_t FinishHash(uint64_t hash)
+{
+   hash ^= hash >> 33;
+   hash *= HASH_PRIME_2;
+   hash ^= hash >> 29;
+   hash *= HASH_PRIME_3;
+   hash ^= hash >> 32;
+   return hash;
+}
+
+// Two 64 bit lanes over 8 byte words, each an xxHash64 style round with its own seed, rotation and multiplier order.
+// 128 bits is enough to trust a match between textures of the same shape and size without comparing the pixels, which
+// are long gone from the CPU once the first texture is uploaded. Still only memory bound over a decoded texture.
+static void HashBytes(uint64_t hash[2], const uint8_t* data, size_t size)
+{
+   size_t i = 0;
+   for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+   {
+      uint64_t word;
+      memcpy(&word, data + i, sizeof(word));
+      hash[0] = RotateLeft(hash[0] + word * HASH_PRIME_2, 31) * HASH_PRIME_1;
+      hash[1] = RotateLeft(hash[1] + word * HASH_PRIME_1, 27) * HASH_PRIME_2;
+   }
+   if (i < size)
+   {
+      // Tail padded with zeros, the size the caller mixes in tells it apart from real zeros.
+      uint64_t word = 0;
+      memcpy(&word, data + i, size - i);
+      hash[0] = RotateLeft(hash[0] + word * HASH_PRIME_2, 31) * HASH_PRIME_1;
+      hash[1] = RotateLeft(hash[1] + word * HASH_PRIME_1, 27) * HASH_PRIME_2;
+   }
+}
+
+// Staging memory the decode running on this thread should hand out for its final image.
+static thread_local struct
+{
+   stbi_uc* data;
+   size_t size;
+   size_t capacity;
+   bool armed;
+} t_decodeTarget = {};
+
+/***********************************************************
+** Decoder Allocation Hooks.
+***********************************************************/
+static void* DecodeMalloc(size_t size)
+{
+   // The output image is the allocation of width * height * 4 (plus the decoder's slack). Hand out the staging memory for it once.
+   if (t_decodeTarget.armed && size >= t_decodeTarget.size && size <= t_decodeTarget.capacity)
+   {
+      t_decodeTarget.armed = false;
+      return t_decodeTarget.data;
+   }
+
+   return malloc(size);
+}
+
+static void* DecodeRealloc(void* ptr, size_t newSize)
+{
+   if (ptr && ptr == t_decodeTarget.data)
+   {
+      // Staging memory can't grow, move the contents to the heap and free the target up again.
+      void* newPtr = malloc(newSize);
+      if (newPtr)
+      {
+         memcpy(newPtr, ptr, newSize < t_decodeTarget.capacity ? newSize : t_decodeTarget.capacity);
+         t_decodeTarget.armed = true;
+      }
+      return newPtr;
+   }
+
+   return realloc(ptr, newSize);
+}
+
+static void DecodeFree(void* ptr)
+{
+   if (ptr && ptr == t_decodeTarget.data)
+   {
+      // Decoder was done with it as a temporary, the next matching allocation can have it.
+      t_decodeTarget.armed = true;
+      return;
+   }
+
+   free(ptr);
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+AssetLoader::AssetLoader()
+{
+   m_iPendingCount = 0;
+}
+
+AssetLoader::~AssetLoader()
+{
+}
+
+void AssetLoader::Init(StagingAllocator allocateStaging, StagingRelease releaseStaging, FormatSupportQuery isFormatSupported,
+   const AssetPack* assetPack, uint32_t threadCount)
+{
+   m_pAssetPack = assetPack;
+   m_allocateStaging = allocateStaging;
+   m_releaseStaging = releaseStaging;
+   m_isFormatSupported = isFormatSupported;
+
+   m_threadPool.Init(threadCount);
+}
+
+void AssetLoader::Deinit()
+{
+   // Stop workers first so nothing is added to the completed list behind our back.
+   m_threadPool.Deinit();
+
+   // Release anything that was decoded but never uploaded.
+   for (auto& texture : m_vecCompletedTextures)
+   {
+      if (texture.staging.buffer != VK_NULL_HANDLE)
+      {
+         m_releaseStaging(texture.staging);
+      }
+   }
+   m_vecCompletedTextures.clear();
+   m_vecCompletedScenes.clear();
+   m_iPendingCount = 0;
+}
+
+void AssetLoader::QueueTexture(uint32_t texId, std::string fileName)
+{
+   m_iPendingCount++;
+
+   m_threadPool.Submit([this, texId, fileName]()
+   {
+      LoadedTexture texture = {};
+      texture.texId = texId;
+      texture.fileName = fileName;
+
+      try
+      {
+         // Header first, so the staging buffer can be sized before any pixels are decoded.
+         TextureContainer container = {};
+         ReadTextureHeader(&texture, &container);
+         texture.staging = m_allocateStaging(texture.imageSize + DECODE_SLACK);
+         LoadTexturePixels(texture, container, static_cast<uint8_t*>(texture.staging.mappedData));
+         HashTextureContent(&texture, static_cast<uint8_t*>(texture.staging.mappedData));
+      }
+      catch (const std::runtime_error& e)
+      {
+         // Leave staging empty, the render thread keeps the placeholder bound.
+         printf("ERROR: %s\n", e.what());
+
+         if (texture.staging.buffer != VK_NULL_HANDLE)
+         {
+            m_releaseStaging(texture.staging);
+            texture.staging = {};
+         }
+      }
+
+      std::lock_guard<std::mutex> lock(m_mtxCompleted);
+      m_vecCompletedTextures.push_back(texture);
+      m_iPendingCount--;
+   });
+}
+
+std::vector<LoadedTexture> AssetLoader::TakeCompletedTextures()
+{
+   std::vector<LoadedTexture> completed;
+
+   std::lock_guard<std::mutex> lock(m_mtxCompleted);
+   completed.swap(m_vecCompletedTextures);
+
+   return completed;
+}
+
+std::vector<LoadedTexture> AssetLoader::LoadTextures(const std::vector<std::string>& fileNames)
+{
+   std::vector<LoadedTexture> textures(fileNames.size());
+   if (textures.empty())
+   {
+      return textures;
+   }
+
+   // Read every header so the whole batch can be laid out in one staging buffer.
+   std::vector<TextureContainer> containers(fileNames.size());
+   RunParallel(textures.size(), [this, &textures, &containers, &fileNames](size_t i)
+   {
+      textures[i].texId = static_cast<uint32_t>(i);
+      textures[i].fileName = fileNames[i];
+      ReadTextureHeader(&textures[i], &containers[i]);
+   });
+
+   // Images go back to back, each with room for the decoder's slack so parallel decodes never overlap.
+   VkDeviceSize totalSize = 0;
+   for (auto& texture : textures)
+   {
+      totalSize = AlignUp(totalSize, STAGING_LEVEL_ALIGNMENT);
+      for (auto& level : texture.levels)
+      {
+         level.offset += totalSize;
+      }
+      totalSize += texture.imageSize + DECODE_SLACK;
+   }
+
+   StagingTarget staging = m_allocateStaging(totalSize);
+
+   // A job per texture, except compressed packed textures that keep their blocks. Those get a job per chunk,
+   // so one large texture unpacks on several workers instead of holding up the batch on one.
+   struct PixelJob
+   {
+      size_t texture;
+      const PackEntry* entry;    // Set for a single chunk job.
+      uint32_t chunk;
+   };
+   std::vector<PixelJob> jobs;
+   for (size_t i = 0; i < textures.size(); i++)
+   {
+      textures[i].staging = staging;
+
+      const PackEntry* entry = containers[i].levels.empty() || textures[i].format != containers[i].format ? nullptr
+         : m_pAssetPack->Find(TEXTURE_DIRECTORY + textures[i].fileName);
+      if (!entry || entry->chunkCount < 2)
+      {
+         jobs.push_back({ i, nullptr, 0 });
+         continue;
+      }
+
+      // Levels sit back to back in the file, so every chunk between the first and last level byte holds some.
+      uint64_t start = UINT64_MAX, end = 0;
+      for (auto& level : containers[i].levels)
+      {
+         start = std::min(start, level.fileOffset);
+         end = std::max(end, level.fileOffset + level.size);
+      }
+      for (uint64_t chunk = start / m_pAssetPack->GetChunkSize(); chunk * m_pAssetPack->GetChunkSize() < end; chunk++)
+      {
+         jobs.push_back({ i, entry, static_cast<uint32_t>(chunk) });
+      }
+   }
+
+   // Each worker decodes straight into its own region of the mapping.
+   try
+   {
+      RunParallel(jobs.size(), [this, &jobs, &textures, &containers, &staging](size_t j)
+      {
+         const PixelJob& job = jobs[j];
+         uint8_t* base = static_cast<uint8_t*>(staging.mappedData);
+         if (job.entry)
+         {
+            LoadPackedChunk(textures[job.texture], containers[job.texture], job.entry, job.chunk, base);
+         }
+         else
+         {
+            LoadTexturePixels(textures[job.texture], containers[job.texture], base);
+         }
+      });
+
+      RunParallel(textures.size(), [this, &textures, &staging](size_t i)
+      {
+         HashTextureContent(&textures[i], static_cast<uint8_t*>(staging.mappedData));
+      });
+   }
+   catch (const std::runtime_error&)
+   {
+      // Batch is all or nothing, same as loading the files one at a time would be.
+      m_releaseStaging(staging);
+      throw;
+   }
+
+   return textures;
+}
+
+ImportedScene AssetLoader::LoadModels(const std::vector<std::string>& fileNames)
+{
+   return ImportModels(fileNames, true);
+}
+
+void AssetLoader::QueueModels(uint32_t requestId, std::vector<std::string> fileNames)
+{
+   m_iPendingCount++;
+
+   m_threadPool.Submit([this, requestId, fileNames]()
+   {
+      LoadedScene loaded = {};
+      loaded.requestId = requestId;
+      loaded.fileNames = fileNames;
+
+      try
+      {
+         // A worker must not wait on the other workers, they could all be doing the same. So every step runs right here.
+         loaded.scene = ImportModels(fileNames, false);
+      }
+      catch (const std::runtime_error& e)
+      {
+         // Leave the scene empty, the render thread keeps the placeholder in the meshes' place.
+         printf("ERROR: %s\n", e.what());
+      }
+
+      std::lock_guard<std::mutex> lock(m_mtxCompleted);
+      m_vecCompletedScenes.push_back(std::move(loaded));
+      m_iPendingCount--;
+   });
+}
+
+std::vector<LoadedScene> AssetLoader::TakeCompletedScenes()
+{
+   std::vector<LoadedScene> completed;
+
+   std::lock_guard<std::mutex> lock(m_mtxCompleted);
+   completed.swap(m_vecCompletedScenes);
+
+   return completed;
+}
+
+uint32_t AssetLoader::GetPendingCount()
+{
+   return m_iPendingCount;
+}
+
+/***********************************************************
+** Private Functions.
+***********************************************************/
+ImportedScene AssetLoader::ImportModels(const std::vector<std::string>& fileNames, bool parallel)
+{
+   auto run = [this, parallel](size_t count, const std::function<void(size_t)>& job)
+   {
+      if (parallel)
+      {
+         RunParallel(count, job);
+         return;
+      }
+
+      for (size_t i = 0; i < count; i++)
+      {
+         job(i);
+      }
+   };
+
+   // A file named more than once is imported once and copied, two workers must never write the same cache file.
+   std::vector<std::string> uniqueNames;
+   std::vector<size_t> uniqueIndices(fileNames.size());
+   std::unordered_map<std::string, size_t> seen;
+   for (size_t i = 0; i < fileNames.size(); i++)
+   {
+      auto inserted = seen.emplace(fileNames[i], uniqueNames.size());
+      if (inserted.second)
+      {
+         uniqueNames.push_back(fileNames[i]);
+      }
+      uniqueIndices[i] = inserted.first->second;
+   }
+
+   if (uniqueNames.size() < fileNames.size())
+   {
+      ImportedScene scene = ImportModels(uniqueNames, parallel);
+      std::vector<ImportedModel> uniqueModels = std::move(scene.models);
+      scene.models.resize(fileNames.size());
+      for (size_t i = 0; i < fileNames.size(); i++)
+      {
+         scene.models[i] = uniqueModels[uniqueIndices[i]];
+      }
+      return scene;
+   }
+
+   auto startTime = std::chrono::steady_clock::now();
+
+   ImportedScene scene = {};
+   scene.models.resize(fileNames.size());
+
+   // Loose model files with an up to date mesh cache beside them are copied out of its mapping instead of parsed.
+   // Packed models are always parsed, the pack is cooked once and the cache is only for iterating on loose files.
+   std::vector<AssetBytes> files(fileNames.size());
+   std::vector<uint64_t> sourceSizes(fileNames.size());
+   std::vector<int64_t> sourceTimes(fileNames.size());
+   std::vector<char> cacheable(fileNames.size());
+   run(files.size(), [this, &files, &fileNames, &sourceSizes, &sourceTimes, &cacheable, &scene](size_t i)
+   {
+      std::string assetPath = MODEL_DIRECTORY + fileNames[i];
+      if (!m_pAssetPack->Find(assetPath) && GetFileStamp(assetPath, &sourceSizes[i], &sourceTimes[i]))
+      {
+         cacheable[i] = true;
+
+         MeshCache cache;
+         if (cache.Open(assetPath + MESH_CACHE_EXTENSION, sourceSizes[i], sourceTimes[i]))
+         {
+            scene.models[i] = cache.ToModel();
+            return;
+         }
+      }
+
+      files[i] = m_pAssetPack->Read(assetPath);
+   });
+
+   // OBJ files get a job per piece, glTF files one job each. The pieces of a file are joined once all of them are parsed.
+   struct ParseJob
+   {
+      size_t file;
+      size_t begin;
+      size_t end;
+      size_t chunk;              // Index into the file's chunks, unused for glTF.
+   };
+   std::vector<ParseJob> jobs;
+   std::vector<std::vector<ObjChunk>> objChunks(fileNames.size());
+   for (size_t i = 0; i < fileNames.size(); i++)
+   {
+      if (scene.models[i].fromCache)
+      {
+         continue;
+      }
+
+      if (IsObjFile(fileNames[i]))
+      {
+         auto ranges = SplitObjChunks(files[i].Data(), static_cast<size_t>(files[i].size), OBJ_CHUNK_SIZE);
+         objChunks[i].resize(ranges.size());
+         for (size_t c = 0; c < ranges.size(); c++)
+         {
+            jobs.push_back({ i, ranges[c].first, ranges[c].second, c });
+         }
+      }
+      else if (IsGltfFile(fileNames[i]))
+      {
+         jobs.push_back({ i, 0, static_cast<size_t>(files[i].size), 0 });
+      }
+      else
+      {
+         throw std::runtime_error("Unsupported model file! (" + fileNames[i] + ")");
+      }
+   }
+
+   run(jobs.size(), [this, &jobs, &files, &fileNames, &objChunks, &scene](size_t j)
+   {
+      const ParseJob& job = jobs[j];
+      const char* text = reinterpret_cast<const char*>(files[job.file].Data());
+      if (IsObjFile(fileNames[job.file]))
+      {
+         objChunks[job.file][job.chunk] = ParseObjChunk(text + job.begin, text + job.end);
+      }
+      else
+      {
+         scene.models[job.file] = ParseGltf(files[job.file].Data(), static_cast<size_t>(files[job.file].size),
+            MODEL_DIRECTORY + fileNames[job.file], *m_pAssetPack);
+      }
+   });
+
+   run(fileNames.size(), [this, &fileNames, &objChunks, &scene](size_t i)
+   {
+      if (IsObjFile(fileNames[i]) && !scene.models[i].fromCache)
+      {
+         scene.models[i] = BuildObjModel(objChunks[i], MODEL_DIRECTORY + fileNames[i], *m_pAssetPack);
+      }
+   });
+
+   // Freshly parsed models are welded and reordered for the vertex cache and overdraw, then get their bounds, levels of detail,
+   // meshlets of every level and a cache for next time.
+   // A cache that can't be written is simply skipped.
+   run(fileNames.size(), [&files, &fileNames, &sourceSizes, &sourceTimes, &cacheable, &scene](size_t i)
+   {
+      ImportedModel& model = scene.models[i];
+      if (model.fromCache)
+      {
+         return;
+      }
+
+      model.bytesRead += files[i].size;
+      for (auto& mesh : model.meshes)
+      {
+         // Exporters often write every corner as its own vertex, which no cache order can help.
+         model.weld.Add(WeldVertices(&mesh.vertices, &mesh.indices));
+
+         VertexCacheStats before;
+         VertexCacheStats after;
+         OptimizeMesh(&mesh.vertices, &mesh.indices, &before, &after);
+         model.vertexCacheBefore.Add(before);
+         model.vertexCacheAfter.Add(after);
+
+         ComputeMeshBounds(&mesh);
+         GenerateMeshLods(mesh.vertices, &mesh.indices, &mesh.lods);
+
+         mesh.meshlets.clear();
+         for (MeshLod& lod : mesh.lods)
+         {
+            std::vector<Meshlet> lodMeshlets = BuildMeshlets(mesh.vertices, mesh.indices, lod.firstIndex, lod.indexCount);
+            lod.firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+            lod.meshletCount = static_cast<uint32_t>(lodMeshlets.size());
+            mesh.meshlets.insert(mesh.meshlets.end(), lodMeshlets.begin(), lodMeshlets.end());
+         }
+      }
+
+      if (cacheable[i])
+      {
+         WriteMeshCache(MODEL_DIRECTORY + fileNames[i] + MESH_CACHE_EXTENSION, model, sourceSizes[i], sourceTimes[i]);
+      }
+   });
+
+   // Textures are loaded by name from TEXTURE_DIRECTORY. References into it keep their sub path, any other
+   // directory is dropped and the file is expected there under its own name.
+   std::unordered_map<std::string, uint32_t> textureIndices;
+   for (size_t i = 0; i < scene.models.size(); i++)
+   {
+      ImportedModel& model = scene.models[i];
+      model.fileName = fileNames[i];
+      scene.bytesRead += model.bytesRead;
+      scene.cachedModels += model.fromCache ? 1 : 0;
+      scene.weld.Add(model.weld);
+      scene.vertexCacheBefore.Add(model.vertexCacheBefore);
+      scene.vertexCacheAfter.Add(model.vertexCacheAfter);
+
+      for (auto& mesh : model.meshes)
+      {
+         if (mesh.texturePath.empty())
+         {
+            continue;
+         }
+
+         std::string textureFile = mesh.texturePath.compare(0, TEXTURE_DIRECTORY.size(), TEXTURE_DIRECTORY) == 0
+            ? mesh.texturePath.substr(TEXTURE_DIRECTORY.size()) : mesh.texturePath.substr(mesh.texturePath.find_last_of('/') + 1);
+
+         auto found = textureIndices.emplace(textureFile, static_cast<uint32_t>(scene.textureFiles.size()));
+         if (found.second)
+         {
+            scene.textureFiles.push_back(textureFile);
+         }
+         mesh.textureIndex = found.first->second;
+      }
+   }
+
+   scene.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+   return scene;
+}
+
+void AssetLoader::ReadTextureInfo(const std::string& fileName, int* width, int* height, VkDeviceSize* imageSize)
+{
+   // Number of channels image uses.
+   int channels;
+
+   // Only parse the header, no pixel data is decoded. Packed files are parsed straight from the mapping.
+   // (images hardly compress, so the cooker stores them as they are)
+   std::string fileLoc = TEXTURE_DIRECTORY + fileName;
+   int result;
+   if (m_pAssetPack->Find(fileLoc))
+   {
+      AssetBytes packed = m_pAssetPack->Read(fileLoc);
+      result = stbi_info_from_memory(packed.Data(), static_cast<int>(packed.size), width, height, &channels);
+   }
+   else
+   {
+      result = stbi_info(fileLoc.c_str(), width, height, &channels);
+   }
+   if (!result)
+   {
+      throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+   }
+
+   // Calculate image size using given and known data. Always decoded to RGBA.
+   *imageSize = static_cast<VkDeviceSize>(*width) * static_cast<VkDeviceSize>(*height) * 4;
+}
+
+void AssetLoader::DecodeTextureFile(const std::string& fileName, stbi_uc* target, VkDeviceSize imageSize)
+{
+   // Number of channels image uses.
+   int channels;
+   int width, height;
+
+   // Arm the allocation hooks so the decoder builds its output in the target.
+   t_decodeTarget.data = target;
+   t_decodeTarget.size = static_cast<size_t>(imageSize);
+   t_decodeTarget.capacity = static_cast<size_t>(imageSize + DECODE_SLACK);
+   t_decodeTarget.armed = true;
+
+   // Load pixel data for image.
+   std::string fileLoc = TEXTURE_DIRECTORY + fileName;
+   stbi_uc* image;
+   if (m_pAssetPack->Find(fileLoc))
+   {
+      AssetBytes packed = m_pAssetPack->Read(fileLoc);
+      image = stbi_load_from_memory(packed.Data(), static_cast<int>(packed.size), &width, &height, &channels, STBI_rgb_alpha);
+   }
+   else
+   {
+      image = stbi_load(fileLoc.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+   }
+
+   t_decodeTarget = {};
+
+   if (!image)
+   {
+      throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+   }
+
+   VkDeviceSize decodedSize = static_cast<VkDeviceSize>(width) * static_cast<VkDeviceSize>(height) * 4;
+   if (decodedSize != imageSize)
+   {
+      if (image != target)
+      {
+         stbi_image_free(image);
+      }
+      throw std::runtime_error("Texture file changed size while loading! (" + fileName + ")");
+   }
+
+   // Decoders that finish in a temporary of their own (e.g. channel conversion) still need one copy.
+   if (image != target)
+   {
+      memcpy(target, image, static_cast<size_t>(imageSize));
+      stbi_image_free(image);
+   }
+}
+
+void AssetLoader::RunParallel(size_t count, const std::function<void(size_t)>& job)
+{
+   std::mutex mtxDone;
+   std::condition_variable cvDone;
+   size_t remaining = count;
+   std::exception_ptr error;
+
+   // One job per index, each worker writes only to its own slot.
+   for (size_t i = 0; i < count; i++)
+   {
+      m_threadPool.Submit([&job, &mtxDone, &cvDone, &remaining, &error, i]()
+      {
+         // Whatever a job throws goes back to the caller, nothing may escape into the pool's worker.
+         std::exception_ptr jobError;
+         try
+         {
+            job(i);
+         }
+         catch (...)
+         {
+            jobError = std::current_exception();
+         }
+
+         // Notify while holding the lock, the waiter owns these and may return as soon as it sees zero.
+         std::lock_guard<std::mutex> lock(mtxDone);
+         if (jobError && !error)
+         {
+            error = jobError;
+         }
+         remaining--;
+         cvDone.notify_one();
+      });
+   }
+
+   std::unique_lock<std::mutex> lock(mtxDone);
+   cvDone.wait(lock, [&remaining] { return remaining == 0; });
+
+   // The first failure, as it was thrown.
+   if (error)
+   {
+      std::rethrow_exception(error);
+   }
+}
+
+void AssetLoader::ReadTextureHeader(LoadedTexture* texture, TextureContainer* container)
+{
+   // A file cooked by the AssetCooker sits beside its source image, prefer it so nothing is decoded or resampled here.
+   if (!IsTextureContainer(texture->fileName))
+   {
+      std::string cookedName = CookedFileName(texture->fileName);
+      if (m_pAssetPack->Exists(TEXTURE_DIRECTORY + cookedName))
+      {
+         texture->fileName = cookedName;
+      }
+   }
+
+   if (!IsTextureContainer(texture->fileName))
+   {
+      // Ordinary image, decoded to a single RGBA8 level. Mips are generated on the GPU.
+      ReadTextureInfo(texture->fileName, &texture->width, &texture->height, &texture->imageSize);
+      texture->format = VK_FORMAT_R8G8B8A8_UNORM;
+      texture->levels = { { 0, texture->imageSize, static_cast<uint32_t>(texture->width), static_cast<uint32_t>(texture->height) } };
+      return;
+   }
+
+   std::string fileLoc = TEXTURE_DIRECTORY + texture->fileName;
+   const PackEntry* entry = m_pAssetPack->Find(fileLoc);
+   if (entry)
+   {
+      // Only the leading bytes are parsed, a compressed file unpacks just its first chunk for them.
+      std::vector<uint8_t> header(static_cast<size_t>(std::min<uint64_t>(entry->size, CONTAINER_HEADER_READ_SIZE)));
+      m_pAssetPack->ReadRange(entry, 0, header.size(), header.data());
+      *container = ReadContainerHeader(header.data(), header.size(), entry->size, texture->fileName);
+   }
+   else
+   {
+      *container = ReadContainerHeader(fileLoc);
+   }
+   texture->width = static_cast<int>(container->width);
+   texture->height = static_cast<int>(container->height);
+
+   // Upload the blocks as they are if the device can sample them, otherwise decode every level to RGBA8.
+   bool keepBlocks = m_isFormatSupported(container->format);
+   texture->format = keepBlocks ? container->format : DecodedFormat(container->format);
+
+   VkDeviceSize offset = 0;
+   texture->levels.clear();
+   for (auto& containerLevel : container->levels)
+   {
+      TextureLevel level = {};
+      level.offset = AlignUp(offset, STAGING_LEVEL_ALIGNMENT);
+      level.size = keepBlocks ? containerLevel.size : static_cast<VkDeviceSize>(containerLevel.width) * containerLevel.height * 4;
+      level.width = containerLevel.width;
+      level.height = containerLevel.height;
+      texture->levels.push_back(level);
+
+      offset = level.offset + level.size;
+   }
+   texture->imageSize = offset;
+}
+
+void AssetLoader::LoadTexturePixels(const LoadedTexture& texture, const TextureContainer& container, uint8_t* base)
+{
+   if (container.levels.empty())
+   {
+      DecodeTextureFile(texture.fileName, base + texture.levels[0].offset, texture.imageSize);
+      return;
+   }
+
+   bool keepBlocks = texture.format == container.format;
+
+   std::vector<char> blocks;
+
+   // Packed containers are copied (or unpacked) straight from the mapping into staging.
+   const PackEntry* entry = m_pAssetPack->Find(TEXTURE_DIRECTORY + texture.fileName);
+   if (entry)
+   {
+      const uint8_t* stored = m_pAssetPack->GetStoredData(entry);
+      for (size_t i = 0; i < container.levels.size(); i++)
+      {
+         const ContainerLevel& containerLevel = container.levels[i];
+         uint8_t* target = base + texture.levels[i].offset;
+         if (keepBlocks)
+         {
+            m_pAssetPack->ReadRange(entry, containerLevel.fileOffset, containerLevel.size, target);
+            continue;
+         }
+
+         // CPU decode reads the blocks in place when they are stored uncompressed.
+         const uint8_t* source = stored ? stored + containerLevel.fileOffset : nullptr;
+         if (!source)
+         {
+            blocks.resize(static_cast<size_t>(containerLevel.size));
+            m_pAssetPack->ReadRange(entry, containerLevel.fileOffset, containerLevel.size, reinterpret_cast<uint8_t*>(blocks.data()));
+            source = reinterpret_cast<const uint8_t*>(blocks.data());
+         }
+         DecodeBlockImage(ToBlockFormat(container.format), source, containerLevel.width, containerLevel.height, target);
+      }
+      return;
+   }
+
+   std::ifstream file(TEXTURE_DIRECTORY + texture.fileName, std::ios::binary);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to load a Texture file! (" + texture.fileName + ")");
+   }
+
+   for (size_t i = 0; i < container.levels.size(); i++)
+   {
+      const ContainerLevel& containerLevel = container.levels[i];
+      uint8_t* target = base + texture.levels[i].offset;
+
+      // Blocks the device can sample are read straight into staging, the rest go through a CPU decode.
+      char* readTarget = reinterpret_cast<char*>(target);
+      if (!keepBlocks)
+      {
+         blocks.resize(static_cast<size_t>(containerLevel.size));
+         readTarget = blocks.data();
+      }
+
+      file.seekg(static_cast<std::streamoff>(containerLevel.fileOffset));
+      file.read(readTarget, static_cast<std::streamsize>(containerLevel.size));
+      if (!file)
+      {
+         throw std::runtime_error("Texture container is truncated! (" + texture.fileName + ")");
+      }
+
+      if (!keepBlocks)
+      {
+         DecodeBlockImage(ToBlockFormat(container.format), reinterpret_cast<const uint8_t*>(blocks.data()),
+            containerLevel.width, containerLevel.height, target);
+      }
+   }
+}
+
+void AssetLoader::LoadPackedChunk(const LoadedTexture& texture, const TextureContainer& container, const PackEntry* entry, uint32_t chunk,
+   uint8_t* base)
+{
+   uint64_t chunkStart = static_cast<uint64_t>(chunk) * m_pAssetPack->GetChunkSize();
+   uint64_t chunkEnd = std::min<uint64_t>(chunkStart + m_pAssetPack->GetChunkSize(), entry->size);
+
+   // Unpacked once, into the level it belongs to if it lies wholly inside one, otherwise into scratch for several copies.
+   std::vector<uint8_t> scratch;
+   for (size_t i = 0; i < container.levels.size(); i++)
+   {
+      const ContainerLevel& containerLevel = container.levels[i];
+      uint64_t start = std::max(containerLevel.fileOffset, chunkStart);
+      uint64_t end = std::min(containerLevel.fileOffset + containerLevel.size, chunkEnd);
+      if (start >= end)
+      {
+         continue;
+      }
+
+      uint8_t* target = base + texture.levels[i].offset + (start - containerLevel.fileOffset);
+      if (start == chunkStart && end == chunkEnd)
+      {
+         m_pAssetPack->UnpackChunk(entry, chunk, target);
+         continue;
+      }
+
+      if (scratch.empty())
+      {
+         scratch.resize(static_cast<size_t>(chunkEnd - chunkStart));
+         m_pAssetPack->UnpackChunk(entry, chunk, scratch.data());
+      }
+      memcpy(target, scratch.data() + (start - chunkStart), static_cast<size_t>(end - start));
+   }
+}
+
+void AssetLoader::HashTextureContent(LoadedTexture* texture, const uint8_t* base)
+{
+   TextureContent& content = texture->content;
+   content.width = static_cast<uint32_t>(texture->width);
+   content.height = static_cast<uint32_t>(texture->height);
+   content.format = static_cast<uint32_t>(texture->format);
+   content.size = 0;
+
+   // Shape and format go in first, the same bytes read as another format are different pixels.
+   uint64_t shape[3] = { content.width, content.height, content.format };
+   uint64_t hash[2] = { HASH_PRIME_1 + HASH_PRIME_2, HASH_PRIME_3 };
+   HashBytes(hash, reinterpret_cast<const uint8_t*>(shape), sizeof(shape));
+
+   for (auto& level : texture->levels)
+   {
+      HashBytes(hash, base + level.offset, static_cast<size_t>(level.size));
+      content.size += level.size;
+   }
+
+   content.hash[0] = FinishHash(hash[0] + content.size);
+   content.hash[1] = FinishHash(hash[1] ^ content.size);
+
+   // Empty is kept for "no pixels".
+   if (content.IsEmpty())
+   {
+      content.hash[0] = 1;
+   }
+}
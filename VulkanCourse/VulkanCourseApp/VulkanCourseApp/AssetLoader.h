@@ -0,0 +1,140 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include "stb_image.h"
+
+#include "ThreadPool.h"
+#include "TextureContainer.h"
+#include "AssetPack.h"
+#include "MeshImport.h"
+#include "TextureCache.h"
+
+// Extra bytes reserved after each decoded image. The JPEG decoder allocates one byte past the image,
+// rounding up to a whole texel keeps the next image's staging offset 4 byte aligned.
+const VkDeviceSize DECODE_SLACK = 4;
+
+// Alignment of every level in staging. Covers copies of BC blocks (8 / 16 bytes) as well as RGBA8 texels.
+const VkDeviceSize STAGING_LEVEL_ALIGNMENT = 16;
+
+// Texture file names are relative to this, both loose and inside the asset pack.
+const std::string TEXTURE_DIRECTORY = "Textures/";
+
+// Mapped, host visible buffer that a decoder writes pixels straight into.
+struct StagingTarget
+{
+   VkBuffer buffer;           // Buffer to copy from once decoding is done.
+   VkDeviceMemory memory;     // Memory bound to the buffer.
+   void* mappedData;          // Host pointer to the start of the mapped memory.
+};
+
+// Supplied by the owner of the device. Both can be called from any worker thread.
+using StagingAllocator = std::function<StagingTarget(VkDeviceSize size)>;
+using StagingRelease = std::function<void(const StagingTarget& staging)>;
+// Whether the device can sample a format directly. Block formats it can't are decoded on the CPU.
+using FormatSupportQuery = std::function<bool(VkFormat format)>;
+
+// One mip level waiting in staging.
+struct TextureLevel
+{
+   VkDeviceSize offset;       // Where the level starts in the staging buffer.
+   VkDeviceSize size;         // Size of the level in bytes.
+   uint32_t width;            // Width of level in pixels.
+   uint32_t height;           // Height of level in pixels.
+};
+
+// Decoded texture waiting to be uploaded by the render thread.
+struct LoadedTexture
+{
+   uint32_t texId;               // Texture slot the result belongs to.
+   std::string fileName;         // File the texture was loaded from.
+   int width;                    // Width of image in pixels.
+   int height;                   // Height of image in pixels.
+   VkDeviceSize imageSize;       // Size of every level in bytes, including alignment between levels.
+   VkFormat format;              // Format of the data in staging. (RGBA8 or a BC block format)
+   std::vector<TextureLevel> levels;   // Levels in staging, largest first. Images hold just level 0.
+   StagingTarget staging;        // Staging memory holding the pixels, empty if the load failed.
+   TextureContent content;       // Shape, format, size and hash of the levels in staging, never empty for a loaded texture.
+};
+
+// Imported models waiting to be turned into meshes by the render thread.
+struct LoadedScene
+{
+   uint32_t requestId;                    // Request the result belongs to.
+   std::vector<std::string> fileNames;    // Files the models were loaded from.
+   ImportedScene scene;                   // No models if the import failed.
+};
+
+class AssetLoader
+{
+public:
+   AssetLoader();
+   ~AssetLoader();
+
+   // Files are read from the pack when it holds them, loose files otherwise. The pack must outlive the loader.
+   void Init(StagingAllocator allocateStaging, StagingRelease releaseStaging, FormatSupportQuery isFormatSupported,
+      const AssetPack* assetPack, uint32_t threadCount = 0);
+   void Deinit();
+
+   // Queue a file to be read and decoded on a worker thread. .ktx2 / .dds files keep their BC blocks if the device supports them.
+   void QueueTexture(uint32_t texId, std::string fileName);
+
+   // Hand over every texture that finished decoding since the last call.
+   std::vector<LoadedTexture> TakeCompletedTextures();
+
+   // Decode a batch of files across all workers into one shared staging buffer and wait for every one to finish.
+   std::vector<LoadedTexture> LoadTextures(const std::vector<std::string>& fileNames);
+
+   // Read and parse a batch of model files across all workers, large OBJ files in several pieces, and wait for every one.
+   // Each texture the models use is listed once, and the meshes refer to it by index. A file named twice gets two models.
+   ImportedScene LoadModels(const std::vector<std::string>& fileNames);
+
+   // Queue a batch of model files to be imported on a worker thread, the same steps as LoadModels but one after another.
+   void QueueModels(uint32_t requestId, std::vector<std::string> fileNames);
+
+   // Hand over every batch of models that finished importing since the last call.
+   std::vector<LoadedScene> TakeCompletedScenes();
+
+   uint32_t GetPendingCount();
+
+private:
+   // -- Loader Functions.
+   void ReadTextureInfo(const std::string& fileName, int* width, int* height, VkDeviceSize* imageSize);
+   // Target must have room for imageSize + DECODE_SLACK bytes.
+   void DecodeTextureFile(const std::string& fileName, stbi_uc* target, VkDeviceSize imageSize);
+
+   // Run job(0) .. job(count - 1) on the workers and wait for all of them. Rethrows the first failure.
+   void RunParallel(size_t count, const std::function<void(size_t)>& job);
+   // LoadModels, with its steps spread across the workers or run in turn on the calling thread.
+   ImportedScene ImportModels(const std::vector<std::string>& fileNames, bool parallel);
+
+   // Fill in size, format and level layout (offsets from 0) without touching the pixels.
+   void ReadTextureHeader(LoadedTexture* texture, TextureContainer* container);
+   // Write every level of the texture into the staging memory at base.
+   void LoadTexturePixels(const LoadedTexture& texture, const TextureContainer& container, uint8_t* base);
+   // Hash what ended up in staging, so identical pixels from different files can share one image.
+   void HashTextureContent(LoadedTexture* texture, const uint8_t* base);
+   // Write the parts of a packed texture's levels that lie in one compressed chunk. Blocks are kept as they are.
+   void LoadPackedChunk(const LoadedTexture& texture, const TextureContainer& container, const PackEntry* entry, uint32_t chunk,
+      uint8_t* base);
+
+   ThreadPool m_threadPool;
+
+   StagingAllocator m_allocateStaging;
+   StagingRelease m_releaseStaging;
+   FormatSupportQuery m_isFormatSupported;
+   const AssetPack* m_pAssetPack = nullptr;
+
+   std::mutex m_mtxCompleted;
+   std::vector<LoadedTexture> m_vecCompletedTextures;
+   std::vector<LoadedScene> m_vecCompletedScenes;
+
+   std::atomic<uint32_t> m_iPendingCount;
+};
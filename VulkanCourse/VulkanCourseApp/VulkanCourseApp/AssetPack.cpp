@@ -0,0 +1,269 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "LzCompression.h"
+
+// True if [offset, offset + length) lies inside a file of the given size, without overflowing.
+static bool InBounds(uint64_t offset, uint64_t length, uint64_t size)
+{
+   return offset <= size && length <= size - offset;
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+AssetPack::AssetPack()
+{
+}
+
+AssetPack::~AssetPack()
+{
+   Close();
+}
+
+bool AssetPack::Open(const std::string& packPath)
+{
+   Close();
+
+   if (!m_mappedFile.Open(packPath))
+   {
+      return false;
+   }
+
+   const uint8_t* data = m_mappedFile.GetData();
+   uint64_t size = m_mappedFile.GetSize();
+
+   // Check everything the lookups will trust up front, so a bad pack fails here and not on a later read.
+   PackHeader header;
+   if (size < sizeof(header))
+   {
+      Close();
+      throw std::runtime_error("Asset pack is too small! (" + packPath + ")");
+   }
+   memcpy(&header, data, sizeof(header));
+
+   if (memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != PACK_VERSION)
+   {
+      Close();
+      throw std::runtime_error("Not an asset pack or the wrong version! (" + packPath + ")");
+   }
+
+   uint64_t tocSize = static_cast<uint64_t>(header.entryCount) * sizeof(PackEntry);
+   uint64_t chunkTableSize = static_cast<uint64_t>(header.chunkCount) * sizeof(PackChunk);
+   if (header.tocOffset % alignof(PackEntry) != 0 || !InBounds(header.tocOffset, tocSize, size) ||
+      header.chunkTableOffset % alignof(PackChunk) != 0 || !InBounds(header.chunkTableOffset, chunkTableSize, size) ||
+      !InBounds(header.stringTableOffset, header.stringTableSize, size))
+   {
+      Close();
+      throw std::runtime_error("Asset pack table of contents is out of bounds! (" + packPath + ")");
+   }
+
+   if (header.chunkSize == 0 || header.chunkSize > PACK_MAX_CHUNK_SIZE)
+   {
+      Close();
+      throw std::runtime_error("Asset pack chunk size is invalid! (" + packPath + ")");
+   }
+
+   m_pEntries = reinterpret_cast<const PackEntry*>(data + header.tocOffset);
+   m_pChunks = reinterpret_cast<const PackChunk*>(data + header.chunkTableOffset);
+   m_pStringTable = reinterpret_cast<const char*>(data + header.stringTableOffset);
+   m_iEntryCount = header.entryCount;
+   m_iChunkSize = header.chunkSize;
+
+   for (uint32_t i = 0; i < m_iEntryCount; i++)
+   {
+      const PackEntry& entry = m_pEntries[i];
+      if (!InBounds(entry.nameOffset, entry.nameLength, header.stringTableSize))
+      {
+         Close();
+         throw std::runtime_error("Asset pack entry is out of bounds! (" + packPath + ")");
+      }
+
+      // Stored payloads are handed out in place and read as the structs they hold, the writer always aligns them.
+      if (entry.offset % PACK_ALIGNMENT != 0)
+      {
+         Close();
+         throw std::runtime_error("Asset pack entry is misaligned! (" + packPath + ")");
+      }
+
+      if (entry.chunkCount == 0)
+      {
+         if (!InBounds(entry.offset, entry.size, size))
+         {
+            Close();
+            throw std::runtime_error("Asset pack entry is out of bounds! (" + packPath + ")");
+         }
+         continue;
+      }
+
+      // Compressed, every chunk but the last is full and each one has to fit in the file.
+      uint64_t expectedChunks = (entry.size + m_iChunkSize - 1) / m_iChunkSize;
+      if (entry.chunkCount != expectedChunks || !InBounds(entry.firstChunk, entry.chunkCount, header.chunkCount))
+      {
+         Close();
+         throw std::runtime_error("Asset pack entry has a bad chunk range! (" + packPath + ")");
+      }
+
+      for (uint32_t c = 0; c < entry.chunkCount; c++)
+      {
+         const PackChunk& chunk = m_pChunks[entry.firstChunk + c];
+         if (chunk.storedSize > m_iChunkSize || !InBounds(chunk.offset, chunk.storedSize, size))
+         {
+            Close();
+            throw std::runtime_error("Asset pack chunk is out of bounds! (" + packPath + ")");
+         }
+      }
+   }
+
+   return true;
+}
+
+void AssetPack::Close()
+{
+   m_mappedFile.Close();
+   m_pEntries = nullptr;
+   m_pChunks = nullptr;
+   m_pStringTable = nullptr;
+   m_iEntryCount = 0;
+   m_iChunkSize = 0;
+}
+
+bool AssetPack::IsOpen() const
+{
+   return m_pEntries != nullptr;
+}
+
+const PackEntry* AssetPack::Find(const std::string& assetPath) const
+{
+   if (!IsOpen())
+   {
+      return nullptr;
+   }
+
+   uint64_t hash = HashAssetName(assetPath.data(), assetPath.size());
+   const PackEntry* end = m_pEntries + m_iEntryCount;
+   const PackEntry* entry = std::lower_bound(m_pEntries, end, hash,
+      [](const PackEntry& lhs, uint64_t value) { return lhs.nameHash < value; });
+
+   // Hashes can collide, the name decides.
+   for (; entry != end && entry->nameHash == hash; entry++)
+   {
+      if (entry->nameLength == assetPath.size() && memcmp(m_pStringTable + entry->nameOffset, assetPath.data(), assetPath.size()) == 0)
+      {
+         return entry;
+      }
+   }
+
+   return nullptr;
+}
+
+const uint8_t* AssetPack::GetStoredData(const PackEntry* entry) const
+{
+   return entry->chunkCount == 0 ? m_mappedFile.GetData() + entry->offset : nullptr;
+}
+
+uint32_t AssetPack::GetChunkSize() const
+{
+   return m_iChunkSize;
+}
+
+void AssetPack::UnpackChunk(const PackEntry* entry, uint32_t chunk, uint8_t* target) const
+{
+   const PackChunk& packChunk = m_pChunks[entry->firstChunk + chunk];
+   const uint8_t* stored = m_mappedFile.GetData() + packChunk.offset;
+
+   uint64_t chunkStart = static_cast<uint64_t>(chunk) * m_iChunkSize;
+   size_t unpackedSize = static_cast<size_t>(std::min<uint64_t>(m_iChunkSize, entry->size - chunkStart));
+
+   // Chunks that wouldn't shrink were left as they are.
+   if (packChunk.storedSize == unpackedSize)
+   {
+      memcpy(target, stored, unpackedSize);
+      return;
+   }
+
+   if (!LzDecompress(stored, packChunk.storedSize, target, unpackedSize))
+   {
+      throw std::runtime_error("Asset pack chunk is corrupt! (" + std::string(m_pStringTable + entry->nameOffset, entry->nameLength) + ")");
+   }
+}
+
+void AssetPack::ReadRange(const PackEntry* entry, uint64_t offset, uint64_t size, uint8_t* target) const
+{
+   if (offset > entry->size || size > entry->size - offset)
+   {
+      throw std::runtime_error("Read past the end of a packed asset! (" + std::string(m_pStringTable + entry->nameOffset, entry->nameLength) + ")");
+   }
+
+   const uint8_t* stored = GetStoredData(entry);
+   if (stored)
+   {
+      memcpy(target, stored + offset, static_cast<size_t>(size));
+      return;
+   }
+
+   // Chunks the range covers completely unpack straight into the target, partly covered ones go through scratch.
+   std::vector<uint8_t> scratch;
+   uint64_t end = offset + size;
+   while (offset < end)
+   {
+      uint32_t chunk = static_cast<uint32_t>(offset / m_iChunkSize);
+      uint64_t chunkStart = static_cast<uint64_t>(chunk) * m_iChunkSize;
+      uint64_t chunkEnd = std::min<uint64_t>(chunkStart + m_iChunkSize, entry->size);
+      uint64_t copyEnd = std::min(chunkEnd, end);
+
+      if (offset == chunkStart && copyEnd == chunkEnd)
+      {
+         UnpackChunk(entry, chunk, target);
+      }
+      else
+      {
+         scratch.resize(static_cast<size_t>(chunkEnd - chunkStart));
+         UnpackChunk(entry, chunk, scratch.data());
+         memcpy(target, scratch.data() + (offset - chunkStart), static_cast<size_t>(copyEnd - offset));
+      }
+
+      target += copyEnd - offset;
+      offset = copyEnd;
+   }
+}
+
+AssetBytes AssetPack::Read(const std::string& assetPath) const
+{
+   AssetBytes bytes = {};
+   const PackEntry* entry = Find(assetPath);
+   if (entry)
+   {
+      bytes.size = entry->size;
+      bytes.mappedData = GetStoredData(entry);
+      if (!bytes.mappedData)
+      {
+         bytes.storage.resize(static_cast<size_t>(bytes.size));
+         ReadRange(entry, 0, bytes.size, bytes.storage.data());
+      }
+      return bytes;
+   }
+
+   // Not packed, fall back to the loose file. (development builds)
+   std::ifstream file(assetPath, std::ios::binary | std::ios::ate);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to open a file! (" + assetPath + ")");
+   }
+
+   bytes.size = static_cast<uint64_t>(file.tellg());
+   bytes.storage.resize(static_cast<size_t>(bytes.size));
+   file.seekg(0);
+   file.read(reinterpret_cast<char*>(bytes.storage.data()), static_cast<std::streamsize>(bytes.size));
+
+   return bytes;
+}
+
+bool AssetPack::Exists(const std::string& assetPath) const
+{
+   return Find(assetPath) != nullptr || std::ifstream(assetPath).good();
+}
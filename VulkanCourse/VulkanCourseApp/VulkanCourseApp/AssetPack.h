@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PackFormat.h"
+#include "MappedFile.h"
+
+// Bytes of one asset. Points into the pack mapping when stored uncompressed, owns a copy otherwise.
+struct AssetBytes
+{
+   const uint8_t* mappedData;    // Start of the asset inside the pack mapping, null for loose files and compressed assets.
+   std::vector<uint8_t> storage; // Contents of a loose file or an unpacked asset.
+   uint64_t size;                // Size of the asset in bytes.
+
+   const uint8_t* Data() const { return mappedData ? mappedData : storage.data(); }
+};
+
+// Memory mapped archive of textures, meshes and SPIR-V. Lookups are read only, so any thread can use an open pack.
+class AssetPack
+{
+public:
+   AssetPack();
+   ~AssetPack();
+
+   // Returns false if there is no pack at the path. Throws if the file is there but isn't a valid pack.
+   bool Open(const std::string& packPath);
+   void Close();
+
+   bool IsOpen() const;
+
+   // Entry of an asset path such as "Textures/giraffe.ktx2", or nullptr if the pack doesn't hold it.
+   const PackEntry* Find(const std::string& assetPath) const;
+
+   // Payload of an entry stored uncompressed, read in place. nullptr if it has to be unpacked.
+   const uint8_t* GetStoredData(const PackEntry* entry) const;
+
+   // Unpacked size of an entry's chunks. (the last one may be shorter)
+   uint32_t GetChunkSize() const;
+   // Unpack one chunk of a compressed entry into target, which needs room for the chunk's unpacked size.
+   void UnpackChunk(const PackEntry* entry, uint32_t chunk, uint8_t* target) const;
+
+   // Copy bytes [offset, offset + size) of an entry into target, unpacking only the chunks they touch.
+   void ReadRange(const PackEntry* entry, uint64_t offset, uint64_t size, uint8_t* target) const;
+
+   // Packed bytes if the pack holds the asset, otherwise the loose file of the same path. Throws if neither exists.
+   AssetBytes Read(const std::string& assetPath) const;
+
+   // True if the asset is packed or exists as a loose file.
+   bool Exists(const std::string& assetPath) const;
+
+private:
+   MappedFile m_mappedFile;
+
+   // Point straight into the mapping.
+   const PackEntry* m_pEntries = nullptr;
+   const PackChunk* m_pChunks = nullptr;
+   const char* m_pStringTable = nullptr;
+   uint32_t m_iEntryCount = 0;
+   uint32_t m_iChunkSize = 0;
+};
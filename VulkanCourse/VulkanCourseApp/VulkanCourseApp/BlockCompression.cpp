@@ -0,0 +1,482 @@
+#include "BlockCompression.h"
+
+#include <cstring>
+
+/***********************************************************
+** BC7 Tables.
+***********************************************************/
+// Subset of each pixel for the 2 subset partitions, bit i set means pixel i is in subset 1.
+static const uint16_t BC7_PARTITIONS_2[64] = {
+   0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+   0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+   0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+   0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+   0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+   0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+   0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+   0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// Subset of each pixel for the 3 subset partitions.
+static const uint8_t BC7_PARTITIONS_3[64][16] = {
+   { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+   { 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+   { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+   { 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+   { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+   { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+   { 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+   { 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+   { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+   { 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+   { 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+   { 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+   { 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+   { 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+   { 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+   { 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+   { 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+   { 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+   { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+   { 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+   { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+   { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+   { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+   { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+   { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+   { 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+   { 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+   { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+   { 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+   { 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+   { 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+   { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+};
+
+// Anchor pixel (stored with one less index bit) of the second subset in 2 subset partitions.
+static const uint8_t BC7_ANCHORS_2[64] = {
+   15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+   15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+   15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+    6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+// Anchor pixels of the second and third subsets in 3 subset partitions.
+static const uint8_t BC7_ANCHORS_3_SECOND[64] = {
+    3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+    3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+    8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+    3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+};
+
+static const uint8_t BC7_ANCHORS_3_THIRD[64] = {
+   15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+   15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+   15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+   15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+};
+
+// Interpolation weights (out of 64) for 2, 3 and 4 bit indices.
+static const uint8_t BC7_WEIGHTS_2[4] = { 0, 21, 43, 64 };
+static const uint8_t BC7_WEIGHTS_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Layout of each of the 8 BC7 modes.
+struct BC7Mode
+{
+   uint8_t subsets;           // Number of subsets. (1 - 3)
+   uint8_t partitionBits;     // Bits of partition index.
+   uint8_t rotationBits;      // Bits selecting a channel to swap with alpha.
+   uint8_t indexSelBits;      // Bit choosing which index set drives color vs alpha.
+   uint8_t colorBits;         // Bits per color endpoint channel.
+   uint8_t alphaBits;         // Bits per alpha endpoint, 0 if alpha is always 255.
+   uint8_t endpointPBits;     // One extra LSB per endpoint.
+   uint8_t sharedPBits;       // One extra LSB per subset, shared by both its endpoints.
+   uint8_t indexBits;         // Bits per pixel of the primary index set.
+   uint8_t indexBits2;        // Bits per pixel of the secondary index set, 0 if there is none.
+};
+
+static const BC7Mode BC7_MODES[8] = {
+   { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+   { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+   { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+   { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+   { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+   { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+   { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+   { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+/***********************************************************
+** Helper Functions.
+***********************************************************/
+// Reads fields LSB first from a 128 bit block.
+struct BlockBitReader
+{
+   const uint8_t* data;
+   uint32_t position;
+
+   uint32_t Read(uint32_t count)
+   {
+      uint32_t value = 0;
+      for (uint32_t i = 0; i < count; i++)
+      {
+         uint32_t bit = (data[position >> 3] >> (position & 7)) & 1;
+         value |= bit << i;
+         position++;
+      }
+      return value;
+   }
+};
+
+static void Expand565(uint16_t color, uint8_t* rgb)
+{
+   uint32_t r = (color >> 11) & 0x1F;
+   uint32_t g = (color >> 5) & 0x3F;
+   uint32_t b = color & 0x1F;
+
+   // Replicate the top bits into the bottom so full intensity maps to 255.
+   rgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+   rgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+   rgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+}
+
+// Color half of BC1/BC3. BC3 always uses the 4 color mode.
+static void DecodeColorBlock(const uint8_t* block, uint8_t* pixels, bool allowThreeColor)
+{
+   uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+   uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+   uint8_t palette[4][4];
+   Expand565(color0, palette[0]);
+   Expand565(color1, palette[1]);
+   palette[0][3] = 255;
+   palette[1][3] = 255;
+
+   if (color0 > color1 || !allowThreeColor)
+   {
+      for (uint32_t c = 0; c < 3; c++)
+      {
+         palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+         palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+      }
+      palette[2][3] = 255;
+      palette[3][3] = 255;
+   }
+   else
+   {
+      // Three color mode, the last entry is transparent black.
+      for (uint32_t c = 0; c < 3; c++)
+      {
+         palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+         palette[3][c] = 0;
+      }
+      palette[2][3] = 255;
+      palette[3][3] = 0;
+   }
+
+   uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      memcpy(&pixels[i * 4], palette[(indices >> (i * 2)) & 3], 4);
+   }
+}
+
+// Single interpolated channel used by BC3 alpha and both BC5 channels. Writes every 4th byte of pixels.
+static void DecodeChannelBlock(const uint8_t* block, uint8_t* pixels)
+{
+   uint32_t value0 = block[0];
+   uint32_t value1 = block[1];
+
+   uint8_t palette[8];
+   palette[0] = static_cast<uint8_t>(value0);
+   palette[1] = static_cast<uint8_t>(value1);
+   if (value0 > value1)
+   {
+      for (uint32_t i = 1; i < 7; i++)
+      {
+         palette[i + 1] = static_cast<uint8_t>(((7 - i) * value0 + i * value1) / 7);
+      }
+   }
+   else
+   {
+      for (uint32_t i = 1; i < 5; i++)
+      {
+         palette[i + 1] = static_cast<uint8_t>(((5 - i) * value0 + i * value1) / 5);
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+   }
+
+   // 16 3-bit indices packed into the remaining 48 bits.
+   uint64_t indices = 0;
+   for (uint32_t i = 0; i < 6; i++)
+   {
+      indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+   }
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      pixels[i * 4] = palette[(indices >> (i * 3)) & 7];
+   }
+}
+
+static uint8_t UnquantizeBC7(uint32_t value, uint32_t bits)
+{
+   // Shift up to 8 bits and replicate the high bits into the gap.
+   value <<= (8 - bits);
+   return static_cast<uint8_t>(value | (value >> bits));
+}
+
+static uint8_t InterpolateBC7(uint32_t e0, uint32_t e1, uint32_t weight)
+{
+   return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+static const uint8_t* BC7Weights(uint32_t indexBits)
+{
+   return indexBits == 2 ? BC7_WEIGHTS_2 : (indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4);
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+uint32_t BlockBytes(BlockFormat format)
+{
+   return format == BLOCK_FORMAT_BC1 ? 8 : 16;
+}
+
+uint64_t BlockImageSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+   uint64_t blocksX = (static_cast<uint64_t>(width) + 3) / 4;
+   uint64_t blocksY = (static_cast<uint64_t>(height) + 3) / 4;
+   return blocksX * blocksY * BlockBytes(format);
+}
+
+void DecodeBlockImage(BlockFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst)
+{
+   uint32_t blocksX = (width + 3) / 4;
+   uint32_t blocksY = (height + 3) / 4;
+   uint32_t blockBytes = BlockBytes(format);
+
+   uint8_t pixels[16 * 4];
+   for (uint32_t by = 0; by < blocksY; by++)
+   {
+      for (uint32_t bx = 0; bx < blocksX; bx++)
+      {
+         const uint8_t* block = src + (static_cast<uint64_t>(by) * blocksX + bx) * blockBytes;
+         switch (format)
+         {
+         case BLOCK_FORMAT_BC1: DecodeBC1Block(block, pixels); break;
+         case BLOCK_FORMAT_BC3: DecodeBC3Block(block, pixels); break;
+         case BLOCK_FORMAT_BC5: DecodeBC5Block(block, pixels); break;
+         case BLOCK_FORMAT_BC7: DecodeBC7Block(block, pixels); break;
+         }
+
+         // Edge blocks of odd sized images hang over the image, only keep the pixels inside it.
+         uint32_t rows = height - by * 4 < 4 ? height - by * 4 : 4;
+         uint32_t columns = width - bx * 4 < 4 ? width - bx * 4 : 4;
+         for (uint32_t y = 0; y < rows; y++)
+         {
+            uint8_t* row = dst + ((static_cast<uint64_t>(by) * 4 + y) * width + bx * 4) * 4;
+            memcpy(row, &pixels[y * 16], columns * 4);
+         }
+      }
+   }
+}
+
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels)
+{
+   DecodeColorBlock(block, pixels, true);
+}
+
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels)
+{
+   // Alpha block first, then a 4 color BC1 style block.
+   DecodeColorBlock(block + 8, pixels, false);
+   DecodeChannelBlock(block, pixels + 3);
+}
+
+void DecodeBC5Block(const uint8_t* block, uint8_t* pixels)
+{
+   // Red then green, blue is left at 0 for the shader to rebuild. (normal maps)
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      pixels[i * 4 + 2] = 0;
+      pixels[i * 4 + 3] = 255;
+   }
+   DecodeChannelBlock(block, pixels);
+   DecodeChannelBlock(block + 8, pixels + 1);
+}
+
+void DecodeBC7Block(const uint8_t* block, uint8_t* pixels)
+{
+   // Mode is the position of the lowest set bit of the first byte.
+   uint32_t mode = 0;
+   while (mode < 8 && !(block[0] & (1 << mode)))
+   {
+      mode++;
+   }
+
+   // Reserved mode, decodes to transparent black.
+   if (mode == 8)
+   {
+      memset(pixels, 0, 16 * 4);
+      return;
+   }
+
+   const BC7Mode& info = BC7_MODES[mode];
+   BlockBitReader reader = { block, mode + 1 };
+
+   uint32_t partition = reader.Read(info.partitionBits);
+   uint32_t rotation = reader.Read(info.rotationBits);
+   uint32_t indexSel = reader.Read(info.indexSelBits);
+
+   // Endpoints as [subset * 2 + end][channel].
+   uint32_t endpoints[6][4] = {};
+   uint32_t endpointCount = info.subsets * 2;
+   for (uint32_t c = 0; c < 3; c++)
+   {
+      for (uint32_t e = 0; e < endpointCount; e++)
+      {
+         endpoints[e][c] = reader.Read(info.colorBits);
+      }
+   }
+   for (uint32_t e = 0; e < endpointCount; e++)
+   {
+      endpoints[e][3] = info.alphaBits ? reader.Read(info.alphaBits) : 255;
+   }
+
+   // P-bits extend every channel by one LSB.
+   uint32_t colorBits = info.colorBits;
+   uint32_t alphaBits = info.alphaBits;
+   if (info.endpointPBits || info.sharedPBits)
+   {
+      uint32_t pBits[6];
+      if (info.endpointPBits)
+      {
+         for (uint32_t e = 0; e < endpointCount; e++)
+         {
+            pBits[e] = reader.Read(1);
+         }
+      }
+      else
+      {
+         for (uint32_t s = 0; s < info.subsets; s++)
+         {
+            pBits[s * 2] = pBits[s * 2 + 1] = reader.Read(1);
+         }
+      }
+
+      for (uint32_t e = 0; e < endpointCount; e++)
+      {
+         for (uint32_t c = 0; c < 4; c++)
+         {
+            if (c < 3 || info.alphaBits)
+            {
+               endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+            }
+         }
+      }
+      colorBits++;
+      if (alphaBits)
+      {
+         alphaBits++;
+      }
+   }
+
+   for (uint32_t e = 0; e < endpointCount; e++)
+   {
+      for (uint32_t c = 0; c < 3; c++)
+      {
+         endpoints[e][c] = UnquantizeBC7(endpoints[e][c], colorBits);
+      }
+      if (alphaBits)
+      {
+         endpoints[e][3] = UnquantizeBC7(endpoints[e][3], alphaBits);
+      }
+   }
+
+   // Work out each pixel's subset and which pixels are anchors. (stored with one less index bit)
+   uint8_t subsetOf[16];
+   bool isAnchor[16] = {};
+   isAnchor[0] = true;
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      if (info.subsets == 2)
+      {
+         subsetOf[i] = (BC7_PARTITIONS_2[partition] >> i) & 1;
+      }
+      else if (info.subsets == 3)
+      {
+         subsetOf[i] = BC7_PARTITIONS_3[partition][i];
+      }
+      else
+      {
+         subsetOf[i] = 0;
+      }
+   }
+   if (info.subsets == 2)
+   {
+      isAnchor[BC7_ANCHORS_2[partition]] = true;
+   }
+   else if (info.subsets == 3)
+   {
+      isAnchor[BC7_ANCHORS_3_SECOND[partition]] = true;
+      isAnchor[BC7_ANCHORS_3_THIRD[partition]] = true;
+   }
+
+   uint32_t indices[16];
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      indices[i] = reader.Read(isAnchor[i] ? info.indexBits - 1 : info.indexBits);
+   }
+
+   // Modes 4 and 5 carry a second index set, only pixel 0 is its anchor.
+   uint32_t indices2[16];
+   if (info.indexBits2)
+   {
+      for (uint32_t i = 0; i < 16; i++)
+      {
+         indices2[i] = reader.Read(i == 0 ? info.indexBits2 - 1 : info.indexBits2);
+      }
+   }
+
+   for (uint32_t i = 0; i < 16; i++)
+   {
+      const uint32_t* e0 = endpoints[subsetOf[i] * 2];
+      const uint32_t* e1 = endpoints[subsetOf[i] * 2 + 1];
+
+      uint32_t colorWeight;
+      uint32_t alphaWeight;
+      if (!info.indexBits2)
+      {
+         colorWeight = BC7Weights(info.indexBits)[indices[i]];
+         alphaWeight = colorWeight;
+      }
+      else if (!indexSel)
+      {
+         colorWeight = BC7Weights(info.indexBits)[indices[i]];
+         alphaWeight = BC7Weights(info.indexBits2)[indices2[i]];
+      }
+      else
+      {
+         colorWeight = BC7Weights(info.indexBits2)[indices2[i]];
+         alphaWeight = BC7Weights(info.indexBits)[indices[i]];
+      }
+
+      uint8_t* pixel = &pixels[i * 4];
+      for (uint32_t c = 0; c < 3; c++)
+      {
+         pixel[c] = InterpolateBC7(e0[c], e1[c], colorWeight);
+      }
+      pixel[3] = InterpolateBC7(e0[3], e1[3], alphaWeight);
+
+      // Rotation swaps alpha with one of the color channels.
+      if (rotation)
+      {
+         uint8_t swap = pixel[3];
+         pixel[3] = pixel[rotation - 1];
+         pixel[rotation - 1] = swap;
+      }
+   }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Block compressed formats the loader can decode on the CPU. Every format works on 4x4 pixel blocks.
+enum BlockFormat
+{
+   BLOCK_FORMAT_BC1,          // RGB + 1 bit alpha, 8 bytes per block.
+   BLOCK_FORMAT_BC3,          // RGB + interpolated alpha, 16 bytes per block.
+   BLOCK_FORMAT_BC5,          // Two interpolated channels (RG), 16 bytes per block.
+   BLOCK_FORMAT_BC7           // High quality RGBA, 16 bytes per block.
+};
+
+uint32_t BlockBytes(BlockFormat format);
+
+// Size in bytes of a width x height image in the given format. (partial blocks round up)
+uint64_t BlockImageSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// Decode a whole image of blocks into tightly packed RGBA8 pixels. dst must hold width * height * 4 bytes.
+void DecodeBlockImage(BlockFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst);
+
+// Decode a single block into 16 RGBA8 pixels, row by row.
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC5Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC7Block(const uint8_t* block, uint8_t* pixels);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// Name the AssetCooker writes a cooked texture under and the AssetLoader looks for it by, e.g.
+// "Textures/giraffe.jpg" -> "Textures/giraffe.ktx2". A dot in a directory name is not an extension.
+inline std::string CookedFileName(const std::string& fileName)
+{
+   size_t dot = fileName.find_last_of('.');
+   size_t slash = fileName.find_last_of("/\\");
+   if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+   {
+      return fileName + ".ktx2";
+   }
+
+   return fileName.substr(0, dot) + ".ktx2";
+}
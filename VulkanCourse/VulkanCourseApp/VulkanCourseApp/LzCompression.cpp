@@ -0,0 +1,92 @@
+#include "LzCompression.h"
+
+#include <cstring>
+
+// Add extra length bytes onto a nibble of 15. Returns false if the input runs out first.
+static bool ReadExtraLength(const uint8_t** src, const uint8_t* srcEnd, size_t* length)
+{
+   uint8_t extra;
+   do
+   {
+      if (*src >= srcEnd)
+      {
+         return false;
+      }
+      extra = *(*src)++;
+      *length += extra;
+   } while (extra == 255);
+
+   return true;
+}
+
+bool LzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+   const uint8_t* srcEnd = src + srcSize;
+   uint8_t* out = dst;
+   uint8_t* outEnd = dst + dstSize;
+
+   while (src < srcEnd)
+   {
+      uint8_t token = *src++;
+
+      // - Literals.
+      size_t literalLength = token >> 4;
+      if (literalLength == 15 && !ReadExtraLength(&src, srcEnd, &literalLength))
+      {
+         return false;
+      }
+      if (literalLength > static_cast<size_t>(srcEnd - src) || literalLength > static_cast<size_t>(outEnd - out))
+      {
+         return false;
+      }
+      if (literalLength)
+      {
+         memcpy(out, src, literalLength);
+         src += literalLength;
+         out += literalLength;
+      }
+
+      // Last sequence stops after its literals.
+      if (src == srcEnd)
+      {
+         break;
+      }
+
+      // - Match.
+      if (srcEnd - src < 2)
+      {
+         return false;
+      }
+      size_t offset = src[0] | (src[1] << 8);
+      src += 2;
+
+      size_t matchLength = token & 15;
+      if (matchLength == 15 && !ReadExtraLength(&src, srcEnd, &matchLength))
+      {
+         return false;
+      }
+      matchLength += LZ_MIN_MATCH;
+
+      if (offset == 0 || offset > static_cast<size_t>(out - dst) || matchLength > static_cast<size_t>(outEnd - out))
+      {
+         return false;
+      }
+
+      // Matches may overlap what they write, e.g. offset 1 repeats a single byte. Only copy in bulk when they don't.
+      const uint8_t* match = out - offset;
+      if (offset >= matchLength)
+      {
+         memcpy(out, match, matchLength);
+         out += matchLength;
+      }
+      else
+      {
+         for (size_t i = 0; i < matchLength; i++)
+         {
+            *out++ = *match++;
+         }
+      }
+   }
+
+   return out == outEnd;
+}
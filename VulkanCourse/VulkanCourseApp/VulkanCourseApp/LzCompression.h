@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Byte oriented LZ77 in the style of LZ4 blocks, picked for decode speed over ratio.
+//
+// A block is a run of sequences. Each starts with a token byte, literal count in the high nibble and match length - 4
+// in the low one. A nibble of 15 continues in extra bytes that are added on until one is below 255.
+// Then come the literals, a 2 byte little endian match offset (1 - 65535) and the extra match length bytes.
+// The last sequence holds only literals and ends the block.
+
+const uint32_t LZ_MIN_MATCH = 4;
+const uint32_t LZ_MAX_OFFSET = 65535;
+
+// Decompress a whole block of srcSize bytes into exactly dstSize bytes.
+// Returns false if the block is corrupt or doesn't unpack to dstSize, never reads or writes out of bounds.
+bool LzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
@@ -0,0 +1,121 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+   Close();
+}
+
+bool MappedFile::Open(const std::string& filePath)
+{
+   Close();
+
+#ifdef _WIN32
+   HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+   if (file == INVALID_HANDLE_VALUE)
+   {
+      return false;
+   }
+   m_hFile = file;
+
+   LARGE_INTEGER size;
+   if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+   {
+      Close();
+      return false;
+   }
+
+   m_hMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+   if (!m_hMapping)
+   {
+      Close();
+      return false;
+   }
+
+   m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+   m_iSize = static_cast<uint64_t>(size.QuadPart);
+#else
+   int file = open(filePath.c_str(), O_RDONLY);
+   if (file < 0)
+   {
+      return false;
+   }
+
+   struct stat status;
+   if (fstat(file, &status) != 0 || status.st_size == 0)
+   {
+      close(file);
+      return false;
+   }
+
+   // The mapping keeps the file referenced, the descriptor isn't needed after this.
+   void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+   close(file);
+
+   m_pData = data == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(data);
+   m_iSize = static_cast<uint64_t>(status.st_size);
+#endif
+
+   if (!m_pData)
+   {
+      Close();
+      return false;
+   }
+
+   return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+   if (m_pData)
+   {
+      UnmapViewOfFile(m_pData);
+   }
+   if (m_hMapping)
+   {
+      CloseHandle(m_hMapping);
+   }
+   if (m_hFile)
+   {
+      CloseHandle(m_hFile);
+   }
+   m_hMapping = nullptr;
+   m_hFile = nullptr;
+#else
+   if (m_pData)
+   {
+      munmap(const_cast<uint8_t*>(m_pData), static_cast<size_t>(m_iSize));
+   }
+#endif
+
+   m_pData = nullptr;
+   m_iSize = 0;
+}
+
+const uint8_t* MappedFile::GetData() const
+{
+   return m_pData;
+}
+
+uint64_t MappedFile::GetSize() const
+{
+   return m_iSize;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Read only view of a whole file, paged in by the OS on first touch.
+class MappedFile
+{
+public:
+   MappedFile();
+   ~MappedFile();
+
+   // Returns false if the file doesn't exist or can't be mapped.
+   bool Open(const std::string& filePath);
+   void Close();
+
+   const uint8_t* GetData() const;
+   uint64_t GetSize() const;
+
+private:
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+   void* m_hFile = nullptr;
+   void* m_hMapping = nullptr;
+#endif
+
+   const uint8_t* m_pData = nullptr;
+   uint64_t m_iSize = 0;
+};
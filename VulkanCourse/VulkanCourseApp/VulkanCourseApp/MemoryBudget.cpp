@@ -0,0 +1,144 @@
+#include "MemoryBudget.h"
+
+#include <algorithm>
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+MemoryBudget::MemoryBudget()
+{
+}
+
+MemoryBudget::~MemoryBudget()
+{
+}
+
+void MemoryBudget::Init(VkPhysicalDevice physicalDevice, bool hasBudgetExtension)
+{
+   m_vkPhysicalDevice = physicalDevice;
+   m_bHasBudgetExtension = hasBudgetExtension;
+
+   VkPhysicalDeviceMemoryProperties memoryProperties;
+   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+   m_vecHeaps.assign(memoryProperties.memoryHeapCount, {});
+   for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+   {
+      m_vecHeaps[i].size = memoryProperties.memoryHeaps[i].size;
+      m_vecHeaps[i].budget = memoryProperties.memoryHeaps[i].size * FALLBACK_BUDGET_PERCENT / 100;
+   }
+
+   // First device local type decides the heap, the same one FindMemoryTypeIndex hands out for images and vertex buffers.
+   m_vecTypeHeaps.resize(memoryProperties.memoryTypeCount);
+   bool foundDeviceLocal = false;
+   for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+   {
+      m_vecTypeHeaps[i] = memoryProperties.memoryTypes[i].heapIndex;
+      if (!foundDeviceLocal && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+      {
+         m_iDeviceLocalHeap = memoryProperties.memoryTypes[i].heapIndex;
+         foundDeviceLocal = true;
+      }
+   }
+
+   Update();
+}
+
+void MemoryBudget::Update()
+{
+   m_iShortfall = m_iShortfallSinceUpdate;
+   m_iShortfallSinceUpdate = 0;
+
+   if (!m_bHasBudgetExtension)
+   {
+      return;
+   }
+
+   VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+   budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+   VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+   memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+   memoryProperties.pNext = &budgetProperties;
+
+   vkGetPhysicalDeviceMemoryProperties2(m_vkPhysicalDevice, &memoryProperties);
+
+   for (size_t i = 0; i < m_vecHeaps.size(); i++)
+   {
+      m_vecHeaps[i].driverUsage = budgetProperties.heapUsage[i];
+      m_vecHeaps[i].budget = budgetProperties.heapBudget[i];
+      m_vecHeaps[i].trackedAtUpdate = m_vecHeaps[i].trackedBytes;
+   }
+}
+
+void MemoryBudget::Track(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+   uint32_t heapIndex = m_vecTypeHeaps[memoryTypeIndex];
+   m_vecHeaps[heapIndex].trackedBytes += size;
+   m_mapAllocations[memory] = { heapIndex, size };
+}
+
+void MemoryBudget::Untrack(VkDeviceMemory memory)
+{
+   auto allocation = m_mapAllocations.find(memory);
+   if (allocation == m_mapAllocations.end())
+   {
+      return;
+   }
+
+   m_vecHeaps[allocation->second.heapIndex].trackedBytes -= allocation->second.size;
+   m_mapAllocations.erase(allocation);
+}
+
+VkDeviceSize MemoryBudget::GetAllocationSize(VkDeviceMemory memory) const
+{
+   auto allocation = m_mapAllocations.find(memory);
+   return allocation != m_mapAllocations.end() ? allocation->second.size : 0;
+}
+
+VkDeviceSize MemoryBudget::GetUsage() const
+{
+   return GetHeapUsage(m_vecHeaps[m_iDeviceLocalHeap]);
+}
+
+VkDeviceSize MemoryBudget::GetBudget() const
+{
+   return m_vecHeaps[m_iDeviceLocalHeap].budget;
+}
+
+VkDeviceSize MemoryBudget::GetHeadroom() const
+{
+   VkDeviceSize usage = GetUsage();
+   VkDeviceSize budget = GetBudget();
+   return usage < budget ? budget - usage : 0;
+}
+
+void MemoryBudget::ReportShortfall(VkDeviceSize size)
+{
+   m_iShortfallSinceUpdate = std::max(m_iShortfallSinceUpdate, size);
+}
+
+VkDeviceSize MemoryBudget::GetShortfall() const
+{
+   return m_iShortfall;
+}
+
+bool MemoryBudget::HasBudgetExtension() const
+{
+   return m_bHasBudgetExtension;
+}
+
+/***********************************************************
+** Private Functions.
+***********************************************************/
+VkDeviceSize MemoryBudget::GetHeapUsage(const Heap& heap) const
+{
+   if (!m_bHasBudgetExtension)
+   {
+      return heap.trackedBytes;
+   }
+
+   // Driver numbers go stale as soon as something is allocated or freed, tracked changes since then are added on.
+   VkDeviceSize usage = heap.driverUsage + heap.trackedBytes;
+   return usage > heap.trackedAtUpdate ? usage - heap.trackedAtUpdate : 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <unordered_map>
+
+// Share of a heap the renderer allows itself when the driver can't say how much it may use.
+const VkDeviceSize FALLBACK_BUDGET_PERCENT = 80;
+
+// Device memory use per heap against how much of it the renderer may use.
+// With VK_EXT_memory_budget the driver's numbers count, refreshed by Update and topped up with tracked allocations made since.
+// Without it only tracked allocations count, against a share of the heap's size.
+// Not thread safe: tracked allocations are all made and freed on the render thread. (worker staging isn't tracked)
+class MemoryBudget
+{
+public:
+   MemoryBudget();
+   ~MemoryBudget();
+
+   void Init(VkPhysicalDevice physicalDevice, bool hasBudgetExtension);
+
+   // Refresh the driver's usage and budget, once per frame is plenty.
+   void Update();
+
+   // Allocation of a memory type was made or freed. Untrack ignores memory it doesn't know, VK_NULL_HANDLE included.
+   void Track(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size);
+   void Untrack(VkDeviceMemory memory);
+   // Size of a tracked allocation, 0 for anything else.
+   VkDeviceSize GetAllocationSize(VkDeviceMemory memory) const;
+
+   // Device local heap, where textures and meshes live.
+   VkDeviceSize GetUsage() const;
+   VkDeviceSize GetBudget() const;
+   // Bytes that still fit in the budget, 0 when over it.
+   VkDeviceSize GetHeadroom() const;
+
+   // An allocation of this size was turned down, there was no room for it and nothing left to make room with.
+   void ReportShortfall(VkDeviceSize size);
+   // Largest allocation turned down between the last two Updates, 0 if everything asked for fit.
+   VkDeviceSize GetShortfall() const;
+
+   bool HasBudgetExtension() const;
+
+private:
+   struct Heap
+   {
+      VkDeviceSize size;            // Whole heap.
+      VkDeviceSize trackedBytes;    // Live tracked allocations.
+      VkDeviceSize trackedAtUpdate; // trackedBytes when the driver was last asked.
+      VkDeviceSize driverUsage;     // Process usage the driver reported, includes allocations that aren't tracked.
+      VkDeviceSize budget;
+   };
+
+   struct Allocation
+   {
+      uint32_t heapIndex;
+      VkDeviceSize size;
+   };
+
+   VkDeviceSize GetHeapUsage(const Heap& heap) const;
+
+   VkPhysicalDevice m_vkPhysicalDevice = VK_NULL_HANDLE;
+   bool m_bHasBudgetExtension = false;
+
+   std::vector<Heap> m_vecHeaps;
+   std::vector<uint32_t> m_vecTypeHeaps;     // Heap index of each memory type.
+   uint32_t m_iDeviceLocalHeap = 0;
+
+   VkDeviceSize m_iShortfall = 0;
+   VkDeviceSize m_iShortfallSinceUpdate = 0;
+
+   std::unordered_map<VkDeviceMemory, Allocation> m_mapAllocations;
+};
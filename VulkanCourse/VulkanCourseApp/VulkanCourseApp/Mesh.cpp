@@ -9,44 +9,258 @@ Mesh::Mesh()
 
 Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue,
            VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
-           uint32_t newTexId)
+           TextureHandle newTexture, MemoryBudget* memoryBudget, const std::vector<Meshlet>* meshlets,
+           const std::vector<MeshLod>* lods)
 {
    m_iVertexCount = static_cast<uint32_t>(vertices->size());
    m_iIndexCount = static_cast<uint32_t>(indices->size());
+
+   // Every index of a small mesh fits in 16 bits, halving its index memory and the bandwidth to read it.
+   if (vertices->size() <= UINT16_MAX + 1)
+   {
+      m_vkIndexType = VK_INDEX_TYPE_UINT16;
+      m_vecIndices16.assign(indices->begin(), indices->end());
+
+      // The cull pass reads them as 32 bit words, an odd count is padded so the last word lies within the buffer.
+      if (m_vecIndices16.size() % 2 != 0)
+      {
+         m_vecIndices16.push_back(0);
+      }
+   }
+   else
+   {
+      m_vkIndexType = VK_INDEX_TYPE_UINT32;
+      m_vecIndices32 = *indices;
+   }
    m_vkPhysicalDevice = newPhysicalDevice;
    m_vkLogicalDevice = newDevice;
-   CreateVertexBuffer(transferQueue, transferCommandPool, vertices);
-   CreateIndexBuffer(transferQueue, transferCommandPool, indices);
+   m_vkTransferQueue = transferQueue;
+   m_vkTransferCommandPool = transferCommandPool;
+   m_pMemoryBudget = memoryBudget;
+
+   // Quantize relative to the mesh's own bounds, so the steps are as fine as its size allows.
+   glm::vec3 boundsMin = vertices->empty() ? glm::vec3(0.0f) : (*vertices)[0].pos;
+   glm::vec3 boundsMax = boundsMin;
+   for (const Vertex& vertex : *vertices)
+   {
+      boundsMin = glm::min(boundsMin, vertex.pos);
+      boundsMax = glm::max(boundsMax, vertex.pos);
+   }
+   m_vertexDecode = MakeVertexDecode<VERTEX_LAYOUT>(boundsMin, boundsMax);
+   m_boundsCenter = (boundsMin + boundsMax) * 0.5f;
+   m_fBoundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+   m_vecVertices = PackVertices<VERTEX_LAYOUT>(*vertices, m_vertexDecode);
+
+   if (meshlets)
+   {
+      m_vecMeshlets = *meshlets;
+   }
 
-   m_model.model = glm::mat4(1.0f);
-   m_texId = newTexId;
+   // Without levels of detail the whole index list and every meshlet make up the one level.
+   if (lods && !lods->empty())
+   {
+      m_vecLods = *lods;
+   }
+   else
+   {
+      MeshLod full = {};
+      full.indexCount = m_iIndexCount;
+      full.meshletCount = static_cast<uint32_t>(m_vecMeshlets.size());
+      m_vecLods.push_back(full);
+   }
+
+   CreateVertexBuffer();
+   CreateIndexBuffer();
+   CreateMeshletBuffers();
+   m_bResident = true;
+
+   m_texture = newTexture;
 }
 
 Mesh::~Mesh()
 {
 }
 
+Mesh::Mesh(Mesh&& other)
+{
+   *this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other)
+{
+   if (this == &other)
+   {
+      return *this;
+   }
+
+   m_vertexDecode = other.m_vertexDecode;
+   m_texture = other.m_texture;
+
+   m_iVertexCount = other.m_iVertexCount;
+   m_vkVertexBuffer = other.m_vkVertexBuffer;
+   m_vkVertexBufferMemory = other.m_vkVertexBufferMemory;
+
+   m_iIndexCount = other.m_iIndexCount;
+   m_vkIndexType = other.m_vkIndexType;
+   m_vkIndexBuffer = other.m_vkIndexBuffer;
+   m_vkIndexBufferMemory = other.m_vkIndexBufferMemory;
+
+   m_vecVertices = std::move(other.m_vecVertices);
+   m_vecIndices16 = std::move(other.m_vecIndices16);
+   m_vecIndices32 = std::move(other.m_vecIndices32);
+   m_vecMeshlets = std::move(other.m_vecMeshlets);
+   m_vecLods = std::move(other.m_vecLods);
+   m_iSelectedLod = other.m_iSelectedLod;
+
+   m_boundsCenter = other.m_boundsCenter;
+   m_fBoundsRadius = other.m_fBoundsRadius;
+
+   m_vkMeshletBuffer = other.m_vkMeshletBuffer;
+   m_vkMeshletBufferMemory = other.m_vkMeshletBufferMemory;
+   m_vkCulledIndexBuffer = other.m_vkCulledIndexBuffer;
+   m_vkCulledIndexBufferMemory = other.m_vkCulledIndexBufferMemory;
+   m_vkDrawCommandBuffer = other.m_vkDrawCommandBuffer;
+   m_vkDrawCommandBufferMemory = other.m_vkDrawCommandBufferMemory;
+   m_iLastDrawnFrame = other.m_iLastDrawnFrame;
+   m_bResident = other.m_bResident;
+   m_bUploading = other.m_bUploading;
+
+   m_vkPhysicalDevice = other.m_vkPhysicalDevice;
+   m_vkLogicalDevice = other.m_vkLogicalDevice;
+   m_vkTransferQueue = other.m_vkTransferQueue;
+   m_vkTransferCommandPool = other.m_vkTransferCommandPool;
+   m_pMemoryBudget = other.m_pMemoryBudget;
+
+   // The buffers belong to this mesh now, other must not free or draw them.
+   other.m_vkVertexBuffer = VK_NULL_HANDLE;
+   other.m_vkVertexBufferMemory = VK_NULL_HANDLE;
+   other.m_vkIndexBuffer = VK_NULL_HANDLE;
+   other.m_vkIndexBufferMemory = VK_NULL_HANDLE;
+   other.m_vkMeshletBuffer = VK_NULL_HANDLE;
+   other.m_vkMeshletBufferMemory = VK_NULL_HANDLE;
+   other.m_vkCulledIndexBuffer = VK_NULL_HANDLE;
+   other.m_vkCulledIndexBufferMemory = VK_NULL_HANDLE;
+   other.m_vkDrawCommandBuffer = VK_NULL_HANDLE;
+   other.m_vkDrawCommandBufferMemory = VK_NULL_HANDLE;
+   other.m_bResident = false;
+   other.m_bUploading = false;
+
+   return *this;
+}
+
 void Mesh::Deinit()
 {
-   vkDestroyBuffer(m_vkLogicalDevice, m_vkVertexBuffer, nullptr);
-   vkFreeMemory(m_vkLogicalDevice, m_vkVertexBufferMemory, nullptr);
-   vkDestroyBuffer(m_vkLogicalDevice, m_vkIndexBuffer, nullptr);
-   vkFreeMemory(m_vkLogicalDevice, m_vkIndexBufferMemory, nullptr);
+   Evict();
+}
+
+void Mesh::Evict()
+{
+   DestroyBuffer(&m_vkVertexBuffer, &m_vkVertexBufferMemory);
+   DestroyBuffer(&m_vkIndexBuffer, &m_vkIndexBufferMemory);
+   DestroyBuffer(&m_vkMeshletBuffer, &m_vkMeshletBufferMemory);
+   DestroyBuffer(&m_vkCulledIndexBuffer, &m_vkCulledIndexBufferMemory);
+   DestroyBuffer(&m_vkDrawCommandBuffer, &m_vkDrawCommandBufferMemory);
+   m_bResident = false;
+   m_bUploading = false;
+}
+
+void Mesh::RecordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, void* stagingData)
+{
+   uint8_t* staging = static_cast<uint8_t*>(stagingData);
+   VkDeviceSize offset = 0;
+
+   RecordDeviceBuffer(commandBuffer, stagingBuffer, staging, &offset, m_vecVertices.data(), sizeof(GpuVertex) * m_vecVertices.size(),
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_vkVertexBuffer, &m_vkVertexBufferMemory);
+
+   const void* indexData = m_vkIndexType == VK_INDEX_TYPE_UINT16 ? static_cast<const void*>(m_vecIndices16.data()) : m_vecIndices32.data();
+   VkDeviceSize indexSize = sizeof(uint16_t) * m_vecIndices16.size() + sizeof(uint32_t) * m_vecIndices32.size();
+   RecordDeviceBuffer(commandBuffer, stagingBuffer, staging, &offset, indexData, indexSize,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &m_vkIndexBuffer, &m_vkIndexBufferMemory);
+
+   if (HasMeshlets())
+   {
+      RecordDeviceBuffer(commandBuffer, stagingBuffer, staging, &offset, m_vecMeshlets.data(), sizeof(Meshlet) * m_vecMeshlets.size(),
+         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &m_vkMeshletBuffer, &m_vkMeshletBufferMemory);
+
+      // Written fresh by the cull pass each frame, so nothing to upload. Same as CreateMeshletBuffers.
+      CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, sizeof(uint32_t) * m_vecLods[0].indexCount,
+         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkCulledIndexBuffer, &m_vkCulledIndexBufferMemory, m_pMemoryBudget);
+
+      VkDrawIndexedIndirectCommand drawCommand = {};
+      drawCommand.instanceCount = 1;
+      RecordDeviceBuffer(commandBuffer, stagingBuffer, staging, &offset, &drawCommand, sizeof(drawCommand),
+         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+         &m_vkDrawCommandBuffer, &m_vkDrawCommandBufferMemory);
+   }
+
+   // Whatever reads the buffers first is submitted later, but still has to see the copies.
+   VkMemoryBarrier uploadBarrier = {};
+   uploadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+   uploadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   uploadBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+   vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0, 1, &uploadBarrier, 0, nullptr, 0, nullptr);
+
+   m_bUploading = true;
+}
+
+void Mesh::FinishUpload()
+{
+   m_bUploading = false;
+   m_bResident = true;
 }
 
-void Mesh::SetModel(glm::mat4 newModel)
+VkDeviceSize Mesh::GetUploadSize()
 {
-   m_model.model = newModel;
+   // Everything but the culled index list.
+   VkDeviceSize size = sizeof(GpuVertex) * m_vecVertices.size() + sizeof(uint16_t) * m_vecIndices16.size() + sizeof(uint32_t) * m_vecIndices32.size();
+   if (HasMeshlets())
+   {
+      size += sizeof(Meshlet) * m_vecMeshlets.size() + sizeof(VkDrawIndexedIndirectCommand);
+   }
+   return size;
 }
 
-Model Mesh::GetModel()
+bool Mesh::IsUploading()
 {
-   return m_model;
+   return m_bUploading;
 }
 
-uint32_t Mesh::GetTexId()
+bool Mesh::IsResident()
 {
-   return m_texId;
+   return m_bResident;
+}
+
+VkDeviceSize Mesh::GetMemorySize()
+{
+   VkDeviceSize size = sizeof(GpuVertex) * m_vecVertices.size() + sizeof(uint16_t) * m_vecIndices16.size() + sizeof(uint32_t) * m_vecIndices32.size();
+   if (HasMeshlets())
+   {
+      size += sizeof(Meshlet) * m_vecMeshlets.size() + sizeof(uint32_t) * m_vecLods[0].indexCount + sizeof(VkDrawIndexedIndirectCommand);
+   }
+   return size;
+}
+
+void Mesh::SetLastDrawnFrame(uint64_t frameNumber)
+{
+   m_iLastDrawnFrame = frameNumber;
+}
+
+uint64_t Mesh::GetLastDrawnFrame()
+{
+   return m_iLastDrawnFrame;
+}
+
+const VertexDecode& Mesh::GetVertexDecode()
+{
+   return m_vertexDecode;
+}
+
+TextureHandle Mesh::GetTexture()
+{
+   return m_texture;
 }
 
 uint32_t Mesh::GetVertexCount()
@@ -69,14 +283,69 @@ VkBuffer Mesh::GetIndexBuffer()
    return m_vkIndexBuffer;
 }
 
+VkIndexType Mesh::GetIndexType()
+{
+   return m_vkIndexType;
+}
+
+bool Mesh::HasMeshlets()
+{
+   return !m_vecMeshlets.empty();
+}
+
+uint32_t Mesh::GetMeshletCount()
+{
+   return static_cast<uint32_t>(m_vecMeshlets.size());
+}
+
+VkBuffer Mesh::GetMeshletBuffer()
+{
+   return m_vkMeshletBuffer;
+}
+
+VkBuffer Mesh::GetCulledIndexBuffer()
+{
+   return m_vkCulledIndexBuffer;
+}
+
+VkBuffer Mesh::GetDrawCommandBuffer()
+{
+   return m_vkDrawCommandBuffer;
+}
+
+const std::vector<MeshLod>& Mesh::GetLods()
+{
+   return m_vecLods;
+}
+
+void Mesh::SetSelectedLod(uint32_t lod)
+{
+   m_iSelectedLod = std::min(lod, static_cast<uint32_t>(m_vecLods.size()) - 1);
+}
+
+const MeshLod& Mesh::GetSelectedLod()
+{
+   return m_vecLods[m_iSelectedLod];
+}
+
+glm::vec3 Mesh::GetBoundsCenter()
+{
+   return m_boundsCenter;
+}
+
+float Mesh::GetBoundsRadius()
+{
+   return m_fBoundsRadius;
+}
+
 /***********************************************************
 ** Private Functions.
 ***********************************************************/
 
-void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices)
+void Mesh::CreateVertexBuffer()
 {
    // Get size of buffer needed for vertices.
-   VkDeviceSize bufferSize = static_cast<uint64_t>(sizeof(Vertex)) * static_cast<uint64_t>(vertices->size());
+   VkDeviceSize bufferSize = static_cast<uint64_t>(sizeof(GpuVertex)) * static_cast<uint64_t>(m_vecVertices.size());
 
    // Temporary buffer to "stage" vertex data before transferring to GPU.
    VkBuffer stagingBuffer;
@@ -91,27 +360,28 @@ void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
    void* data;                                                                         // 1. Create pointer to a point in normal memory.
    CREATION_SUCCEEDED(vkMapMemory(m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data),
       "Failed to map staging buffer memory!");                                         // 2. "Map" the vertex buffer memory to that point.
-   memcpy(data, vertices->data(), static_cast<uint32_t>(bufferSize));                  // 3. Copy memory from vertices vector to the point.
+   memcpy(data, m_vecVertices.data(), static_cast<uint32_t>(bufferSize));                  // 3. Copy memory from vertices vector to the point.
    vkUnmapMemory(m_vkLogicalDevice, stagingBufferMemory);                              // 4. Unmap the vertex buffer memory.
 
    // Create buffer with TRANSFER_DST_BIT to mark as recipient of the transfer data.
    // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU. (host)
    CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, bufferSize,
       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkVertexBuffer, &m_vkVertexBufferMemory);
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkVertexBuffer, &m_vkVertexBufferMemory, m_pMemoryBudget);
 
    // Copy staging buffer to vertex buffer on GPU.
-   CopyBuffer(m_vkLogicalDevice, transferQueue, transferCommandPool, stagingBuffer, m_vkVertexBuffer, bufferSize);
+   CopyBuffer(m_vkLogicalDevice, m_vkTransferQueue, m_vkTransferCommandPool, stagingBuffer, m_vkVertexBuffer, bufferSize);
 
    // Clean up staging buffer parts.
    vkDestroyBuffer(m_vkLogicalDevice, stagingBuffer, nullptr);
    vkFreeMemory(m_vkLogicalDevice, stagingBufferMemory, nullptr);
 }
 
-void Mesh::CreateIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices)
+void Mesh::CreateIndexBuffer()
 {
-   // Get size of buffer needed for indices.
-   VkDeviceSize bufferSize = sizeof(uint32_t) * indices->size();
+   // Get size of buffer needed for indices, in whichever width they are stored.
+   const void* indexData = m_vkIndexType == VK_INDEX_TYPE_UINT16 ? static_cast<const void*>(m_vecIndices16.data()) : m_vecIndices32.data();
+   VkDeviceSize bufferSize = sizeof(uint16_t) * m_vecIndices16.size() + sizeof(uint32_t) * m_vecIndices32.size();
 
    // Temporary buffer to "stage" vertex data before transferring to GPU.
    VkBuffer stagingBuffer;
@@ -125,18 +395,95 @@ void Mesh::CreateIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
    // -- MAP MEMORY TO VERTEX BUFFER --
    void* data;
    CREATION_SUCCEEDED(vkMapMemory(m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data), "Failed to map staging buffer memory!");
-   memcpy(data, indices->data(), static_cast<uint32_t>(bufferSize));
+   memcpy(data, indexData, static_cast<uint32_t>(bufferSize));
    vkUnmapMemory(m_vkLogicalDevice, stagingBufferMemory);
 
-   // Create buffer for index data on gpu access only area.
+   // Create buffer for index data on gpu access only area. The meshlet cull pass reads it as a storage buffer.
    CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, bufferSize,
-      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkIndexBuffer, &m_vkIndexBufferMemory);
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkIndexBuffer, &m_vkIndexBufferMemory, m_pMemoryBudget);
 
    // Copy from staging buffer to GPU access buffer.
-   CopyBuffer(m_vkLogicalDevice, transferQueue, transferCommandPool, stagingBuffer, m_vkIndexBuffer, bufferSize);
+   CopyBuffer(m_vkLogicalDevice, m_vkTransferQueue, m_vkTransferCommandPool, stagingBuffer, m_vkIndexBuffer, bufferSize);
 
    // Clean up staging buffer parts.
    vkDestroyBuffer(m_vkLogicalDevice, stagingBuffer, nullptr);
    vkFreeMemory(m_vkLogicalDevice, stagingBufferMemory, nullptr);
 }
+
+void Mesh::CreateMeshletBuffers()
+{
+   if (!HasMeshlets())
+   {
+      return;
+   }
+
+   CreateDeviceBuffer(m_vecMeshlets.data(), sizeof(Meshlet) * m_vecMeshlets.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      &m_vkMeshletBuffer, &m_vkMeshletBufferMemory);
+
+   // Room for every index of the full level, in case nothing is culled. Coarser levels are always smaller.
+   // Written fresh by the cull pass each frame, so nothing to upload.
+   CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, sizeof(uint32_t) * m_vecLods[0].indexCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkCulledIndexBuffer, &m_vkCulledIndexBufferMemory, m_pMemoryBudget);
+
+   // One instance from the start of the culled list, the cull pass fills in the index count.
+   VkDrawIndexedIndirectCommand drawCommand = {};
+   drawCommand.instanceCount = 1;
+   CreateDeviceBuffer(&drawCommand, sizeof(drawCommand),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      &m_vkDrawCommandBuffer, &m_vkDrawCommandBufferMemory);
+}
+
+void Mesh::CreateDeviceBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+{
+   VkBuffer stagingBuffer;
+   VkDeviceMemory stagingBufferMemory;
+   CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      &stagingBuffer, &stagingBufferMemory);
+
+   void* mapped;
+   CREATION_SUCCEEDED(vkMapMemory(m_vkLogicalDevice, stagingBufferMemory, 0, size, 0, &mapped), "Failed to map staging buffer memory!");
+   memcpy(mapped, data, static_cast<size_t>(size));
+   vkUnmapMemory(m_vkLogicalDevice, stagingBufferMemory);
+
+   CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory, m_pMemoryBudget);
+
+   CopyBuffer(m_vkLogicalDevice, m_vkTransferQueue, m_vkTransferCommandPool, stagingBuffer, *buffer, size);
+
+   vkDestroyBuffer(m_vkLogicalDevice, stagingBuffer, nullptr);
+   vkFreeMemory(m_vkLogicalDevice, stagingBufferMemory, nullptr);
+}
+
+void Mesh::RecordDeviceBuffer(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, uint8_t* stagingData, VkDeviceSize* offset,
+   const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+{
+   memcpy(stagingData + *offset, data, static_cast<size_t>(size));
+
+   CreateBuffer(m_vkPhysicalDevice, m_vkLogicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory, m_pMemoryBudget);
+
+   VkBufferCopy bufferCopyRegion = {};
+   bufferCopyRegion.srcOffset = *offset;
+   bufferCopyRegion.dstOffset = 0;
+   bufferCopyRegion.size = size;
+   vkCmdCopyBuffer(commandBuffer, stagingBuffer, *buffer, 1, &bufferCopyRegion);
+
+   *offset += size;
+}
+
+void Mesh::DestroyBuffer(VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+{
+   if (m_pMemoryBudget)
+   {
+      m_pMemoryBudget->Untrack(*bufferMemory);
+   }
+
+   vkDestroyBuffer(m_vkLogicalDevice, *buffer, nullptr);
+   vkFreeMemory(m_vkLogicalDevice, *bufferMemory, nullptr);
+
+   *buffer = VK_NULL_HANDLE;
+   *bufferMemory = VK_NULL_HANDLE;
+}
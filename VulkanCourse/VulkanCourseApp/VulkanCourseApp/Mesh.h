@@ -6,49 +6,155 @@
 #include <vector>
 
 #include "Utilities.h"
-
+#include "VertexLayout.h"
+#include "Meshlet.h"
+#include "MeshSimplify.h"
+#include "SlotMap.h"
+#include "TextureCache.h"
+
+// How model transforms reach shader.vert, passed to it as a specialization constant. Compact transforms are translation,
+// rotation and scale (40 bytes) rather than a matrix (64 bytes), and the shader applies them as they are. Only nodes whose
+// world matrix they reproduce (SceneGraph::IsWorldTrsExact) go that way. A rotated node below a non-uniformly scaled
+// ancestor still pushes its matrix, decode.positionOffset.w tells the shader which one a draw has.
+const bool COMPACT_TRANSFORMS = true;
+
+// Vertex push constants of a draw with full matrices. The matrix comes from the mesh's scene node, the decode from the mesh.
 struct Model {
+   VertexDecode decode;    // Undoes the mesh's position quantization, pushed along with the transform.
    glm::mat4 model;
 };
 
+// Vertex push constants of a draw with compact transforms.
+struct ModelTrs {
+   VertexDecode decode;          // positionOffset.w is 1, where a full matrix draw has 0.
+   glm::vec4 rotation;           // Quaternion x, y, z, w.
+   glm::vec4 translationScaleX;  // Translation x, y, z, then the x scale.
+   glm::vec2 scaleYZ;
+};
+
+static_assert(sizeof(Model) == 96, "Model must match shader.vert.");
+static_assert(sizeof(ModelTrs) == 72, "ModelTrs must match shader.vert.");
+
+// Mesh of the renderer's scene, stays valid to pass in for as long as the mesh exists.
+struct MeshTag;
+using MeshHandle = Handle<MeshTag>;
+
 class Mesh
 {
 public:
    Mesh();
    Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue,
         VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
-        uint32_t newTexId);
+        TextureHandle newTexture, MemoryBudget* memoryBudget = nullptr, const std::vector<Meshlet>* meshlets = nullptr,
+        const std::vector<MeshLod>* lods = nullptr);
    ~Mesh();
 
-   void Deinit();
+   // Move only, a copy would share the device buffers. The moved from mesh is left without buffers, evicted, so a
+   // Deinit on it frees nothing. Moving onto a mesh that still has buffers leaks them, Deinit it first.
+   Mesh(Mesh&& other);
+   Mesh& operator=(Mesh&& other);
 
-   void SetModel(glm::mat4 newModel);
-   Model GetModel();
+   void Deinit();
 
-   uint32_t GetTexId();
+   // Free the device buffers under memory pressure, the vertices and indices stay on the CPU to upload again.
+   // Only call once no frame in flight draws the mesh.
+   void Evict();
+   // Bring an evicted mesh back without waiting: create its buffers and record copies into them from staging, which the
+   // CPU copies are written into from offset 0 and has to hold GetUploadSize bytes. The mesh isn't resident until
+   // FinishUpload, call that once commandBuffer has run.
+   void RecordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, void* stagingData);
+   void FinishUpload();
+   VkDeviceSize GetUploadSize();
+   // Buffers exist but their copy may not have run yet, nothing may read them.
+   bool IsUploading();
+   bool IsResident();
+   // Device memory the buffers take while resident.
+   VkDeviceSize GetMemorySize();
+
+   // Frame the mesh was last recorded into, eviction goes by it.
+   void SetLastDrawnFrame(uint64_t frameNumber);
+   uint64_t GetLastDrawnFrame();
+
+   const VertexDecode& GetVertexDecode();
+
+   // Texture the mesh holds a reference on.
+   TextureHandle GetTexture();
 
    uint32_t GetVertexCount();
    VkBuffer GetVertexBuffer();
 
+   // Every level of detail's indices together.
    uint32_t GetIndexCount();
    VkBuffer GetIndexBuffer();
+   // 16 bit for meshes with fewer than 65536 vertices, 32 bit otherwise.
+   VkIndexType GetIndexType();
+
+   // Meshes made with meshlets are culled per meshlet on the GPU. The cull pass reads the meshlets and the index buffer,
+   // writes what survives to the culled index buffer (always 32 bit) and its count to the draw command.
+   bool HasMeshlets();
+   uint32_t GetMeshletCount();
+   VkBuffer GetMeshletBuffer();
+   VkBuffer GetCulledIndexBuffer();
+   VkBuffer GetDrawCommandBuffer();
+
+   // Levels of detail, level 0 the full mesh. Meshes made without any have that one level.
+   const std::vector<MeshLod>& GetLods();
+   // Level drawn from the next recorded frame on, picked by its size on screen.
+   void SetSelectedLod(uint32_t lod);
+   const MeshLod& GetSelectedLod();
+
+   // Bounding sphere in mesh space.
+   glm::vec3 GetBoundsCenter();
+   float GetBoundsRadius();
 
 private:
-   void CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices);
-   void CreateIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices);
-
-   Model m_model;
-   uint32_t m_texId;
+   void CreateVertexBuffer();
+   void CreateIndexBuffer();
+   void CreateMeshletBuffers();
+   // Device local buffer holding a copy of data, uploaded through a staging buffer.
+   void CreateDeviceBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
+   // Same without waiting, data goes into shared staging at *offset, which moves past it, and the copy into commandBuffer.
+   void RecordDeviceBuffer(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, uint8_t* stagingData, VkDeviceSize* offset,
+      const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
+   void DestroyBuffer(VkBuffer* buffer, VkDeviceMemory* bufferMemory);
+
+   VertexDecode m_vertexDecode;
+   TextureHandle m_texture;
 
    uint32_t m_iVertexCount;
-   VkBuffer m_vkVertexBuffer;
-   VkDeviceMemory m_vkVertexBufferMemory;
+   VkBuffer m_vkVertexBuffer = VK_NULL_HANDLE;
+   VkDeviceMemory m_vkVertexBufferMemory = VK_NULL_HANDLE;
 
    uint32_t m_iIndexCount;
-   VkBuffer m_vkIndexBuffer;
-   VkDeviceMemory m_vkIndexBufferMemory;
+   VkIndexType m_vkIndexType;
+   VkBuffer m_vkIndexBuffer = VK_NULL_HANDLE;
+   VkDeviceMemory m_vkIndexBufferMemory = VK_NULL_HANDLE;
+
+   // CPU copies to upload from again after an eviction, vertices already in the GPU layout.
+   std::vector<GpuVertex> m_vecVertices;
+   std::vector<uint16_t> m_vecIndices16;     // Only the one matching m_vkIndexType holds the indices.
+   std::vector<uint32_t> m_vecIndices32;
+   std::vector<Meshlet> m_vecMeshlets;
+   std::vector<MeshLod> m_vecLods;
+   uint32_t m_iSelectedLod = 0;
+
+   glm::vec3 m_boundsCenter;
+   float m_fBoundsRadius;
+
+   VkBuffer m_vkMeshletBuffer = VK_NULL_HANDLE;
+   VkDeviceMemory m_vkMeshletBufferMemory = VK_NULL_HANDLE;
+   VkBuffer m_vkCulledIndexBuffer = VK_NULL_HANDLE;
+   VkDeviceMemory m_vkCulledIndexBufferMemory = VK_NULL_HANDLE;
+   VkBuffer m_vkDrawCommandBuffer = VK_NULL_HANDLE;
+   VkDeviceMemory m_vkDrawCommandBufferMemory = VK_NULL_HANDLE;
+   uint64_t m_iLastDrawnFrame = 0;
+   bool m_bResident = false;
+   bool m_bUploading = false;
 
    VkPhysicalDevice m_vkPhysicalDevice;
    VkDevice m_vkLogicalDevice;
+   VkQueue m_vkTransferQueue;
+   VkCommandPool m_vkTransferCommandPool;
+   MemoryBudget* m_pMemoryBudget = nullptr;
 };
 
@@ -0,0 +1,371 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+static void WritePadding(std::ofstream* file, uint64_t from, uint64_t to)
+{
+   file->write(std::string(static_cast<size_t>(to - from), '\0').data(), to - from);
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+bool GetFileStamp(const std::string& filePath, uint64_t* size, int64_t* time)
+{
+#ifdef _WIN32
+   WIN32_FILE_ATTRIBUTE_DATA attributes;
+   if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &attributes) ||
+      (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+   {
+      return false;
+   }
+
+   // 100 ns ticks, fine enough that saving twice in a second still shows.
+   *size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+   *time = static_cast<int64_t>((static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+      attributes.ftLastWriteTime.dwLowDateTime);
+#else
+   struct stat status;
+   if (stat(filePath.c_str(), &status) != 0 || !S_ISREG(status.st_mode))
+   {
+      return false;
+   }
+
+#ifdef __APPLE__
+   const struct timespec& modified = status.st_mtimespec;
+#else
+   const struct timespec& modified = status.st_mtim;
+#endif
+   *size = static_cast<uint64_t>(status.st_size);
+   *time = static_cast<int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+#endif
+
+   return true;
+}
+
+bool WriteMeshCache(const std::string& cachePath, const ImportedModel& model, uint64_t sourceSize, int64_t sourceTime)
+{
+   MeshCacheHeader header = {};
+   memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+   header.version = MESH_CACHE_VERSION;
+   header.vertexSize = sizeof(Vertex);
+   header.submeshCount = static_cast<uint32_t>(model.meshes.size());
+   header.sourceSize = sourceSize;
+   header.sourceTime = sourceTime;
+   header.sourceBytesRead = model.bytesRead;
+
+   // Lay out the tables first, the blobs follow them each on its own aligned offset.
+   std::vector<MeshCacheSubmesh> submeshes(model.meshes.size());
+   std::vector<MeshCacheDependency> dependencies(model.dependencies.size());
+   std::string stringTable;
+   header.submeshTableOffset = AlignUp(sizeof(MeshCacheHeader), alignof(MeshCacheSubmesh));
+   header.dependencyTableOffset = AlignUp(header.submeshTableOffset + submeshes.size() * sizeof(MeshCacheSubmesh), alignof(MeshCacheDependency));
+   header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+   header.stringTableOffset = header.dependencyTableOffset + dependencies.size() * sizeof(MeshCacheDependency);
+
+   for (size_t i = 0; i < model.meshes.size(); i++)
+   {
+      const ImportedMesh& mesh = model.meshes[i];
+      submeshes[i].vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+      submeshes[i].indexCount = static_cast<uint32_t>(mesh.indices.size());
+      submeshes[i].texturePathOffset = static_cast<uint32_t>(stringTable.size());
+      submeshes[i].texturePathLength = static_cast<uint32_t>(mesh.texturePath.size());
+      memcpy(submeshes[i].boundsMin, &mesh.boundsMin, sizeof(submeshes[i].boundsMin));
+      memcpy(submeshes[i].boundsMax, &mesh.boundsMax, sizeof(submeshes[i].boundsMax));
+      stringTable += mesh.texturePath;
+
+      glm::vec3 boundsMin = i == 0 ? mesh.boundsMin : glm::min(glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]), mesh.boundsMin);
+      glm::vec3 boundsMax = i == 0 ? mesh.boundsMax : glm::max(glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]), mesh.boundsMax);
+      memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+      memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+   }
+
+   for (size_t i = 0; i < model.dependencies.size(); i++)
+   {
+      dependencies[i].size = model.dependencies[i].size;
+      dependencies[i].time = model.dependencies[i].time;
+      dependencies[i].pathOffset = static_cast<uint32_t>(stringTable.size());
+      dependencies[i].pathLength = static_cast<uint32_t>(model.dependencies[i].path.size());
+      stringTable += model.dependencies[i].path;
+   }
+   header.stringTableSize = static_cast<uint32_t>(stringTable.size());
+
+   uint64_t offset = header.stringTableOffset + stringTable.size();
+   for (size_t i = 0; i < model.meshes.size(); i++)
+   {
+      submeshes[i].vertexOffset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+      offset = submeshes[i].vertexOffset + model.meshes[i].vertices.size() * sizeof(Vertex);
+      submeshes[i].indexOffset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+      offset = submeshes[i].indexOffset + model.meshes[i].indices.size() * sizeof(uint32_t);
+      submeshes[i].meshletOffset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+      submeshes[i].meshletCount = static_cast<uint32_t>(model.meshes[i].meshlets.size());
+      offset = submeshes[i].meshletOffset + model.meshes[i].meshlets.size() * sizeof(Meshlet);
+      submeshes[i].lodOffset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+      submeshes[i].lodCount = static_cast<uint32_t>(model.meshes[i].lods.size());
+      offset = submeshes[i].lodOffset + model.meshes[i].lods.size() * sizeof(MeshLod);
+   }
+
+   // Written under a temporary name and moved over the old cache at the end, so a reader never maps half a file.
+   std::string tempPath = cachePath + ".tmp";
+   {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+      if (!file.is_open())
+      {
+         return false;
+      }
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      WritePadding(&file, sizeof(header), header.submeshTableOffset);
+      file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(MeshCacheSubmesh));
+      WritePadding(&file, header.submeshTableOffset + submeshes.size() * sizeof(MeshCacheSubmesh), header.dependencyTableOffset);
+      file.write(reinterpret_cast<const char*>(dependencies.data()), dependencies.size() * sizeof(MeshCacheDependency));
+      file.write(stringTable.data(), stringTable.size());
+
+      offset = header.stringTableOffset + stringTable.size();
+      for (size_t i = 0; i < model.meshes.size(); i++)
+      {
+         const ImportedMesh& mesh = model.meshes[i];
+         WritePadding(&file, offset, submeshes[i].vertexOffset);
+         file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+         offset = submeshes[i].vertexOffset + mesh.vertices.size() * sizeof(Vertex);
+
+         WritePadding(&file, offset, submeshes[i].indexOffset);
+         file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+         offset = submeshes[i].indexOffset + mesh.indices.size() * sizeof(uint32_t);
+
+         WritePadding(&file, offset, submeshes[i].meshletOffset);
+         file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+         offset = submeshes[i].meshletOffset + mesh.meshlets.size() * sizeof(Meshlet);
+
+         WritePadding(&file, offset, submeshes[i].lodOffset);
+         file.write(reinterpret_cast<const char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+         offset = submeshes[i].lodOffset + mesh.lods.size() * sizeof(MeshLod);
+      }
+
+      if (!file.good())
+      {
+         file.close();
+         std::remove(tempPath.c_str());
+         return false;
+      }
+   }
+
+   // Rename doesn't replace an existing file everywhere, clear the way first.
+   std::remove(cachePath.c_str());
+   if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+   {
+      std::remove(tempPath.c_str());
+      return false;
+   }
+
+   return true;
+}
+
+MeshCache::MeshCache()
+{
+}
+
+MeshCache::~MeshCache()
+{
+   Close();
+}
+
+bool MeshCache::Open(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime)
+{
+   Close();
+
+   if (!m_mappedFile.Open(cachePath))
+   {
+      return false;
+   }
+
+   // Anything that doesn't check out is treated like a missing cache, the model is parsed again and the cache rewritten.
+   const uint8_t* data = m_mappedFile.GetData();
+   uint64_t fileSize = m_mappedFile.GetSize();
+   if (fileSize < sizeof(MeshCacheHeader))
+   {
+      Close();
+      return false;
+   }
+
+   const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(data);
+   if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != MESH_CACHE_VERSION ||
+      header->vertexSize != sizeof(Vertex) || header->sourceSize != sourceSize || header->sourceTime != sourceTime)
+   {
+      Close();
+      return false;
+   }
+
+   uint64_t tableSize = static_cast<uint64_t>(header->submeshCount) * sizeof(MeshCacheSubmesh);
+   uint64_t dependencyTableSize = static_cast<uint64_t>(header->dependencyCount) * sizeof(MeshCacheDependency);
+   if (header->submeshTableOffset % alignof(MeshCacheSubmesh) != 0 || header->submeshTableOffset > fileSize ||
+      tableSize > fileSize - header->submeshTableOffset ||
+      header->dependencyTableOffset % alignof(MeshCacheDependency) != 0 || header->dependencyTableOffset > fileSize ||
+      dependencyTableSize > fileSize - header->dependencyTableOffset ||
+      header->stringTableOffset > fileSize || header->stringTableSize > fileSize - header->stringTableOffset)
+   {
+      Close();
+      return false;
+   }
+
+   // Material libraries and buffers can change without the model file changing, each one has to match as well.
+   const MeshCacheDependency* dependencies = reinterpret_cast<const MeshCacheDependency*>(data + header->dependencyTableOffset);
+   const char* stringTable = reinterpret_cast<const char*>(data + header->stringTableOffset);
+   for (uint32_t i = 0; i < header->dependencyCount; i++)
+   {
+      const MeshCacheDependency& dependency = dependencies[i];
+      uint64_t size = 0;
+      int64_t time = 0;
+      if (dependency.pathOffset > header->stringTableSize || dependency.pathLength > header->stringTableSize - dependency.pathOffset ||
+         !GetFileStamp(std::string(stringTable + dependency.pathOffset, dependency.pathLength), &size, &time) ||
+         size != dependency.size || time != dependency.time)
+      {
+         Close();
+         return false;
+      }
+   }
+
+   const MeshCacheSubmesh* submeshes = reinterpret_cast<const MeshCacheSubmesh*>(data + header->submeshTableOffset);
+   for (uint32_t i = 0; i < header->submeshCount; i++)
+   {
+      const MeshCacheSubmesh& submesh = submeshes[i];
+      uint64_t vertexBytes = static_cast<uint64_t>(submesh.vertexCount) * sizeof(Vertex);
+      uint64_t indexBytes = static_cast<uint64_t>(submesh.indexCount) * sizeof(uint32_t);
+      uint64_t meshletBytes = static_cast<uint64_t>(submesh.meshletCount) * sizeof(Meshlet);
+      uint64_t lodBytes = static_cast<uint64_t>(submesh.lodCount) * sizeof(MeshLod);
+      bool valid = submesh.vertexOffset % MESH_CACHE_ALIGNMENT == 0 && submesh.indexOffset % MESH_CACHE_ALIGNMENT == 0 &&
+         submesh.meshletOffset % MESH_CACHE_ALIGNMENT == 0 && submesh.lodOffset % MESH_CACHE_ALIGNMENT == 0 &&
+         submesh.vertexOffset <= fileSize && vertexBytes <= fileSize - submesh.vertexOffset &&
+         submesh.indexOffset <= fileSize && indexBytes <= fileSize - submesh.indexOffset &&
+         submesh.meshletOffset <= fileSize && meshletBytes <= fileSize - submesh.meshletOffset &&
+         submesh.lodOffset <= fileSize && lodBytes <= fileSize - submesh.lodOffset &&
+         submesh.texturePathOffset <= header->stringTableSize &&
+         submesh.texturePathLength <= header->stringTableSize - submesh.texturePathOffset;
+
+      // Indices are uploaded as they are, one past the vertex count would read outside the buffer on the GPU.
+      const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + submesh.indexOffset);
+      for (uint32_t j = 0; valid && j < submesh.indexCount; j++)
+      {
+         valid = indices[j] < submesh.vertexCount;
+      }
+
+      // Meshlets index into the index list, the cull shader copies their ranges as they are.
+      const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(data + submesh.meshletOffset);
+      for (uint32_t j = 0; valid && j < submesh.meshletCount; j++)
+      {
+         valid = meshlets[j].firstIndex <= submesh.indexCount && meshlets[j].indexCount <= submesh.indexCount - meshlets[j].firstIndex;
+      }
+
+      // Levels of detail pick the index and meshlet ranges drawn.
+      const MeshLod* lods = reinterpret_cast<const MeshLod*>(data + submesh.lodOffset);
+      for (uint32_t j = 0; valid && j < submesh.lodCount; j++)
+      {
+         valid = lods[j].firstIndex <= submesh.indexCount && lods[j].indexCount <= submesh.indexCount - lods[j].firstIndex &&
+            lods[j].firstMeshlet <= submesh.meshletCount && lods[j].meshletCount <= submesh.meshletCount - lods[j].firstMeshlet;
+      }
+
+      if (!valid)
+      {
+         Close();
+         return false;
+      }
+   }
+
+   m_pHeader = header;
+   m_pSubmeshes = submeshes;
+   m_pStringTable = stringTable;
+   return true;
+}
+
+void MeshCache::Close()
+{
+   m_mappedFile.Close();
+   m_pHeader = nullptr;
+   m_pSubmeshes = nullptr;
+   m_pStringTable = nullptr;
+}
+
+const MeshCacheHeader& MeshCache::GetHeader() const
+{
+   return *m_pHeader;
+}
+
+uint64_t MeshCache::GetFileSize() const
+{
+   return m_mappedFile.GetSize();
+}
+
+uint32_t MeshCache::GetSubmeshCount() const
+{
+   return m_pHeader->submeshCount;
+}
+
+const MeshCacheSubmesh& MeshCache::GetSubmesh(uint32_t submesh) const
+{
+   return m_pSubmeshes[submesh];
+}
+
+const Vertex* MeshCache::GetVertices(uint32_t submesh) const
+{
+   return reinterpret_cast<const Vertex*>(m_mappedFile.GetData() + m_pSubmeshes[submesh].vertexOffset);
+}
+
+const uint32_t* MeshCache::GetIndices(uint32_t submesh) const
+{
+   return reinterpret_cast<const uint32_t*>(m_mappedFile.GetData() + m_pSubmeshes[submesh].indexOffset);
+}
+
+const Meshlet* MeshCache::GetMeshlets(uint32_t submesh) const
+{
+   return reinterpret_cast<const Meshlet*>(m_mappedFile.GetData() + m_pSubmeshes[submesh].meshletOffset);
+}
+
+const MeshLod* MeshCache::GetLods(uint32_t submesh) const
+{
+   return reinterpret_cast<const MeshLod*>(m_mappedFile.GetData() + m_pSubmeshes[submesh].lodOffset);
+}
+
+std::string MeshCache::GetTexturePath(uint32_t submesh) const
+{
+   return std::string(m_pStringTable + m_pSubmeshes[submesh].texturePathOffset, m_pSubmeshes[submesh].texturePathLength);
+}
+
+ImportedModel MeshCache::ToModel() const
+{
+   ImportedModel model = {};
+   model.meshes.resize(m_pHeader->submeshCount);
+   model.bytesRead = m_mappedFile.GetSize();
+   model.fromCache = true;
+
+   // Straight copies out of the mapping, nothing is parsed.
+   for (uint32_t i = 0; i < m_pHeader->submeshCount; i++)
+   {
+      const MeshCacheSubmesh& submesh = m_pSubmeshes[i];
+      ImportedMesh& mesh = model.meshes[i];
+      mesh.vertices.assign(GetVertices(i), GetVertices(i) + submesh.vertexCount);
+      mesh.indices.assign(GetIndices(i), GetIndices(i) + submesh.indexCount);
+      mesh.meshlets.assign(GetMeshlets(i), GetMeshlets(i) + submesh.meshletCount);
+      mesh.lods.assign(GetLods(i), GetLods(i) + submesh.lodCount);
+      mesh.texturePath = GetTexturePath(i);
+      mesh.textureIndex = UINT32_MAX;
+      mesh.boundsMin = glm::vec3(submesh.boundsMin[0], submesh.boundsMin[1], submesh.boundsMin[2]);
+      mesh.boundsMax = glm::vec3(submesh.boundsMax[0], submesh.boundsMax[1], submesh.boundsMax[2]);
+   }
+
+   return model;
+}
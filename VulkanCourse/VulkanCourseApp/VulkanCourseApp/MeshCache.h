@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "MeshImport.h"
+#include "MappedFile.h"
+
+// Layout of a mesh cache: header, submesh table, dependency table, string table of texture and dependency paths, then each
+// submesh's vertices, indices, meshlets and levels of detail.
+// Written beside a model file after its first import so later runs map it and skip the text parsing.
+// Everything is little endian and written exactly as these structs lie in memory, vertices as the Vertex struct itself.
+
+const char MESH_CACHE_MAGIC[4] = { 'V', 'K', 'M', 'C' };
+const uint32_t MESH_CACHE_VERSION = 6;         // 2: meshes are stored after OptimizeMesh. 3: meshlets. 4: levels of detail. 5: welded.
+                                               // 6: material libraries and buffers are stamped too.
+
+// Appended to the model's file name, "Models/giraffe.obj" caches to "Models/giraffe.obj.vkmesh".
+const std::string MESH_CACHE_EXTENSION = ".vkmesh";
+
+// Every vertex, index, meshlet and level of detail blob starts on this boundary, so they can be read in place as their structs.
+const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+struct MeshCacheHeader
+{
+   char magic[4];             // MESH_CACHE_MAGIC.
+   uint32_t version;          // MESH_CACHE_VERSION.
+   uint32_t vertexSize;       // sizeof(Vertex) when written, a changed layout makes the cache stale.
+   uint32_t submeshCount;     // Number of entries in the submesh table.
+   uint64_t sourceSize;       // Size of the model file the cache was made from.
+   int64_t sourceTime;        // Modification time of the model file, in the file system's own units.
+   uint64_t sourceBytesRead;  // Bytes the original import read, model plus material libraries and buffers.
+   float boundsMin[3];        // Bounds of every submesh together.
+   float boundsMax[3];
+   uint64_t submeshTableOffset;  // Where the submesh table starts in the file.
+   uint64_t stringTableOffset;   // Where the string table starts in the file.
+   uint32_t stringTableSize;  // Size of the string table in bytes.
+   uint32_t dependencyCount;  // Number of entries in the dependency table.
+   uint64_t dependencyTableOffset;  // Where the dependency table starts in the file.
+};
+
+struct MeshCacheSubmesh
+{
+   uint64_t vertexOffset;     // Where the vertices start in the file.
+   uint64_t indexOffset;      // Where the indices start in the file.
+   uint32_t vertexCount;
+   uint32_t indexCount;       // Every level of detail's indices together.
+   uint32_t texturePathOffset;   // Texture asset path in the string table.
+   uint32_t texturePathLength;   // Length of the path (no terminator), 0 if untextured.
+   float boundsMin[3];
+   float boundsMax[3];
+   uint64_t meshletOffset;    // Where the meshlets start in the file.
+   uint32_t meshletCount;
+   uint32_t lodCount;
+   uint64_t lodOffset;        // Where the levels of detail start in the file.
+};
+
+// Loose file the import read besides the model, the cache is stale once it differs from its stamp or is gone.
+struct MeshCacheDependency
+{
+   uint64_t size;
+   int64_t time;              // Modification time, in the file system's own units.
+   uint32_t pathOffset;       // Asset path in the string table.
+   uint32_t pathLength;       // Length of the path (no terminator).
+};
+
+static_assert(sizeof(MeshCacheHeader) == 96, "MeshCacheHeader must match the file layout.");
+static_assert(sizeof(MeshCacheSubmesh) == 80, "MeshCacheSubmesh must match the file layout.");
+static_assert(sizeof(MeshCacheDependency) == 24, "MeshCacheDependency must match the file layout.");
+
+// Size and modification time of a loose file. Returns false if it doesn't exist.
+bool GetFileStamp(const std::string& filePath, uint64_t* size, int64_t* time);
+
+// Write a model's meshes to a cache file, made from a source with the given stamp, along with the stamps of the model's
+// dependencies. Returns false if the file couldn't be written, the cache is only an optimization so callers carry on without it.
+bool WriteMeshCache(const std::string& cachePath, const ImportedModel& model, uint64_t sourceSize, int64_t sourceTime);
+
+// Read only view of a mesh cache file, mapped rather than read.
+class MeshCache
+{
+public:
+   MeshCache();
+   ~MeshCache();
+
+   // Returns false if there is no cache, it was made from a different source or by a different version, a file the import
+   // read besides the source has changed since, or it is damaged.
+   bool Open(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime);
+   void Close();
+
+   const MeshCacheHeader& GetHeader() const;
+   uint64_t GetFileSize() const;
+
+   uint32_t GetSubmeshCount() const;
+   const MeshCacheSubmesh& GetSubmesh(uint32_t submesh) const;
+   // Point straight into the mapping, valid until Close.
+   const Vertex* GetVertices(uint32_t submesh) const;
+   const uint32_t* GetIndices(uint32_t submesh) const;
+   const Meshlet* GetMeshlets(uint32_t submesh) const;
+   const MeshLod* GetLods(uint32_t submesh) const;
+   std::string GetTexturePath(uint32_t submesh) const;
+
+   // Copy every submesh out into an imported model, as if it was just parsed. That is one copy of each blob, the Mesh then
+   // packs the vertices into the GPU layout (and narrows small meshes' indices) into its own copies, which staging is filled from.
+   ImportedModel ToModel() const;
+
+private:
+   MappedFile m_mappedFile;
+
+   // Point straight into the mapping.
+   const MeshCacheHeader* m_pHeader = nullptr;
+   const MeshCacheSubmesh* m_pSubmeshes = nullptr;
+   const char* m_pStringTable = nullptr;
+};
@@ -0,0 +1,1317 @@
+#include "MeshImport.h"
+#include "MeshCache.h"
+
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <GLM/gtc/quaternion.hpp>
+
+/***********************************************************
+** Text Parsing.
+***********************************************************/
+static bool IsSpace(char c)
+{
+   return c == ' ' || c == '\t' || c == '\r';
+}
+
+static void SkipSpaces(const char*& p, const char* end)
+{
+   while (p < end && IsSpace(*p))
+   {
+      p++;
+   }
+}
+
+static const char* LineEnd(const char* p, const char* end)
+{
+   const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+   return newline ? newline : end;
+}
+
+// Rest of the line with the surrounding spaces cut off.
+static std::string RestOfLine(const char* p, const char* lineEnd)
+{
+   SkipSpaces(p, lineEnd);
+   while (lineEnd > p && IsSpace(lineEnd[-1]))
+   {
+      lineEnd--;
+   }
+   return std::string(p, lineEnd);
+}
+
+// Decimal number without locale or streams. Digits past what a uint64_t holds only move the exponent,
+// which is far more precision than vertex data keeps.
+static bool ParseDouble(const char*& p, const char* end, double* value)
+{
+   static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+   SkipSpaces(p, end);
+   const char* start = p;
+
+   bool negative = false;
+   if (p < end && (*p == '-' || *p == '+'))
+   {
+      negative = *p == '-';
+      p++;
+   }
+
+   uint64_t mantissa = 0;
+   int32_t exponent = 0;
+   bool hasDigits = false;
+   for (; p < end && *p >= '0' && *p <= '9'; p++)
+   {
+      if (mantissa < 1000000000000000000ull)
+      {
+         mantissa = mantissa * 10 + (*p - '0');
+      }
+      else
+      {
+         exponent++;
+      }
+      hasDigits = true;
+   }
+   if (p < end && *p == '.')
+   {
+      for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+      {
+         if (mantissa < 1000000000000000000ull)
+         {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+         }
+         hasDigits = true;
+      }
+   }
+   if (!hasDigits)
+   {
+      p = start;
+      return false;
+   }
+
+   if (p < end && (*p == 'e' || *p == 'E'))
+   {
+      const char* exponentStart = p;
+      p++;
+      bool negativeExponent = false;
+      if (p < end && (*p == '-' || *p == '+'))
+      {
+         negativeExponent = *p == '-';
+         p++;
+      }
+
+      int32_t written = 0;
+      bool hasExponent = false;
+      for (; p < end && *p >= '0' && *p <= '9'; p++)
+      {
+         written = written < 10000 ? written * 10 + (*p - '0') : written;
+         hasExponent = true;
+      }
+
+      // "1e" is the number 1 followed by junk.
+      if (hasExponent)
+      {
+         exponent += negativeExponent ? -written : written;
+      }
+      else
+      {
+         p = exponentStart;
+      }
+   }
+
+   // Powers up to 1e22 are exact doubles, one multiply or divide rounds correctly for most inputs.
+   double result = static_cast<double>(mantissa);
+   if (exponent < 0)
+   {
+      result = -exponent <= 22 ? result / powersOf10[-exponent] : result * pow(10.0, exponent);
+   }
+   else if (exponent > 0)
+   {
+      result = exponent <= 22 ? result * powersOf10[exponent] : result * pow(10.0, exponent);
+   }
+
+   *value = negative ? -result : result;
+   return true;
+}
+
+static bool ParseFloat(const char*& p, const char* end, float* value)
+{
+   double result;
+   if (!ParseDouble(p, end, &result))
+   {
+      return false;
+   }
+
+   *value = static_cast<float>(result);
+   return true;
+}
+
+static bool ParseInt(const char*& p, const char* end, int32_t* value)
+{
+   bool negative = false;
+   if (p < end && (*p == '-' || *p == '+'))
+   {
+      negative = *p == '-';
+      p++;
+   }
+
+   if (p >= end || *p < '0' || *p > '9')
+   {
+      return false;
+   }
+
+   int64_t result = 0;
+   for (; p < end && *p >= '0' && *p <= '9'; p++)
+   {
+      result = result < INT32_MAX ? result * 10 + (*p - '0') : result;
+   }
+
+   *value = static_cast<int32_t>(negative ? -std::min<int64_t>(result, INT32_MAX) : std::min<int64_t>(result, INT32_MAX));
+   return true;
+}
+
+// Does the line start with this keyword followed by a space?
+static bool MatchKeyword(const char*& p, const char* lineEnd, const char* keyword)
+{
+   size_t length = strlen(keyword);
+   if (static_cast<size_t>(lineEnd - p) < length || memcmp(p, keyword, length) != 0)
+   {
+      return false;
+   }
+   if (p + length < lineEnd && !IsSpace(p[length]))
+   {
+      return false;
+   }
+
+   p += length;
+   return true;
+}
+
+/***********************************************************
+** Paths.
+***********************************************************/
+// "Models/house/house.obj" -> "Models/house/"
+static std::string DirectoryOf(const std::string& assetPath)
+{
+   size_t slash = assetPath.find_last_of("/\\");
+   return slash == std::string::npos ? std::string() : assetPath.substr(0, slash + 1);
+}
+
+// Join a reference from inside a file to the file's directory, folding "." and ".." so the pack finds it.
+static std::string ResolvePath(const std::string& directory, const std::string& reference)
+{
+   std::string joined = directory + reference;
+   for (auto& c : joined)
+   {
+      c = c == '\\' ? '/' : c;
+   }
+
+   std::vector<std::string> parts;
+   size_t start = 0;
+   while (start <= joined.size())
+   {
+      size_t slash = joined.find('/', start);
+      if (slash == std::string::npos)
+      {
+         slash = joined.size();
+      }
+
+      std::string part = joined.substr(start, slash - start);
+      if (part == "..")
+      {
+         if (!parts.empty() && parts.back() != "..")
+         {
+            parts.pop_back();
+         }
+         else
+         {
+            parts.push_back(part);
+         }
+      }
+      else if (!part.empty() && part != ".")
+      {
+         parts.push_back(part);
+      }
+      start = slash + 1;
+   }
+
+   std::string resolved;
+   for (size_t i = 0; i < parts.size(); i++)
+   {
+      resolved += (i > 0 ? "/" : "") + parts[i];
+   }
+   return resolved;
+}
+
+static bool HasExtension(const std::string& fileName, const char* extension)
+{
+   size_t length = strlen(extension);
+   if (fileName.size() < length)
+   {
+      return false;
+   }
+
+   for (size_t i = 0; i < length; i++)
+   {
+      if (tolower(static_cast<unsigned char>(fileName[fileName.size() - length + i])) != extension[i])
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+// Read a file the model refers to, noting it as a dependency of the model if it's loose.
+// Stamped first, so a file that changes during the read is seen as changed the next time rather than missed.
+static AssetBytes ReadDependency(const std::string& assetPath, const AssetPack& assetPack, ImportedModel* model)
+{
+   ModelDependency dependency = { assetPath, 0, 0 };
+   if (!assetPack.Find(assetPath) && GetFileStamp(assetPath, &dependency.size, &dependency.time))
+   {
+      model->dependencies.push_back(dependency);
+   }
+
+   AssetBytes bytes = assetPack.Read(assetPath);
+   model->bytesRead += bytes.size;
+   return bytes;
+}
+
+/***********************************************************
+** OBJ.
+***********************************************************/
+struct ObjMaterial
+{
+   glm::vec3 color;
+   std::string texturePath;
+};
+
+static void ParseMtl(const AssetBytes& bytes, const std::string& directory, std::unordered_map<std::string, ObjMaterial>* materials)
+{
+   const char* p = reinterpret_cast<const char*>(bytes.Data());
+   const char* end = p + bytes.size;
+
+   ObjMaterial* current = nullptr;
+   while (p < end)
+   {
+      const char* lineEnd = LineEnd(p, end);
+      SkipSpaces(p, lineEnd);
+
+      if (MatchKeyword(p, lineEnd, "newmtl"))
+      {
+         current = &(*materials)[RestOfLine(p, lineEnd)];
+         current->color = glm::vec3(1.0f);
+      }
+      else if (current && MatchKeyword(p, lineEnd, "Kd"))
+      {
+         for (int i = 0; i < 3; i++)
+         {
+            ParseFloat(p, lineEnd, &current->color[i]);
+         }
+      }
+      else if (current && MatchKeyword(p, lineEnd, "map_Kd"))
+      {
+         // Options such as "-s 1 1 1" come first, the file name is the last word.
+         std::string rest = RestOfLine(p, lineEnd);
+         size_t space = rest.find_last_of(" \t");
+         current->texturePath = ResolvePath(directory, space == std::string::npos ? rest : rest.substr(space + 1));
+      }
+
+      p = lineEnd + 1;
+   }
+}
+
+bool IsObjFile(const std::string& fileName)
+{
+   return HasExtension(fileName, ".obj");
+}
+
+bool IsGltfFile(const std::string& fileName)
+{
+   return HasExtension(fileName, ".gltf") || HasExtension(fileName, ".glb");
+}
+
+std::vector<std::pair<size_t, size_t>> SplitObjChunks(const uint8_t* data, size_t size, size_t chunkSize)
+{
+   std::vector<std::pair<size_t, size_t>> chunks;
+   size_t begin = 0;
+   while (begin < size)
+   {
+      // Cut after the first line end past the target size, so no line is split.
+      size_t end = begin + chunkSize;
+      if (end >= size)
+      {
+         end = size;
+      }
+      else
+      {
+         const void* newline = memchr(data + end, '\n', size - end);
+         end = newline ? static_cast<const uint8_t*>(newline) - data + 1 : size;
+      }
+
+      chunks.push_back({ begin, end });
+      begin = end;
+   }
+
+   return chunks;
+}
+
+ObjChunk ParseObjChunk(const char* begin, const char* end)
+{
+   ObjChunk chunk;
+
+   // Corners of the face being read, reused between lines.
+   std::vector<ObjCorner> face;
+
+   const char* p = begin;
+   while (p < end)
+   {
+      const char* lineEnd = LineEnd(p, end);
+      SkipSpaces(p, lineEnd);
+
+      if (MatchKeyword(p, lineEnd, "v"))
+      {
+         // Extra vertex color components some exporters write are ignored.
+         glm::vec3 position;
+         if (!ParseFloat(p, lineEnd, &position.x) || !ParseFloat(p, lineEnd, &position.y) || !ParseFloat(p, lineEnd, &position.z))
+         {
+            throw std::runtime_error("Malformed OBJ vertex position!");
+         }
+         chunk.positions.push_back(position);
+      }
+      else if (MatchKeyword(p, lineEnd, "vt"))
+      {
+         glm::vec2 texCoord;
+         if (!ParseFloat(p, lineEnd, &texCoord.x))
+         {
+            throw std::runtime_error("Malformed OBJ texture coordinate!");
+         }
+         texCoord.y = 0.0f;
+         ParseFloat(p, lineEnd, &texCoord.y);
+         chunk.texCoords.push_back(texCoord);
+      }
+      else if (MatchKeyword(p, lineEnd, "f"))
+      {
+         // "v", "v/vt", "v//vn" or "v/vt/vn", normals aren't used.
+         face.clear();
+         for (;;)
+         {
+            SkipSpaces(p, lineEnd);
+            if (p >= lineEnd)
+            {
+               break;
+            }
+
+            ObjCorner corner = {};
+            int32_t index;
+            if (!ParseInt(p, lineEnd, &index) || index == 0)
+            {
+               throw std::runtime_error("Malformed OBJ face!");
+            }
+            corner.position = index > 0 ? index - 1 : static_cast<int32_t>(chunk.positions.size()) + index;
+            corner.flags = index > 0 ? 0 : OBJ_CORNER_RELATIVE_POSITION;
+
+            corner.flags |= OBJ_CORNER_NO_TEX_COORD;
+            if (p < lineEnd && *p == '/')
+            {
+               p++;
+               if (ParseInt(p, lineEnd, &index))
+               {
+                  if (index == 0)
+                  {
+                     throw std::runtime_error("Malformed OBJ face!");
+                  }
+                  corner.texCoord = index > 0 ? index - 1 : static_cast<int32_t>(chunk.texCoords.size()) + index;
+                  corner.flags &= ~OBJ_CORNER_NO_TEX_COORD;
+                  corner.flags |= index > 0 ? 0 : OBJ_CORNER_RELATIVE_TEX_COORD;
+               }
+               if (p < lineEnd && *p == '/')
+               {
+                  p++;
+                  ParseInt(p, lineEnd, &index);
+               }
+            }
+
+            face.push_back(corner);
+         }
+
+         // Polygons become a fan around their first corner.
+         for (size_t i = 2; i < face.size(); i++)
+         {
+            chunk.corners.push_back(face[0]);
+            chunk.corners.push_back(face[i - 1]);
+            chunk.corners.push_back(face[i]);
+         }
+      }
+      else if (MatchKeyword(p, lineEnd, "usemtl"))
+      {
+         chunk.materialSwitches.push_back({ RestOfLine(p, lineEnd), chunk.corners.size() });
+      }
+      else if (MatchKeyword(p, lineEnd, "mtllib"))
+      {
+         chunk.materialLibraries.push_back(RestOfLine(p, lineEnd));
+      }
+
+      p = lineEnd + 1;
+   }
+
+   return chunk;
+}
+
+ImportedModel BuildObjModel(const std::vector<ObjChunk>& chunks, const std::string& assetPath, const AssetPack& assetPack)
+{
+   ImportedModel model = {};
+   std::string directory = DirectoryOf(assetPath);
+
+   // Materials come from libraries beside the model.
+   std::unordered_map<std::string, ObjMaterial> materials;
+   for (const auto& chunk : chunks)
+   {
+      for (const auto& library : chunk.materialLibraries)
+      {
+         std::string libraryPath = ResolvePath(directory, library);
+         AssetBytes bytes = ReadDependency(libraryPath, assetPack, &model);
+         ParseMtl(bytes, DirectoryOf(libraryPath), &materials);
+      }
+   }
+
+   // Indices count across the whole file, each chunk's local ones start after everything before it.
+   size_t totalPositions = 0, totalTexCoords = 0;
+   for (const auto& chunk : chunks)
+   {
+      totalPositions += chunk.positions.size();
+      totalTexCoords += chunk.texCoords.size();
+   }
+
+   std::vector<glm::vec3> positions;
+   std::vector<glm::vec2> texCoords;
+   positions.reserve(totalPositions);
+   texCoords.reserve(totalTexCoords);
+   for (const auto& chunk : chunks)
+   {
+      positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+      texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+   }
+
+   // A mesh per material, each with its own vertices. Corners sharing position and texture coordinate share a vertex.
+   std::unordered_map<std::string, size_t> meshOfMaterial;
+   std::vector<std::unordered_map<uint64_t, uint32_t>> vertexOfCorner;
+   std::vector<glm::vec3> meshColors;
+   std::string material;
+   size_t meshIndex = SIZE_MAX;
+
+   size_t positionBase = 0, texCoordBase = 0;
+   for (const auto& chunk : chunks)
+   {
+      size_t nextSwitch = 0;
+      for (size_t c = 0; c < chunk.corners.size(); c++)
+      {
+         while (nextSwitch < chunk.materialSwitches.size() && chunk.materialSwitches[nextSwitch].firstCorner == c)
+         {
+            material = chunk.materialSwitches[nextSwitch].material;
+            meshIndex = SIZE_MAX;
+            nextSwitch++;
+         }
+
+         if (meshIndex == SIZE_MAX)
+         {
+            auto found = meshOfMaterial.find(material);
+            if (found == meshOfMaterial.end())
+            {
+               // Unknown materials draw white and untextured.
+               ImportedMesh mesh = {};
+               auto known = materials.find(material);
+               mesh.texturePath = known != materials.end() ? known->second.texturePath : std::string();
+               mesh.textureIndex = UINT32_MAX;
+
+               found = meshOfMaterial.emplace(material, model.meshes.size()).first;
+               model.meshes.push_back(std::move(mesh));
+               vertexOfCorner.emplace_back();
+               meshColors.push_back(known != materials.end() ? known->second.color : glm::vec3(1.0f));
+            }
+            meshIndex = found->second;
+         }
+
+         const ObjCorner& corner = chunk.corners[c];
+         int64_t position = corner.position + ((corner.flags & OBJ_CORNER_RELATIVE_POSITION) ? static_cast<int64_t>(positionBase) : 0);
+         int64_t texCoord = -1;
+         if (!(corner.flags & OBJ_CORNER_NO_TEX_COORD))
+         {
+            texCoord = corner.texCoord + ((corner.flags & OBJ_CORNER_RELATIVE_TEX_COORD) ? static_cast<int64_t>(texCoordBase) : 0);
+            if (texCoord < 0 || texCoord >= static_cast<int64_t>(texCoords.size()))
+            {
+               throw std::runtime_error("OBJ face uses a texture coordinate that doesn't exist! (" + assetPath + ")");
+            }
+         }
+         if (position < 0 || position >= static_cast<int64_t>(positions.size()))
+         {
+            throw std::runtime_error("OBJ face uses a vertex that doesn't exist! (" + assetPath + ")");
+         }
+
+         ImportedMesh& mesh = model.meshes[meshIndex];
+         uint64_t key = (static_cast<uint64_t>(position) << 32) | static_cast<uint32_t>(texCoord + 1);
+         auto vertex = vertexOfCorner[meshIndex].find(key);
+         if (vertex == vertexOfCorner[meshIndex].end())
+         {
+            // OBJ puts v = 0 at the bottom of the image, Vulkan at the top.
+            Vertex newVertex = {};
+            newVertex.pos = positions[position];
+            newVertex.col = meshColors[meshIndex];
+            newVertex.tex = texCoord >= 0 ? glm::vec2(texCoords[texCoord].x, 1.0f - texCoords[texCoord].y) : glm::vec2(0.0f);
+
+            vertex = vertexOfCorner[meshIndex].emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+            mesh.vertices.push_back(newVertex);
+         }
+         mesh.indices.push_back(vertex->second);
+      }
+
+      // Switches after the chunk's last face still apply to the next chunk.
+      for (; nextSwitch < chunk.materialSwitches.size(); nextSwitch++)
+      {
+         material = chunk.materialSwitches[nextSwitch].material;
+         meshIndex = SIZE_MAX;
+      }
+
+      positionBase += chunk.positions.size();
+      texCoordBase += chunk.texCoords.size();
+   }
+
+   return model;
+}
+
+/***********************************************************
+** JSON.
+***********************************************************/
+// Just enough JSON for glTF. Objects keep their keys in order, lookups are linear, which is fine for the handful each one has.
+struct JsonValue
+{
+   enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+   Type type = JSON_NULL;
+   bool boolean = false;
+   double number = 0.0;
+   std::string string;
+   std::vector<JsonValue> array;
+   std::vector<std::pair<std::string, JsonValue>> object;
+
+   const JsonValue* Find(const char* key) const
+   {
+      for (const auto& member : object)
+      {
+         if (member.first == key)
+         {
+            return &member.second;
+         }
+      }
+      return nullptr;
+   }
+
+   const JsonValue* At(size_t index) const
+   {
+      return type == JSON_ARRAY && index < array.size() ? &array[index] : nullptr;
+   }
+};
+
+class JsonParser
+{
+public:
+   JsonParser(const char* begin, const char* end) : m_p(begin), m_end(end)
+   {
+   }
+
+   JsonValue ParseDocument()
+   {
+      JsonValue value = ParseValue(0);
+      SkipWhitespace();
+      if (m_p != m_end)
+      {
+         Fail();
+      }
+      return value;
+   }
+
+private:
+   static const int MAX_DEPTH = 128;
+
+   [[noreturn]] void Fail()
+   {
+      throw std::runtime_error("Malformed glTF JSON!");
+   }
+
+   void SkipWhitespace()
+   {
+      while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n'))
+      {
+         m_p++;
+      }
+   }
+
+   void Expect(char c)
+   {
+      SkipWhitespace();
+      if (m_p >= m_end || *m_p != c)
+      {
+         Fail();
+      }
+      m_p++;
+   }
+
+   bool Consume(const char* literal)
+   {
+      size_t length = strlen(literal);
+      if (static_cast<size_t>(m_end - m_p) >= length && memcmp(m_p, literal, length) == 0)
+      {
+         m_p += length;
+         return true;
+      }
+      return false;
+   }
+
+   JsonValue ParseValue(int depth)
+   {
+      if (depth > MAX_DEPTH)
+      {
+         Fail();
+      }
+
+      SkipWhitespace();
+      if (m_p >= m_end)
+      {
+         Fail();
+      }
+
+      JsonValue value;
+      if (*m_p == '{')
+      {
+         value.type = JsonValue::JSON_OBJECT;
+         m_p++;
+         SkipWhitespace();
+         if (m_p < m_end && *m_p == '}')
+         {
+            m_p++;
+            return value;
+         }
+         for (;;)
+         {
+            SkipWhitespace();
+            std::string key = ParseString();
+            Expect(':');
+            value.object.emplace_back(std::move(key), ParseValue(depth + 1));
+            SkipWhitespace();
+            if (m_p < m_end && *m_p == ',')
+            {
+               m_p++;
+               continue;
+            }
+            Expect('}');
+            return value;
+         }
+      }
+      if (*m_p == '[')
+      {
+         value.type = JsonValue::JSON_ARRAY;
+         m_p++;
+         SkipWhitespace();
+         if (m_p < m_end && *m_p == ']')
+         {
+            m_p++;
+            return value;
+         }
+         for (;;)
+         {
+            value.array.push_back(ParseValue(depth + 1));
+            SkipWhitespace();
+            if (m_p < m_end && *m_p == ',')
+            {
+               m_p++;
+               continue;
+            }
+            Expect(']');
+            return value;
+         }
+      }
+      if (*m_p == '"')
+      {
+         value.type = JsonValue::JSON_STRING;
+         value.string = ParseString();
+         return value;
+      }
+      if (Consume("true"))
+      {
+         value.type = JsonValue::JSON_BOOL;
+         value.boolean = true;
+         return value;
+      }
+      if (Consume("false"))
+      {
+         value.type = JsonValue::JSON_BOOL;
+         return value;
+      }
+      if (Consume("null"))
+      {
+         return value;
+      }
+
+      // Doubles hold every byte offset and count a glTF file can have exactly.
+      double number;
+      if (!ParseDouble(m_p, m_end, &number))
+      {
+         Fail();
+      }
+      value.type = JsonValue::JSON_NUMBER;
+      value.number = number;
+      return value;
+   }
+
+   std::string ParseString()
+   {
+      if (m_p >= m_end || *m_p != '"')
+      {
+         Fail();
+      }
+      m_p++;
+
+      std::string result;
+      while (m_p < m_end && *m_p != '"')
+      {
+         char c = *m_p++;
+         if (c != '\\')
+         {
+            result += c;
+            continue;
+         }
+
+         if (m_p >= m_end)
+         {
+            Fail();
+         }
+         c = *m_p++;
+         switch (c)
+         {
+         case 'n': result += '\n'; break;
+         case 't': result += '\t'; break;
+         case 'r': result += '\r'; break;
+         case 'b': result += '\b'; break;
+         case 'f': result += '\f'; break;
+         case 'u':
+         {
+            // glTF names and URIs are almost always ASCII, anything else is written out as UTF-8. (no surrogate pairs)
+            if (m_end - m_p < 4)
+            {
+               Fail();
+            }
+            uint32_t code = 0;
+            for (int i = 0; i < 4; i++)
+            {
+               char h = *m_p++;
+               code = code * 16 + (h >= '0' && h <= '9' ? h - '0' : h >= 'a' && h <= 'f' ? h - 'a' + 10 : h >= 'A' && h <= 'F' ? h - 'A' + 10 : 0);
+            }
+            if (code < 0x80)
+            {
+               result += static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+               result += static_cast<char>(0xC0 | (code >> 6));
+               result += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else
+            {
+               result += static_cast<char>(0xE0 | (code >> 12));
+               result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+               result += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            break;
+         }
+         default: result += c; break;
+         }
+      }
+
+      if (m_p >= m_end)
+      {
+         Fail();
+      }
+      m_p++;
+      return result;
+   }
+
+   const char* m_p;
+   const char* m_end;
+};
+
+static int64_t GetInt(const JsonValue* object, const char* key, int64_t defaultValue)
+{
+   const JsonValue* value = object ? object->Find(key) : nullptr;
+   return value && value->type == JsonValue::JSON_NUMBER ? static_cast<int64_t>(value->number) : defaultValue;
+}
+
+static const JsonValue* GetElement(const JsonValue& root, const char* arrayName, int64_t index)
+{
+   const JsonValue* array = root.Find(arrayName);
+   return array && index >= 0 ? array->At(static_cast<size_t>(index)) : nullptr;
+}
+
+/***********************************************************
+** glTF.
+***********************************************************/
+const uint32_t GLB_MAGIC = 0x46546C67;          // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;     // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;      // "BIN\0"
+
+const int64_t GLTF_BYTE = 5120;
+const int64_t GLTF_UNSIGNED_BYTE = 5121;
+const int64_t GLTF_SHORT = 5122;
+const int64_t GLTF_UNSIGNED_SHORT = 5123;
+const int64_t GLTF_UNSIGNED_INT = 5125;
+const int64_t GLTF_FLOAT = 5126;
+const int64_t GLTF_TRIANGLES = 4;
+
+static std::vector<uint8_t> DecodeBase64(const char* p, const char* end)
+{
+   std::vector<uint8_t> bytes;
+   bytes.reserve((end - p) / 4 * 3);
+
+   uint32_t bits = 0;
+   int bitCount = 0;
+   for (; p < end && *p != '='; p++)
+   {
+      char c = *p;
+      int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 : c >= '0' && c <= '9' ? c - '0' + 52 :
+         c == '+' ? 62 : c == '/' ? 63 : -1;
+      if (value < 0)
+      {
+         throw std::runtime_error("Malformed base64 glTF buffer!");
+      }
+
+      bits = (bits << 6) | static_cast<uint32_t>(value);
+      bitCount += 6;
+      if (bitCount >= 8)
+      {
+         bitCount -= 8;
+         bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+      }
+   }
+
+   return bytes;
+}
+
+struct GltfFile
+{
+   JsonValue root;
+   std::vector<AssetBytes> buffers;
+   std::string directory;
+   std::string assetPath;
+};
+
+// Bytes of an accessor's elements, with their stride and component layout. Throws if any of it lies outside its buffer.
+struct GltfAccessorView
+{
+   const uint8_t* data;
+   size_t stride;
+   size_t count;
+   int64_t componentType;
+   uint32_t componentCount;
+   bool normalized;
+};
+
+static uint32_t ComponentSize(int64_t componentType)
+{
+   switch (componentType)
+   {
+   case GLTF_BYTE: case GLTF_UNSIGNED_BYTE: return 1;
+   case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: return 2;
+   case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+   default: return 0;
+   }
+}
+
+static GltfAccessorView GetAccessorView(const GltfFile& file, int64_t accessorIndex)
+{
+   const JsonValue* accessor = GetElement(file.root, "accessors", accessorIndex);
+   if (!accessor)
+   {
+      throw std::runtime_error("glTF accessor doesn't exist! (" + file.assetPath + ")");
+   }
+   if (accessor->Find("sparse"))
+   {
+      throw std::runtime_error("Sparse glTF accessors aren't supported! (" + file.assetPath + ")");
+   }
+
+   GltfAccessorView view = {};
+   view.count = static_cast<size_t>(GetInt(accessor, "count", 0));
+   view.componentType = GetInt(accessor, "componentType", 0);
+   const JsonValue* normalized = accessor->Find("normalized");
+   view.normalized = normalized && normalized->boolean;
+
+   const JsonValue* type = accessor->Find("type");
+   std::string typeName = type ? type->string : std::string();
+   view.componentCount = typeName == "SCALAR" ? 1 : typeName == "VEC2" ? 2 : typeName == "VEC3" ? 3 : typeName == "VEC4" ? 4 : 0;
+
+   uint32_t elementSize = ComponentSize(view.componentType) * view.componentCount;
+   if (elementSize == 0)
+   {
+      throw std::runtime_error("Unsupported glTF accessor type! (" + file.assetPath + ")");
+   }
+
+   const JsonValue* bufferView = GetElement(file.root, "bufferViews", GetInt(accessor, "bufferView", -1));
+   if (!bufferView)
+   {
+      throw std::runtime_error("glTF accessor without a buffer view isn't supported! (" + file.assetPath + ")");
+   }
+
+   int64_t bufferIndex = GetInt(bufferView, "buffer", -1);
+   if (bufferIndex < 0 || bufferIndex >= static_cast<int64_t>(file.buffers.size()))
+   {
+      throw std::runtime_error("glTF buffer view uses a buffer that doesn't exist! (" + file.assetPath + ")");
+   }
+   const AssetBytes& buffer = file.buffers[static_cast<size_t>(bufferIndex)];
+
+   uint64_t viewOffset = static_cast<uint64_t>(GetInt(bufferView, "byteOffset", 0));
+   uint64_t viewLength = static_cast<uint64_t>(GetInt(bufferView, "byteLength", 0));
+   uint64_t accessorOffset = static_cast<uint64_t>(GetInt(accessor, "byteOffset", 0));
+   view.stride = static_cast<size_t>(GetInt(bufferView, "byteStride", elementSize));
+
+   // Last element ends at offset + stride * (count - 1) + elementSize, all of it inside the view and the view inside the buffer.
+   uint64_t needed = view.count == 0 ? 0 : accessorOffset + static_cast<uint64_t>(view.stride) * (view.count - 1) + elementSize;
+   if (view.stride < elementSize || viewOffset + viewLength > buffer.size || needed > viewLength)
+   {
+      throw std::runtime_error("glTF accessor reads outside its buffer! (" + file.assetPath + ")");
+   }
+
+   view.data = buffer.Data() + viewOffset + accessorOffset;
+   return view;
+}
+
+static float ReadComponent(const uint8_t* src, int64_t componentType, bool normalized)
+{
+   switch (componentType)
+   {
+   case GLTF_FLOAT: { float v; memcpy(&v, src, 4); return v; }
+   case GLTF_UNSIGNED_BYTE: return normalized ? src[0] / 255.0f : src[0];
+   case GLTF_BYTE: { int8_t v; memcpy(&v, src, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+   case GLTF_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, src, 2); return normalized ? v / 65535.0f : v; }
+   case GLTF_SHORT: { int16_t v; memcpy(&v, src, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+   case GLTF_UNSIGNED_INT: { uint32_t v; memcpy(&v, src, 4); return static_cast<float>(v); }
+   default: return 0.0f;
+   }
+}
+
+// Element i of an accessor as floats, missing components stay as they are in out.
+static void ReadElement(const GltfAccessorView& view, size_t i, float* out, uint32_t outCount)
+{
+   const uint8_t* element = view.data + view.stride * i;
+   uint32_t componentSize = ComponentSize(view.componentType);
+   for (uint32_t c = 0; c < std::min(outCount, view.componentCount); c++)
+   {
+      out[c] = ReadComponent(element + c * componentSize, view.componentType, view.normalized);
+   }
+}
+
+static void AppendPrimitive(const GltfFile& file, const JsonValue& primitive, const glm::mat4& transform, ImportedModel* model)
+{
+   if (GetInt(&primitive, "mode", GLTF_TRIANGLES) != GLTF_TRIANGLES)
+   {
+      return;
+   }
+
+   const JsonValue* attributes = primitive.Find("attributes");
+   int64_t positionAccessor = GetInt(attributes, "POSITION", -1);
+   if (positionAccessor < 0)
+   {
+      return;
+   }
+
+   ImportedMesh mesh = {};
+   mesh.textureIndex = UINT32_MAX;
+
+   // Base color factor tints the vertices, its texture becomes the mesh's texture.
+   glm::vec4 baseColor(1.0f);
+   const JsonValue* material = GetElement(file.root, "materials", GetInt(&primitive, "material", -1));
+   const JsonValue* pbr = material ? material->Find("pbrMetallicRoughness") : nullptr;
+   if (pbr)
+   {
+      const JsonValue* factor = pbr->Find("baseColorFactor");
+      for (size_t c = 0; factor && c < 4 && c < factor->array.size(); c++)
+      {
+         baseColor[static_cast<int>(c)] = static_cast<float>(factor->array[c].number);
+      }
+
+      const JsonValue* texture = GetElement(file.root, "textures", GetInt(pbr->Find("baseColorTexture"), "index", -1));
+      const JsonValue* image = GetElement(file.root, "images", GetInt(texture, "source", -1));
+      const JsonValue* uri = image ? image->Find("uri") : nullptr;
+
+      // Images embedded in buffers or data URIs would need decoding from memory, they keep the placeholder.
+      if (uri && uri->type == JsonValue::JSON_STRING && uri->string.compare(0, 5, "data:") != 0)
+      {
+         mesh.texturePath = ResolvePath(file.directory, uri->string);
+      }
+   }
+
+   GltfAccessorView positions = GetAccessorView(file, positionAccessor);
+   int64_t texCoordAccessor = GetInt(attributes, "TEXCOORD_0", -1);
+   int64_t colorAccessor = GetInt(attributes, "COLOR_0", -1);
+   GltfAccessorView texCoords = texCoordAccessor >= 0 ? GetAccessorView(file, texCoordAccessor) : GltfAccessorView{};
+   GltfAccessorView colors = colorAccessor >= 0 ? GetAccessorView(file, colorAccessor) : GltfAccessorView{};
+
+   mesh.vertices.resize(positions.count);
+   for (size_t i = 0; i < positions.count; i++)
+   {
+      Vertex& vertex = mesh.vertices[i];
+
+      float position[3] = { 0.0f, 0.0f, 0.0f };
+      ReadElement(positions, i, position, 3);
+      vertex.pos = glm::vec3(transform * glm::vec4(position[0], position[1], position[2], 1.0f));
+
+      // glTF puts texture coordinate 0, 0 at the top left already, same as Vulkan.
+      float texCoord[2] = { 0.0f, 0.0f };
+      if (i < texCoords.count)
+      {
+         ReadElement(texCoords, i, texCoord, 2);
+      }
+      vertex.tex = glm::vec2(texCoord[0], texCoord[1]);
+
+      float color[3] = { 1.0f, 1.0f, 1.0f };
+      if (i < colors.count)
+      {
+         ReadElement(colors, i, color, 3);
+      }
+      vertex.col = glm::vec3(color[0], color[1], color[2]) * glm::vec3(baseColor);
+   }
+
+   // No indices means every three vertices are a triangle.
+   int64_t indexAccessor = GetInt(&primitive, "indices", -1);
+   if (indexAccessor >= 0)
+   {
+      GltfAccessorView indices = GetAccessorView(file, indexAccessor);
+      if (indices.componentCount != 1 || indices.componentType == GLTF_FLOAT)
+      {
+         throw std::runtime_error("Unsupported glTF index type! (" + file.assetPath + ")");
+      }
+
+      mesh.indices.resize(indices.count);
+      uint32_t componentSize = ComponentSize(indices.componentType);
+      for (size_t i = 0; i < indices.count; i++)
+      {
+         uint32_t index = 0;
+         memcpy(&index, indices.data + indices.stride * i, componentSize);
+         if (index >= positions.count)
+         {
+            throw std::runtime_error("glTF index refers to a vertex that doesn't exist! (" + file.assetPath + ")");
+         }
+         mesh.indices[i] = index;
+      }
+   }
+   else
+   {
+      mesh.indices.resize(positions.count);
+      for (size_t i = 0; i < positions.count; i++)
+      {
+         mesh.indices[i] = static_cast<uint32_t>(i);
+      }
+   }
+
+   // A mirroring transform turns the triangles inside out, swap two corners to keep the front faces in front.
+   if (glm::determinant(glm::mat3(transform)) < 0.0f)
+   {
+      for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+      {
+         std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+      }
+   }
+
+   mesh.indices.resize(mesh.indices.size() / 3 * 3);
+   model->meshes.push_back(std::move(mesh));
+}
+
+static glm::mat4 NodeTransform(const JsonValue& node)
+{
+   const JsonValue* matrix = node.Find("matrix");
+   if (matrix && matrix->array.size() == 16)
+   {
+      // Column major, same as glm.
+      glm::mat4 result;
+      for (int i = 0; i < 16; i++)
+      {
+         result[i / 4][i % 4] = static_cast<float>(matrix->array[i].number);
+      }
+      return result;
+   }
+
+   glm::vec3 translation(0.0f), scale(1.0f);
+   glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+   const JsonValue* t = node.Find("translation");
+   const JsonValue* r = node.Find("rotation");
+   const JsonValue* s = node.Find("scale");
+   if (t && t->array.size() == 3)
+   {
+      translation = glm::vec3(t->array[0].number, t->array[1].number, t->array[2].number);
+   }
+   if (r && r->array.size() == 4)
+   {
+      // Stored x, y, z, w.
+      rotation = glm::quat(static_cast<float>(r->array[3].number), static_cast<float>(r->array[0].number),
+         static_cast<float>(r->array[1].number), static_cast<float>(r->array[2].number));
+   }
+   if (s && s->array.size() == 3)
+   {
+      scale = glm::vec3(s->array[0].number, s->array[1].number, s->array[2].number);
+   }
+
+   return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+static void AppendNode(const GltfFile& file, int64_t nodeIndex, const glm::mat4& parentTransform, int depth, ImportedModel* model)
+{
+   const JsonValue* node = GetElement(file.root, "nodes", nodeIndex);
+   if (!node || depth > 64)
+   {
+      throw std::runtime_error("glTF node hierarchy is broken! (" + file.assetPath + ")");
+   }
+
+   glm::mat4 transform = parentTransform * NodeTransform(*node);
+
+   const JsonValue* mesh = GetElement(file.root, "meshes", GetInt(node, "mesh", -1));
+   const JsonValue* primitives = mesh ? mesh->Find("primitives") : nullptr;
+   for (size_t i = 0; primitives && i < primitives->array.size(); i++)
+   {
+      AppendPrimitive(file, primitives->array[i], transform, model);
+   }
+
+   const JsonValue* children = node->Find("children");
+   for (size_t i = 0; children && i < children->array.size(); i++)
+   {
+      AppendNode(file, static_cast<int64_t>(children->array[i].number), transform, depth + 1, model);
+   }
+}
+
+ImportedModel ParseGltf(const uint8_t* data, size_t size, const std::string& assetPath, const AssetPack& assetPack)
+{
+   ImportedModel model = {};
+
+   GltfFile file;
+   file.assetPath = assetPath;
+   file.directory = DirectoryOf(assetPath);
+
+   // Binary glTF is a 12 byte header and chunks, JSON first and then an optional binary buffer.
+   const char* json = reinterpret_cast<const char*>(data);
+   size_t jsonSize = size;
+   const uint8_t* binChunk = nullptr;
+   size_t binSize = 0;
+
+   uint32_t magic = 0;
+   if (size >= 4)
+   {
+      memcpy(&magic, data, 4);
+   }
+   if (magic == GLB_MAGIC)
+   {
+      json = nullptr;
+      for (size_t offset = 12; offset + 8 <= size;)
+      {
+         uint32_t chunkLength, chunkType;
+         memcpy(&chunkLength, data + offset, 4);
+         memcpy(&chunkType, data + offset + 4, 4);
+         if (chunkLength > size - offset - 8)
+         {
+            throw std::runtime_error("Truncated GLB chunk! (" + assetPath + ")");
+         }
+
+         if (chunkType == GLB_CHUNK_JSON && !json)
+         {
+            json = reinterpret_cast<const char*>(data + offset + 8);
+            jsonSize = chunkLength;
+         }
+         else if (chunkType == GLB_CHUNK_BIN && !binChunk)
+         {
+            binChunk = data + offset + 8;
+            binSize = chunkLength;
+         }
+         offset += 8 + static_cast<size_t>(chunkLength);
+      }
+
+      if (!json)
+      {
+         throw std::runtime_error("GLB file has no JSON chunk! (" + assetPath + ")");
+      }
+   }
+
+   file.root = JsonParser(json, json + jsonSize).ParseDocument();
+
+   // Buffers are the GLB binary chunk, a base64 data URI, or a file beside the model.
+   const JsonValue* buffers = file.root.Find("buffers");
+   for (size_t i = 0; buffers && i < buffers->array.size(); i++)
+   {
+      const JsonValue* uri = buffers->array[i].Find("uri");
+      AssetBytes bytes = {};
+      if (!uri)
+      {
+         if (!binChunk)
+         {
+            throw std::runtime_error("glTF buffer has no data! (" + assetPath + ")");
+         }
+         bytes.mappedData = binChunk;
+         bytes.size = binSize;
+      }
+      else if (uri->string.compare(0, 5, "data:") == 0)
+      {
+         size_t comma = uri->string.find(',');
+         if (comma == std::string::npos || uri->string.rfind(";base64", comma) == std::string::npos)
+         {
+            throw std::runtime_error("glTF data URI isn't base64! (" + assetPath + ")");
+         }
+         bytes.storage = DecodeBase64(uri->string.data() + comma + 1, uri->string.data() + uri->string.size());
+         bytes.size = bytes.storage.size();
+      }
+      else
+      {
+         bytes = ReadDependency(ResolvePath(file.directory, uri->string), assetPack, &model);
+      }
+      file.buffers.push_back(std::move(bytes));
+   }
+
+   // The default scene's node trees, or every mesh as it is if the file has no scenes.
+   const JsonValue* scene = GetElement(file.root, "scenes", GetInt(&file.root, "scene", 0));
+   const JsonValue* nodes = scene ? scene->Find("nodes") : nullptr;
+   if (nodes)
+   {
+      for (size_t i = 0; i < nodes->array.size(); i++)
+      {
+         AppendNode(file, static_cast<int64_t>(nodes->array[i].number), glm::mat4(1.0f), 0, &model);
+      }
+   }
+   else
+   {
+      const JsonValue* meshes = file.root.Find("meshes");
+      for (size_t m = 0; meshes && m < meshes->array.size(); m++)
+      {
+         const JsonValue* primitives = meshes->array[m].Find("primitives");
+         for (size_t i = 0; primitives && i < primitives->array.size(); i++)
+         {
+            AppendPrimitive(file, primitives->array[i], glm::mat4(1.0f), &model);
+         }
+      }
+   }
+
+   return model;
+}
+
+void ComputeMeshBounds(ImportedMesh* mesh)
+{
+   if (mesh->vertices.empty())
+   {
+      mesh->boundsMin = glm::vec3(0.0f);
+      mesh->boundsMax = glm::vec3(0.0f);
+      return;
+   }
+
+   mesh->boundsMin = mesh->vertices[0].pos;
+   mesh->boundsMax = mesh->vertices[0].pos;
+   for (const Vertex& vertex : mesh->vertices)
+   {
+      mesh->boundsMin = glm::min(mesh->boundsMin, vertex.pos);
+      mesh->boundsMax = glm::max(mesh->boundsMax, vertex.pos);
+   }
+}
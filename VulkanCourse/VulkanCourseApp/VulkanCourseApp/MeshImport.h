@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Utilities.h"
+#include "AssetPack.h"
+#include "MeshOptimize.h"
+#include "Meshlet.h"
+#include "MeshSimplify.h"
+
+// Model file names are relative to this, both loose and inside the asset pack.
+const std::string MODEL_DIRECTORY = "Models/";
+
+// OBJ files are split at line ends into pieces of about this size, each parsed on its own worker.
+const size_t OBJ_CHUNK_SIZE = 1024 * 1024;
+
+// Geometry of one material, drawn as one Mesh.
+struct ImportedMesh
+{
+   std::vector<Vertex> vertices;
+   std::vector<uint32_t> indices;
+   std::string texturePath;      // Asset path of the base color texture, empty if there is none.
+   uint32_t textureIndex;        // Index into ImportedScene::textureFiles, UINT32_MAX if untextured.
+   glm::vec3 boundsMin;          // Axis aligned bounds of the vertices, see ComputeMeshBounds.
+   glm::vec3 boundsMax;
+   std::vector<Meshlet> meshlets;   // Clusters of the index list, built after it was optimized.
+   std::vector<MeshLod> lods;       // Levels of detail, level 0 the full mesh. Their index lists follow each other in indices.
+};
+
+// Loose file besides the model that its import read, a material library or a glTF buffer, stamped just before the read.
+struct ModelDependency
+{
+   std::string path;             // Asset path, as it was read.
+   uint64_t size;
+   int64_t time;                 // Modification time, see GetFileStamp.
+};
+
+struct ImportedModel
+{
+   std::string fileName;
+   std::vector<ImportedMesh> meshes;
+   std::vector<ModelDependency> dependencies;   // Packed files aren't listed, the pack doesn't change under a running import.
+   uint64_t bytesRead;           // Model file plus the material libraries and buffers it pulled in.
+   bool fromCache;               // Loaded from its mesh cache instead of parsed.
+   VertexWeldStats weld;         // Every mesh's welding, zero if loaded from cache.
+   VertexCacheStats vertexCacheBefore;    // Every mesh as parsed and after OptimizeMesh, both zero if loaded from cache.
+   VertexCacheStats vertexCacheAfter;
+};
+
+// Result of importing a batch of model files.
+struct ImportedScene
+{
+   std::vector<ImportedModel> models;
+   std::vector<std::string> textureFiles;    // Every texture the models use once, relative to TEXTURE_DIRECTORY.
+   uint64_t bytesRead;
+   uint32_t cachedModels;        // Models loaded from their mesh cache.
+   VertexWeldStats weld;         // Sums over the models that were parsed.
+   VertexCacheStats vertexCacheBefore;    // Sums over the models that were parsed.
+   VertexCacheStats vertexCacheAfter;
+   double seconds;               // Wall time of the whole import, reading included.
+};
+
+// One corner of an OBJ face as written in the file, indices already made 0 based.
+// Negative (relative) indices can refer to an earlier chunk, they're only resolved once every chunk's counts are known.
+struct ObjCorner
+{
+   int32_t position;
+   int32_t texCoord;
+   uint8_t flags;                // OBJ_CORNER_* bits.
+};
+
+const uint8_t OBJ_CORNER_RELATIVE_POSITION = 1;
+const uint8_t OBJ_CORNER_RELATIVE_TEX_COORD = 2;
+const uint8_t OBJ_CORNER_NO_TEX_COORD = 4;
+
+// What one piece of an OBJ file holds. Faces are already split into triangles.
+struct ObjChunk
+{
+   std::vector<glm::vec3> positions;
+   std::vector<glm::vec2> texCoords;
+   std::vector<ObjCorner> corners;           // Three per triangle.
+
+   // usemtl switches, corners before the first one keep the previous chunk's material.
+   struct MaterialSwitch
+   {
+      std::string material;
+      size_t firstCorner;
+   };
+   std::vector<MaterialSwitch> materialSwitches;
+   std::vector<std::string> materialLibraries;
+};
+
+bool IsObjFile(const std::string& fileName);
+bool IsGltfFile(const std::string& fileName);
+
+// Line aligned [begin, end) ranges of about chunkSize bytes covering the whole file.
+std::vector<std::pair<size_t, size_t>> SplitObjChunks(const uint8_t* data, size_t size, size_t chunkSize);
+// Parse one range from SplitObjChunks. Throws on malformed lines.
+ObjChunk ParseObjChunk(const char* begin, const char* end);
+// Join a file's chunks, in file order, into one mesh per material. Material libraries are read from the pack or loose files.
+ImportedModel BuildObjModel(const std::vector<ObjChunk>& chunks, const std::string& assetPath, const AssetPack& assetPack);
+
+// glTF 2.0, either .gltf JSON with external or embedded buffers, or a binary .glb. Node transforms are baked into the vertices.
+ImportedModel ParseGltf(const uint8_t* data, size_t size, const std::string& assetPath, const AssetPack& assetPack);
+
+// Fill in a mesh's bounds from its vertices. Empty meshes get zero bounds.
+void ComputeMeshBounds(ImportedMesh* mesh);
@@ -0,0 +1,458 @@
+#include "MeshOptimize.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// FIFO post transform cache. A vertex is cached if fewer than size misses happened since it was last loaded,
+// so a miss is one compare and a store rather than shifting a queue.
+struct FifoCache
+{
+   std::vector<uint32_t> loadTimes;
+   uint32_t time;
+   uint32_t size;
+
+   FifoCache(uint32_t vertexCount, uint32_t cacheSize) : loadTimes(vertexCount, 0), time(cacheSize + 1), size(cacheSize)
+   {
+   }
+
+   // Returns 1 on a miss, 0 on a hit.
+   uint32_t Access(uint32_t vertex)
+   {
+      if (time - loadTimes[vertex] > size)
+      {
+         loadTimes[vertex] = time++;
+         return 1;
+      }
+      return 0;
+   }
+
+   // Age every vertex out, as if a whole cache of others had been loaded.
+   void Flush()
+   {
+      time += size + 1;
+   }
+};
+
+// FNV-1a over 8 byte words, the same mix the asset loader hashes textures with.
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+   const uint8_t* bytes = static_cast<const uint8_t*>(data);
+   size_t i = 0;
+   for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+   {
+      uint64_t word;
+      memcpy(&word, bytes + i, sizeof(word));
+      hash = (hash ^ word) * 1099511628211ull;
+      hash ^= hash >> 29;
+   }
+   for (; i < size; i++)
+   {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+   }
+   return hash;
+}
+
+static bool IsNearlyEqual(const Vertex& a, const Vertex& b, float epsilon)
+{
+   const float* x = reinterpret_cast<const float*>(&a);
+   const float* y = reinterpret_cast<const float*>(&b);
+   for (size_t i = 0; i < sizeof(Vertex) / sizeof(float); i++)
+   {
+      if (!(std::abs(x[i] - y[i]) <= epsilon))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+VertexWeldStats WeldVertices(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, float epsilon)
+{
+   auto startTime = std::chrono::steady_clock::now();
+
+   VertexWeldStats stats = {};
+   stats.vertexCountBefore = vertices->size();
+
+   // Open addressing, at most half full. Slots hold an index into the kept vertices, UINT32_MAX when empty.
+   size_t tableSize = 16;
+   while (tableSize < vertices->size() * 2)
+   {
+      tableSize *= 2;
+   }
+   std::vector<uint32_t> table(tableSize, UINT32_MAX);
+   std::vector<glm::ivec3> keptCells;
+
+   std::vector<Vertex> kept;
+   kept.reserve(vertices->size());
+   std::vector<uint32_t> remap(vertices->size());
+
+   for (size_t v = 0; v < vertices->size(); v++)
+   {
+      const Vertex& vertex = (*vertices)[v];
+      uint32_t found = UINT32_MAX;
+      uint64_t hash;
+
+      if (epsilon <= 0.0f)
+      {
+         // Bit identical, so the raw bytes are both the hash and the comparison.
+         hash = HashBytes(14695981039346656037ull, &vertex, sizeof(Vertex));
+         for (size_t slot = hash & (tableSize - 1); table[slot] != UINT32_MAX; slot = (slot + 1) & (tableSize - 1))
+         {
+            if (memcmp(&kept[table[slot]], &vertex, sizeof(Vertex)) == 0)
+            {
+               found = table[slot];
+               break;
+            }
+         }
+      }
+      else
+      {
+         // A vertex within epsilon of this one can only sit in this position cell or one next to it.
+         glm::ivec3 cell = glm::ivec3(glm::floor(vertex.pos / epsilon));
+         for (int dz = -1; dz <= 1 && found == UINT32_MAX; dz++)
+         {
+            for (int dy = -1; dy <= 1 && found == UINT32_MAX; dy++)
+            {
+               for (int dx = -1; dx <= 1 && found == UINT32_MAX; dx++)
+               {
+                  glm::ivec3 neighbour = cell + glm::ivec3(dx, dy, dz);
+                  uint64_t neighbourHash = HashBytes(14695981039346656037ull, &neighbour, sizeof(neighbour));
+                  for (size_t slot = neighbourHash & (tableSize - 1); table[slot] != UINT32_MAX; slot = (slot + 1) & (tableSize - 1))
+                  {
+                     if (keptCells[table[slot]] == neighbour && IsNearlyEqual(kept[table[slot]], vertex, epsilon))
+                     {
+                        found = table[slot];
+                        break;
+                     }
+                  }
+               }
+            }
+         }
+         hash = HashBytes(14695981039346656037ull, &cell, sizeof(cell));
+         if (found == UINT32_MAX)
+         {
+            keptCells.push_back(cell);
+         }
+      }
+
+      if (found == UINT32_MAX)
+      {
+         found = static_cast<uint32_t>(kept.size());
+         kept.push_back(vertex);
+
+         size_t slot = hash & (tableSize - 1);
+         while (table[slot] != UINT32_MAX)
+         {
+            slot = (slot + 1) & (tableSize - 1);
+         }
+         table[slot] = found;
+      }
+      remap[v] = found;
+   }
+
+   // Corners merged into one close up their triangle, it's dropped.
+   size_t written = 0;
+   size_t triangleIndexCount = indices->size() / 3 * 3;
+   for (size_t i = 0; i < triangleIndexCount; i += 3)
+   {
+      uint32_t a = remap[(*indices)[i]];
+      uint32_t b = remap[(*indices)[i + 1]];
+      uint32_t c = remap[(*indices)[i + 2]];
+      if (a == b || b == c || c == a)
+      {
+         continue;
+      }
+      (*indices)[written++] = a;
+      (*indices)[written++] = b;
+      (*indices)[written++] = c;
+   }
+   indices->resize(written);
+   *vertices = std::move(kept);
+
+   stats.vertexCountAfter = vertices->size();
+   stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+   return stats;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+   VertexCacheStats stats = {};
+   stats.triangleCount = indices.size() / 3;
+
+   FifoCache cache(vertexCount, cacheSize);
+   std::vector<char> used(vertexCount, 0);
+   for (size_t i = 0; i < stats.triangleCount * 3; i++)
+   {
+      stats.transformCount += cache.Access(indices[i]);
+      if (!used[indices[i]])
+      {
+         used[indices[i]] = 1;
+         stats.vertexCount++;
+      }
+   }
+
+   return stats;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>* indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+   size_t triangleCount = indices->size() / 3;
+   if (triangleCount == 0)
+   {
+      return;
+   }
+
+   const std::vector<uint32_t> source(indices->begin(), indices->begin() + triangleCount * 3);
+
+   // Triangles around each vertex as one flat list. Live counts are the triangles of a vertex not emitted yet.
+   std::vector<uint32_t> liveCounts(vertexCount, 0);
+   for (uint32_t index : source)
+   {
+      liveCounts[index]++;
+   }
+
+   std::vector<uint32_t> adjacencyOffsets(static_cast<size_t>(vertexCount) + 1, 0);
+   for (uint32_t v = 0; v < vertexCount; v++)
+   {
+      adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCounts[v];
+   }
+
+   std::vector<uint32_t> adjacency(source.size());
+   std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+   for (size_t i = 0; i < source.size(); i++)
+   {
+      adjacency[fillOffsets[source[i]]++] = static_cast<uint32_t>(i / 3);
+   }
+
+   FifoCache cache(vertexCount, cacheSize);
+   std::vector<char> emitted(triangleCount, 0);
+   std::vector<uint32_t> deadEnds;
+   std::vector<uint32_t> candidates;
+   uint32_t scanCursor = 0;
+
+   size_t written = 0;
+   int64_t fan = source[0];
+   while (fan >= 0)
+   {
+      // Emit every remaining triangle around the fan vertex.
+      candidates.clear();
+      for (uint32_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; a++)
+      {
+         uint32_t triangle = adjacency[a];
+         if (emitted[triangle])
+         {
+            continue;
+         }
+
+         for (uint32_t k = 0; k < 3; k++)
+         {
+            uint32_t vertex = source[triangle * 3 + k];
+            (*indices)[written++] = vertex;
+            deadEnds.push_back(vertex);
+            candidates.push_back(vertex);
+            liveCounts[vertex]--;
+            cache.Access(vertex);
+         }
+         emitted[triangle] = 1;
+      }
+
+      // Next fan is the oldest candidate that will still be cached after its own triangles went through.
+      int64_t next = -1;
+      int64_t bestPriority = -1;
+      for (uint32_t vertex : candidates)
+      {
+         if (liveCounts[vertex] == 0)
+         {
+            continue;
+         }
+
+         int64_t age = cache.time - cache.loadTimes[vertex];
+         int64_t priority = age + 2 * static_cast<int64_t>(liveCounts[vertex]) <= cacheSize ? age : 0;
+         if (priority > bestPriority)
+         {
+            bestPriority = priority;
+            next = vertex;
+         }
+      }
+
+      // Dead end, go back to the most recent vertex with triangles left, then to any vertex at all.
+      while (next < 0 && !deadEnds.empty())
+      {
+         uint32_t vertex = deadEnds.back();
+         deadEnds.pop_back();
+         if (liveCounts[vertex] > 0)
+         {
+            next = vertex;
+         }
+      }
+      while (next < 0 && scanCursor < vertexCount)
+      {
+         if (liveCounts[scanCursor] > 0)
+         {
+            next = scanCursor;
+         }
+         scanCursor++;
+      }
+
+      fan = next;
+   }
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<Vertex>& vertices, uint32_t cacheSize, float threshold)
+{
+   size_t triangleCount = indices->size() / 3;
+   if (triangleCount < 2)
+   {
+      return;
+   }
+
+   const std::vector<uint32_t>& source = *indices;
+   uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+   // Hard boundaries are triangles that miss on every corner, the cache order restarts there anyway.
+   std::vector<uint32_t> triangleMisses(triangleCount);
+   std::vector<size_t> hardBoundaries;
+   FifoCache cache(vertexCount, cacheSize);
+   for (size_t t = 0; t < triangleCount; t++)
+   {
+      triangleMisses[t] = cache.Access(source[t * 3]) + cache.Access(source[t * 3 + 1]) + cache.Access(source[t * 3 + 2]);
+      if (t == 0 || triangleMisses[t] == 3)
+      {
+         hardBoundaries.push_back(t);
+      }
+   }
+   hardBoundaries.push_back(triangleCount);
+
+   // Soft boundaries split a hard cluster wherever the part so far is already about as cache friendly as the whole.
+   std::vector<size_t> boundaries;
+   for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+   {
+      size_t start = hardBoundaries[h];
+      size_t end = hardBoundaries[h + 1];
+
+      uint64_t clusterMisses = 0;
+      for (size_t t = start; t < end; t++)
+      {
+         clusterMisses += triangleMisses[t];
+      }
+      float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+      boundaries.push_back(start);
+      cache.Flush();
+      uint64_t runningMisses = 0;
+      uint64_t runningTriangles = 0;
+      for (size_t t = start; t < end; t++)
+      {
+         runningMisses += cache.Access(source[t * 3]) + cache.Access(source[t * 3 + 1]) + cache.Access(source[t * 3 + 2]);
+         runningTriangles++;
+
+         if (t + 1 < end && static_cast<float>(runningMisses) <= clusterThreshold * static_cast<float>(runningTriangles))
+         {
+            boundaries.push_back(t + 1);
+            cache.Flush();
+            runningMisses = 0;
+            runningTriangles = 0;
+         }
+      }
+   }
+   boundaries.push_back(triangleCount);
+
+   // Area weighted centre and facing of every cluster, and the centre of the mesh as a whole.
+   struct Cluster
+   {
+      size_t start;
+      size_t end;
+      float sortKey;
+   };
+   std::vector<Cluster> clusters(boundaries.size() - 1);
+   std::vector<glm::vec3> centroids(clusters.size());
+   std::vector<glm::vec3> normals(clusters.size());
+   glm::vec3 meshCentroid(0.0f);
+   float meshArea = 0.0f;
+   for (size_t c = 0; c < clusters.size(); c++)
+   {
+      clusters[c].start = boundaries[c];
+      clusters[c].end = boundaries[c + 1];
+
+      glm::vec3 centroid(0.0f);
+      glm::vec3 normal(0.0f);
+      float area = 0.0f;
+      for (size_t t = clusters[c].start; t < clusters[c].end; t++)
+      {
+         const glm::vec3& p0 = vertices[source[t * 3]].pos;
+         const glm::vec3& p1 = vertices[source[t * 3 + 1]].pos;
+         const glm::vec3& p2 = vertices[source[t * 3 + 2]].pos;
+
+         glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+         float triangleArea = glm::length(cross);
+         centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+         normal += cross;
+         area += triangleArea;
+      }
+
+      meshCentroid += centroid;
+      meshArea += area;
+      centroids[c] = area > 0.0f ? centroid / area : vertices[source[clusters[c].start * 3]].pos;
+      normals[c] = normal;
+   }
+   if (meshArea > 0.0f)
+   {
+      meshCentroid /= meshArea;
+   }
+
+   for (size_t c = 0; c < clusters.size(); c++)
+   {
+      float normalLength = glm::length(normals[c]);
+      clusters[c].sortKey = normalLength > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / normalLength) : 0.0f;
+   }
+
+   // Most outward facing first, ties keep the cache order.
+   std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+   {
+      return a.sortKey > b.sortKey;
+   });
+
+   std::vector<uint32_t> sorted;
+   sorted.reserve(indices->size());
+   for (const Cluster& cluster : clusters)
+   {
+      sorted.insert(sorted.end(), source.begin() + cluster.start * 3, source.begin() + cluster.end * 3);
+   }
+   sorted.insert(sorted.end(), source.begin() + triangleCount * 3, source.end());
+   *indices = std::move(sorted);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+   std::vector<uint32_t> remap(vertices->size(), UINT32_MAX);
+   std::vector<Vertex> ordered;
+   ordered.reserve(vertices->size());
+
+   for (uint32_t& index : *indices)
+   {
+      if (remap[index] == UINT32_MAX)
+      {
+         remap[index] = static_cast<uint32_t>(ordered.size());
+         ordered.push_back((*vertices)[index]);
+      }
+      index = remap[index];
+   }
+
+   *vertices = std::move(ordered);
+}
+
+void OptimizeMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, VertexCacheStats* before, VertexCacheStats* after)
+{
+   *before = AnalyzeVertexCache(*indices, static_cast<uint32_t>(vertices->size()));
+
+   OptimizeVertexCache(indices, static_cast<uint32_t>(vertices->size()));
+   OptimizeOverdraw(indices, *vertices);
+   OptimizeVertexFetch(vertices, indices);
+
+   *after = AnalyzeVertexCache(*indices, static_cast<uint32_t>(vertices->size()));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities.h"
+
+// Reordering passes run on imported meshes before they are cached and uploaded. None of them change what is drawn,
+// only the order the GPU meets triangles and vertices in.
+
+// Post transform cache entries the passes optimize and measure for. Small enough to hold on any GPU,
+// a mesh ordered for a small cache stays well ordered for a larger one.
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+// A cluster of triangles is cut off once its ACMR gets within this factor of the whole mesh's, the larger it is the more
+// freely triangles are sorted for overdraw at the cost of vertex cache hits.
+const float OVERDRAW_THRESHOLD = 1.05f;
+
+// Vertices whose every component lies within this of another's are merged by the welder. 0 merges only bit identical vertices,
+// anything larger also closes the near misses exporters leave behind, at the risk of merging detail finer than it.
+const float VERTEX_WELD_EPSILON = 0.0f;
+
+// Simulated FIFO post transform cache over an index list. Counts add up across meshes.
+struct VertexCacheStats
+{
+   uint64_t triangleCount;
+   uint64_t vertexCount;         // Vertices referenced by at least one triangle.
+   uint64_t transformCount;      // Cache misses, each one runs the vertex shader.
+
+   // Average cache miss ratio, vertex shader runs per triangle. 0.5 at best on large grids, 3 at worst.
+   float GetAcmr() const { return triangleCount ? static_cast<float>(transformCount) / triangleCount : 0.0f; }
+   // Average transform to vertex ratio, vertex shader runs per vertex. 1 is ideal.
+   float GetAtvr() const { return vertexCount ? static_cast<float>(transformCount) / vertexCount : 0.0f; }
+
+   void Add(const VertexCacheStats& other)
+   {
+      triangleCount += other.triangleCount;
+      vertexCount += other.vertexCount;
+      transformCount += other.transformCount;
+   }
+};
+
+// What welding did to a mesh. Counts and time add up across meshes.
+struct VertexWeldStats
+{
+   uint64_t vertexCountBefore;
+   uint64_t vertexCountAfter;
+   double seconds;
+
+   // Vertex memory the merged duplicates took.
+   uint64_t GetBytesSaved() const { return (vertexCountBefore - vertexCountAfter) * sizeof(Vertex); }
+
+   void Add(const VertexWeldStats& other)
+   {
+      vertexCountBefore += other.vertexCountBefore;
+      vertexCountAfter += other.vertexCountAfter;
+      seconds += other.seconds;
+   }
+};
+
+// Merge duplicate vertices through a hash table and point the indices at the ones kept, in first seen order.
+// Triangles left with two corners on one vertex are dropped.
+// With an epsilon, vertices are bucketed by position on a grid of that size and compared against the neighbouring cells too,
+// so a merge never depends on which side of a cell border two vertices fell.
+VertexWeldStats WeldVertices(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, float epsilon = VERTEX_WELD_EPSILON);
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander et al. 2007). Emits triangles fanning around one vertex at a time, picking the next fan from the vertices
+// still in the cache, in linear time.
+void OptimizeVertexCache(std::vector<uint32_t>* indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Split a cache optimized index list into clusters and draw the ones facing outward from the mesh's centre first,
+// they tend to hide what lies behind them from any direction. Keeps the order within each cluster.
+void OptimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<Vertex>& vertices,
+   uint32_t cacheSize = VERTEX_CACHE_SIZE, float threshold = OVERDRAW_THRESHOLD);
+
+// Reorder vertices by first use in the index list and rewrite the indices to match, so fetches walk memory forward.
+// Vertices no triangle uses are dropped.
+void OptimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+// Every reordering pass above in order, welding is left to the caller. Returns the cache stats of the mesh as it came and as it leaves.
+void OptimizeMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, VertexCacheStats* before, VertexCacheStats* after);
@@ -0,0 +1,334 @@
+#include "MeshSimplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "MeshOptimize.h"
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and Heckbert.
+// Planes are weighted by the area of their triangle, the weight is kept so errors come out as mean distances.
+struct Quadric
+{
+   double a2, ab, ac, ad;
+   double b2, bc, bd;
+   double c2, cd;
+   double d2;
+   double weight;
+
+   static Quadric FromPlane(const glm::dvec3& normal, double distance, double planeWeight)
+   {
+      Quadric q;
+      q.a2 = normal.x * normal.x * planeWeight;
+      q.ab = normal.x * normal.y * planeWeight;
+      q.ac = normal.x * normal.z * planeWeight;
+      q.ad = normal.x * distance * planeWeight;
+      q.b2 = normal.y * normal.y * planeWeight;
+      q.bc = normal.y * normal.z * planeWeight;
+      q.bd = normal.y * distance * planeWeight;
+      q.c2 = normal.z * normal.z * planeWeight;
+      q.cd = normal.z * distance * planeWeight;
+      q.d2 = distance * distance * planeWeight;
+      q.weight = planeWeight;
+      return q;
+   }
+
+   void Add(const Quadric& other)
+   {
+      a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+      b2 += other.b2; bc += other.bc; bd += other.bd;
+      c2 += other.c2; cd += other.cd;
+      d2 += other.d2;
+      weight += other.weight;
+   }
+
+   // Mean squared distance of a point to the planes.
+   double Evaluate(const glm::vec3& point) const
+   {
+      double x = point.x;
+      double y = point.y;
+      double z = point.z;
+      double sum = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+         + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+         + c2 * z * z + 2.0 * cd * z
+         + d2;
+      return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+   }
+};
+
+static glm::vec3 TriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+   return glm::cross(p1 - p0, p2 - p0);
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+float SimplifyMesh(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, size_t targetIndexCount)
+{
+   std::vector<uint32_t>& triangles = *indices;
+   triangles.resize(triangles.size() / 3 * 3);
+   uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+   // An edge only one triangle uses lies on a border: the mesh's own, a UV seam or a material cut. Moving its vertices
+   // would open a crack, so they stay where they are and only interior vertices collapse, onto them or each other.
+   std::vector<char> locked(vertexCount, 0);
+   {
+      std::unordered_map<uint64_t, uint32_t> edgeUses;
+      edgeUses.reserve(triangles.size());
+      for (size_t i = 0; i < triangles.size(); i += 3)
+      {
+         for (size_t k = 0; k < 3; k++)
+         {
+            uint32_t a = triangles[i + k];
+            uint32_t b = triangles[i + (k + 1) % 3];
+            edgeUses[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)]++;
+         }
+      }
+      for (const auto& edge : edgeUses)
+      {
+         if (edge.second == 1)
+         {
+            locked[static_cast<uint32_t>(edge.first >> 32)] = 1;
+            locked[static_cast<uint32_t>(edge.first)] = 1;
+         }
+      }
+   }
+
+   // Each vertex starts with the planes of the triangles around it.
+   std::vector<Quadric> quadrics(vertexCount, Quadric());
+   for (size_t i = 0; i < triangles.size(); i += 3)
+   {
+      glm::dvec3 normal(TriangleNormal(vertices[triangles[i]].pos, vertices[triangles[i + 1]].pos, vertices[triangles[i + 2]].pos));
+      double length = glm::length(normal);
+      if (length <= 0.0)
+      {
+         continue;
+      }
+
+      normal /= length;
+      Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, glm::dvec3(vertices[triangles[i]].pos)), length * 0.5);
+      for (size_t k = 0; k < 3; k++)
+      {
+         quadrics[triangles[i + k]].Add(plane);
+      }
+   }
+
+   struct Collapse
+   {
+      uint32_t from;
+      uint32_t to;
+      double cost;
+   };
+   std::vector<Collapse> collapses;
+   std::vector<uint32_t> adjacencyOffsets;
+   std::vector<uint32_t> adjacency;
+   std::vector<char> touched;
+   double maxCost = 0.0;
+
+   // Passes of independent collapses, cheapest first. A vertex takes part in at most one collapse a pass and nothing
+   // around it moves either, so every check is made against the mesh as it will be.
+   while (triangles.size() > targetIndexCount)
+   {
+      collapses.clear();
+      for (size_t i = 0; i < triangles.size(); i += 3)
+      {
+         for (size_t k = 0; k < 3; k++)
+         {
+            uint32_t a = triangles[i + k];
+            uint32_t b = triangles[i + (k + 1) % 3];
+            Quadric sum = quadrics[a];
+            sum.Add(quadrics[b]);
+            if (!locked[a])
+            {
+               collapses.push_back({ a, b, sum.Evaluate(vertices[b].pos) });
+            }
+            if (!locked[b])
+            {
+               collapses.push_back({ b, a, sum.Evaluate(vertices[a].pos) });
+            }
+         }
+      }
+      if (collapses.empty())
+      {
+         break;
+      }
+
+      std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y)
+      {
+         return x.cost < y.cost;
+      });
+
+      // Triangles around each vertex, rebuilt for the mesh as the last pass left it.
+      adjacencyOffsets.assign(static_cast<size_t>(vertexCount) + 1, 0);
+      for (uint32_t index : triangles)
+      {
+         adjacencyOffsets[index + 1]++;
+      }
+      for (uint32_t v = 0; v < vertexCount; v++)
+      {
+         adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+      }
+      adjacency.resize(triangles.size());
+      std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+      for (size_t i = 0; i < triangles.size(); i++)
+      {
+         adjacency[fillOffsets[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+      }
+
+      // A collapse takes about two triangles with it, don't overshoot the target by much.
+      size_t collapseBudget = (triangles.size() - targetIndexCount) / 6 + 1;
+      size_t collapsed = 0;
+      touched.assign(vertexCount, 0);
+      std::vector<uint32_t> remap(vertexCount);
+      for (uint32_t v = 0; v < vertexCount; v++)
+      {
+         remap[v] = v;
+      }
+
+      for (const Collapse& collapse : collapses)
+      {
+         if (collapsed >= collapseBudget)
+         {
+            break;
+         }
+         if (touched[collapse.from] || touched[collapse.to])
+         {
+            continue;
+         }
+
+         // Triangles that stay must keep facing the way they did, anything else folds the surface over.
+         bool flips = false;
+         for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++)
+         {
+            const uint32_t* triangle = &triangles[static_cast<size_t>(adjacency[a]) * 3];
+            if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+            {
+               continue;
+            }
+
+            glm::vec3 before = TriangleNormal(vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos);
+            glm::vec3 corners[3];
+            for (size_t k = 0; k < 3; k++)
+            {
+               corners[k] = vertices[triangle[k] == collapse.from ? collapse.to : triangle[k]].pos;
+            }
+            glm::vec3 after = TriangleNormal(corners[0], corners[1], corners[2]);
+            flips = glm::dot(before, after) <= 0.0f;
+         }
+         if (flips)
+         {
+            continue;
+         }
+
+         remap[collapse.from] = collapse.to;
+         quadrics[collapse.to].Add(quadrics[collapse.from]);
+         maxCost = std::max(maxCost, collapse.cost);
+         collapsed++;
+
+         // Everything the collapse changed the triangles of sits out the rest of the pass.
+         for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+         {
+            for (size_t k = 0; k < 3; k++)
+            {
+               touched[triangles[static_cast<size_t>(adjacency[a]) * 3 + k]] = 1;
+            }
+         }
+      }
+
+      if (collapsed == 0)
+      {
+         break;
+      }
+
+      // Move the collapsed corners and drop the triangles that closed up.
+      size_t written = 0;
+      for (size_t i = 0; i < triangles.size(); i += 3)
+      {
+         uint32_t a = remap[triangles[i]];
+         uint32_t b = remap[triangles[i + 1]];
+         uint32_t c = remap[triangles[i + 2]];
+         if (a == b || b == c || c == a)
+         {
+            continue;
+         }
+         triangles[written++] = a;
+         triangles[written++] = b;
+         triangles[written++] = c;
+      }
+      triangles.resize(written);
+   }
+
+   return static_cast<float>(std::sqrt(maxCost));
+}
+
+void GenerateMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, std::vector<MeshLod>* lods)
+{
+   lods->clear();
+
+   size_t fullIndexCount = indices->size() / 3 * 3;
+   MeshLod full = {};
+   full.indexCount = static_cast<uint32_t>(fullIndexCount);
+   lods->push_back(full);
+
+   // Every level is simplified from the full mesh, so its error is measured against what the mesh really looks like.
+   const std::vector<uint32_t> source(indices->begin(), indices->begin() + fullIndexCount);
+   size_t previousIndexCount = fullIndexCount;
+   float previousError = 0.0f;
+   while (lods->size() < MESH_LOD_MAX_COUNT && previousIndexCount / 3 >= MESH_LOD_MIN_TRIANGLES)
+   {
+      size_t targetIndexCount = static_cast<size_t>(previousIndexCount / 3 * MESH_LOD_REDUCTION) * 3;
+      std::vector<uint32_t> simplified = source;
+      float error = SimplifyMesh(vertices, &simplified, targetIndexCount);
+      if (simplified.empty() || simplified.size() > previousIndexCount * MESH_LOD_MIN_GAIN)
+      {
+         break;
+      }
+
+      OptimizeVertexCache(&simplified, static_cast<uint32_t>(vertices.size()));
+
+      MeshLod lod = {};
+      lod.firstIndex = static_cast<uint32_t>(indices->size());
+      lod.indexCount = static_cast<uint32_t>(simplified.size());
+      // Selection walks the levels until one is too coarse, errors must never shrink along the way.
+      lod.error = std::max(error, previousError);
+      lods->push_back(lod);
+      indices->insert(indices->end(), simplified.begin(), simplified.end());
+
+      previousIndexCount = simplified.size();
+      previousError = lod.error;
+   }
+}
+
+uint32_t SelectMeshLod(const std::vector<MeshLod>& lods, const glm::vec3& center, float radius,
+   const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight)
+{
+   if (lods.size() <= 1)
+   {
+      return 0;
+   }
+
+   // Errors grow with the largest scale the model applies, and are seen from the nearest point of the bounding sphere.
+   float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+   glm::vec3 viewCenter = glm::vec3(view * model * glm::vec4(center, 1.0f));
+   float distance = glm::length(viewCenter) - radius * scale;
+   if (distance <= 0.0f)
+   {
+      return 0;
+   }
+
+   // projection[1][1] is the cotangent of half the vertical field of view, negative once Y is flipped for Vulkan.
+   float pixelsPerUnit = viewportHeight * 0.5f * std::abs(projection[1][1]) / distance;
+
+   uint32_t selected = 0;
+   for (uint32_t i = 1; i < lods.size(); i++)
+   {
+      if (lods[i].error * scale * pixelsPerUnit > MESH_LOD_PIXEL_ERROR)
+      {
+         break;
+      }
+      selected = i;
+   }
+
+   return selected;
+}
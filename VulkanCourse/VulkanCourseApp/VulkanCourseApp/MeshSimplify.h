@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities.h"
+
+// Levels of detail of a mesh, every level at most this many including the full mesh.
+const uint32_t MESH_LOD_MAX_COUNT = 5;
+
+// Each level aims for this share of the triangles of the level before it.
+const float MESH_LOD_REDUCTION = 0.5f;
+
+// Meshes below this many triangles aren't worth another level, their vertex work is already negligible.
+const uint32_t MESH_LOD_MIN_TRIANGLES = 64;
+
+// A level that keeps more than this share of the previous level's triangles is dropped, and no coarser one is tried.
+// Locked borders and folds stop the simplifier before it gets anywhere near the target on some meshes.
+const float MESH_LOD_MIN_GAIN = 0.85f;
+
+// Coarsest level whose error projects to at most this many pixels on screen is drawn.
+const float MESH_LOD_PIXEL_ERROR = 1.0f;
+
+// One level of detail, a run of the mesh's index list and of its meshlets. Every level shares the mesh's vertices.
+// Stored this way in mesh caches.
+struct MeshLod
+{
+   uint32_t firstIndex;
+   uint32_t indexCount;
+   uint32_t firstMeshlet;
+   uint32_t meshletCount;
+   float error;               // Distance the level strays from the full mesh, in mesh space. 0 for the full mesh.
+   uint32_t reserved;         // Always 0.
+};
+
+static_assert(sizeof(MeshLod) == 24, "MeshLod must match the mesh cache layout.");
+
+// Quadric error metric edge collapse (Garland and Heckbert 1997). Collapses vertices onto neighbours until the index list
+// is down to targetIndexCount or no collapse is left that wouldn't fold a triangle over. Vertices are only ever moved onto
+// existing ones, so the result indexes the same vertex list. Vertices on open edges, UV seams and material borders included,
+// never move. Returns the largest error of a collapse made, as a distance in mesh space.
+float SimplifyMesh(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, size_t targetIndexCount);
+
+// Fill in the levels of detail of a mesh. The full index list stays as level 0, every coarser level is simplified from it,
+// ordered for the vertex cache and appended to the index list. Meshlet ranges are left for the caller.
+void GenerateMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, std::vector<MeshLod>* lods);
+
+// Coarsest level whose error projects to within MESH_LOD_PIXEL_ERROR, for a mesh with the given mesh space bounding sphere
+// drawn with these matrices into a viewport this many pixels high. Level 0 once the camera is inside the sphere.
+uint32_t SelectMeshLod(const std::vector<MeshLod>& lods, const glm::vec3& center, float radius,
+   const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
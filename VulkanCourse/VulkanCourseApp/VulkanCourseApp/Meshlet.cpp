@@ -0,0 +1,143 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "TransformMath.h"
+
+// Fill in the bounding sphere and normal cone of a meshlet from its triangles.
+static void ComputeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet* meshlet)
+{
+   // Sphere around the centre of the box, not minimal but never far off for compact clusters.
+   glm::vec3 boundsMin = vertices[indices[meshlet->firstIndex]].pos;
+   glm::vec3 boundsMax = boundsMin;
+   for (uint32_t i = meshlet->firstIndex; i < meshlet->firstIndex + meshlet->indexCount; i++)
+   {
+      boundsMin = glm::min(boundsMin, vertices[indices[i]].pos);
+      boundsMax = glm::max(boundsMax, vertices[indices[i]].pos);
+   }
+
+   meshlet->center = (boundsMin + boundsMax) * 0.5f;
+   meshlet->radius = 0.0f;
+   for (uint32_t i = meshlet->firstIndex; i < meshlet->firstIndex + meshlet->indexCount; i++)
+   {
+      meshlet->radius = std::max(meshlet->radius, glm::length(vertices[indices[i]].pos - meshlet->center));
+   }
+
+   // Cone around the average facing, as wide as the triangle facing furthest from it. Degenerate triangles face nowhere.
+   std::vector<glm::vec3> normals;
+   normals.reserve(meshlet->indexCount / 3);
+   glm::vec3 normalSum(0.0f);
+   for (uint32_t i = meshlet->firstIndex; i + 2 < meshlet->firstIndex + meshlet->indexCount; i += 3)
+   {
+      const glm::vec3& p0 = vertices[indices[i]].pos;
+      const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+      const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float length = glm::length(normal);
+      if (length > 0.0f)
+      {
+         normals.push_back(normal / length);
+         normalSum += normal / length;
+      }
+   }
+
+   meshlet->coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+   meshlet->coneCutoff = 1.0f;
+
+   float sumLength = glm::length(normalSum);
+   if (normals.empty() || sumLength <= 0.0f)
+   {
+      return;
+   }
+
+   glm::vec3 axis = normalSum / sumLength;
+   float minDot = 1.0f;
+   for (const glm::vec3& normal : normals)
+   {
+      minDot = std::min(minDot, glm::dot(normal, axis));
+   }
+
+   // A cone of half a sphere or more holds front and back faces from every direction.
+   if (minDot <= 0.0f)
+   {
+      return;
+   }
+
+   meshlet->coneAxis = axis;
+   meshlet->coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+   size_t firstIndex, size_t indexCount)
+{
+   std::vector<Meshlet> meshlets;
+
+   // Meshlet each vertex was last counted in, so counting unique vertices needs no clearing between meshlets.
+   std::vector<uint32_t> vertexMeshlet(vertices.size(), UINT32_MAX);
+
+   firstIndex = std::min(firstIndex, indices.size());
+   size_t triangleIndexEnd = firstIndex + std::min(indexCount, indices.size() - firstIndex) / 3 * 3;
+
+   Meshlet current = {};
+   current.firstIndex = static_cast<uint32_t>(firstIndex);
+   uint32_t uniqueVertices = 0;
+   for (size_t i = firstIndex; i < triangleIndexEnd; i += 3)
+   {
+      uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+      uint32_t newVertices = 0;
+      for (size_t k = 0; k < 3; k++)
+      {
+         // Repeats within the triangle count once.
+         bool repeat = (k > 0 && indices[i + k] == indices[i]) || (k > 1 && indices[i + k] == indices[i + 1]);
+         newVertices += vertexMeshlet[indices[i + k]] != meshletId && !repeat ? 1 : 0;
+      }
+
+      // Full, start the next meshlet with this triangle.
+      if (current.indexCount > 0 &&
+         (uniqueVertices + newVertices > MESHLET_MAX_VERTICES || current.indexCount / 3 >= MESHLET_MAX_TRIANGLES))
+      {
+         ComputeMeshletBounds(vertices, indices, &current);
+         meshlets.push_back(current);
+
+         current = {};
+         current.firstIndex = static_cast<uint32_t>(i);
+         uniqueVertices = 0;
+         meshletId++;
+      }
+
+      for (size_t k = 0; k < 3; k++)
+      {
+         if (vertexMeshlet[indices[i + k]] != meshletId)
+         {
+            vertexMeshlet[indices[i + k]] = meshletId;
+            uniqueVertices++;
+         }
+      }
+      current.indexCount += 3;
+   }
+
+   if (current.indexCount > 0)
+   {
+      ComputeMeshletBounds(vertices, indices, &current);
+      meshlets.push_back(current);
+   }
+
+   return meshlets;
+}
+
+void SetMeshletCullView(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, const glm::mat4& model, MeshletCullPush* push)
+{
+   // Planes straight from the rows of the whole transform come out in mesh space.
+   glm::mat4 transform;
+   MultiplyMatrices(viewProjection, model, &transform);
+   ExtractFrustumPlanes(transform, push->planes);
+
+   // Facing is kept by affine transforms, so the cone test works in mesh space too. A mirroring model flips which side is front.
+   glm::vec4 eye = glm::inverse(model) * glm::vec4(cameraPosition, 1.0f);
+   push->eye = glm::vec4(glm::vec3(eye) / eye.w, glm::determinant(glm::mat3(model)) < 0.0f ? -1.0f : 1.0f);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities.h"
+
+// Limits of one meshlet. 64 vertices and 124 triangles keep a meshlet's vertices in a small post transform cache
+// and its indices (372) within a few passes of the 64 wide cull workgroup.
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of a mesh's triangles, a contiguous run of its index list, culled as one by meshlet_cull.comp.
+// Laid out as the shader reads it (std430), and stored this way in mesh caches.
+struct Meshlet
+{
+   glm::vec3 center;          // Bounding sphere in mesh space.
+   float radius;
+   glm::vec3 coneAxis;        // Average facing of the triangles.
+   float coneCutoff;          // Sine of the normal cone's half angle, 1 if the triangles face too many ways to ever cull.
+   uint32_t firstIndex;       // Where the meshlet's triangles start in the mesh's index list.
+   uint32_t indexCount;
+   uint32_t reserved[2];      // Always 0.
+};
+
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match the shader and mesh cache layout.");
+
+// Push constants of meshlet_cull.comp for one mesh. Everything is in mesh space, so the shader never applies the model matrix.
+struct MeshletCullPush
+{
+   glm::vec4 planes[6];       // Frustum planes, normalized, inside where dot(xyz, p) + w >= 0.
+   glm::vec4 eye;             // Camera position, w scales the cone axis: 1, -1 if the model mirrors.
+   uint32_t firstMeshlet;     // Meshlets of the level of detail drawn.
+   uint32_t meshletCount;
+   uint32_t sixteenBitIndices;   // Source indices are packed two to a word.
+};
+
+static_assert(sizeof(MeshletCullPush) == 124, "MeshletCullPush must fit the guaranteed 128 bytes of push constants.");
+
+// Cut a run of an index list into meshlets in the order it already has, so a vertex cache optimized list gives meshlets of
+// neighbouring triangles and the indices need no reordering. Front faces wind counter clockwise. The run defaults to the whole list,
+// meshlet ranges are always into the whole list.
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+   size_t firstIndex = 0, size_t indexCount = SIZE_MAX);
+
+// Fill in the frustum planes and camera position of a cull push for a mesh drawn with this model matrix, from the frame's
+// view projection matrix and world space camera position.
+void SetMeshletCullView(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, const glm::mat4& model, MeshletCullPush* push);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Layout of an asset pack: header, payloads, table of contents, chunk table, then the string table of asset names.
+// Everything is little endian and written exactly as these structs lie in memory.
+
+const char PACK_MAGIC[4] = { 'V', 'K', 'P', 'K' };
+const uint32_t PACK_VERSION = 2;
+
+// Every payload starts on this boundary, enough for staging copies of BC blocks and for SPIR-V words.
+const uint64_t PACK_ALIGNMENT = 16;
+
+// Compressed payloads are split into chunks of this many unpacked bytes (the last one may be shorter).
+// Each chunk decompresses on its own, so one large texture can be unpacked by several workers at once.
+const uint32_t PACK_CHUNK_SIZE = 256 * 1024;
+
+// Largest chunk size a pack may declare, bounds the scratch memory a reader needs.
+const uint32_t PACK_MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+
+struct PackHeader
+{
+   char magic[4];             // PACK_MAGIC.
+   uint32_t version;          // PACK_VERSION.
+   uint32_t entryCount;       // Number of entries in the table of contents.
+   uint32_t stringTableSize;  // Size of the name string table in bytes.
+   uint64_t tocOffset;        // Where the table of contents starts in the file.
+   uint64_t stringTableOffset;   // Where the name string table starts in the file.
+   uint64_t chunkTableOffset; // Where the chunk table starts in the file.
+   uint32_t chunkCount;       // Number of entries in the chunk table.
+   uint32_t chunkSize;        // Unpacked size of every chunk but the last of each asset.
+};
+
+// Entries are sorted by name hash so a lookup is a binary search straight over the mapping.
+struct PackEntry
+{
+   uint64_t nameHash;         // HashAssetName of the asset path.
+   uint64_t offset;           // Where the payload starts in the file, used when the asset is stored uncompressed.
+   uint64_t size;             // Size of the asset in bytes once unpacked.
+   uint32_t nameOffset;       // Asset path in the string table, to tell hash collisions apart.
+   uint32_t nameLength;       // Length of the asset path. (no terminator)
+   uint32_t firstChunk;       // First of the asset's chunks in the chunk table.
+   uint32_t chunkCount;       // Number of chunks, 0 if the asset is stored uncompressed.
+};
+
+// One compressed chunk of an asset. A chunk that didn't shrink is stored as is, storedSize then equals its unpacked size.
+struct PackChunk
+{
+   uint64_t offset;           // Where the chunk's data starts in the file.
+   uint32_t storedSize;       // Size of the chunk in the file.
+   uint32_t reserved;         // Always 0.
+};
+
+static_assert(sizeof(PackHeader) == 48, "PackHeader must match the file layout.");
+static_assert(sizeof(PackEntry) == 40, "PackEntry must match the file layout.");
+static_assert(sizeof(PackChunk) == 16, "PackChunk must match the file layout.");
+
+// FNV-1a over an asset path such as "Textures/giraffe.ktx2". Paths always use forward slashes.
+inline uint64_t HashAssetName(const char* name, size_t length)
+{
+   uint64_t hash = 14695981039346656037ull;
+   for (size_t i = 0; i < length; i++)
+   {
+      hash ^= static_cast<uint8_t>(name[i]);
+      hash *= 1099511628211ull;
+   }
+   return hash;
+}
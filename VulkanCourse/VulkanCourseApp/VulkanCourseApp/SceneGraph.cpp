@@ -0,0 +1,363 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+#include "TransformMath.h"
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+SceneGraph::SceneGraph()
+{
+}
+
+SceneGraph::~SceneGraph()
+{
+   Deinit();
+}
+
+void SceneGraph::Init(uint32_t threadCount)
+{
+   m_threadPool.Init(threadCount);
+}
+
+void SceneGraph::Deinit()
+{
+   m_threadPool.Deinit();
+}
+
+uint32_t SceneGraph::AddNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+   if (parent != SCENE_NO_PARENT && parent >= m_vecParents.size())
+   {
+      throw std::runtime_error("Failed to add a scene node, its parent doesn't exist!");
+   }
+
+   uint32_t node;
+   if (!m_vecFreeNodes.empty())
+   {
+      node = m_vecFreeNodes.back();
+      m_vecFreeNodes.pop_back();
+   }
+   else
+   {
+      node = static_cast<uint32_t>(m_vecParents.size());
+      m_vecParents.push_back(SCENE_NO_PARENT);
+      m_vecDepths.push_back(0);
+      m_vecFirstChildren.push_back(SCENE_NO_PARENT);
+      m_vecNextSiblings.push_back(SCENE_NO_PARENT);
+      m_vecTranslations.push_back(glm::vec3(0.0f));
+      m_vecRotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+      m_vecScales.push_back(glm::vec3(1.0f));
+      m_vecWorldMatrices.push_back(glm::mat4(1.0f));
+      m_vecWorldTranslations.push_back(glm::vec3(0.0f));
+      m_vecWorldRotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+      m_vecWorldScales.push_back(glm::vec3(1.0f));
+      m_vecWorldTrsExact.push_back(1);
+      m_vecDirty.push_back(0);
+      m_vecQueued.push_back(0);
+   }
+
+   m_vecParents[node] = parent;
+   m_vecDepths[node] = parent == SCENE_NO_PARENT ? 0 : m_vecDepths[parent] + 1;
+   m_vecFirstChildren[node] = SCENE_NO_PARENT;
+   m_vecNextSiblings[node] = SCENE_NO_PARENT;
+   if (parent != SCENE_NO_PARENT)
+   {
+      m_vecNextSiblings[node] = m_vecFirstChildren[parent];
+      m_vecFirstChildren[parent] = node;
+   }
+
+   m_vecTranslations[node] = translation;
+   m_vecRotations[node] = rotation;
+   m_vecScales[node] = scale;
+   MarkDirty(node);
+
+   return node;
+}
+
+void SceneGraph::RemoveNode(uint32_t node)
+{
+   if (m_vecFirstChildren[node] != SCENE_NO_PARENT)
+   {
+      throw std::runtime_error("Failed to remove a scene node, it still has children!");
+   }
+
+   uint32_t parent = m_vecParents[node];
+   if (parent != SCENE_NO_PARENT)
+   {
+      if (m_vecFirstChildren[parent] == node)
+      {
+         m_vecFirstChildren[parent] = m_vecNextSiblings[node];
+      }
+      else
+      {
+         uint32_t sibling = m_vecFirstChildren[parent];
+         while (m_vecNextSiblings[sibling] != node)
+         {
+            sibling = m_vecNextSiblings[sibling];
+         }
+         m_vecNextSiblings[sibling] = m_vecNextSiblings[node];
+      }
+   }
+
+   // A free node may still be on the dirty list, updating it as a lone root does no harm.
+   m_vecParents[node] = SCENE_NO_PARENT;
+   m_vecDepths[node] = 0;
+   m_vecNextSiblings[node] = SCENE_NO_PARENT;
+   m_vecFreeNodes.push_back(node);
+}
+
+void SceneGraph::SetLocalTransform(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+   m_vecTranslations[node] = translation;
+   m_vecRotations[node] = rotation;
+   m_vecScales[node] = scale;
+   MarkDirty(node);
+}
+
+void SceneGraph::SetTranslation(uint32_t node, const glm::vec3& translation)
+{
+   m_vecTranslations[node] = translation;
+   MarkDirty(node);
+}
+
+void SceneGraph::SetRotation(uint32_t node, const glm::quat& rotation)
+{
+   m_vecRotations[node] = rotation;
+   MarkDirty(node);
+}
+
+void SceneGraph::SetScale(uint32_t node, const glm::vec3& scale)
+{
+   m_vecScales[node] = scale;
+   MarkDirty(node);
+}
+
+uint32_t SceneGraph::Update()
+{
+   if (m_vecDirtyNodes.empty())
+   {
+      return 0;
+   }
+
+   // Everything below a dirty node has to follow it. A subtree already queued from a dirty node further down is skipped
+   // whole, so every affected node is visited once however many of its ancestors changed.
+   m_vecAffected.clear();
+   for (uint32_t dirtyNode : m_vecDirtyNodes)
+   {
+      m_vecDirty[dirtyNode] = 0;
+      m_vecWalkStack.push_back(dirtyNode);
+      while (!m_vecWalkStack.empty())
+      {
+         uint32_t node = m_vecWalkStack.back();
+         m_vecWalkStack.pop_back();
+         if (m_vecQueued[node])
+         {
+            continue;
+         }
+
+         m_vecQueued[node] = 1;
+         m_vecAffected.push_back(node);
+         for (uint32_t child = m_vecFirstChildren[node]; child != SCENE_NO_PARENT; child = m_vecNextSiblings[child])
+         {
+            m_vecWalkStack.push_back(child);
+         }
+      }
+   }
+   m_vecDirtyNodes.clear();
+
+   // Bucket by depth. A level only reads world matrices of the one above, so its nodes can be updated in any order, in parallel.
+   uint32_t maxDepth = 0;
+   for (uint32_t node : m_vecAffected)
+   {
+      maxDepth = std::max(maxDepth, m_vecDepths[node]);
+   }
+   m_vecLevelOffsets.assign(static_cast<size_t>(maxDepth) + 2, 0);
+   for (uint32_t node : m_vecAffected)
+   {
+      m_vecLevelOffsets[m_vecDepths[node] + 1]++;
+   }
+   for (uint32_t depth = 0; depth <= maxDepth; depth++)
+   {
+      m_vecLevelOffsets[depth + 1] += m_vecLevelOffsets[depth];
+   }
+   m_vecSorted.resize(m_vecAffected.size());
+   std::vector<uint32_t> fillOffsets(m_vecLevelOffsets.begin(), m_vecLevelOffsets.end() - 1);
+   for (uint32_t node : m_vecAffected)
+   {
+      m_vecSorted[fillOffsets[m_vecDepths[node]]++] = node;
+      m_vecQueued[node] = 0;
+   }
+
+   for (uint32_t depth = 0; depth <= maxDepth; depth++)
+   {
+      const uint32_t* levelNodes = m_vecSorted.data() + m_vecLevelOffsets[depth];
+      size_t levelCount = m_vecLevelOffsets[depth + 1] - m_vecLevelOffsets[depth];
+      if (levelCount < SCENE_UPDATE_CHUNK * 2 || m_threadPool.GetThreadCount() == 0)
+      {
+         UpdateNodes(levelNodes, levelCount);
+         continue;
+      }
+
+      size_t chunkCount = (levelCount + SCENE_UPDATE_CHUNK - 1) / SCENE_UPDATE_CHUNK;
+      RunParallel(chunkCount, [this, levelNodes, levelCount](size_t chunk)
+      {
+         size_t first = chunk * SCENE_UPDATE_CHUNK;
+         UpdateNodes(levelNodes + first, std::min<size_t>(SCENE_UPDATE_CHUNK, levelCount - first));
+      });
+   }
+
+   return static_cast<uint32_t>(m_vecAffected.size());
+}
+
+const glm::mat4& SceneGraph::GetWorldMatrix(uint32_t node) const
+{
+   return m_vecWorldMatrices[node];
+}
+
+const glm::vec3& SceneGraph::GetWorldTranslation(uint32_t node) const
+{
+   return m_vecWorldTranslations[node];
+}
+
+const glm::quat& SceneGraph::GetWorldRotation(uint32_t node) const
+{
+   return m_vecWorldRotations[node];
+}
+
+const glm::vec3& SceneGraph::GetWorldScale(uint32_t node) const
+{
+   return m_vecWorldScales[node];
+}
+
+bool SceneGraph::IsWorldTrsExact(uint32_t node) const
+{
+   return m_vecWorldTrsExact[node] != 0;
+}
+
+uint32_t SceneGraph::GetParent(uint32_t node) const
+{
+   return m_vecParents[node];
+}
+
+uint32_t SceneGraph::GetNodeCount() const
+{
+   return static_cast<uint32_t>(m_vecParents.size());
+}
+
+/***********************************************************
+** Private Functions.
+***********************************************************/
+void SceneGraph::MarkDirty(uint32_t node)
+{
+   if (!m_vecDirty[node])
+   {
+      m_vecDirty[node] = 1;
+      m_vecDirtyNodes.push_back(node);
+   }
+}
+
+void SceneGraph::UpdateNodes(const uint32_t* nodes, size_t count)
+{
+   // The nodes are scattered through the arrays, so they're gathered a batch at a time into contiguous runs the
+   // transform kernels take whole. Roots get the identity as their parent.
+   glm::vec3 translations[SCENE_UPDATE_BATCH];
+   glm::quat rotations[SCENE_UPDATE_BATCH];
+   glm::vec3 scales[SCENE_UPDATE_BATCH];
+   glm::mat4 parents[SCENE_UPDATE_BATCH];
+   glm::mat4 worlds[SCENE_UPDATE_BATCH];
+
+   for (size_t first = 0; first < count; first += SCENE_UPDATE_BATCH)
+   {
+      size_t batchCount = std::min<size_t>(SCENE_UPDATE_BATCH, count - first);
+      for (size_t i = 0; i < batchCount; i++)
+      {
+         uint32_t node = nodes[first + i];
+         uint32_t parent = m_vecParents[node];
+         translations[i] = m_vecTranslations[node];
+         rotations[i] = m_vecRotations[node];
+         scales[i] = m_vecScales[node];
+         parents[i] = parent == SCENE_NO_PARENT ? glm::mat4(1.0f) : m_vecWorldMatrices[parent];
+      }
+
+      ComposeTransforms(translations, rotations, scales, worlds, batchCount);
+      MultiplyMatrices(parents, worlds, worlds, batchCount);
+
+      for (size_t i = 0; i < batchCount; i++)
+      {
+         uint32_t node = nodes[first + i];
+         uint32_t parent = m_vecParents[node];
+         m_vecWorldMatrices[node] = worlds[i];
+         m_vecWorldTranslations[node] = glm::vec3(worlds[i][3]);
+         if (parent == SCENE_NO_PARENT)
+         {
+            m_vecWorldRotations[node] = rotations[i];
+            m_vecWorldScales[node] = scales[i];
+            m_vecWorldTrsExact[node] = 1;
+         }
+         else
+         {
+            // The parent's scale only passes through the node's rotation unchanged if it's the same along every axis,
+            // or if there is no rotation to pass through.
+            const glm::vec3& parentScale = m_vecWorldScales[parent];
+            float largest = std::max(std::abs(parentScale.x), std::max(std::abs(parentScale.y), std::abs(parentScale.z)));
+            bool uniform = std::abs(parentScale.x - parentScale.y) <= SCENE_TRS_TOLERANCE * largest &&
+               std::abs(parentScale.x - parentScale.z) <= SCENE_TRS_TOLERANCE * largest;
+            glm::vec3 axis(rotations[i].x, rotations[i].y, rotations[i].z);
+            bool unrotated = glm::dot(axis, axis) <= SCENE_TRS_TOLERANCE * SCENE_TRS_TOLERANCE;
+
+            m_vecWorldRotations[node] = m_vecWorldRotations[parent] * rotations[i];
+            m_vecWorldScales[node] = parentScale * scales[i];
+            m_vecWorldTrsExact[node] = m_vecWorldTrsExact[parent] && (uniform || unrotated);
+         }
+      }
+   }
+}
+
+void SceneGraph::RunParallel(size_t count, const std::function<void(size_t)>& job)
+{
+   std::mutex mtxDone;
+   std::condition_variable cvDone;
+   size_t remaining = count;
+   std::exception_ptr error;
+
+   // Nodes of one level never share a world matrix, so the pieces need no locking of their own.
+   for (size_t i = 0; i < count; i++)
+   {
+      m_threadPool.Submit([&job, &mtxDone, &cvDone, &remaining, &error, i]()
+      {
+         // Same as the asset loader's, a throwing piece must not take the pool's worker down with it.
+         std::exception_ptr jobError;
+         try
+         {
+            job(i);
+         }
+         catch (...)
+         {
+            jobError = std::current_exception();
+         }
+
+         // Notify while holding the lock, the waiter owns these and may return as soon as it sees zero.
+         std::lock_guard<std::mutex> lock(mtxDone);
+         if (jobError && !error)
+         {
+            error = jobError;
+         }
+         remaining--;
+         cvDone.notify_one();
+      });
+   }
+
+   std::unique_lock<std::mutex> lock(mtxDone);
+   cvDone.wait(lock, [&remaining] { return remaining == 0; });
+
+   if (error)
+   {
+      std::rethrow_exception(error);
+   }
+}
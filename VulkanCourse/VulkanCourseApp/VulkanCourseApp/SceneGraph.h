@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "ThreadPool.h"
+
+// Parent of root nodes.
+const uint32_t SCENE_NO_PARENT = UINT32_MAX;
+
+// Levels of the hierarchy with at least this many nodes to update are split across the workers in pieces of this size,
+// smaller ones aren't worth waking a thread for.
+const uint32_t SCENE_UPDATE_CHUNK = 2048;
+
+// Nodes gathered at a time for the batched transform kernels. Small enough for the stack.
+const uint32_t SCENE_UPDATE_BATCH = 64;
+
+// How far a world scale's axes may differ, relative to the largest, and still count as uniform. Also how far a rotation's
+// axis part may be from zero and still count as none. Anything further and the composed world TRS stops matching the matrix.
+const float SCENE_TRS_TOLERANCE = 1e-6f;
+
+// Transform hierarchy stored as structure of arrays, a node's index is its handle. Indices of removed nodes are handed out
+// again, so the arrays are in no particular order and updates go by depth instead. Changing a node only marks it dirty,
+// Update then recomputes the world matrices of dirty nodes and everything below them, and nothing else.
+class SceneGraph
+{
+public:
+   SceneGraph();
+   ~SceneGraph();
+
+   // Workers for updates of large hierarchies. 0 takes the ThreadPool default.
+   void Init(uint32_t threadCount = 0);
+   void Deinit();
+
+   uint32_t AddNode(uint32_t parent = SCENE_NO_PARENT, const glm::vec3& translation = glm::vec3(0.0f),
+      const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+   // Only nodes without children can go. The index is reused by a later AddNode. O(1) for roots, otherwise it walks the
+   // parent's children.
+   void RemoveNode(uint32_t node);
+
+   // Local transform relative to the parent, applied scale first, then rotation, then translation.
+   void SetLocalTransform(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+   void SetTranslation(uint32_t node, const glm::vec3& translation);
+   void SetRotation(uint32_t node, const glm::quat& rotation);
+   void SetScale(uint32_t node, const glm::vec3& scale);
+
+   // Recompute the world matrices of everything changed since the last update. Returns how many nodes it touched.
+   uint32_t Update();
+
+   // As of the last Update.
+   const glm::mat4& GetWorldMatrix(uint32_t node) const;
+   // World transform as translation, rotation and scale, for compact GPU transforms. Composed from the parent's as
+   // rotation * rotation and scale * scale, which only gives the world matrix when IsWorldTrsExact says so.
+   const glm::vec3& GetWorldTranslation(uint32_t node) const;
+   const glm::quat& GetWorldRotation(uint32_t node) const;
+   const glm::vec3& GetWorldScale(uint32_t node) const;
+   // False for a node with a rotation of its own below a non-uniformly scaled ancestor, and everything under it. The parent's
+   // scale then acts along the rotated axes, the matrix stretches (or shears) in ways one rotation and one scale can't.
+   bool IsWorldTrsExact(uint32_t node) const;
+   uint32_t GetParent(uint32_t node) const;
+   // Indices handed out so far, removed nodes included.
+   uint32_t GetNodeCount() const;
+
+private:
+   void MarkDirty(uint32_t node);
+   // Compose the local transforms of nodes and apply their parents' world matrices, in batches of SCENE_UPDATE_BATCH.
+   void UpdateNodes(const uint32_t* nodes, size_t count);
+   // Run job(0) .. job(count - 1) on the workers and wait for all of them.
+   void RunParallel(size_t count, const std::function<void(size_t)>& job);
+
+   // Hierarchy. Children are linked from the parent, so a dirty subtree is walked without visiting anything else.
+   std::vector<uint32_t> m_vecParents;
+   std::vector<uint32_t> m_vecDepths;
+   std::vector<uint32_t> m_vecFirstChildren;
+   std::vector<uint32_t> m_vecNextSiblings;
+   std::vector<uint32_t> m_vecFreeNodes;
+
+   // Local transforms.
+   std::vector<glm::vec3> m_vecTranslations;
+   std::vector<glm::quat> m_vecRotations;
+   std::vector<glm::vec3> m_vecScales;
+
+   std::vector<glm::mat4> m_vecWorldMatrices;
+   std::vector<glm::vec3> m_vecWorldTranslations;
+   std::vector<glm::quat> m_vecWorldRotations;
+   std::vector<glm::vec3> m_vecWorldScales;
+   std::vector<uint8_t> m_vecWorldTrsExact;
+
+   // Nodes changed since the last update. The flags keep a node from being listed twice.
+   std::vector<uint8_t> m_vecDirty;
+   std::vector<uint32_t> m_vecDirtyNodes;
+
+   // Scratch for Update, kept to avoid allocating every frame.
+   std::vector<uint8_t> m_vecQueued;
+   std::vector<uint32_t> m_vecAffected;
+   std::vector<uint32_t> m_vecSorted;
+   std::vector<uint32_t> m_vecLevelOffsets;
+   std::vector<uint32_t> m_vecWalkStack;
+
+   ThreadPool m_threadPool;
+};
@@ -1,3 +1,5 @@
 D:\VulkanSDK\1.2.148.1\Bin32\glslangValidator.exe -V shader.vert
 D:\VulkanSDK\1.2.148.1\Bin32\glslangValidator.exe -V shader.frag
+D:\VulkanSDK\1.2.148.1\Bin32\glslangValidator.exe -V mipgen.comp -o mipgen.spv
+D:\VulkanSDK\1.2.148.1\Bin32\glslangValidator.exe -V meshlet_cull.comp -o meshlet_cull.spv
 pause
\ No newline at end of file
@@ -5,9 +5,39 @@ layout(location = 1) in vec2 fragTex;
 
 layout(set = 1, binding = 0) uniform sampler2D textureSampler;
 
+// Off where the device can't store from fragment shaders, the renderer streams whole textures instead.
+layout(constant_id = 0) const bool TEXTURE_FEEDBACK = true;
+
+// Finest mip level sampled per texture ID this frame, read back by the renderer to decide which levels stay in VRAM.
+layout(set = 2, binding = 0) buffer TextureFeedback {
+    uint minLevel[];
+} textureFeedback;
+
+layout(push_constant) uniform PushTexture {
+    layout(offset = 96) uint texId;     // Texture the draw asked for, feedback goes to its slot. (after the vertex stage's block)
+    uint baseLevel;                     // Level of the full chain the bound view starts at, all bits set for the placeholder.
+} pushTexture;
+
 layout(location = 0) out vec4 outColor; // Final output color. (must also have location.)
 
 void main()
 {
     outColor = texture(textureSampler, fragTex);
-}
\ No newline at end of file
+
+    // LOD is relative to the view, which starts at baseLevel while the finer levels aren't resident.
+    // Queried before branching, it needs derivatives from the whole quad.
+    float lod = textureQueryLod(textureSampler, fragTex).y + float(pushTexture.baseLevel);
+
+    // One pixel in 16 is plenty to find the finest level a surface needs, and keeps atomics off the rest.
+    // The placeholder's size says nothing about the texture it stands in for.
+    if (TEXTURE_FEEDBACK && pushTexture.baseLevel != 0xFFFFFFFFu && ((uint(gl_FragCoord.x) | uint(gl_FragCoord.y)) & 3u) == 0u)
+    {
+        uint level = uint(max(lod, 0.0));
+
+        // Plain read first, the atomic only happens when this pixel wants a finer level than already recorded.
+        if (level < textureFeedback.minLevel[pushTexture.texId])
+        {
+            atomicMin(textureFeedback.minLevel[pushTexture.texId], level);
+        }
+    }
+}
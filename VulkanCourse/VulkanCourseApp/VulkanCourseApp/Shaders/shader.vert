@@ -5,8 +5,7 @@ layout(location = 1) in vec3 col;
 layout(location = 2) in vec2 tex;
 
 layout(set = 0, binding = 0) uniform UboViewProjection {
-    mat4 projection;
-    mat4 view;
+    mat4 viewProjection;    // Projection * view, combined once a frame on the CPU.
 } uboViewProjection;
 
 // NOT IN USE, LEFT FOR REFERENCE.
@@ -14,16 +13,44 @@ layout(set = 0, binding = 0) uniform UboViewProjection {
 //    mat4 model;
 //} uboModel;
 
+// Model transforms may come as translation, rotation and scale rather than a matrix. (COMPACT_TRANSFORMS on the CPU side)
+layout(constant_id = 0) const bool COMPACT_TRANSFORMS = false;
+
 layout(push_constant) uniform PushModel {
-    mat4 model;
+    vec4 positionScale;     // Undoes the mesh's position quantization, 1 and 0 for float vertices.
+    vec4 positionOffset;    // w is 1 for a compact transform, 0 for a matrix.
+    vec4 transform[4];      // Model matrix columns, or rotation quaternion, translation with x scale, y and z scale.
 } pushModel;
 
+// Model space to world space.
+vec3 ApplyModel(vec3 position)
+{
+    // Nodes the compact form can't describe exactly still send their matrix.
+    if (COMPACT_TRANSFORMS && pushModel.positionOffset.w != 0.0)
+    {
+        vec4 rotation = pushModel.transform[0];
+        vec3 scale = vec3(pushModel.transform[1].w, pushModel.transform[2].xy);
+
+        // Rotating by a unit quaternion, two cross products instead of building the matrix.
+        vec3 scaled = position * scale;
+        vec3 rotated = scaled + 2.0 * cross(rotation.xyz, cross(rotation.xyz, scaled) + rotation.w * scaled);
+        return rotated + pushModel.transform[1].xyz;
+    }
+
+    mat4 model = mat4(pushModel.transform[0], pushModel.transform[1], pushModel.transform[2], pushModel.transform[3]);
+    return (model * vec4(position, 1.0)).xyz;
+}
+
 layout(location = 0) out vec3 fragCol;
 layout(location = 1) out vec2 fragTex;
 
 void main()
 {
-    gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
+    // Quantized positions arrive in [-1, 1] of the mesh bounds.
+    vec3 position = pos * pushModel.positionScale.xyz + pushModel.positionOffset.xyz;
+
+    gl_Position = uboViewProjection.viewProjection * vec4(ApplyModel(position), 1.0);
 
     fragCol = col;
+    fragTex = tex;
 }
\ No newline at end of file
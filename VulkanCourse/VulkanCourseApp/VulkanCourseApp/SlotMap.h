@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Slot of a handle that refers to nothing.
+const uint32_t INVALID_SLOT = UINT32_MAX;
+
+// Reference to an object that may be removed while the handle is still around. The slot is reused by later objects, the
+// generation tells them apart: it changes every time the slot is freed, so a handle to a removed object never finds the
+// next one. Tag only keeps handles to different kinds of object from mixing.
+template <typename Tag>
+struct Handle
+{
+   uint32_t index = INVALID_SLOT;
+   uint32_t generation = 0;
+
+   bool IsValid() const
+   {
+      return index != INVALID_SLOT;
+   }
+
+   bool operator==(const Handle& other) const
+   {
+      return index == other.index && generation == other.generation;
+   }
+
+   bool operator!=(const Handle& other) const
+   {
+      return !(*this == other);
+   }
+};
+
+// Objects addressed by generational handles. The objects themselves sit packed in one array in no particular order, so
+// walking every live one is a walk over contiguous memory. Slots map handles to positions in that array, freed slots go
+// on a free list. Insert, Remove and Get are all O(1). Removing moves the last object into the hole, so positions (not
+// handles) change on every remove.
+template <typename T, typename Tag>
+class SlotMap
+{
+public:
+   using HandleType = Handle<Tag>;
+
+   HandleType Insert(T&& object)
+   {
+      uint32_t slot;
+      if (!m_vecFreeSlots.empty())
+      {
+         slot = m_vecFreeSlots.back();
+         m_vecFreeSlots.pop_back();
+      }
+      else
+      {
+         slot = static_cast<uint32_t>(m_vecSlots.size());
+         m_vecSlots.push_back({ INVALID_SLOT, 0 });
+      }
+
+      m_vecSlots[slot].position = static_cast<uint32_t>(m_vecObjects.size());
+      m_vecObjects.push_back(std::move(object));
+      m_vecSlotOfPosition.push_back(slot);
+
+      return { slot, m_vecSlots[slot].generation };
+   }
+
+   // False if the handle was already stale.
+   bool Remove(HandleType handle)
+   {
+      if (!Contains(handle))
+      {
+         return false;
+      }
+
+      Slot& slot = m_vecSlots[handle.index];
+      uint32_t last = static_cast<uint32_t>(m_vecObjects.size() - 1);
+      if (slot.position != last)
+      {
+         m_vecObjects[slot.position] = std::move(m_vecObjects[last]);
+         m_vecSlotOfPosition[slot.position] = m_vecSlotOfPosition[last];
+         m_vecSlots[m_vecSlotOfPosition[last]].position = slot.position;
+      }
+      m_vecObjects.pop_back();
+      m_vecSlotOfPosition.pop_back();
+
+      slot.position = INVALID_SLOT;
+      slot.generation++;
+      m_vecFreeSlots.push_back(handle.index);
+
+      return true;
+   }
+
+   bool Contains(HandleType handle) const
+   {
+      return handle.index < m_vecSlots.size() && m_vecSlots[handle.index].generation == handle.generation &&
+         m_vecSlots[handle.index].position != INVALID_SLOT;
+   }
+
+   // Object of a handle, nullptr if it was removed.
+   T* Get(HandleType handle)
+   {
+      return Contains(handle) ? &m_vecObjects[m_vecSlots[handle.index].position] : nullptr;
+   }
+
+   const T* Get(HandleType handle) const
+   {
+      return Contains(handle) ? &m_vecObjects[m_vecSlots[handle.index].position] : nullptr;
+   }
+
+   // Live objects by position, 0 to GetSize() - 1.
+   T& operator[](size_t position)
+   {
+      return m_vecObjects[position];
+   }
+
+   const T& operator[](size_t position) const
+   {
+      return m_vecObjects[position];
+   }
+
+   HandleType GetHandle(size_t position) const
+   {
+      uint32_t slot = m_vecSlotOfPosition[position];
+      return { slot, m_vecSlots[slot].generation };
+   }
+
+   // Handle of the object in a slot, for callers that keep arrays of their own indexed by slot. Invalid while the slot is free.
+   HandleType GetSlotHandle(uint32_t slot) const
+   {
+      if (slot >= m_vecSlots.size() || m_vecSlots[slot].position == INVALID_SLOT)
+      {
+         return {};
+      }
+      return { slot, m_vecSlots[slot].generation };
+   }
+
+   // Slots used so far, live or free. Every handle's index is below this.
+   size_t GetSlotCount() const
+   {
+      return m_vecSlots.size();
+   }
+
+   size_t GetSize() const
+   {
+      return m_vecObjects.size();
+   }
+
+   // Every live object, packed.
+   typename std::vector<T>::iterator begin()
+   {
+      return m_vecObjects.begin();
+   }
+
+   typename std::vector<T>::iterator end()
+   {
+      return m_vecObjects.end();
+   }
+
+   typename std::vector<T>::const_iterator begin() const
+   {
+      return m_vecObjects.begin();
+   }
+
+   typename std::vector<T>::const_iterator end() const
+   {
+      return m_vecObjects.end();
+   }
+
+private:
+   struct Slot
+   {
+      uint32_t position;         // In m_vecObjects, INVALID_SLOT while free.
+      uint32_t generation;       // Of the object in the slot, or of the next one while free.
+   };
+
+   std::vector<T> m_vecObjects;
+   std::vector<uint32_t> m_vecSlotOfPosition;
+   std::vector<Slot> m_vecSlots;
+   std::vector<uint32_t> m_vecFreeSlots;
+};
@@ -0,0 +1,68 @@
+#include "StaticBatch.h"
+
+#include <unordered_map>
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+std::vector<StaticBatch> BuildStaticBatches(const ImportedScene& scene, const std::vector<StaticPlacement>& placements,
+   const std::vector<uint32_t>& modelOfPlacement)
+{
+   std::vector<StaticBatch> batches;
+
+   // Batch still taking meshes for each texture.
+   std::unordered_map<uint32_t, size_t> openBatches;
+
+   for (size_t p = 0; p < placements.size(); p++)
+   {
+      const glm::mat4& transform = placements[p].transform;
+      // A mirroring transform turns every triangle around, its corners are swapped back to keep front faces counter clockwise.
+      bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+
+      for (const ImportedMesh& mesh : scene.models[modelOfPlacement[p]].meshes)
+      {
+         uint32_t firstIndex = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+         uint32_t indexCount = mesh.lods.empty() ? static_cast<uint32_t>(mesh.indices.size()) : mesh.lods[0].indexCount;
+         if (indexCount == 0)
+         {
+            continue;
+         }
+
+         auto open = openBatches.find(mesh.textureIndex);
+         if (open == openBatches.end() ||
+            (!batches[open->second].vertices.empty() && batches[open->second].vertices.size() + mesh.vertices.size() > STATIC_BATCH_MAX_VERTICES))
+         {
+            StaticBatch batch = {};
+            batch.textureIndex = mesh.textureIndex;
+            batches.push_back(std::move(batch));
+            openBatches[mesh.textureIndex] = batches.size() - 1;
+            open = openBatches.find(mesh.textureIndex);
+         }
+
+         StaticBatch& batch = batches[open->second];
+         uint32_t baseVertex = static_cast<uint32_t>(batch.vertices.size());
+         for (const Vertex& vertex : mesh.vertices)
+         {
+            Vertex placed = vertex;
+            placed.pos = glm::vec3(transform * glm::vec4(vertex.pos, 1.0f));
+            batch.vertices.push_back(placed);
+         }
+
+         for (uint32_t i = firstIndex; i + 2 < firstIndex + indexCount; i += 3)
+         {
+            batch.indices.push_back(baseVertex + mesh.indices[i]);
+            batch.indices.push_back(baseVertex + mesh.indices[mirrored ? i + 2 : i + 1]);
+            batch.indices.push_back(baseVertex + mesh.indices[mirrored ? i + 1 : i + 2]);
+         }
+         batch.sourceMeshCount++;
+      }
+   }
+
+   // Each mesh came in cache order already, the batch keeps it mesh by mesh and only needs its meshlets.
+   for (StaticBatch& batch : batches)
+   {
+      batch.meshlets = BuildMeshlets(batch.vertices, batch.indices);
+   }
+
+   return batches;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshImport.h"
+
+// Batches stop taking meshes at this many vertices, so their indices stay 16 bit and their quantized positions keep
+// a useful precision. A mesh larger than this on its own still becomes a batch by itself.
+const uint32_t STATIC_BATCH_MAX_VERTICES = 65536;
+
+// A model placed once and never moved again.
+struct StaticPlacement
+{
+   std::string fileName;         // Model file, relative to MODEL_DIRECTORY.
+   glm::mat4 transform;
+};
+
+// Meshes of every static placement that share a texture, merged into one with their transforms baked in.
+struct StaticBatch
+{
+   std::vector<Vertex> vertices;
+   std::vector<uint32_t> indices;
+   std::vector<Meshlet> meshlets;
+   uint32_t textureIndex;        // Index into ImportedScene::textureFiles, UINT32_MAX if untextured.
+   uint32_t sourceMeshCount;     // Meshes merged into the batch.
+};
+
+// Merge the meshes of imported models into batches by texture. modelOfPlacement gives the model each placement uses,
+// so a file placed many times is only imported once. Only the full level of detail of each mesh is taken, a batch
+// spans too much of the scene for one level to suit all of it, and its meshlets are culled one by one instead.
+std::vector<StaticBatch> BuildStaticBatches(const ImportedScene& scene, const std::vector<StaticPlacement>& placements,
+   const std::vector<uint32_t>& modelOfPlacement);
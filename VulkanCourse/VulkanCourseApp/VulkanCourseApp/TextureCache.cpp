@@ -0,0 +1,191 @@
+#include "TextureCache.h"
+
+#include "PackFormat.h"
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+TextureCache::TextureCache()
+{
+}
+
+TextureCache::~TextureCache()
+{
+}
+
+uint32_t TextureCache::Acquire(const std::string& fileName)
+{
+   auto range = m_mapPaths.equal_range(HashPath(fileName));
+   for (auto it = range.first; it != range.second; it++)
+   {
+      CachedTexture& texture = GetTexture(it->second);
+      if (texture.fileName == fileName)
+      {
+         texture.refCount++;
+         return it->second;
+      }
+   }
+
+   return INVALID_TEXTURE_ID;
+}
+
+void TextureCache::AddReference(uint32_t texId)
+{
+   GetTexture(texId).refCount++;
+}
+
+uint32_t TextureCache::Insert(const std::string& fileName)
+{
+   CachedTexture texture = {};
+   texture.fileName = fileName;
+   texture.pathHash = HashPath(fileName);
+   texture.content = TextureContent();
+   texture.refCount = 1;
+   texture.loading = true;
+
+   // Freed slots are reused first, which keeps IDs dense.
+   uint64_t pathHash = texture.pathHash;
+   uint32_t texId = m_textures.Insert(std::move(texture)).index;
+   GetTexture(texId).pixelOwner = texId;
+
+   m_mapPaths.insert({ pathHash, texId });
+
+   return texId;
+}
+
+uint32_t TextureCache::SetContent(uint32_t texId, const TextureContent& content)
+{
+   CachedTexture& texture = GetTexture(texId);
+   texture.loading = false;
+
+   // Released while its file was still loading, the ID was held back until now.
+   if (texture.refCount == 0)
+   {
+      FreeId(texId);
+      return INVALID_TEXTURE_ID;
+   }
+
+   // Failed loads have nothing to share.
+   if (content.IsEmpty())
+   {
+      return texId;
+   }
+
+   auto range = m_mapContents.equal_range(content.hash[0]);
+   for (auto it = range.first; it != range.second; it++)
+   {
+      CachedTexture& owner = GetTexture(it->second);
+      if (owner.content == content)
+      {
+         // Same pixels under another name. (or a second copy of one file) Show the first image, keep it alive for this one.
+         texture.pixelOwner = it->second;
+         owner.refCount++;
+         return it->second;
+      }
+   }
+
+   texture.content = content;
+   m_mapContents.insert({ content.hash[0], texId });
+   return texId;
+}
+
+bool TextureCache::Release(uint32_t texId)
+{
+   CachedTexture& texture = GetTexture(texId);
+   if (--texture.refCount > 0)
+   {
+      return false;
+   }
+
+   // Forget the file and pixels so nothing finds this texture again.
+   auto range = m_mapPaths.equal_range(texture.pathHash);
+   for (auto it = range.first; it != range.second; it++)
+   {
+      if (it->second == texId)
+      {
+         m_mapPaths.erase(it);
+         break;
+      }
+   }
+
+   if (!texture.content.IsEmpty())
+   {
+      auto contents = m_mapContents.equal_range(texture.content.hash[0]);
+      for (auto it = contents.first; it != contents.second; it++)
+      {
+         if (it->second == texId)
+         {
+            m_mapContents.erase(it);
+            break;
+         }
+      }
+      texture.content = TextureContent();
+   }
+
+   texture.fileName.clear();
+
+   if (!texture.loading)
+   {
+      FreeId(texId);
+   }
+
+   return true;
+}
+
+uint32_t TextureCache::GetPixelOwner(uint32_t texId) const
+{
+   const CachedTexture* texture = FindTexture(texId);
+   return texture ? texture->pixelOwner : texId;
+}
+
+uint32_t TextureCache::GetRefCount(uint32_t texId) const
+{
+   const CachedTexture* texture = FindTexture(texId);
+   return texture ? texture->refCount : 0;
+}
+
+bool TextureCache::IsLoading(uint32_t texId) const
+{
+   const CachedTexture* texture = FindTexture(texId);
+   return texture && texture->loading;
+}
+
+uint32_t TextureCache::GetCapacity() const
+{
+   return static_cast<uint32_t>(m_textures.GetSlotCount());
+}
+
+TextureHandle TextureCache::GetHandle(uint32_t texId) const
+{
+   return m_textures.GetSlotHandle(texId);
+}
+
+bool TextureCache::IsCurrent(TextureHandle texture) const
+{
+   const CachedTexture* cached = m_textures.Get(texture);
+   return cached && cached->refCount > 0;
+}
+
+/***********************************************************
+** Private Functions.
+***********************************************************/
+uint64_t TextureCache::HashPath(const std::string& fileName)
+{
+   return HashAssetName(fileName.data(), fileName.size());
+}
+
+TextureCache::CachedTexture& TextureCache::GetTexture(uint32_t texId)
+{
+   return *m_textures.Get(m_textures.GetSlotHandle(texId));
+}
+
+const TextureCache::CachedTexture* TextureCache::FindTexture(uint32_t texId) const
+{
+   return m_textures.Get(m_textures.GetSlotHandle(texId));
+}
+
+void TextureCache::FreeId(uint32_t texId)
+{
+   // Handles to the texture that had the ID go stale here.
+   m_textures.Remove(m_textures.GetSlotHandle(texId));
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "SlotMap.h"
+
+const uint32_t INVALID_TEXTURE_ID = UINT32_MAX;
+
+// Texture with the generation of its slot, for holding on to a texture beyond the call that made it. The index is the
+// texture ID.
+struct TextureTag;
+using TextureHandle = Handle<TextureTag>;
+
+// What a texture's pixels are, to find identical images by. Two textures only share an image when every field matches,
+// so it takes a collision in the 128 bit hash between levels of exactly the same shape, format and size to mix them up.
+struct TextureContent
+{
+   uint64_t hash[2];          // Hash of every level, both halves 0 for no pixels.
+   uint64_t size;             // Bytes in all levels together.
+   uint32_t width;            // Width of level 0 in pixels.
+   uint32_t height;           // Height of level 0 in pixels.
+   uint32_t format;           // VkFormat of the levels.
+
+   bool IsEmpty() const
+   {
+      return hash[0] == 0 && hash[1] == 0;
+   }
+
+   bool operator==(const TextureContent& other) const
+   {
+      return hash[0] == other.hash[0] && hash[1] == other.hash[1] && size == other.size && width == other.width &&
+         height == other.height && format == other.format;
+   }
+};
+
+// Book keeping for shared textures. Hands out texture IDs (descriptor slots), remembers which file and which pixels each
+// one holds and counts references, so a file is only decoded once and identical pixels only take VRAM once.
+// IDs are the slots of a SlotMap, so they stay dense and a handle's generation tells a freed ID from the texture reusing it.
+// GPU objects stay with the renderer, this only tells it what to do with them.
+class TextureCache
+{
+public:
+   TextureCache();
+   ~TextureCache();
+
+   // Texture already loaded or loading for this file, with one more reference. INVALID_TEXTURE_ID if there is none.
+   uint32_t Acquire(const std::string& fileName);
+   // One more reference on a live texture.
+   void AddReference(uint32_t texId);
+   // New texture for a file with one reference. Released IDs are reused before new ones are handed out.
+   uint32_t Insert(const std::string& fileName);
+
+   // Pixels of a loading texture are known, empty content if its load failed. If a live texture already holds identical pixels
+   // it gains a reference for this one and its ID is returned, otherwise this texture owns its pixels and gets its own ID back.
+   // Returns INVALID_TEXTURE_ID if the texture was released while loading, its ID is recycled now and the pixels are unwanted.
+   uint32_t SetContent(uint32_t texId, const TextureContent& content);
+
+   // Drop one reference. Returns true if it was the last. The ID is reused from then on, unless the texture is still loading,
+   // in which case that waits for SetContent so a late result can't land on a new texture.
+   // A texture sharing another's pixels holds a reference on the owner, read GetPixelOwner first and release that too.
+   bool Release(uint32_t texId);
+
+   // Texture whose image this one shows, itself unless it shares another's pixels.
+   uint32_t GetPixelOwner(uint32_t texId) const;
+   // 0 for a free ID.
+   uint32_t GetRefCount(uint32_t texId) const;
+   bool IsLoading(uint32_t texId) const;
+
+   // Number of IDs handed out so far, every ID is below this.
+   uint32_t GetCapacity() const;
+
+   // Handle of the texture that has the ID now, invalid if the ID is free.
+   TextureHandle GetHandle(uint32_t texId) const;
+   // Still the texture the handle was made for, and referenced.
+   bool IsCurrent(TextureHandle texture) const;
+
+private:
+   struct CachedTexture
+   {
+      std::string fileName;      // File the texture was requested by.
+      uint64_t pathHash;         // Hash of fileName.
+      TextureContent content;    // Loaded pixels, empty while loading or if the load failed.
+      uint32_t refCount;         // 0 when the ID is free.
+      uint32_t pixelOwner;       // Texture holding the image, this one unless its pixels matched another's.
+      bool loading;              // Set until SetContent.
+   };
+
+   static uint64_t HashPath(const std::string& fileName);
+   // Texture of a live ID. An ID stays live while loading even once its last reference is gone, until SetContent frees it.
+   CachedTexture& GetTexture(uint32_t texId);
+   const CachedTexture* FindTexture(uint32_t texId) const;
+   void FreeId(uint32_t texId);
+
+   SlotMap<CachedTexture, TextureTag> m_textures;
+
+   // Path hashes can collide, every texture with a hash is listed and the name decides.
+   std::unordered_multimap<uint64_t, uint32_t> m_mapPaths;
+   // Pixel owners by the first half of their content hash. Hashes can collide too, the whole content decides.
+   std::unordered_multimap<uint64_t, uint32_t> m_mapContents;
+};
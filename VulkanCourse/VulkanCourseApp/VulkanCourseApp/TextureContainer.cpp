@@ -0,0 +1,317 @@
+#include "TextureContainer.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+// KTX2 files start with "«KTX 20»\r\n\x1A\n".
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// Fixed part of a KTX2 header, level index follows it.
+static const size_t KTX2_HEADER_SIZE = 80;
+
+static_assert(CONTAINER_HEADER_READ_SIZE >= KTX2_HEADER_SIZE + MAX_CONTAINER_LEVELS * 24, "Header read must cover a full level index.");
+
+// DDS magic, header and the optional DX10 extension.
+static const size_t DDS_HEADER_SIZE = 128;
+static const size_t DDS_DX10_HEADER_SIZE = 20;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+
+/***********************************************************
+** Helper Functions.
+***********************************************************/
+static uint32_t ReadU32(const uint8_t* data)
+{
+   return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static uint64_t ReadU64(const uint8_t* data)
+{
+   return ReadU32(data) | (static_cast<uint64_t>(ReadU32(data + 4)) << 32);
+}
+
+static uint32_t FourCC(const char* code)
+{
+   return ReadU32(reinterpret_cast<const uint8_t*>(code));
+}
+
+// Leading bytes of a container file, every header read is bounds checked against them.
+struct HeaderBytes
+{
+   const uint8_t* data;
+   uint64_t size;
+   const std::string& name;
+
+   const uint8_t* At(uint64_t offset, uint64_t count) const
+   {
+      if (offset + count > size)
+      {
+         throw std::runtime_error("Texture container is truncated! (" + name + ")");
+      }
+      return data + offset;
+   }
+};
+
+// Fill in level sizes for a chain stored back to back from dataOffset. (DDS)
+static void LayoutLevels(TextureContainer* container, uint32_t levelCount, uint64_t dataOffset)
+{
+   BlockFormat blockFormat = ToBlockFormat(container->format);
+
+   uint32_t width = container->width;
+   uint32_t height = container->height;
+   for (uint32_t i = 0; i < levelCount; i++)
+   {
+      ContainerLevel level = {};
+      level.fileOffset = dataOffset;
+      level.size = BlockImageSize(blockFormat, width, height);
+      level.width = width;
+      level.height = height;
+      container->levels.push_back(level);
+
+      dataOffset += level.size;
+      width = std::max(width / 2, 1u);
+      height = std::max(height / 2, 1u);
+   }
+}
+
+static VkFormat DdsFormat(uint32_t fourCC, uint32_t dxgiFormat)
+{
+   if (fourCC == FourCC("DXT1")) return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+   if (fourCC == FourCC("DXT5")) return VK_FORMAT_BC3_UNORM_BLOCK;
+   if (fourCC == FourCC("ATI2") || fourCC == FourCC("BC5U")) return VK_FORMAT_BC5_UNORM_BLOCK;
+
+   if (fourCC == FourCC("DX10"))
+   {
+      switch (dxgiFormat)
+      {
+      case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;   // DXGI_FORMAT_BC1_UNORM
+      case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;    // DXGI_FORMAT_BC1_UNORM_SRGB
+      case 77: return VK_FORMAT_BC3_UNORM_BLOCK;        // DXGI_FORMAT_BC3_UNORM
+      case 78: return VK_FORMAT_BC3_SRGB_BLOCK;         // DXGI_FORMAT_BC3_UNORM_SRGB
+      case 83: return VK_FORMAT_BC5_UNORM_BLOCK;        // DXGI_FORMAT_BC5_UNORM
+      case 98: return VK_FORMAT_BC7_UNORM_BLOCK;        // DXGI_FORMAT_BC7_UNORM
+      case 99: return VK_FORMAT_BC7_SRGB_BLOCK;         // DXGI_FORMAT_BC7_UNORM_SRGB
+      }
+   }
+
+   return VK_FORMAT_UNDEFINED;
+}
+
+static TextureContainer ReadKtx2Header(const HeaderBytes& bytes)
+{
+   const uint8_t* header = bytes.At(0, KTX2_HEADER_SIZE);
+   const std::string& filePath = bytes.name;
+
+   TextureContainer container = {};
+   container.format = static_cast<VkFormat>(ReadU32(&header[12]));
+   container.width = ReadU32(&header[20]);
+   container.height = ReadU32(&header[24]);
+
+   uint32_t depth = ReadU32(&header[28]);
+   uint32_t layerCount = ReadU32(&header[32]);
+   uint32_t faceCount = ReadU32(&header[36]);
+   uint32_t levelCount = std::max(ReadU32(&header[40]), 1u);
+   uint32_t supercompression = ReadU32(&header[44]);
+
+   if (depth > 1 || layerCount > 1 || faceCount != 1)
+   {
+      throw std::runtime_error("Only 2D textures are supported! (" + filePath + ")");
+   }
+   if (levelCount > MAX_CONTAINER_LEVELS)
+   {
+      throw std::runtime_error("Texture container has too many levels! (" + filePath + ")");
+   }
+   if (supercompression != 0)
+   {
+      throw std::runtime_error("Supercompressed KTX2 files are not supported! (" + filePath + ")");
+   }
+   if (!IsBlockFormat(container.format))
+   {
+      throw std::runtime_error("Texture container format is not BC1/3/5/7! (" + filePath + ")");
+   }
+
+   // Level index: byteOffset, byteLength, uncompressedByteLength per level, largest first.
+   const uint8_t* index = bytes.At(KTX2_HEADER_SIZE, levelCount * 24);
+   BlockFormat blockFormat = ToBlockFormat(container.format);
+   for (uint32_t i = 0; i < levelCount; i++)
+   {
+      ContainerLevel level = {};
+      level.fileOffset = ReadU64(&index[i * 24]);
+      level.size = ReadU64(&index[i * 24 + 8]);
+      level.width = std::max(container.width >> i, 1u);
+      level.height = std::max(container.height >> i, 1u);
+
+      if (level.size != BlockImageSize(blockFormat, level.width, level.height))
+      {
+         throw std::runtime_error("Texture container level has the wrong size! (" + filePath + ")");
+      }
+      container.levels.push_back(level);
+   }
+
+   return container;
+}
+
+static TextureContainer ReadDdsHeader(const HeaderBytes& bytes)
+{
+   const uint8_t* header = bytes.At(0, DDS_HEADER_SIZE);
+   const std::string& filePath = bytes.name;
+
+   TextureContainer container = {};
+   container.height = ReadU32(&header[12]);
+   container.width = ReadU32(&header[16]);
+
+   uint32_t flags = ReadU32(&header[8]);
+   uint32_t levelCount = (flags & DDSD_MIPMAPCOUNT) ? std::max(ReadU32(&header[28]), 1u) : 1;
+   uint32_t fourCC = ReadU32(&header[84]);
+
+   uint64_t dataOffset = DDS_HEADER_SIZE;
+   uint32_t dxgiFormat = 0;
+   if (fourCC == FourCC("DX10"))
+   {
+      const uint8_t* dx10 = bytes.At(DDS_HEADER_SIZE, DDS_DX10_HEADER_SIZE);
+      dxgiFormat = ReadU32(&dx10[0]);
+
+      // Dimension 3 is TEXTURE2D, array size must be 1 and no cube flag.
+      if (ReadU32(&dx10[4]) != 3 || (ReadU32(&dx10[8]) & 0x4) || ReadU32(&dx10[12]) > 1)
+      {
+         throw std::runtime_error("Only 2D textures are supported! (" + filePath + ")");
+      }
+      dataOffset += DDS_DX10_HEADER_SIZE;
+   }
+
+   if (levelCount > MAX_CONTAINER_LEVELS)
+   {
+      throw std::runtime_error("Texture container has too many levels! (" + filePath + ")");
+   }
+
+   container.format = DdsFormat(fourCC, dxgiFormat);
+   if (container.format == VK_FORMAT_UNDEFINED)
+   {
+      throw std::runtime_error("Texture container format is not BC1/3/5/7! (" + filePath + ")");
+   }
+
+   LayoutLevels(&container, levelCount, dataOffset);
+   return container;
+}
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+bool IsTextureContainer(const std::string& fileName)
+{
+   size_t dot = fileName.find_last_of('.');
+   if (dot == std::string::npos)
+   {
+      return false;
+   }
+
+   std::string extension = fileName.substr(dot + 1);
+   std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+   return extension == "ktx2" || extension == "dds";
+}
+
+TextureContainer ReadContainerHeader(const std::string& filePath)
+{
+   std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+   if (!file.is_open())
+   {
+      throw std::runtime_error("Failed to load a Texture file! (" + filePath + ")");
+   }
+
+   // Only the leading bytes are needed, level data stays on disk.
+   uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+   std::vector<uint8_t> header(static_cast<size_t>(std::min(fileSize, CONTAINER_HEADER_READ_SIZE)));
+   file.seekg(0);
+   file.read(reinterpret_cast<char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+   return ReadContainerHeader(header.data(), header.size(), fileSize, filePath);
+}
+
+TextureContainer ReadContainerHeader(const uint8_t* data, uint64_t size, uint64_t fileSize, const std::string& name)
+{
+   HeaderBytes bytes = { data, size, name };
+
+   // Identify by magic rather than extension.
+   const uint8_t* magic = bytes.At(0, 4);
+   TextureContainer container;
+   if (size >= sizeof(KTX2_IDENTIFIER) && memcmp(magic, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+   {
+      container = ReadKtx2Header(bytes);
+   }
+   else if (memcmp(magic, "DDS ", 4) == 0)
+   {
+      container = ReadDdsHeader(bytes);
+   }
+   else
+   {
+      throw std::runtime_error("Unknown texture container! (" + name + ")");
+   }
+
+   if (container.width == 0 || container.height == 0)
+   {
+      throw std::runtime_error("Texture container has no pixels! (" + name + ")");
+   }
+
+   // Every level must actually be in the file.
+   for (auto& level : container.levels)
+   {
+      if (level.fileOffset + level.size > fileSize)
+      {
+         throw std::runtime_error("Texture container is truncated! (" + name + ")");
+      }
+   }
+
+   return container;
+}
+
+bool IsBlockFormat(VkFormat format)
+{
+   switch (format)
+   {
+   case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+   case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+   case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+   case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+   case VK_FORMAT_BC3_UNORM_BLOCK:
+   case VK_FORMAT_BC3_SRGB_BLOCK:
+   case VK_FORMAT_BC5_UNORM_BLOCK:
+   case VK_FORMAT_BC7_UNORM_BLOCK:
+   case VK_FORMAT_BC7_SRGB_BLOCK:
+      return true;
+   default:
+      return false;
+   }
+}
+
+BlockFormat ToBlockFormat(VkFormat format)
+{
+   switch (format)
+   {
+   case VK_FORMAT_BC3_UNORM_BLOCK:
+   case VK_FORMAT_BC3_SRGB_BLOCK:
+      return BLOCK_FORMAT_BC3;
+   case VK_FORMAT_BC5_UNORM_BLOCK:
+      return BLOCK_FORMAT_BC5;
+   case VK_FORMAT_BC7_UNORM_BLOCK:
+   case VK_FORMAT_BC7_SRGB_BLOCK:
+      return BLOCK_FORMAT_BC7;
+   default:
+      return BLOCK_FORMAT_BC1;
+   }
+}
+
+VkFormat DecodedFormat(VkFormat format)
+{
+   switch (format)
+   {
+   case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+   case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+   case VK_FORMAT_BC3_SRGB_BLOCK:
+   case VK_FORMAT_BC7_SRGB_BLOCK:
+      return VK_FORMAT_R8G8B8A8_SRGB;
+   default:
+      return VK_FORMAT_R8G8B8A8_UNORM;
+   }
+}
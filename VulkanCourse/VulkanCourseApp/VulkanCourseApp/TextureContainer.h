@@ -0,0 +1,47 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+
+// One mip level as it is stored in the file.
+struct ContainerLevel
+{
+   uint64_t fileOffset;       // Where the level's blocks start in the file.
+   uint64_t size;             // Size of the level in bytes.
+   uint32_t width;            // Width of level in pixels.
+   uint32_t height;           // Height of level in pixels.
+};
+
+// Pre-compressed texture (KTX2 or DDS), only the header is read.
+struct TextureContainer
+{
+   VkFormat format;                       // Block compressed format of every level.
+   uint32_t width;                        // Width of level 0 in pixels.
+   uint32_t height;                       // Height of level 0 in pixels.
+   std::vector<ContainerLevel> levels;    // Largest level first.
+};
+
+// Most levels a 2D texture can have. (a 2^31 pixel side)
+const uint32_t MAX_CONTAINER_LEVELS = 32;
+
+// Leading bytes of a file that hold its header, enough for either format's header and a full level index.
+const uint64_t CONTAINER_HEADER_READ_SIZE = 80 + MAX_CONTAINER_LEVELS * 24;
+
+// True if the file is a .ktx2 or .dds container rather than an image stb can decode.
+bool IsTextureContainer(const std::string& fileName);
+
+// Parse the container header and level index. Throws if the file isn't a 2D BC1/3/5/7 texture.
+TextureContainer ReadContainerHeader(const std::string& filePath);
+// Same from memory. data holds at least the header (or the whole file), fileSize is the size of the whole file.
+TextureContainer ReadContainerHeader(const uint8_t* data, uint64_t size, uint64_t fileSize, const std::string& name);
+
+// -- Format Helpers.
+bool IsBlockFormat(VkFormat format);
+BlockFormat ToBlockFormat(VkFormat format);
+// RGBA8 format a block format is decoded to when the device can't sample it directly.
+VkFormat DecodedFormat(VkFormat format);
@@ -0,0 +1,88 @@
+#include "ThreadPool.h"
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+ThreadPool::ThreadPool()
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+   Deinit();
+}
+
+void ThreadPool::Init(uint32_t threadCount)
+{
+   // Default to one worker per core, leaving one for the main (render) thread.
+   if (threadCount == 0)
+   {
+      uint32_t coreCount = std::thread::hardware_concurrency();
+      threadCount = coreCount > 1 ? coreCount - 1 : 1;
+   }
+
+   m_bStopping = false;
+   for (uint32_t i = 0; i < threadCount; i++)
+   {
+      m_vecWorkers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+   }
+}
+
+void ThreadPool::Deinit()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mtxJobs);
+      m_bStopping = true;
+   }
+   m_cvJobs.notify_all();
+
+   // Workers finish the job they are on, then exit. Unstarted jobs are dropped.
+   for (auto& worker : m_vecWorkers)
+   {
+      worker.join();
+   }
+   m_vecWorkers.clear();
+
+   std::queue<std::function<void()>>().swap(m_queJobs);
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mtxJobs);
+      m_queJobs.push(std::move(job));
+   }
+   m_cvJobs.notify_one();
+}
+
+uint32_t ThreadPool::GetThreadCount()
+{
+   return static_cast<uint32_t>(m_vecWorkers.size());
+}
+
+/***********************************************************
+** Private Functions.
+***********************************************************/
+void ThreadPool::WorkerLoop()
+{
+   while (true)
+   {
+      std::function<void()> job;
+
+      {
+         // Sleep until there is work to do or the pool is shutting down.
+         std::unique_lock<std::mutex> lock(m_mtxJobs);
+         m_cvJobs.wait(lock, [this] { return m_bStopping || !m_queJobs.empty(); });
+
+         if (m_bStopping)
+         {
+            return;
+         }
+
+         job = std::move(m_queJobs.front());
+         m_queJobs.pop();
+      }
+
+      job();
+   }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool
+{
+public:
+   ThreadPool();
+   ~ThreadPool();
+
+   void Init(uint32_t threadCount = 0);
+   void Deinit();
+
+   void Submit(std::function<void()> job);
+
+   uint32_t GetThreadCount();
+
+private:
+   void WorkerLoop();
+
+   std::vector<std::thread> m_vecWorkers;
+
+   // Jobs waiting for a free worker.
+   std::queue<std::function<void()>> m_queJobs;
+   std::mutex m_mtxJobs;
+   std::condition_variable m_cvJobs;
+
+   bool m_bStopping = false;
+};
@@ -0,0 +1,276 @@
+#include "TransformMath.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_MATH_SSE
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#include "TransformMathAvx2.h"
+
+// Quaternions are read straight from memory as x, y, z, w, glm's default storage order. The AVX2 kernels take vectors
+// and matrices as packed floats.
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::quat) == 4 * sizeof(float) &&
+   sizeof(glm::mat4) == 16 * sizeof(float), "TransformMathAvx2 needs tightly packed glm types.");
+
+// Whether the CPU and OS run AVX2: cpuid says the CPU has AVX and AVX2, and XGETBV that the OS saves the YMM registers.
+static bool CpuHasAvx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+   {
+      return false;
+   }
+
+   __cpuid(info, 1);
+   bool osxsave = (info[2] & (1 << 27)) != 0;
+   bool avx = (info[2] & (1 << 28)) != 0;
+   if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+   {
+      return false;
+   }
+
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   return __builtin_cpu_supports("avx2") != 0;
+#else
+   return false;
+#endif
+}
+
+// Checked once, the first time a kernel runs. Anything without AVX2 stays on SSE2.
+static bool UseAvx2()
+{
+   static const bool useAvx2 = IsTransformMathAvx2Built() && CpuHasAvx2();
+   return useAvx2;
+}
+
+#ifdef TRANSFORM_MATH_SSE
+// result = a * b. Each column of the result is the columns of a weighted by one column of b, four lanes at a time.
+// Columns of b are read before that column of the result is written, so result may be a or b.
+static inline void MultiplyMatrixSse(const float* pa, const float* pb, float* pr)
+{
+   __m128 a0 = _mm_loadu_ps(pa);
+   __m128 a1 = _mm_loadu_ps(pa + 4);
+   __m128 a2 = _mm_loadu_ps(pa + 8);
+   __m128 a3 = _mm_loadu_ps(pa + 12);
+   for (int column = 0; column < 4; column++)
+   {
+      const float* bc = pb + column * 4;
+      __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+      sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+      sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+      sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+      _mm_storeu_ps(pr + column * 4, sum);
+   }
+}
+#endif
+
+#ifdef TRANSFORM_MATH_SSE
+// ComposeTransform of four transforms, a lane each. The quaternions are transposed in, the matrices transposed back out.
+static void ComposeTransforms4(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* results)
+{
+   __m128 x = _mm_loadu_ps(&rotations[0].x);
+   __m128 y = _mm_loadu_ps(&rotations[1].x);
+   __m128 z = _mm_loadu_ps(&rotations[2].x);
+   __m128 w = _mm_loadu_ps(&rotations[3].x);
+   _MM_TRANSPOSE4_PS(x, y, z, w);
+
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 two = _mm_set1_ps(2.0f);
+   __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+   __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+   __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+   __m128 sx = _mm_setr_ps(scales[0].x, scales[1].x, scales[2].x, scales[3].x);
+   __m128 sy = _mm_setr_ps(scales[0].y, scales[1].y, scales[2].y, scales[3].y);
+   __m128 sz = _mm_setr_ps(scales[0].z, scales[1].z, scales[2].z, scales[3].z);
+
+   __m128 columns[4][4];
+   columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+   columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+   columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+   columns[0][3] = _mm_setzero_ps();
+
+   columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+   columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+   columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+   columns[1][3] = _mm_setzero_ps();
+
+   columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+   columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+   columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+   columns[2][3] = _mm_setzero_ps();
+
+   columns[3][0] = _mm_setr_ps(translations[0].x, translations[1].x, translations[2].x, translations[3].x);
+   columns[3][1] = _mm_setr_ps(translations[0].y, translations[1].y, translations[2].y, translations[3].y);
+   columns[3][2] = _mm_setr_ps(translations[0].z, translations[1].z, translations[2].z, translations[3].z);
+   columns[3][3] = one;
+
+   for (int column = 0; column < 4; column++)
+   {
+      _MM_TRANSPOSE4_PS(columns[column][0], columns[column][1], columns[column][2], columns[column][3]);
+      for (int i = 0; i < 4; i++)
+      {
+         _mm_storeu_ps(&results[i][column][0], columns[column][i]);
+      }
+   }
+}
+#endif
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4* result)
+{
+   if (UseAvx2())
+   {
+      MultiplyMatricesAvx2(&a[0][0], &b[0][0], &(*result)[0][0], 1);
+      return;
+   }
+
+#if defined(TRANSFORM_MATH_SSE)
+   MultiplyMatrixSse(&a[0][0], &b[0][0], &(*result)[0][0]);
+#else
+   *result = a * b;
+#endif
+}
+
+void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count)
+{
+   if (UseAvx2())
+   {
+      MultiplyMatricesAvx2(reinterpret_cast<const float*>(a), reinterpret_cast<const float*>(b),
+         reinterpret_cast<float*>(results), count);
+      return;
+   }
+
+   for (size_t i = 0; i < count; i++)
+   {
+#if defined(TRANSFORM_MATH_SSE)
+      MultiplyMatrixSse(&a[i][0][0], &b[i][0][0], &results[i][0][0]);
+#else
+      results[i] = a[i] * b[i];
+#endif
+   }
+}
+
+glm::mat4 ComposeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+   // Written out rather than as three matrix products.
+   float xx = rotation.x * rotation.x, yy = rotation.y * rotation.y, zz = rotation.z * rotation.z;
+   float xy = rotation.x * rotation.y, xz = rotation.x * rotation.z, yz = rotation.y * rotation.z;
+   float wx = rotation.w * rotation.x, wy = rotation.w * rotation.y, wz = rotation.w * rotation.z;
+
+   glm::mat4 transform;
+   transform[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * scale.x, 2.0f * (xy + wz) * scale.x, 2.0f * (xz - wy) * scale.x, 0.0f);
+   transform[1] = glm::vec4(2.0f * (xy - wz) * scale.y, (1.0f - 2.0f * (xx + zz)) * scale.y, 2.0f * (yz + wx) * scale.y, 0.0f);
+   transform[2] = glm::vec4(2.0f * (xz + wy) * scale.z, 2.0f * (yz - wx) * scale.z, (1.0f - 2.0f * (xx + yy)) * scale.z, 0.0f);
+   transform[3] = glm::vec4(translation, 1.0f);
+   return transform;
+}
+
+void ComposeTransforms(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+   glm::mat4* results, size_t count)
+{
+   size_t i = 0;
+   if (UseAvx2())
+   {
+      i = count - count % 8;
+      ComposeTransformsAvx2(reinterpret_cast<const float*>(translations), reinterpret_cast<const float*>(rotations),
+         reinterpret_cast<const float*>(scales), reinterpret_cast<float*>(results), i);
+   }
+
+#if defined(TRANSFORM_MATH_SSE)
+   for (; i + 4 <= count; i += 4)
+   {
+      ComposeTransforms4(translations + i, rotations + i, scales + i, results + i);
+   }
+#endif
+
+   // Whatever doesn't fill a full set of lanes.
+   for (; i < count; i++)
+   {
+      results[i] = ComposeTransform(translations[i], rotations[i], scales[i]);
+   }
+}
+
+void ExtractFrustumPlanes(const glm::mat4& transform, glm::vec4 planes[6])
+{
+#ifdef TRANSFORM_MATH_SSE
+   // Rows of the transform, the matrix is stored by columns.
+   __m128 r0 = _mm_loadu_ps(&transform[0][0]);
+   __m128 r1 = _mm_loadu_ps(&transform[1][0]);
+   __m128 r2 = _mm_loadu_ps(&transform[2][0]);
+   __m128 r3 = _mm_loadu_ps(&transform[3][0]);
+   _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+   // Two sets of four planes, the second padded with copies, transposed so one lane is one plane while normalizing.
+   __m128 sets[2][4] = {
+      { _mm_add_ps(r3, r0), _mm_sub_ps(r3, r0), _mm_add_ps(r3, r1), _mm_sub_ps(r3, r1) },
+      { _mm_add_ps(r3, r2), _mm_sub_ps(r3, r2), _mm_add_ps(r3, r2), _mm_sub_ps(r3, r2) }
+   };
+
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   for (int set = 0; set < 2; set++)
+   {
+      __m128* p = sets[set];
+      _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+
+      __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0], p[0]), _mm_mul_ps(p[1], p[1])), _mm_mul_ps(p[2], p[2]));
+      __m128 valid = _mm_cmpgt_ps(lengthSquared, zero);
+      __m128 inverseLength = _mm_and_ps(valid, _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSquared, zero))));
+      p[0] = _mm_mul_ps(p[0], inverseLength);
+      p[1] = _mm_mul_ps(p[1], inverseLength);
+      p[2] = _mm_mul_ps(p[2], inverseLength);
+      p[3] = _mm_or_ps(_mm_mul_ps(p[3], inverseLength), _mm_andnot_ps(valid, one));
+
+      _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+   }
+
+   for (int i = 0; i < 4; i++)
+   {
+      _mm_storeu_ps(&planes[i][0], sets[0][i]);
+   }
+   _mm_storeu_ps(&planes[4][0], sets[1][0]);
+   _mm_storeu_ps(&planes[5][0], sets[1][1]);
+#else
+   glm::vec4 rows[4];
+   for (int i = 0; i < 4; i++)
+   {
+      rows[i] = glm::vec4(transform[0][i], transform[1][i], transform[2][i], transform[3][i]);
+   }
+
+   planes[0] = rows[3] + rows[0];
+   planes[1] = rows[3] - rows[0];
+   planes[2] = rows[3] + rows[1];
+   planes[3] = rows[3] - rows[1];
+   planes[4] = rows[3] + rows[2];
+   planes[5] = rows[3] - rows[2];
+   for (int i = 0; i < 6; i++)
+   {
+      float length = glm::length(glm::vec3(planes[i]));
+      planes[i] = length > 0.0f ? planes[i] / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+   }
+#endif
+}
+
+bool SphereInFrustum(const glm::vec4 planes[6], const glm::vec3& center, float radius)
+{
+   for (int i = 0; i < 6; i++)
+   {
+      if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
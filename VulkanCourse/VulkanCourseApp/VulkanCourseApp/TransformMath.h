@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+// Batched transform kernels for updating many objects a frame. CPUs with AVX2 take eight lanes at a time, found at run time
+// so the program itself only needs SSE2 (the AVX2 kernels are in TransformMathAvx2.cpp, the one file built with AVX2).
+// Anything else with SSE takes four, and everything else falls back to glm. Every kernel gives the same results as the glm
+// expression it stands in for, up to rounding.
+
+// result = a * b.
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4* result);
+
+// results[i] = a[i] * b[i] for count pairs. results may be either input.
+void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count);
+
+// Translation * rotation * scale, the matrix that scales first, then rotates, then translates. Rotations must be unit quaternions.
+glm::mat4 ComposeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+// results[i] = ComposeTransform(translations[i], rotations[i], scales[i]) for count transforms.
+void ComposeTransforms(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+   glm::mat4* results, size_t count);
+
+// Left, right, bottom, top, near and far planes of the clip volume of a transform (Gribb and Hartmann), in the space the
+// transform maps from. Normalized, inside where dot(xyz, p) + w >= 0. The near plane takes -w <= z, so it holds whichever
+// depth range the projection was made for. A plane that degenerates comes out as (0, 0, 0, 1), which keeps everything.
+void ExtractFrustumPlanes(const glm::mat4& transform, glm::vec4 planes[6]);
+
+// False only if the sphere lies wholly outside one of the planes ExtractFrustumPlanes made, in the space they came out in.
+bool SphereInFrustum(const glm::vec4 planes[6], const glm::vec3& center, float radius);
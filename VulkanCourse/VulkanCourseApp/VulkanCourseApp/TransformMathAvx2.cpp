@@ -0,0 +1,132 @@
+#include "TransformMathAvx2.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// MultiplyMatrixSse (TransformMath.cpp) with two columns of the result a pass. Both halves hold the same column of a, and the
+// permutes spread one element of b's column c over the low half and of column c + 1 over the high half.
+static inline void MultiplyMatrix(const float* pa, const float* pb, float* pr)
+{
+   __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa));
+   __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 4));
+   __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 8));
+   __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 12));
+   for (int column = 0; column < 4; column += 2)
+   {
+      __m256 b = _mm256_loadu_ps(pb + column * 4);
+      __m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(b, 0x00));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(a1, _mm256_permute_ps(b, 0x55)));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(a2, _mm256_permute_ps(b, 0xAA)));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(a3, _mm256_permute_ps(b, 0xFF)));
+      _mm256_storeu_ps(pr + column * 4, sum);
+   }
+}
+
+// One component of eight consecutive three float vectors.
+static inline __m256 Gather8(const float* v, int component)
+{
+   return _mm256_setr_ps(v[component], v[3 + component], v[6 + component], v[9 + component],
+      v[12 + component], v[15 + component], v[18 + component], v[21 + component]);
+}
+
+// Write one column of eight matrices, given as its four rows across the matrices.
+static inline void ScatterColumn8(const __m256 rows[4], float* results, int column)
+{
+   for (int half = 0; half < 2; half++)
+   {
+      __m128 r0 = half == 0 ? _mm256_castps256_ps128(rows[0]) : _mm256_extractf128_ps(rows[0], 1);
+      __m128 r1 = half == 0 ? _mm256_castps256_ps128(rows[1]) : _mm256_extractf128_ps(rows[1], 1);
+      __m128 r2 = half == 0 ? _mm256_castps256_ps128(rows[2]) : _mm256_extractf128_ps(rows[2], 1);
+      __m128 r3 = half == 0 ? _mm256_castps256_ps128(rows[3]) : _mm256_extractf128_ps(rows[3], 1);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      float* matrix = results + half * 4 * 16 + column * 4;
+      _mm_storeu_ps(matrix, r0);
+      _mm_storeu_ps(matrix + 16, r1);
+      _mm_storeu_ps(matrix + 32, r2);
+      _mm_storeu_ps(matrix + 48, r3);
+   }
+}
+
+// ComposeTransform of eight transforms, a lane each. The quaternions are transposed in, the matrices transposed back out.
+static void ComposeTransforms8(const float* translations, const float* rotations, const float* scales, float* results)
+{
+   __m128 q[8];
+   for (int i = 0; i < 8; i++)
+   {
+      q[i] = _mm_loadu_ps(rotations + i * 4);
+   }
+   _MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+   _MM_TRANSPOSE4_PS(q[4], q[5], q[6], q[7]);
+   __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(q[0]), q[4], 1);
+   __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(q[1]), q[5], 1);
+   __m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(q[2]), q[6], 1);
+   __m256 w = _mm256_insertf128_ps(_mm256_castps128_ps256(q[3]), q[7], 1);
+
+   const __m256 one = _mm256_set1_ps(1.0f);
+   const __m256 two = _mm256_set1_ps(2.0f);
+   const __m256 zero = _mm256_setzero_ps();
+   __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+   __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+   __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+   __m256 sx = Gather8(scales, 0);
+   __m256 sy = Gather8(scales, 1);
+   __m256 sz = Gather8(scales, 2);
+
+   __m256 rows[4];
+   rows[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+   rows[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+   rows[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+   rows[3] = zero;
+   ScatterColumn8(rows, results, 0);
+
+   rows[0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+   rows[1] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+   rows[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+   ScatterColumn8(rows, results, 1);
+
+   rows[0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+   rows[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+   rows[2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+   ScatterColumn8(rows, results, 2);
+
+   rows[0] = Gather8(translations, 0);
+   rows[1] = Gather8(translations, 1);
+   rows[2] = Gather8(translations, 2);
+   rows[3] = one;
+   ScatterColumn8(rows, results, 3);
+}
+#endif
+
+/***********************************************************
+** Public Functions.
+***********************************************************/
+bool IsTransformMathAvx2Built()
+{
+#ifdef __AVX2__
+   return true;
+#else
+   return false;
+#endif
+}
+
+void MultiplyMatricesAvx2(const float* a, const float* b, float* results, size_t count)
+{
+#ifdef __AVX2__
+   for (size_t i = 0; i < count; i++)
+   {
+      MultiplyMatrix(a + i * 16, b + i * 16, results + i * 16);
+   }
+#endif
+}
+
+void ComposeTransformsAvx2(const float* translations, const float* rotations, const float* scales, float* results,
+   size_t count)
+{
+#ifdef __AVX2__
+   for (size_t i = 0; i + 8 <= count; i += 8)
+   {
+      ComposeTransforms8(translations + i * 3, rotations + i * 4, scales + i * 3, results + i * 16);
+   }
+#endif
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+// AVX2 kernels behind TransformMath, in a translation unit of their own. Only that file is built with /arch:AVX2, the rest
+// of the program stays on SSE2 and calls in here once the CPU has been checked. (see TransformMath.cpp)
+// Everything is plain floats so the file never instantiates glm: the linker keeps one copy of each inline function, and
+// an AVX2 copy of a glm operator could end up used by code meant to run on any x64 CPU.
+
+// False if TransformMathAvx2.cpp was built without AVX2, in which case none of the functions below do anything.
+bool IsTransformMathAvx2Built();
+
+// Column-major 4x4 matrices, results[i] = a[i] * b[i] for count pairs. results may be either input.
+void MultiplyMatricesAvx2(const float* a, const float* b, float* results, size_t count);
+
+// ComposeTransform for count transforms, a multiple of eight. Translations and scales are three floats each, rotations
+// x, y, z, w.
+void ComposeTransformsAvx2(const float* translations, const float* rotations, const float* scales, float* results,
+   size_t count);
@@ -7,8 +7,24 @@
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
 
+#include "MemoryBudget.h"
+
 const int MAX_FRAME_DRAWS = 2;
 const int MAX_OBJECTS = 2;
+const int MAX_TEXTURES = 64;
+const int MAX_MIPGEN_SETS = 64;
+const int MESHLET_CULL_POOL_SIZE = 256;      // Meshlet cull sets per descriptor pool, another pool is made when they're all taken.
+
+// Bytes of texture data copied to the GPU per frame. A level bigger than this still goes alone so nothing stalls.
+const VkDeviceSize TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024;
+
+// Frames a streamed texture's finer levels stay in VRAM after the shaders last asked for them.
+const uint64_t TEXTURE_EVICT_FRAMES = 300;
+// Base level pushed for textures still showing the placeholder, the shader skips feedback for them.
+const uint32_t NO_TEXTURE_FEEDBACK = UINT32_MAX;
+
+// Packed assets, loose files under the working directory are used when this is missing.
+const std::string ASSET_PACK_FILE = "assets.pak";
 
 const std::vector<const char*> deviceExtensions = {
    VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -59,6 +75,13 @@ struct SwapchainImage
    VkImageView imageView;
 };
 
+// Per level views and descriptor sets used by a compute mip generation, freed once its commands have run.
+struct MipgenScratch
+{
+   std::vector<VkImageView> levelViews;
+   std::vector<VkDescriptorSet> descriptorSets;
+};
+
 static std::vector<char> readFile(const std::string& filename)
 {
    // Open stream from given file.
@@ -109,7 +132,7 @@ static uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
 }
 
 static void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
-   VkMemoryPropertyFlags bufferProperties, VkBuffer * buffer, VkDeviceMemory * bufferMemory)
+   VkMemoryPropertyFlags bufferProperties, VkBuffer * buffer, VkDeviceMemory * bufferMemory, MemoryBudget * memoryBudget = nullptr)
 {
    // -- CREATE VERTEX BUFFER --
    // Information to create a buffer. (doesn't include assigning memory)
@@ -135,6 +158,12 @@ static void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice logicalDevice
    // Allocate memory to VkDeviceMemory.
    CREATION_SUCCEEDED(vkAllocateMemory(logicalDevice, &memoryAllocInfo, nullptr, bufferMemory), "Failed to allocate vertex buffer memory!");
 
+   // Count it against the budget if the caller keeps one, whoever frees it then untracks it.
+   if (memoryBudget)
+   {
+      memoryBudget->Track(*bufferMemory, memoryAllocInfo.memoryTypeIndex, memoryAllocInfo.allocationSize);
+   }
+
    // Allocate memory to given vertex buffer.
    CREATION_SUCCEEDED(vkBindBufferMemory(logicalDevice, *buffer, *bufferMemory, 0), "Failed to bind buffer memory!");
 }
@@ -202,35 +231,80 @@ static void CopyBuffer(VkDevice logicalDevice, VkQueue transferQueue, VkCommandP
    EndSubmitDestroyCommandBuffer(logicalDevice, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void CopyImageBuffer(VkDevice logicalDevice, VkQueue transferQueue, VkCommandPool transferCommandPool,
-   VkBuffer srcBuffer, VkImage image, uint32_t width, uint32_t height)
+static void RecordCopyImageBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkImage image, uint32_t width, uint32_t height,
+   VkDeviceSize bufferOffset = 0, uint32_t mipLevel = 0)
 {
-   // Create buffer.
-   VkCommandBuffer transferCommandBuffer = BeginCommandBuffer(logicalDevice, transferCommandPool);
-
    // Region of data to copy from and to.
    VkBufferImageCopy imageRegion = {};
-   imageRegion.bufferOffset = 0;                                        // Offet into data.
+   imageRegion.bufferOffset = bufferOffset;                             // Offet into data.
    imageRegion.bufferRowLength = 0;                                     // Row length of data to calculate data spacing.
    imageRegion.bufferImageHeight = 0;                                   // Image height to calculate data spacing.
    imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Which aspect of image to copy.
-   imageRegion.imageSubresource.mipLevel = 0;                           // Mipmap level to copy.
+   imageRegion.imageSubresource.mipLevel = mipLevel;                    // Mipmap level to copy.
    imageRegion.imageSubresource.baseArrayLayer = 0;                     // Starting array layer. (if array)
    imageRegion.imageSubresource.layerCount = 1;                         // Number of layers to copy starting at baseArrayLayer.
    imageRegion.imageOffset = { 0, 0, 0 };                               // Offet into image. (as opposed to raw data in buffer offset)
    imageRegion.imageExtent = { width, height, 1 };                      // Size of region to copy as (x, y, z) values.
 
    // Copy buffer to given image.
-   vkCmdCopyBufferToImage(transferCommandBuffer, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+   vkCmdCopyBufferToImage(commandBuffer, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+}
+
+static void CopyImageBuffer(VkDevice logicalDevice, VkQueue transferQueue, VkCommandPool transferCommandPool,
+   VkBuffer srcBuffer, VkImage image, uint32_t width, uint32_t height)
+{
+   // Create buffer.
+   VkCommandBuffer transferCommandBuffer = BeginCommandBuffer(logicalDevice, transferCommandPool);
+
+   RecordCopyImageBuffer(transferCommandBuffer, srcBuffer, image, width, height);
 
    EndSubmitDestroyCommandBuffer(logicalDevice, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void TransitionImageLayout(VkDevice logicalDevice, VkQueue queue, VkCommandPool commandPool, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
+static uint32_t MipLevelCount(uint32_t width, uint32_t height)
 {
-   // Create buffer.
-   VkCommandBuffer commandBuffer = BeginCommandBuffer(logicalDevice, commandPool);
+   // Keep halving the largest side until it reaches a single pixel.
+   uint32_t size = width > height ? width : height;
+   uint32_t levels = 1;
+   while (size > 1)
+   {
+      size >>= 1;
+      levels++;
+   }
+
+   return levels;
+}
 
+static void RecordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMipLevel, uint32_t levelCount,
+   VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+   VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+   VkImageMemoryBarrier imageMemoryBarrier = {};
+   imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+   imageMemoryBarrier.oldLayout = oldLayout;                                     // Layout to transition from.
+   imageMemoryBarrier.newLayout = newLayout;                                     // Layout to transition to.
+   imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;             // Queue family to transition from.
+   imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;             // Queue family to transition to.
+   imageMemoryBarrier.image = image;                                             // Image being accessed and modified as part of barrier.
+   imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;   // Aspect of image being altered.
+   imageMemoryBarrier.subresourceRange.baseMipLevel = baseMipLevel;              // First mip level to start alterations on.
+   imageMemoryBarrier.subresourceRange.levelCount = levelCount;                  // Number of mipmap levels to alter starting from baseMipLevel.
+   imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;                       // First layer to start alterations on.
+   imageMemoryBarrier.subresourceRange.layerCount = 1;                           // Number of layers to alter starting from baseArrayLayer.
+   imageMemoryBarrier.srcAccessMask = srcAccessMask;                             // Memory access stage transition must happen after...
+   imageMemoryBarrier.dstAccessMask = dstAccessMask;                             // Memory access stage transition must happen before...
+
+   vkCmdPipelineBarrier(commandBuffer,
+      srcStage, dstStage,                             // Pipeline stages. (match to src and dst AccessMasks)
+      0,                                              // Dependency flags.
+      0, nullptr,                                     // Memory barrier count + data.
+      0, nullptr,                                     // Buffer memory barrier count + data.
+      1, &imageMemoryBarrier);                        // Image memory barrier count + data.
+}
+
+static void RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+   uint32_t mipLevels = 1)
+{
    VkImageMemoryBarrier imageMemoryBarrier = {};
    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
    imageMemoryBarrier.oldLayout = oldLayout;                                     // Layout to transition from.
@@ -240,7 +314,7 @@ static void TransitionImageLayout(VkDevice logicalDevice, VkQueue queue, VkComma
    imageMemoryBarrier.image = image;                                             // Image being accessed and modified as part of barrier.
    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;   // Aspect of image being altered.
    imageMemoryBarrier.subresourceRange.baseMipLevel = 0;                         // First mip level to start alterations on.
-   imageMemoryBarrier.subresourceRange.levelCount = 1;                           // Number of mipmap levels to alter starting from baseMipLevel.
+   imageMemoryBarrier.subresourceRange.levelCount = mipLevels;                   // Number of mipmap levels to alter starting from baseMipLevel.
    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;                       // First layer to start alterations on.
    imageMemoryBarrier.subresourceRange.layerCount = 1;                           // Number of layers to alter starting from baseArrayLayer.
 
@@ -272,6 +346,68 @@ static void TransitionImageLayout(VkDevice logicalDevice, VkQueue queue, VkComma
       0, nullptr,                                     // Memory barrier count + data.
       0, nullptr,                                     // Buffer memory barrier count + data.
       1, &imageMemoryBarrier);                        // Image memory barrier count + data.
+}
+
+static void TransitionImageLayout(VkDevice logicalDevice, VkQueue queue, VkCommandPool commandPool, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+   // Create buffer.
+   VkCommandBuffer commandBuffer = BeginCommandBuffer(logicalDevice, commandPool);
+
+   RecordImageLayoutTransition(commandBuffer, image, oldLayout, newLayout);
 
    EndSubmitDestroyCommandBuffer(logicalDevice, commandPool, queue, commandBuffer);
 }
+
+static void RecordBlitMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+   // Every level starts in TRANSFER_DST, level 0 already holds the copied image.
+   int32_t mipWidth = static_cast<int32_t>(width);
+   int32_t mipHeight = static_cast<int32_t>(height);
+
+   for (uint32_t i = 1; i < mipLevels; i++)
+   {
+      // Previous level is complete, make it the blit source.
+      RecordImageBarrier(commandBuffer, image, i - 1, 1,
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+         VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+      int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+      int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+      // Downsample the whole previous level into this one.
+      VkImageBlit blit = {};
+      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel = i - 1;
+      blit.srcSubresource.baseArrayLayer = 0;
+      blit.srcSubresource.layerCount = 1;
+      blit.srcOffsets[0] = { 0, 0, 0 };
+      blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+      blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.dstSubresource.mipLevel = i;
+      blit.dstSubresource.baseArrayLayer = 0;
+      blit.dstSubresource.layerCount = 1;
+      blit.dstOffsets[0] = { 0, 0, 0 };
+      blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+
+      vkCmdBlitImage(commandBuffer,
+         image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+         image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         1, &blit, VK_FILTER_LINEAR);
+
+      // Source level won't be touched again, hand it over to the fragment shader.
+      RecordImageBarrier(commandBuffer, image, i - 1, 1,
+         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+         VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+      mipWidth = nextWidth;
+      mipHeight = nextHeight;
+   }
+
+   // Last level was only ever a blit destination.
+   RecordImageBarrier(commandBuffer, image, mipLevels - 1, 1,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
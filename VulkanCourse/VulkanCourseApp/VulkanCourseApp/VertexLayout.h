@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include <GLM/gtc/packing.hpp>
+
+#include "Utilities.h"
+
+// Layouts vertices can take in GPU memory. Vertex stays the full precision form meshes are imported and cached in,
+// Mesh packs it into the selected layout on upload and the vertex input stage turns every format back into floats.
+enum class VertexLayout
+{
+   Float,         // Vertex as it is, 32 bytes.
+   Half,          // Half float positions relative to the mesh bounds, UNORM8 colors, half float UVs. 16 bytes.
+   Snorm16,       // SNORM16 positions relative to the mesh bounds, UNORM8 colors, half float UVs. 16 bytes.
+};
+
+// Layout every mesh is uploaded in. SNORM16 spreads its steps evenly over the bounds, half floats only get fine near the centre.
+const VertexLayout VERTEX_LAYOUT = VertexLayout::Snorm16;
+
+// Quantized positions are stored as (pos - offset) / scale, the vertex shader undoes it with the pair pushed for each mesh.
+struct VertexDecode
+{
+   glm::vec4 positionScale;      // w unused.
+   glm::vec4 positionOffset;     // w is set per draw, 1 if the transform pushed with it is compact. (see Mesh.h)
+};
+
+struct VertexHalf
+{
+   uint16_t pos[4];              // Half float x, y, z relative to the mesh bounds, w 0.
+   uint8_t col[4];               // UNORM8 r, g, b, a 255.
+   uint16_t tex[2];              // Half float u, v.
+};
+
+struct VertexSnorm16
+{
+   int16_t pos[4];               // SNORM16 x, y, z relative to the mesh bounds, w 0.
+   uint8_t col[4];               // UNORM8 r, g, b, a 255.
+   uint16_t tex[2];              // Half float u, v.
+};
+
+static_assert(sizeof(VertexHalf) == 16, "VertexHalf must stay 16 bytes.");
+static_assert(sizeof(VertexSnorm16) == 16, "VertexSnorm16 must stay 16 bytes.");
+
+// Per layout vertex type, attribute formats and packing. Three component 16 bit formats are rarely supported for
+// vertex input, so positions take four and the shader ignores w.
+template<VertexLayout Layout>
+struct VertexLayoutTraits;
+
+template<>
+struct VertexLayoutTraits<VertexLayout::Float>
+{
+   using Type = Vertex;
+   static const VkFormat POSITION_FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+   static const VkFormat COLOR_FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+   static const VkFormat TEX_COORD_FORMAT = VK_FORMAT_R32G32_SFLOAT;
+   static const bool QUANTIZED_POSITIONS = false;
+
+   static Type Pack(const Vertex& vertex, const glm::vec3& /*normalized*/)
+   {
+      return vertex;
+   }
+};
+
+template<>
+struct VertexLayoutTraits<VertexLayout::Half>
+{
+   using Type = VertexHalf;
+   static const VkFormat POSITION_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+   static const VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+   static const VkFormat TEX_COORD_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+   static const bool QUANTIZED_POSITIONS = true;
+
+   // normalized is the position already mapped into [-1, 1] by the mesh's VertexDecode.
+   static Type Pack(const Vertex& vertex, const glm::vec3& normalized)
+   {
+      Type packed;
+      packed.pos[0] = glm::packHalf1x16(normalized.x);
+      packed.pos[1] = glm::packHalf1x16(normalized.y);
+      packed.pos[2] = glm::packHalf1x16(normalized.z);
+      packed.pos[3] = 0;
+      uint32_t color = glm::packUnorm4x8(glm::vec4(vertex.col, 1.0f));
+      memcpy(packed.col, &color, sizeof(packed.col));
+      packed.tex[0] = glm::packHalf1x16(vertex.tex.x);
+      packed.tex[1] = glm::packHalf1x16(vertex.tex.y);
+      return packed;
+   }
+};
+
+template<>
+struct VertexLayoutTraits<VertexLayout::Snorm16>
+{
+   using Type = VertexSnorm16;
+   static const VkFormat POSITION_FORMAT = VK_FORMAT_R16G16B16A16_SNORM;
+   static const VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+   static const VkFormat TEX_COORD_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+   static const bool QUANTIZED_POSITIONS = true;
+
+   static Type Pack(const Vertex& vertex, const glm::vec3& normalized)
+   {
+      Type packed;
+      packed.pos[0] = static_cast<int16_t>(glm::packSnorm1x16(normalized.x));
+      packed.pos[1] = static_cast<int16_t>(glm::packSnorm1x16(normalized.y));
+      packed.pos[2] = static_cast<int16_t>(glm::packSnorm1x16(normalized.z));
+      packed.pos[3] = 0;
+      uint32_t color = glm::packUnorm4x8(glm::vec4(vertex.col, 1.0f));
+      memcpy(packed.col, &color, sizeof(packed.col));
+      packed.tex[0] = glm::packHalf1x16(vertex.tex.x);
+      packed.tex[1] = glm::packHalf1x16(vertex.tex.y);
+      return packed;
+   }
+};
+
+// Vertex type meshes hold in GPU memory.
+using GpuVertex = VertexLayoutTraits<VERTEX_LAYOUT>::Type;
+
+// Attribute descriptions for binding 0 in a given layout. Locations match shader.vert: position, color, texture coords.
+template<VertexLayout Layout>
+std::array<VkVertexInputAttributeDescription, 3> GetVertexAttributeDescriptions()
+{
+   using Traits = VertexLayoutTraits<Layout>;
+   using Type = typename Traits::Type;
+
+   std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions;
+   attributeDescriptions[0] = { 0, 0, Traits::POSITION_FORMAT, static_cast<uint32_t>(offsetof(Type, pos)) };
+   attributeDescriptions[1] = { 1, 0, Traits::COLOR_FORMAT, static_cast<uint32_t>(offsetof(Type, col)) };
+   attributeDescriptions[2] = { 2, 0, Traits::TEX_COORD_FORMAT, static_cast<uint32_t>(offsetof(Type, tex)) };
+   return attributeDescriptions;
+}
+
+// Decode for vertices spanning the given bounds. Flat axes get a scale of 1 so nothing divides by zero.
+template<VertexLayout Layout>
+VertexDecode MakeVertexDecode(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+   VertexDecode decode = { glm::vec4(1.0f, 1.0f, 1.0f, 0.0f), glm::vec4(0.0f) };
+   if (VertexLayoutTraits<Layout>::QUANTIZED_POSITIONS)
+   {
+      glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+      for (int i = 0; i < 3; i++)
+      {
+         decode.positionScale[i] = halfExtent[i] > 0.0f ? halfExtent[i] : 1.0f;
+      }
+      decode.positionOffset = glm::vec4((boundsMin + boundsMax) * 0.5f, 0.0f);
+   }
+   return decode;
+}
+
+// Pack vertices into a layout with the decode MakeVertexDecode gave for their bounds.
+template<VertexLayout Layout>
+std::vector<typename VertexLayoutTraits<Layout>::Type> PackVertices(const std::vector<Vertex>& vertices, const VertexDecode& decode)
+{
+   std::vector<typename VertexLayoutTraits<Layout>::Type> packed(vertices.size());
+   glm::vec3 scale(decode.positionScale);
+   glm::vec3 offset(decode.positionOffset);
+   for (size_t i = 0; i < vertices.size(); i++)
+   {
+      packed[i] = VertexLayoutTraits<Layout>::Pack(vertices[i], (vertices[i].pos - offset) / scale);
+   }
+   return packed;
+}
@@ -16,6 +16,9 @@ int32_t VulkanRenderer::Init(GLFWwindow* newWindow)
    m_vkWindow = newWindow;
    try
    {
+      // Shaders and textures come from the pack when there is one, loose files otherwise.
+      m_assetPack.Open(ASSET_PACK_FILE);
+
       CreateInstance();
       CreateSurface();
       GetPhysicalDevice();
@@ -32,43 +35,39 @@ int32_t VulkanRenderer::Init(GLFWwindow* newWindow)
       CreateTextureSampler();
       //AllocateDynamicBufferTransferSpace();
       CreateUniformBuffers();
+      CreateFeedbackBuffers();
       CreateDescriptorPool();
       CreateDescriptorSets();
+      CreateMeshletCullPipeline();
       CreateSynchronization();
+      CreatePlaceholderTexture();
+      CreatePlaceholderMesh();
 
-      m_uboViewProjection.projection = glm::perspective(glm::radians(45.0f), (float)m_vkSwapchainExtent.width / (float)m_vkSwapchainExtent.height, 0.1f, 100.0f);
-      m_uboViewProjection.view = glm::lookAt(glm::vec3(2.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+      // The scene graph gets workers of its own for large transform updates, so texture decodes never hold them up.
+      m_sceneGraph.Init();
 
-      m_uboViewProjection.projection[1][1] *= -1;
+      // Start background workers for file reading and decoding. They decode straight into staging memory from here.
+      m_assetLoader.Init([this](VkDeviceSize size) { return AllocateStaging(size); },
+         [this](const StagingTarget& staging) { ReleaseStaging(staging); },
+         [this](VkFormat format) { return IsTextureFormatSupported(format); },
+         &m_assetPack);
 
-      // Create a mesh.
-      // Vertex Data.
-      std::vector<Vertex> meshVertices = {
-         { { -0.4,   0.4,   0.0}, { 1.0f, 0.0f, 0.0f}, { 1.0f, 1.0f } },
-         { { -0.4,  -0.4,   0.0}, { 0.0f, 1.0f, 0.0f}, { 1.0f, 0.0f }  },
-         { {  0.4,  -0.4,   0.0}, { 0.0f, 0.0f, 1.0f}, { 0.0f, 0.0f }  },
-         { {  0.4,   0.4,   0.0}, { 0.0f, 1.0f, 0.0f}, { 0.0f, 1.0f }  }
-      };
-      std::vector<Vertex> meshVertices2 = {
-         { { -0.25,  0.6,   0.0}, { 0.0f, 0.0f, 1.0f}, { 1.0f, 1.0f }  },
-         { { -0.25, -0.6,   0.0}, { 1.0f, 0.0f, 0.0f}, { 1.0f, 0.0f }  },
-         { {  0.25, -0.6,   0.0}, { 0.0f, 1.0f, 0.0f}, { 0.0f, 0.0f }  },
-         { {  0.25,  0.6,   0.0}, { 1.0f, 0.0f, 0.0f}, { 0.0f, 1.0f }  }
-      };
+      m_camera.projection = glm::perspective(glm::radians(45.0f), (float)m_vkSwapchainExtent.width / (float)m_vkSwapchainExtent.height, 0.1f, 100.0f);
+      m_camera.view = glm::lookAt(glm::vec3(2.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-      // Index Data.
-      std::vector<uint32_t> meshIndices = {
-         0, 1, 2,
-         2, 3, 0
-      };
+      m_camera.projection[1][1] *= -1;
 
-      Mesh firstMesh = Mesh(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice,
-         m_vkGraphicsQueue, m_vkGraphicsCommandPool, &meshVertices, &meshIndices, CreateTexture("giraffe.jpg"));
-      Mesh secMesh = Mesh(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice,
-         m_vkGraphicsQueue, m_vkGraphicsCommandPool, &meshVertices2, &meshIndices, CreateTexture("panda.jpg"));
+      // Scene geometry comes from model files, every material of a model becomes its own mesh. They import in the background.
+      m_vecStartupMeshes = { CreateMeshAsync("giraffe.obj"), CreateMeshAsync("panda.obj") };
 
-      m_vecMesh.push_back(firstMesh);
-      m_vecMesh.push_back(secMesh);
+      // A row of props behind them that never moves, drawn as one batch per texture.
+      std::vector<StaticPlacement> props;
+      for (int i = 0; i < 8; i++)
+      {
+         glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(-3.5f + i, 0.0f, -6.0f));
+         props.push_back({ i % 2 == 0 ? "giraffe.obj" : "panda.obj", glm::scale(transform, glm::vec3(0.5f)) });
+      }
+      CreateStaticMeshes(props);
    }
    catch (const std::runtime_error& e)
    {
@@ -81,9 +80,63 @@ int32_t VulkanRenderer::Init(GLFWwindow* newWindow)
 
 void VulkanRenderer::Deinit()
 {
+   // Stop asset workers before anything they could still be decoding for is destroyed.
+   m_assetLoader.Deinit();
+   m_mapPendingImports.clear();
+   m_sceneGraph.Deinit();
+   m_assetPack.Close();
+
    // Keep at top - waiting for idle so a proper cleanup can occur.
    vkDeviceWaitIdle(m_vkMainDevice.logicalDevice);
 
+   // Uploads still in flight own their staging, and their image too until it's shown in its slot.
+   for (auto& upload : m_vecTextureUploads)
+   {
+      vkDestroyFence(m_vkMainDevice.logicalDevice, upload.fence, nullptr);
+      ReleaseStaging(upload.staging);
+      FreeMipgenScratch(&upload.mipgenScratch);
+      if (!upload.shown)
+      {
+         vkDestroyImage(m_vkMainDevice.logicalDevice, upload.image, nullptr);
+         FreeImageMemory(upload.imageMemory);
+      }
+      vkDestroyImage(m_vkMainDevice.logicalDevice, upload.rebaseImage, nullptr);
+      FreeImageMemory(upload.rebaseImageMemory);
+   }
+   m_vecTextureUploads.clear();
+
+   for (auto& upload : m_vecMeshUploads)
+   {
+      vkDestroyFence(m_vkMainDevice.logicalDevice, upload.fence, nullptr);
+      ReleaseStaging(upload.staging);
+   }
+   m_vecMeshUploads.clear();
+
+   for (auto& queued : m_vecQueuedTextures)
+   {
+      ReleaseStaging(queued.loaded.staging);
+   }
+   m_vecQueuedTextures.clear();
+
+   DestroyRetiredTextures(true);
+   DestroyRetiredMeshes(true);
+
+   if (m_vkMipgenPipeline != VK_NULL_HANDLE)
+   {
+      vkDestroyDescriptorPool(m_vkMainDevice.logicalDevice, m_vkMipgenDescriptorPool, nullptr);
+      vkDestroyPipeline(m_vkMainDevice.logicalDevice, m_vkMipgenPipeline, nullptr);
+      vkDestroyPipelineLayout(m_vkMainDevice.logicalDevice, m_vkMipgenPipelineLayout, nullptr);
+      vkDestroyDescriptorSetLayout(m_vkMainDevice.logicalDevice, m_vkMipgenSetLayout, nullptr);
+   }
+
+   for (VkDescriptorPool pool : m_vecMeshletCullDescriptorPools)
+   {
+      vkDestroyDescriptorPool(m_vkMainDevice.logicalDevice, pool, nullptr);
+   }
+   vkDestroyPipeline(m_vkMainDevice.logicalDevice, m_vkMeshletCullPipeline, nullptr);
+   vkDestroyPipelineLayout(m_vkMainDevice.logicalDevice, m_vkMeshletCullPipelineLayout, nullptr);
+   vkDestroyDescriptorSetLayout(m_vkMainDevice.logicalDevice, m_vkMeshletCullSetLayout, nullptr);
+
    //_aligned_free(m_uboModelTransferSpace);
 
    vkDestroyDescriptorPool(m_vkMainDevice.logicalDevice, m_vkSamplerDescriptorPool, nullptr);
@@ -95,12 +148,12 @@ void VulkanRenderer::Deinit()
    {
       vkDestroyImageView(m_vkMainDevice.logicalDevice, m_vkTextureImageViews[i], nullptr);
       vkDestroyImage(m_vkMainDevice.logicalDevice, m_vkTextureImages[i], nullptr);
-      vkFreeMemory(m_vkMainDevice.logicalDevice, m_vkTextureImageMemory[i], nullptr);
+      FreeImageMemory(m_vkTextureImageMemory[i]);
    }
 
    vkDestroyImageView(m_vkMainDevice.logicalDevice, m_vkDepthBufferImageView, nullptr);
    vkDestroyImage(m_vkMainDevice.logicalDevice, m_vkDepthBufferImage, nullptr);
-   vkFreeMemory(m_vkMainDevice.logicalDevice, m_vkDepthBufferImageMemory, nullptr);
+   FreeImageMemory(m_vkDepthBufferImageMemory);
 
    for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
    {
@@ -109,9 +162,9 @@ void VulkanRenderer::Deinit()
       vkDestroySemaphore(m_vkMainDevice.logicalDevice, m_vecSemImageAvailable[i], nullptr);
    }
    vkDestroyCommandPool(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool, nullptr);
-   for (size_t i = 0; i < m_vecMesh.size(); i++)
+   for (SceneMesh& sceneMesh : m_meshes)
    {
-      m_vecMesh[i].Deinit();
+      sceneMesh.mesh.Deinit();
    }
    for (auto framebuffer : m_vecSwapchainFramebuffers)
    {
@@ -125,6 +178,13 @@ void VulkanRenderer::Deinit()
       //vkDestroyBuffer(m_vkMainDevice.logicalDevice, m_vecModelDUniformBuffer[i], nullptr);
       //vkFreeMemory(m_vkMainDevice.logicalDevice, m_vecModelDUniformBufferMemory[i], nullptr);
    }
+   for (size_t i = 0; i < m_vecFeedbackBuffer.size(); i++)
+   {
+      vkUnmapMemory(m_vkMainDevice.logicalDevice, m_vecFeedbackBufferMemory[i]);
+      vkDestroyBuffer(m_vkMainDevice.logicalDevice, m_vecFeedbackBuffer[i], nullptr);
+      vkFreeMemory(m_vkMainDevice.logicalDevice, m_vecFeedbackBufferMemory[i], nullptr);
+   }
+   vkDestroyDescriptorSetLayout(m_vkMainDevice.logicalDevice, m_vkFeedbackSetLayout, nullptr);
    vkDestroyDescriptorSetLayout(m_vkMainDevice.logicalDevice, m_vkDescriptorSetLayout, nullptr);
    vkDestroyPipeline(m_vkMainDevice.logicalDevice, m_vkGraphicsPipeline, nullptr);
    vkDestroyPipelineLayout(m_vkMainDevice.logicalDevice, m_vkPipelineLayout, nullptr);
@@ -139,15 +199,60 @@ void VulkanRenderer::Deinit()
    vkDestroyInstance(m_vkInstance, nullptr);
 }
 
-void VulkanRenderer::UpdateModel(uint32_t modelId, glm::mat4 newModel)
+bool VulkanRenderer::DestroyMesh(MeshHandle meshHandle)
 {
-   if (modelId >= m_vecMesh.size())
+   SceneMesh* sceneMesh = m_meshes.Get(meshHandle);
+   if (sceneMesh == nullptr)
    {
-      throw std::runtime_error("Failed to update model! Probably need to update max model count!");
-      return;
+      return false;
+   }
+
+   // The rest of the model first, their nodes hang off this one's. Removing them moves meshes around, look this one up again.
+   std::vector<MeshHandle> parts = std::move(sceneMesh->parts);
+   for (MeshHandle part : parts)
+   {
+      DestroyMesh(part);
    }
+   sceneMesh = m_meshes.Get(meshHandle);
 
-   m_vecMesh[modelId].SetModel(newModel);
+   // Buffers still being copied into can't be destroyed with the rest, let the copy finish first.
+   for (size_t i = 0; i < m_vecMeshUploads.size(); i++)
+   {
+      if (m_vecMeshUploads[i].mesh == meshHandle)
+      {
+         FinishMeshUpload(i);
+         break;
+      }
+   }
+
+   // Nothing recorded from here on refers to the texture or node. Frames already submitted may still draw the buffers,
+   // so those go a few frames from now.
+   TextureHandle texture = sceneMesh->mesh.GetTexture();
+   if (m_textureCache.IsCurrent(texture))
+   {
+      ReleaseTexture(texture.index);
+   }
+   m_sceneGraph.RemoveNode(sceneMesh->node);
+   m_vecRetiredMeshes.push_back({ std::move(sceneMesh->mesh), sceneMesh->meshletCullSet, sceneMesh->meshletCullPool, m_iFrameNumber });
+
+   m_meshes.Remove(meshHandle);
+   return true;
+}
+
+const std::vector<MeshHandle>& VulkanRenderer::GetStartupMeshes() const
+{
+   return m_vecStartupMeshes;
+}
+
+void VulkanRenderer::UpdateModel(MeshHandle meshHandle, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+   SceneMesh* sceneMesh = m_meshes.Get(meshHandle);
+   if (sceneMesh == nullptr)
+   {
+      throw std::runtime_error("Failed to update model, the mesh was destroyed!");
+   }
+
+   m_sceneGraph.SetLocalTransform(sceneMesh->node, translation, rotation, scale);
 }
 
 void VulkanRenderer::Draw()
@@ -158,11 +263,28 @@ void VulkanRenderer::Draw()
    // Manually close fences.
    vkResetFences(m_vkMainDevice.logicalDevice, 1, &m_vecDrawFences[m_iCurrentFrame]);
 
+   // Frame boundary - this frame's feedback buffer is free again, memory of textures no frame samples anymore goes back,
+   // anything over the budget is evicted, then swap in any models that finished importing and textures that finished streaming.
+   ReadTextureFeedback();
+   DestroyRetiredTextures(false);
+   DestroyRetiredMeshes(false);
+   EnforceMemoryBudget();
+   ProcessModelImports();
+   ProcessTextureUploads();
+   ProcessMeshUploads();
+
    // Get index to next image to be drawn. Signal semaphore when ready to be drawn to.
    uint32_t imageIndex;
    vkAcquireNextImageKHR(m_vkMainDevice.logicalDevice, m_vkSwapchain, std::numeric_limits<uint64_t>::max(),
       m_vecSemImageAvailable[m_iCurrentFrame], VK_NULL_HANDLE, &imageIndex);
 
+   // Only what moved since the last frame is recomputed.
+   m_sceneGraph.Update();
+
+   // Combine the camera's matrices once for the frame, the vertex shader and culling both take the product.
+   MultiplyMatrices(m_camera.projection, m_camera.view, &m_uboViewProjection.viewProjection);
+   m_camera.position = glm::vec3(glm::inverse(m_camera.view)[3]);
+
    RecordCommands(imageIndex);
    UpdateUniformBuffers(imageIndex);
 
@@ -197,6 +319,7 @@ void VulkanRenderer::Draw()
 
    // Keep at bottom - incrementing draw frame.
    m_iCurrentFrame = (m_iCurrentFrame + 1) % MAX_FRAME_DRAWS;
+   m_iFrameNumber++;
 }
 
 /***********************************************************
@@ -288,11 +411,28 @@ void VulkanRenderer::CreateLogicalDevice()
    deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
    deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateinfos.size());   // Numver of queue create infos.
    deviceCreateInfo.pQueueCreateInfos = queueCreateinfos.data();                             // List of queue create infos so the device can create required queues.
-   deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());  // Number of enabled logical device extensions.
-   deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();                       // List of enabled logical device extensions.
+
+   // Required extensions, plus the driver's heap budgets where it can report them.
+   std::vector<const char*> enabledExtensions = deviceExtensions;
+   bool hasMemoryBudget = CheckDeviceExtension(m_vkMainDevice.physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+   if (hasMemoryBudget)
+   {
+      enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+   }
+
+   deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()); // Number of enabled logical device extensions.
+   deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();                      // List of enabled logical device extensions.
+
+   // Optional features are only turned on if the device has them.
+   VkPhysicalDeviceFeatures supportedFeatures;
+   vkGetPhysicalDeviceFeatures(m_vkMainDevice.physicalDevice, &supportedFeatures);
+   m_bTextureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+   m_bTextureFeedback = supportedFeatures.fragmentStoresAndAtomics == VK_TRUE;
 
    VkPhysicalDeviceFeatures deviceFeatures = {};
    deviceFeatures.samplerAnisotropy = VK_TRUE;                                               // Enable Anisotropy.
+   deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;             // Sample BC1-7 textures without decoding them.
+   deviceFeatures.fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics;     // Texture feedback from the fragment shader.
 
    deviceCreateInfo.pEnabledFeatures = &deviceFeatures;                                      // Physical device features that the logical device will use.
 
@@ -302,6 +442,9 @@ void VulkanRenderer::CreateLogicalDevice()
    // Queues are created at the same time as the device. Store handle.
    vkGetDeviceQueue(m_vkMainDevice.logicalDevice, indices.graphicsFamily, 0, &m_vkGraphicsQueue);
    vkGetDeviceQueue(m_vkMainDevice.logicalDevice, indices.presentationFamily, 0, &m_vkPresentationQueue);
+
+   // Without the extension only our own allocations are counted, against a share of the heap.
+   m_memoryBudget.Init(m_vkMainDevice.physicalDevice, hasMemoryBudget);
 }
 
 void VulkanRenderer::CreateSurface()
@@ -538,6 +681,22 @@ void VulkanRenderer::CreateDescriptorSetLayout()
 
    // Create descriptor set layout.
    CREATION_SUCCEEDED(vkCreateDescriptorSetLayout(m_vkMainDevice.logicalDevice, &textureLayoutCreateInfo, nullptr, &m_vkSamplerSetLayout), "Failed to create a descriptor set layout!");
+
+   // CREATE TEXTURE FEEDBACK DESCRIPTOR SET LAYOUT.
+   // Storage buffer the fragment shader writes requested mip levels into.
+   VkDescriptorSetLayoutBinding feedbackLayoutBinding = {};
+   feedbackLayoutBinding.binding = 0;
+   feedbackLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+   feedbackLayoutBinding.descriptorCount = 1;
+   feedbackLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+   feedbackLayoutBinding.pImmutableSamplers = nullptr;
+
+   VkDescriptorSetLayoutCreateInfo feedbackLayoutCreateInfo = {};
+   feedbackLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+   feedbackLayoutCreateInfo.bindingCount = 1;
+   feedbackLayoutCreateInfo.pBindings = &feedbackLayoutBinding;
+
+   CREATION_SUCCEEDED(vkCreateDescriptorSetLayout(m_vkMainDevice.logicalDevice, &feedbackLayoutCreateInfo, nullptr, &m_vkFeedbackSetLayout), "Failed to create a descriptor set layout!");
 }
 
 void VulkanRenderer::CreatePushConstantRange()
@@ -545,13 +704,18 @@ void VulkanRenderer::CreatePushConstantRange()
    // Define push constant values. (no create needed)
    m_vkPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;                      // Shader stage push constant will go to.
    m_vkPushConstantRange.offset = 0;                                                   // Offset into given data to pass to push constant.
-   m_vkPushConstantRange.size = sizeof(Model);                                         // Size of data being passed.
+   m_vkPushConstantRange.size = sizeof(Model);                                         // Size of data being passed. (compact transforms use less of it)
+
+   // Texture ID and view base level for feedback, straight after the model.
+   m_vkFeedbackPushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+   m_vkFeedbackPushConstantRange.offset = sizeof(Model);
+   m_vkFeedbackPushConstantRange.size = 2 * sizeof(uint32_t);
 }
 
 void VulkanRenderer::CreateDepthBufferImage()
 {
    // Create depth buffer image.
-   m_vkDepthBufferImage = CreateImage(m_vkSwapchainExtent.width, m_vkSwapchainExtent.height, m_vkDepthFormat, VK_IMAGE_TILING_OPTIMAL,
+   m_vkDepthBufferImage = CreateImage(m_vkSwapchainExtent.width, m_vkSwapchainExtent.height, 1, m_vkDepthFormat, VK_IMAGE_TILING_OPTIMAL,
       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkDepthBufferImageMemory);
 
    // Create depth buffer image view.
@@ -561,8 +725,8 @@ void VulkanRenderer::CreateDepthBufferImage()
 void VulkanRenderer::CreateGraphicsPipeline()
 {
    // Read in SPIR-V code of shaders.
-   auto vertexShaderCode = readFile("Shaders/vert.spv");
-   auto fragmentShaderCode = readFile("Shaders/frag.spv");
+   AssetBytes vertexShaderCode = m_assetPack.Read("Shaders/vert.spv");
+   AssetBytes fragmentShaderCode = m_assetPack.Read("Shaders/frag.spv");
 
    // Build Shader Modules to link to Graphics Pipeline.
    VkShaderModule vertexShaderModule = CreateShaderModule(vertexShaderCode);
@@ -577,6 +741,16 @@ void VulkanRenderer::CreateGraphicsPipeline()
    vertexShaderCreateInfo.module = vertexShaderModule;                                 // Shader module to be used by stage.
    vertexShaderCreateInfo.pName = "main";                                              // Entry point in to shader.
 
+   // Which transform encoding the vertex shader reads its push constants in.
+   VkBool32 compactTransforms = COMPACT_TRANSFORMS ? VK_TRUE : VK_FALSE;
+   VkSpecializationMapEntry vertexSpecializationEntry = { 0, 0, sizeof(VkBool32) };
+   VkSpecializationInfo vertexSpecializationInfo = {};
+   vertexSpecializationInfo.mapEntryCount = 1;
+   vertexSpecializationInfo.pMapEntries = &vertexSpecializationEntry;
+   vertexSpecializationInfo.dataSize = sizeof(compactTransforms);
+   vertexSpecializationInfo.pData = &compactTransforms;
+   vertexShaderCreateInfo.pSpecializationInfo = &vertexSpecializationInfo;
+
    // Fragment stage creation info.
    VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
    fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -584,6 +758,16 @@ void VulkanRenderer::CreateGraphicsPipeline()
    fragmentShaderCreateInfo.module = fragmentShaderModule;                             // Shader module to be used by stage.
    fragmentShaderCreateInfo.pName = "main";                                            // Entry point in to shader.
 
+   // Whether the fragment shader writes texture feedback, it may only where the device has fragment stores.
+   VkBool32 textureFeedback = m_bTextureFeedback ? VK_TRUE : VK_FALSE;
+   VkSpecializationMapEntry fragmentSpecializationEntry = { 0, 0, sizeof(VkBool32) };
+   VkSpecializationInfo fragmentSpecializationInfo = {};
+   fragmentSpecializationInfo.mapEntryCount = 1;
+   fragmentSpecializationInfo.pMapEntries = &fragmentSpecializationEntry;
+   fragmentSpecializationInfo.dataSize = sizeof(textureFeedback);
+   fragmentSpecializationInfo.pData = &textureFeedback;
+   fragmentShaderCreateInfo.pSpecializationInfo = &fragmentSpecializationInfo;
+
    // Put shader stage creation info into array.
    // Graphics pipeline creation info requires array of shader stage creates.
    VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
@@ -591,29 +775,12 @@ void VulkanRenderer::CreateGraphicsPipeline()
    // How the data for a single vertex (including info such as position, color, texture coords, normals, etc) is as a whole.
    VkVertexInputBindingDescription bindingDescription = {};
    bindingDescription.binding = 0;                                                     // Can bind multiple streams of data, this defines which one.
-   bindingDescription.stride = sizeof(Vertex);                                         // Size of a single vertex object.
+   bindingDescription.stride = sizeof(GpuVertex);                                      // Size of a single vertex object.
    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;                         // How to move between data after each vertex. VK_VERTEX_INPUT_RATE_VERTEX : move on to the next vertex. VK_VERTEX_INPUT_RATE_INSTANCE : move to a vertex for the next instance.
 
-   // How the data for an attribute is defined within a vertex.
-   std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions;
-
-   // Position Attribute.
-   attributeDescriptions[0].binding = 0;                                               // Which binding the data is at (should be same as above).
-   attributeDescriptions[0].location = 0;                                              // Location in shader where data will be read from.
-   attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;                       // Format the data will take. (also helps define the size of the data).
-   attributeDescriptions[0].offset = offsetof(Vertex, pos);                            // Where this attribute is defined in the data for a signle vertex.
-
-   // Color Attribute.
-   attributeDescriptions[1].binding = 0;
-   attributeDescriptions[1].location = 1;
-   attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-   attributeDescriptions[1].offset = offsetof(Vertex, col);
-
-   // Texture Attribute.
-   attributeDescriptions[2].binding = 0;
-   attributeDescriptions[2].location = 2;
-   attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-   attributeDescriptions[2].offset = offsetof(Vertex, tex);
+   // How the data for an attribute is defined within a vertex. (position, color, texture coords in the selected layout)
+   // Compact formats are unpacked to floats by the vertex input stage, the shader only undoes the position quantization.
+   std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = GetVertexAttributeDescriptions<VERTEX_LAYOUT>();
 
    // -- VERTEX INPUT --
    VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
@@ -714,14 +881,15 @@ void VulkanRenderer::CreateGraphicsPipeline()
 
 
    // -- PIPELINE LAYOUT --
-   std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = { m_vkDescriptorSetLayout, m_vkSamplerSetLayout };
+   std::array<VkDescriptorSetLayout, 3> descriptorSetLayouts = { m_vkDescriptorSetLayout, m_vkSamplerSetLayout, m_vkFeedbackSetLayout };
+   std::array<VkPushConstantRange, 2> pushConstantRanges = { m_vkPushConstantRange, m_vkFeedbackPushConstantRange };
 
    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
    pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
    pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-   pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-   pipelineLayoutCreateInfo.pPushConstantRanges = &m_vkPushConstantRange;
+   pipelineLayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+   pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRanges.data();
 
    // Create pipeline layout.
    CREATION_SUCCEEDED(vkCreatePipelineLayout(m_vkMainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_vkPipelineLayout), "Failed to create Pipline Layout!");
@@ -858,13 +1026,61 @@ void VulkanRenderer::CreateTextureSampler()
    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;                          // Mipmap interpolation mode.
    samplerCreateInfo.mipLodBias = 0.0f;                                                   // Level of detail bias for mip level.
    samplerCreateInfo.minLod = 0.0f;                                                       // Minimum level of detail to pick mip level.
-   samplerCreateInfo.maxLod = 0.0;                                                        // Maximum level of detail to pick mip level.
+   samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;                                          // Maximum level of detail to pick mip level. (no clamp, use the whole chain)
    samplerCreateInfo.anisotropyEnable = VK_TRUE;                                          // Enable Anisotropy.
    samplerCreateInfo.maxAnisotropy = 16;                                                  // Anisotropy sample level.
 
    CREATION_SUCCEEDED(vkCreateSampler(m_vkMainDevice.logicalDevice, &samplerCreateInfo, nullptr, &m_vkTextureSampler), "Failed to create a texture sampler!");
 }
 
+void VulkanRenderer::CreatePlaceholderTexture()
+{
+   // Small grey checker bound to textures that are still streaming in.
+   const stbi_uc pixels[] = {
+      160, 160, 160, 255,    96,  96,  96, 255,
+       96,  96,  96, 255,   160, 160, 160, 255
+   };
+
+   // Takes a texture ID like any file, but nothing ever releases it.
+   m_iPlaceholderTexId = AllocateTextureSlot("");
+   m_textureCache.SetContent(m_iPlaceholderTexId, TextureContent());
+
+   m_vkTextureImages[m_iPlaceholderTexId] = CreateTextureImage(pixels, 2, 2, sizeof(pixels), &m_vkTextureImageMemory[m_iPlaceholderTexId]);
+   m_vkTextureImageViews[m_iPlaceholderTexId] = CreateImageView(m_vkTextureImages[m_iPlaceholderTexId], VK_FORMAT_R8G8B8A8_UNORM,
+      VK_IMAGE_ASPECT_COLOR_BIT);
+   m_vkSamplerDescriptorSets[m_iPlaceholderTexId] = CreateTextureDescriptorSet(m_vkTextureImageViews[m_iPlaceholderTexId]);
+}
+
+void VulkanRenderer::CreatePlaceholderMesh()
+{
+   // Unit cube, four corners per face so each face shows the whole placeholder checker. Only kept on the CPU, every model
+   // that is still importing uploads a copy.
+   const glm::vec3 normals[] = {
+      { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+      { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+   };
+   const glm::vec2 corners[] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+   for (const glm::vec3& normal : normals)
+   {
+      // Two axes across the face, u cross v is the normal so the corners go counter clockwise seen from outside.
+      glm::vec3 u = normal.y != 0.0f ? glm::vec3(normal.y, 0.0f, 0.0f) : glm::vec3(-normal.z, 0.0f, normal.x);
+      glm::vec3 v = glm::cross(normal, u);
+
+      uint32_t first = static_cast<uint32_t>(m_vecPlaceholderVertices.size());
+      for (const glm::vec2& corner : corners)
+      {
+         glm::vec3 pos = (normal + u * (corner.x * 2.0f - 1.0f) + v * (corner.y * 2.0f - 1.0f)) * 0.5f;
+         m_vecPlaceholderVertices.push_back({ pos, glm::vec3(1.0f), corner });
+      }
+
+      for (uint32_t index : { 0u, 1u, 2u, 2u, 3u, 0u })
+      {
+         m_vecPlaceholderIndices.push_back(first + index);
+      }
+   }
+}
+
 void VulkanRenderer::CreateUniformBuffers()
 {
    // View projection buffer size.
@@ -890,6 +1106,30 @@ void VulkanRenderer::CreateUniformBuffers()
    }
 }
 
+void VulkanRenderer::CreateFeedbackBuffers()
+{
+   // A level per texture slot, kept mapped so the CPU can read and reset it every frame.
+   VkDeviceSize feedbackBufferSize = MAX_TEXTURES * sizeof(uint32_t);
+
+   m_vecFeedbackBuffer.resize(MAX_FRAME_DRAWS);
+   m_vecFeedbackBufferMemory.resize(MAX_FRAME_DRAWS);
+   m_vecFeedbackMapped.resize(MAX_FRAME_DRAWS);
+
+   for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+   {
+      CreateBuffer(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice, feedbackBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_vecFeedbackBuffer[i], &m_vecFeedbackBufferMemory[i]);
+
+      void* data;
+      CREATION_SUCCEEDED(vkMapMemory(m_vkMainDevice.logicalDevice, m_vecFeedbackBufferMemory[i], 0, feedbackBufferSize, 0, &data),
+         "Failed to map texture feedback memory!");
+      m_vecFeedbackMapped[i] = static_cast<uint32_t*>(data);
+
+      // All bits set means no level was asked for.
+      memset(data, 0xFF, static_cast<size_t>(feedbackBufferSize));
+   }
+}
+
 void VulkanRenderer::CreateDescriptorPool()
 {
    // CREATE UNIFORM DESCRIPTOR POOL.
@@ -904,13 +1144,18 @@ void VulkanRenderer::CreateDescriptorPool()
    //modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
    //modelPoolSize.descriptorCount = static_cast<uint32_t>(m_vecModelDUniformBuffer.size());
 
+   // Texture feedback Pool.
+   VkDescriptorPoolSize feedbackPoolSize = {};
+   feedbackPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+   feedbackPoolSize.descriptorCount = static_cast<uint32_t>(m_vecFeedbackBuffer.size());
+
    // List of pool sizes.
-   std::vector<VkDescriptorPoolSize> descriptorPoolSizes = { vpPoolSize };//{ vpPoolSize, modelPoolSize };
+   std::vector<VkDescriptorPoolSize> descriptorPoolSizes = { vpPoolSize, feedbackPoolSize };//{ vpPoolSize, modelPoolSize };
 
    // Data to create descriptor pool.
    VkDescriptorPoolCreateInfo poolCreateInfo = {};
    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-   poolCreateInfo.maxSets = static_cast<uint32_t>(m_vecVpUniformBuffer.size());        // Maximum number of descriptor sets that can be created from pool.
+   poolCreateInfo.maxSets = static_cast<uint32_t>(m_vecVpUniformBuffer.size() + m_vecFeedbackBuffer.size());   // Maximum number of descriptor sets that can be created from pool.
    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());   // Amount of pool sizes being passed.
    poolCreateInfo.pPoolSizes = descriptorPoolSizes.data();                             // Pool sizes to create pool with.
 
@@ -921,11 +1166,14 @@ void VulkanRenderer::CreateDescriptorPool()
    // Texture sampler pool.
    VkDescriptorPoolSize samplerPoolSize = {};
    samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-   samplerPoolSize.descriptorCount = MAX_OBJECTS;
+   samplerPoolSize.descriptorCount = MAX_TEXTURES * (1 + MAX_FRAME_DRAWS);
 
+   // Sets replaced while mips stream in (or released) live on until the frames using them are done, so each texture
+   // can hold a set from each frame in flight on top of its current one.
    VkDescriptorPoolCreateInfo samplerPoolCreateInfo = {};
    samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-   samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
+   samplerPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;     // Released textures give their set back.
+   samplerPoolCreateInfo.maxSets = MAX_TEXTURES * (1 + MAX_FRAME_DRAWS);
    samplerPoolCreateInfo.poolSizeCount = 1;
    samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;
 
@@ -991,6 +1239,39 @@ void VulkanRenderer::CreateDescriptorSets()
       // Update the descriptor sets with new buffer/bindging info.
       vkUpdateDescriptorSets(m_vkMainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
    }
+
+   // TEXTURE FEEDBACK DESCRIPTORS.
+   // One per frame in flight, like the buffers.
+   m_vecFeedbackDescriptorSets.resize(m_vecFeedbackBuffer.size());
+
+   std::vector<VkDescriptorSetLayout> feedbackLayouts(m_vecFeedbackBuffer.size(), m_vkFeedbackSetLayout);
+
+   VkDescriptorSetAllocateInfo feedbackAllocInfo = {};
+   feedbackAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+   feedbackAllocInfo.descriptorPool = m_vkDescriptorPool;
+   feedbackAllocInfo.descriptorSetCount = static_cast<uint32_t>(feedbackLayouts.size());
+   feedbackAllocInfo.pSetLayouts = feedbackLayouts.data();
+
+   CREATION_SUCCEEDED(vkAllocateDescriptorSets(m_vkMainDevice.logicalDevice, &feedbackAllocInfo, m_vecFeedbackDescriptorSets.data()), "Failed to allocate descriptor set!");
+
+   for (size_t i = 0; i < m_vecFeedbackBuffer.size(); i++)
+   {
+      VkDescriptorBufferInfo feedbackBufferInfo = {};
+      feedbackBufferInfo.buffer = m_vecFeedbackBuffer[i];
+      feedbackBufferInfo.offset = 0;
+      feedbackBufferInfo.range = VK_WHOLE_SIZE;
+
+      VkWriteDescriptorSet feedbackSetWrite = {};
+      feedbackSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      feedbackSetWrite.dstSet = m_vecFeedbackDescriptorSets[i];
+      feedbackSetWrite.dstBinding = 0;
+      feedbackSetWrite.dstArrayElement = 0;
+      feedbackSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      feedbackSetWrite.descriptorCount = 1;
+      feedbackSetWrite.pBufferInfo = &feedbackBufferInfo;
+
+      vkUpdateDescriptorSets(m_vkMainDevice.logicalDevice, 1, &feedbackSetWrite, 0, nullptr);
+   }
 }
 
 void VulkanRenderer::UpdateUniformBuffers(uint32_t imageIndex)
@@ -1039,6 +1320,43 @@ void VulkanRenderer::RecordCommands(uint32_t currentImage)
    // Start recording commands to command buffer.
    CREATION_SUCCEEDED(vkBeginCommandBuffer(m_vecCommandBuffers[currentImage], &bufferBeginInfo), "Failed to start recording a command buffer!");
 
+      // Only meshes whose bounds are in view count as drawn. The rest are left out of the cull pass and the draws, and age
+      // towards eviction like anything else nobody looks at.
+      glm::vec4 frustumPlanes[6];
+      ExtractFrustumPlanes(m_uboViewProjection.viewProjection, frustumPlanes);
+
+      // Evicted meshes start back the first time they would be drawn again, within the memory budget like any other upload,
+      // and stay out until their buffers are in. If the budget has no room, the next frame asks again.
+      // Each mesh's level of detail is picked here too, the cull pass and the draws both go by it.
+      for (size_t i = 0; i < m_meshes.GetSize(); i++)
+      {
+         SceneMesh& sceneMesh = m_meshes[i];
+         Mesh& mesh = sceneMesh.mesh;
+         const glm::mat4& world = m_sceneGraph.GetWorldMatrix(sceneMesh.node);
+         float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+         sceneMesh.visible = false;
+         if (!SphereInFrustum(frustumPlanes, glm::vec3(world * glm::vec4(mesh.GetBoundsCenter(), 1.0f)), mesh.GetBoundsRadius() * scale))
+         {
+            continue;
+         }
+
+         if (!mesh.IsResident())
+         {
+            if (!mesh.IsUploading())
+            {
+               BeginMeshUpload(m_meshes.GetHandle(i));
+            }
+            continue;
+         }
+         sceneMesh.visible = true;
+         mesh.SetLastDrawnFrame(m_iFrameNumber);
+         mesh.SetSelectedLod(SelectMeshLod(mesh.GetLods(), mesh.GetBoundsCenter(), mesh.GetBoundsRadius(),
+            world, m_camera.view, m_camera.projection, static_cast<float>(m_vkSwapchainExtent.height)));
+      }
+
+      // Build this frame's index lists of meshlet meshes, outside the render pass as compute has to be.
+      RecordMeshletCulling(m_vecCommandBuffers[currentImage]);
+
       // Begin render pass.
       vkCmdBeginRenderPass(m_vecCommandBuffers[currentImage], &renderpassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -1046,187 +1364,1493 @@ void VulkanRenderer::RecordCommands(uint32_t currentImage)
          vkCmdBindPipeline(m_vecCommandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkGraphicsPipeline);
 
          // Bind vertex buffer.
-         for (size_t j = 0; j < m_vecMesh.size(); j++)
+         for (SceneMesh& sceneMesh : m_meshes)
          {
-            VkBuffer vertexBuffers[] = { m_vecMesh[j].GetVertexBuffer() };                   // Buffers to bind.
+            Mesh& mesh = sceneMesh.mesh;
+            if (!sceneMesh.visible)
+            {
+               continue;
+            }
+
+            VkBuffer vertexBuffers[] = { mesh.GetVertexBuffer() };                           // Buffers to bind.
             VkDeviceSize offsets[] = { 0 };                                                  // Offsets into buffers being bound.
             vkCmdBindVertexBuffers(m_vecCommandBuffers[currentImage], 0, 1, vertexBuffers, offsets);    // Command to bind vertex buffer before drawing with them.
 
-            // Bind index buffer.
-            vkCmdBindIndexBuffer(m_vecCommandBuffers[currentImage], m_vecMesh[j].GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            // Bind index buffer. Meshlet meshes draw whatever the cull pass left of theirs.
+            if (mesh.HasMeshlets())
+            {
+               vkCmdBindIndexBuffer(m_vecCommandBuffers[currentImage], mesh.GetCulledIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            }
+            else
+            {
+               vkCmdBindIndexBuffer(m_vecCommandBuffers[currentImage], mesh.GetIndexBuffer(), 0, mesh.GetIndexType());
+            }
 
             // Dynamic offset amount.
             //uint32_t dynamicOffset = static_cast<uint32_t>(m_vkModelUniformAlignment) * j;
 
             // Push constants to given shader stage directly. (no buffer)
-            vkCmdPushConstants(m_vecCommandBuffers[currentImage], m_vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Model), &m_vecMesh[j].GetModel());
-
-            std::array<VkDescriptorSet, 2> descriptorSetGroup = { m_vecDescriptorSets[currentImage],
-               m_vkSamplerDescriptorSets[m_vecMesh[j].GetTexId()] };
+            uint32_t node = sceneMesh.node;
+            if (COMPACT_TRANSFORMS && m_sceneGraph.IsWorldTrsExact(node))
+            {
+               glm::quat rotation = m_sceneGraph.GetWorldRotation(node);
+               glm::vec3 translation = m_sceneGraph.GetWorldTranslation(node);
+               glm::vec3 scale = m_sceneGraph.GetWorldScale(node);
+
+               ModelTrs model = {};
+               model.decode = mesh.GetVertexDecode();
+               model.decode.positionOffset.w = 1.0f;
+               model.rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+               model.translationScaleX = glm::vec4(translation, scale.x);
+               model.scaleYZ = glm::vec2(scale.y, scale.z);
+               vkCmdPushConstants(m_vecCommandBuffers[currentImage], m_vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelTrs), &model);
+            }
+            else
+            {
+               Model model = { mesh.GetVertexDecode(), m_sceneGraph.GetWorldMatrix(node) };
+               vkCmdPushConstants(m_vecCommandBuffers[currentImage], m_vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Model), &model);
+            }
+
+            // Texture feedback needs to know which texture this is and which level its view starts at.
+            // A handle gone stale shows the placeholder rather than whatever texture took over its slot.
+            TextureHandle texture = mesh.GetTexture();
+            uint32_t texId = m_textureCache.IsCurrent(texture) ? texture.index : m_iPlaceholderTexId;
+            uint32_t pushTexture[2] = { texId, m_vecTextureBaseLevels[texId] };
+            vkCmdPushConstants(m_vecCommandBuffers[currentImage], m_vkPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+               m_vkFeedbackPushConstantRange.offset, m_vkFeedbackPushConstantRange.size, pushTexture);
+
+            std::array<VkDescriptorSet, 3> descriptorSetGroup = { m_vecDescriptorSets[currentImage],
+               m_vkSamplerDescriptorSets[texId], m_vecFeedbackDescriptorSets[m_iCurrentFrame] };
 
             // Bind descriptor sets.
             vkCmdBindDescriptorSets(m_vecCommandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout,
                0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
 
-            // Execute pipeline.
-            vkCmdDrawIndexed(m_vecCommandBuffers[currentImage], m_vecMesh[j].GetIndexCount(), 1, 0, 0, 0);
+            // Execute pipeline. The index count of a meshlet mesh is only known on the GPU.
+            if (mesh.HasMeshlets())
+            {
+               vkCmdDrawIndexedIndirect(m_vecCommandBuffers[currentImage], mesh.GetDrawCommandBuffer(), 0, 1,
+                  sizeof(VkDrawIndexedIndirectCommand));
+            }
+            else
+            {
+               const MeshLod& lod = mesh.GetSelectedLod();
+               vkCmdDrawIndexed(m_vecCommandBuffers[currentImage], lod.indexCount, 1, lod.firstIndex, 0, 0);
+            }
          }
 
       // End render pass.
       vkCmdEndRenderPass(m_vecCommandBuffers[currentImage]);
 
+      // Feedback writes have to reach the host before the frame's fence says they can be read.
+      if (m_bTextureFeedback)
+      {
+         VkMemoryBarrier feedbackBarrier = {};
+         feedbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+         feedbackBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+         feedbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+         vkCmdPipelineBarrier(m_vecCommandBuffers[currentImage], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+            0, 1, &feedbackBarrier, 0, nullptr, 0, nullptr);
+      }
+
    // Strop recording to command buffer.
    CREATION_SUCCEEDED(vkEndCommandBuffer(m_vecCommandBuffers[currentImage]), "Failed to stop recording a command buffer!");
 }
 
-void VulkanRenderer::GetPhysicalDevice()
+void VulkanRenderer::CreateMeshletCullPipeline()
 {
-   // Enumerate physical device that the vkIOnstance can access.
-   uint32_t deviceCount = 0;
-   vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, nullptr);
-
-   // If no devices available, then none support Vulkan!
-   if (deviceCount == 0)
+   // Meshlets, source indices, culled indices and the draw command, all storage buffers of one mesh.
+   VkDescriptorSetLayoutBinding bufferBindings[4] = {};
+   for (uint32_t i = 0; i < 4; i++)
    {
-      throw std::runtime_error("Can't find GPUs that support Vulkan Instance!");
+      bufferBindings[i].binding = i;
+      bufferBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bufferBindings[i].descriptorCount = 1;
+      bufferBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+      bufferBindings[i].pImmutableSamplers = nullptr;
    }
 
-   // Get list of physical devices.
-   std::vector<VkPhysicalDevice> deviceList(deviceCount);
-   vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, deviceList.data());
+   VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+   layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+   layoutCreateInfo.bindingCount = 4;
+   layoutCreateInfo.pBindings = bufferBindings;
 
-   // TODO: Just picking first device currently.
-   for (const auto& device : deviceList)
-   {
-      if (CheckDeviceSuitable(device))
-      {
-         m_vkMainDevice.physicalDevice = device;
-         break;
-      }
-   }
+   CREATION_SUCCEEDED(vkCreateDescriptorSetLayout(m_vkMainDevice.logicalDevice, &layoutCreateInfo, nullptr, &m_vkMeshletCullSetLayout), "Failed to create a meshlet cull descriptor set layout!");
 
-   // Get properties of our new device.
-   VkPhysicalDeviceProperties deviceProperties;
-   vkGetPhysicalDeviceProperties(m_vkMainDevice.physicalDevice, &deviceProperties);
+   CreateMeshletCullPool();
 
-   //m_vkMinUniformBufferOffset = deviceProperties.limits.minUniformBufferOffsetAlignment;
+   VkPushConstantRange pushConstantRange = {};
+   pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+   pushConstantRange.offset = 0;
+   pushConstantRange.size = sizeof(MeshletCullPush);
+
+   VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+   pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   pipelineLayoutCreateInfo.setLayoutCount = 1;
+   pipelineLayoutCreateInfo.pSetLayouts = &m_vkMeshletCullSetLayout;
+   pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+   pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+   CREATION_SUCCEEDED(vkCreatePipelineLayout(m_vkMainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_vkMeshletCullPipelineLayout), "Failed to create a meshlet cull pipeline layout!");
+
+   // Read in SPIR-V code of shader.
+   AssetBytes computeShaderCode = m_assetPack.Read("Shaders/meshlet_cull.spv");
+   VkShaderModule computeShaderModule = CreateShaderModule(computeShaderCode);
+
+   VkComputePipelineCreateInfo pipelineCreateInfo = {};
+   pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+   pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+   pipelineCreateInfo.stage.module = computeShaderModule;
+   pipelineCreateInfo.stage.pName = "main";
+   pipelineCreateInfo.layout = m_vkMeshletCullPipelineLayout;
+
+   CREATION_SUCCEEDED(vkCreateComputePipelines(m_vkMainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_vkMeshletCullPipeline), "Failed to create the meshlet cull pipeline!");
+
+   vkDestroyShaderModule(m_vkMainDevice.logicalDevice, computeShaderModule, nullptr);
 }
 
-void VulkanRenderer::AllocateDynamicBufferTransferSpace()
+void VulkanRenderer::CreateMeshletCullPool()
 {
-   //// Calculate alignment of model data.
-   //m_vkModelUniformAlignment = (sizeof(Model) + (size_t)m_vkMinUniformBufferOffset -1) & ~(m_vkMinUniformBufferOffset - 1);
+   // A set per mesh for as long as the renderer lives, rewritten in place when an evicted mesh comes back.
+   VkDescriptorPoolSize poolSize = {};
+   poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+   poolSize.descriptorCount = MESHLET_CULL_POOL_SIZE * 4;
 
-   //// Create space in memory to hold dynamic buffer that is aligned to our required alignment and holds MAX_OBJECTS.
-   //m_uboModelTransferSpace = (Model *)_aligned_malloc(m_vkModelUniformAlignment * MAX_OBJECTS, m_vkModelUniformAlignment);
+   VkDescriptorPoolCreateInfo poolCreateInfo = {};
+   poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+   poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;           // Destroyed meshes give their set back.
+   poolCreateInfo.maxSets = MESHLET_CULL_POOL_SIZE;
+   poolCreateInfo.poolSizeCount = 1;
+   poolCreateInfo.pPoolSizes = &poolSize;
+
+   VkDescriptorPool pool;
+   CREATION_SUCCEEDED(vkCreateDescriptorPool(m_vkMainDevice.logicalDevice, &poolCreateInfo, nullptr, &pool), "Failed to create a meshlet cull descriptor pool!");
+   m_vecMeshletCullDescriptorPools.push_back(pool);
 }
 
-bool VulkanRenderer::CheckInstanceExtensionSupport(std::vector<const char*>* checkExtensions)
+void VulkanRenderer::WriteMeshletCullSet(SceneMesh* sceneMesh)
 {
-   // Need to get number of extensions to create array of correct size to hold extensions.
-   uint32_t extensionCount = 0;
-   vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-
-   if (extensionCount == 0)
+   Mesh& mesh = sceneMesh->mesh;
+   if (!mesh.HasMeshlets() || !mesh.IsResident())
    {
-      return false;
+      return;
    }
 
-   // Create a list of VkExtensionProperties using count.
-   std::vector<VkExtensionProperties> extensions(extensionCount);
-   vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
-
-   // Check if given extensions are in list of available extensions.
-   for (const auto& checkExtension : *checkExtensions)
+   if (sceneMesh->meshletCullSet == VK_NULL_HANDLE)
    {
-      bool hasExtension = false;
+      VkDescriptorSetAllocateInfo setAllocInfo = {};
+      setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+      setAllocInfo.descriptorSetCount = 1;
+      setAllocInfo.pSetLayouts = &m_vkMeshletCullSetLayout;
 
-      for (const auto& extension : extensions)
+      // Newest pool first, older ones only have room where destroyed meshes gave sets back. A new pool when none has.
+      for (size_t i = m_vecMeshletCullDescriptorPools.size(); i-- > 0;)
       {
-         if (strcmp(checkExtension, extension.extensionName) == 0)
+         setAllocInfo.descriptorPool = m_vecMeshletCullDescriptorPools[i];
+         if (vkAllocateDescriptorSets(m_vkMainDevice.logicalDevice, &setAllocInfo, &sceneMesh->meshletCullSet) == VK_SUCCESS)
          {
-            hasExtension = true;
+            sceneMesh->meshletCullPool = setAllocInfo.descriptorPool;
             break;
          }
+         sceneMesh->meshletCullSet = VK_NULL_HANDLE;
       }
 
-      // Problem, extension doesn't exist.
-      if (!hasExtension)
+      if (sceneMesh->meshletCullSet == VK_NULL_HANDLE)
       {
-         return false;
+         CreateMeshletCullPool();
+         setAllocInfo.descriptorPool = m_vecMeshletCullDescriptorPools.back();
+         CREATION_SUCCEEDED(vkAllocateDescriptorSets(m_vkMainDevice.logicalDevice, &setAllocInfo, &sceneMesh->meshletCullSet), "Failed to allocate a meshlet cull descriptor set!");
+         sceneMesh->meshletCullPool = setAllocInfo.descriptorPool;
       }
    }
 
-   return true;
+   // Buffers are recreated on every return from eviction, so the set always points at the current ones.
+   VkBuffer buffers[4] = { mesh.GetMeshletBuffer(), mesh.GetIndexBuffer(), mesh.GetCulledIndexBuffer(), mesh.GetDrawCommandBuffer() };
+   VkDescriptorBufferInfo bufferInfos[4] = {};
+   VkWriteDescriptorSet writes[4] = {};
+   for (uint32_t i = 0; i < 4; i++)
+   {
+      bufferInfos[i].buffer = buffers[i];
+      bufferInfos[i].offset = 0;
+      bufferInfos[i].range = VK_WHOLE_SIZE;
+
+      writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet = sceneMesh->meshletCullSet;
+      writes[i].dstBinding = i;
+      writes[i].dstArrayElement = 0;
+      writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[i].descriptorCount = 1;
+      writes[i].pBufferInfo = &bufferInfos[i];
+   }
+
+   vkUpdateDescriptorSets(m_vkMainDevice.logicalDevice, 4, writes, 0, nullptr);
 }
 
-bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
+void VulkanRenderer::RecordMeshletCulling(VkCommandBuffer commandBuffer)
 {
-   // Get device extension count.
-   uint32_t extensionCount = 0;
-   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+   // Workgroup counts are only guaranteed up to this per dimension, larger meshes go on in y.
+   const uint32_t maxGroupsX = 65535;
 
-   if (extensionCount == 0)
+   bool anyMeshlets = false;
+   for (SceneMesh& sceneMesh : m_meshes)
    {
-      return false;
+      anyMeshlets = anyMeshlets || (sceneMesh.mesh.HasMeshlets() && sceneMesh.visible);
+   }
+   if (!anyMeshlets)
+   {
+      return;
    }
 
-   // Populate list of extensions.
-   std::vector<VkExtensionProperties> extensions(extensionCount);
-   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+   // The last frame's draws read the culled lists and draw commands being rewritten here, they have to be done first.
+   vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
 
-   // Check for extension.
-   for (const auto& deviceExtension : deviceExtensions)
+   // Every meshlet that survives adds its indices to the count, which starts from nothing each frame.
+   for (SceneMesh& sceneMesh : m_meshes)
    {
-      bool hasExtension = false;
-      for (const auto& extension : extensions)
+      if (sceneMesh.mesh.HasMeshlets() && sceneMesh.visible)
       {
-         if (strcmp(deviceExtension, extension.extensionName) == 0)
-         {
-            hasExtension = true;
-            break;
-         }
+         vkCmdFillBuffer(commandBuffer, sceneMesh.mesh.GetDrawCommandBuffer(), offsetof(VkDrawIndexedIndirectCommand, indexCount), sizeof(uint32_t), 0);
       }
+   }
 
-      if (!hasExtension)
+   VkMemoryBarrier clearBarrier = {};
+   clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+   clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+   vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkMeshletCullPipeline);
+
+   for (SceneMesh& sceneMesh : m_meshes)
+   {
+      Mesh& mesh = sceneMesh.mesh;
+      if (!mesh.HasMeshlets() || !sceneMesh.visible)
       {
-         return false;
+         continue;
+      }
+
+      MeshletCullPush push = {};
+      SetMeshletCullView(m_uboViewProjection.viewProjection, m_camera.position, m_sceneGraph.GetWorldMatrix(sceneMesh.node), &push);
+      push.firstMeshlet = mesh.GetSelectedLod().firstMeshlet;
+      push.meshletCount = mesh.GetSelectedLod().meshletCount;
+      if (push.meshletCount == 0)
+      {
+         continue;
       }
+      push.sixteenBitIndices = mesh.GetIndexType() == VK_INDEX_TYPE_UINT16 ? 1 : 0;
+
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkMeshletCullPipelineLayout,
+         0, 1, &sceneMesh.meshletCullSet, 0, nullptr);
+      vkCmdPushConstants(commandBuffer, m_vkMeshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+
+      // One workgroup per meshlet.
+      uint32_t groupsX = std::min(push.meshletCount, maxGroupsX);
+      uint32_t groupsY = (push.meshletCount + groupsX - 1) / groupsX;
+      vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
    }
 
-   return true;
+   // Culled lists feed the index fetch and their counts the indirect draws.
+   VkMemoryBarrier cullBarrier = {};
+   cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+   cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+   cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+   vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
 }
 
-bool VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device)
+void VulkanRenderer::ReadTextureFeedback()
 {
-   //// Information about the device itself (ID, name, type, vendor, etc)
-   //VkPhysicalDeviceProperties deviceProperties;
-   //vkGetPhysicalDeviceProperties(device, &deviceProperties);
+   // Without feedback nothing says which levels are needed, every live texture asks for all of them all the time.
+   // Streams still bring the smallest levels first, and the budget still holds back what doesn't fit.
+   if (!m_bTextureFeedback)
+   {
+      for (uint32_t texId = 0; texId < m_vecTextureDemand.size(); texId++)
+      {
+         if (m_textureCache.GetRefCount(texId) > 0 && m_textureCache.GetPixelOwner(texId) == texId)
+         {
+            TextureDemand& demand = m_vecTextureDemand[texId];
+            demand.level = 0;
+            demand.frameNumber = m_iFrameNumber;
+            demand.sampled = true;
+         }
+      }
+      return;
+   }
 
-   // Information about what the device can do (geo shader, tess shader, wide lines, etc)
-   VkPhysicalDeviceFeatures deviceFeatures;
-   vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+   // This frame's fence has been waited on, so the buffer holds what its last use asked for. Reset it for this use.
+   uint32_t* feedback = m_vecFeedbackMapped[m_iCurrentFrame];
 
-   QueueFamilyIndices indices = GetQueueFamilies(device);
+   // Textures sharing pixels ask on their own IDs, the owner needs the finest level any of them wants.
+   std::vector<uint32_t> wanted(m_vecTextureDemand.size(), UINT32_MAX);
+   for (uint32_t texId = 0; texId < wanted.size(); texId++)
+   {
+      uint32_t level = feedback[texId];
+      feedback[texId] = UINT32_MAX;
 
-   bool extensionsSupported = CheckDeviceExtensionSupport(device);
+      if (m_textureCache.GetRefCount(texId) > 0)
+      {
+         uint32_t pixelOwner = m_textureCache.GetPixelOwner(texId);
+         wanted[pixelOwner] = std::min(wanted[pixelOwner], level);
+      }
+   }
 
-   bool swapchainValid = false;
-   if (extensionsSupported)
+   for (uint32_t texId = 0; texId < wanted.size(); texId++)
    {
-      SwapchainDetails swapchainDetails = GetSwapchainDetails(device);
-      swapchainValid = !swapchainDetails.presentationModes.empty() && !swapchainDetails.formats.empty();
-   }
+      // Nothing is known until the real image has been sampled once.
+      TextureDemand& demand = m_vecTextureDemand[texId];
+      if (!demand.sampled && wanted[texId] == UINT32_MAX)
+      {
+         continue;
+      }
 
-   return indices.isValid() && extensionsSupported && swapchainValid && deviceFeatures.samplerAnisotropy;
+      // A finer level counts at once, a coarser one only after the finer levels went unused for a while.
+      // Keeps textures that come in and out of view from streaming back and forth.
+      if (!demand.sampled || wanted[texId] <= demand.level || m_iFrameNumber >= demand.frameNumber + TEXTURE_EVICT_FRAMES)
+      {
+         demand.level = wanted[texId];
+         demand.frameNumber = m_iFrameNumber;
+         demand.sampled = true;
+      }
+   }
 }
 
-QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device)
+void VulkanRenderer::ProcessTextureUploads()
 {
-   QueueFamilyIndices indices;
-
-   // Get all Queue Family Property info for the given device.
-   uint32_t queueFamilyCount = 0;
+   // Finish off batches the GPU has completed and show the levels they brought.
+   for (uint32_t i = 0; i < m_vecTextureUploads.size();)
+   {
+      TextureUpload& upload = m_vecTextureUploads[i];
+      if (upload.fence != VK_NULL_HANDLE)
+      {
+         if (vkGetFenceStatus(m_vkMainDevice.logicalDevice, upload.fence) != VK_SUCCESS)
+         {
+            i++;
+            continue;
+         }
+
+         vkFreeCommandBuffers(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool, 1, &upload.commandBuffer);
+         vkDestroyFence(m_vkMainDevice.logicalDevice, upload.fence, nullptr);
+         upload.commandBuffer = VK_NULL_HANDLE;
+         upload.fence = VK_NULL_HANDLE;
+         upload.residentLevel = upload.recordedLevel;
+
+         if (m_textureCache.IsCurrent(upload.texture))
+         {
+            if (upload.rebaseImage != VK_NULL_HANDLE)
+            {
+               // Resident levels live in the new image now. Frames in flight may still sample the old one.
+               m_vecRetiredTextures.push_back({ upload.image, upload.imageMemory, VK_NULL_HANDLE, VK_NULL_HANDLE, m_iFrameNumber });
+
+               upload.image = upload.rebaseImage;
+               upload.imageMemory = upload.rebaseImageMemory;
+               upload.imageBaseLevel = upload.rebaseLevel;
+               upload.rebaseImage = VK_NULL_HANDLE;
+               upload.rebaseImageMemory = VK_NULL_HANDLE;
+
+               m_vkTextureImages[upload.texId] = upload.image;
+               m_vkTextureImageMemory[upload.texId] = upload.imageMemory;
+            }
+
+            ShowResidentLevels(i);
+         }
+      }
+
+      // Released uploads stop once nothing is in flight. Streams last as long as their texture, the rest end once every level is on the GPU.
+      if (m_textureCache.IsCurrent(upload.texture) && (upload.streamed || upload.residentLevel > 0))
+      {
+         i++;
+         continue;
+      }
+
+      // Nothing wants an image that never got shown and no frame ever sampled it. A shown one was retired with its slot.
+      if (!upload.shown)
+      {
+         vkDestroyImage(m_vkMainDevice.logicalDevice, upload.image, nullptr);
+         FreeImageMemory(upload.imageMemory);
+      }
+      vkDestroyImage(m_vkMainDevice.logicalDevice, upload.rebaseImage, nullptr);
+      FreeImageMemory(upload.rebaseImageMemory);
+
+      // Clean up upload parts.
+      ReleaseStaging(upload.staging);
+      FreeMipgenScratch(&upload.mipgenScratch);
+
+      m_vecTextureUploads.erase(m_vecTextureUploads.begin() + i);
+   }
+
+   // Queue anything the workers finished decoding since last frame.
+   for (auto& texture : m_assetLoader.TakeCompletedTextures())
+   {
+      // Failed loads keep the placeholder.
+      TextureContent content = texture.staging.buffer != VK_NULL_HANDLE ? texture.content : TextureContent();
+      uint32_t pixelOwner = m_textureCache.SetContent(texture.texId, content);
+
+      // Released while loading, failed, or the same pixels are already on the GPU (or on their way). No upload needed.
+      if (pixelOwner != texture.texId || content.IsEmpty())
+      {
+         if (texture.staging.buffer != VK_NULL_HANDLE)
+         {
+            ReleaseStaging(texture.staging);
+         }
+         if (pixelOwner != INVALID_TEXTURE_ID)
+         {
+            ShowSharedTexture(texture.texId);
+         }
+         continue;
+      }
+
+      TextureHandle handle = m_textureCache.GetHandle(texture.texId);
+      m_vecQueuedTextures.push_back({ std::move(texture), handle });
+   }
+
+   StreamTextureLevels();
+}
+
+void VulkanRenderer::StreamTextureLevels()
+{
+   // The first thing recorded each frame goes even if it's over budget, so a big level can't hold everything up.
+   VkDeviceSize budget = TEXTURE_UPLOAD_BUDGET;
+   bool firstThisFrame = true;
+
+   // Newly decoded textures go first. Files that bring their whole chain become streams, which only take memory once
+   // their first batch goes below.
+   size_t kept = 0;
+   bool blocked = false;
+   for (size_t i = 0; i < m_vecQueuedTextures.size(); i++)
+   {
+      // Released while it waited.
+      QueuedTexture& queued = m_vecQueuedTextures[i];
+      if (!m_textureCache.IsCurrent(queued.texture))
+      {
+         ReleaseStaging(queued.loaded.staging);
+         continue;
+      }
+
+      LoadedTexture& texture = queued.loaded;
+      if (TextureMipLevels(texture) == texture.levels.size())
+      {
+         BeginTextureStream(texture);
+         continue;
+      }
+
+      // Generating the chain needs all of level 0 on the GPU at once, and the generated levels add about a third.
+      // Later ones wait too so they still start in the order they finished.
+      if (!blocked && (texture.imageSize <= budget || firstThisFrame) && ReserveDeviceMemory(texture.imageSize * 4 / 3) &&
+         BeginTextureUpload(texture))
+      {
+         budget = texture.imageSize < budget ? budget - texture.imageSize : 0;
+         firstThisFrame = false;
+         continue;
+      }
+
+      blocked = true;
+      if (kept != i)
+      {
+         m_vecQueuedTextures[kept] = std::move(queued);
+      }
+      kept++;
+   }
+   m_vecQueuedTextures.erase(m_vecQueuedTextures.begin() + kept, m_vecQueuedTextures.end());
+
+   // Streams that have nothing on the GPU yet get their smallest levels first, they're cheap and get them off the placeholder.
+   for (uint32_t i = 0; i < m_vecTextureUploads.size(); i++)
+   {
+      const TextureUpload& upload = m_vecTextureUploads[i];
+      if (!upload.streamed || upload.shown || upload.fence != VK_NULL_HANDLE || !m_textureCache.IsCurrent(upload.texture))
+      {
+         continue;
+      }
+
+      // Only the smallest levels to begin with, feedback decides how far the rest goes once it's on screen.
+      VkDeviceSize used = RecordStreamBatch(i, 0, budget, firstThisFrame);
+      if (used == 0)
+      {
+         continue;
+      }
+
+      budget = used < budget ? budget - used : 0;
+      firstThisFrame = false;
+   }
+
+   // Then move streams whose last batch has landed towards the level the shaders asked for.
+   for (uint32_t i = 0; i < m_vecTextureUploads.size(); i++)
+   {
+      const TextureUpload& upload = m_vecTextureUploads[i];
+      if (!upload.streamed || !upload.shown || upload.fence != VK_NULL_HANDLE || !m_textureCache.IsCurrent(upload.texture))
+      {
+         continue;
+      }
+
+      const TextureDemand& demand = m_vecTextureDemand[upload.texId];
+      if (!demand.sampled)
+      {
+         continue;
+      }
+
+      // Not sampled at all for a while keeps just the smallest level.
+      uint32_t wantedLevel = std::min(demand.level, upload.mipLevels - 1);
+
+      VkDeviceSize used;
+      if (wantedLevel < upload.residentLevel)
+      {
+         // Levels the image has no room for need a bigger image first, the resident ones move across and the rest follow.
+         used = wantedLevel < upload.imageBaseLevel ? RecordStreamRebase(i, wantedLevel, budget, firstThisFrame) :
+            RecordStreamBatch(i, wantedLevel, budget, firstThisFrame);
+      }
+      else if (wantedLevel > upload.residentLevel)
+      {
+         // Finer levels nobody samples leave VRAM, the rest moves into a smaller image.
+         used = RecordStreamRebase(i, wantedLevel, budget, firstThisFrame);
+      }
+      else
+      {
+         continue;
+      }
+
+      // Over budget, or waiting for memory to make room.
+      if (used == 0)
+      {
+         continue;
+      }
+
+      budget = used < budget ? budget - used : 0;
+      firstThisFrame = false;
+   }
+}
+
+bool VulkanRenderer::BeginTextureUpload(const LoadedTexture& texture)
+{
+   TextureUpload upload = {};
+   upload.texId = texture.texId;
+   upload.texture = m_textureCache.GetHandle(texture.texId);
+
+   // Worker already decoded the pixels into this staging buffer, it now belongs to the upload.
+   upload.staging = texture.staging;
+
+   upload.format = texture.format;
+   upload.width = texture.width;
+   upload.height = texture.height;
+   upload.mipLevels = TextureMipLevels(texture);
+   upload.levels = texture.levels;
+   upload.streamed = false;
+   upload.residentLevel = upload.mipLevels;
+
+   // Record the whole upload, mip chain included, into one command buffer.
+   upload.commandBuffer = BeginCommandBuffer(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool);
+   upload.image = RecordTextureUpload(upload.commandBuffer, texture, upload.mipLevels, &upload.imageMemory, &upload.mipgenScratch);
+   upload.recordedLevel = 0;
+
+   // Out of device memory even after freeing what could be, the texture stays queued for a later frame.
+   if (upload.image == VK_NULL_HANDLE)
+   {
+      vkFreeCommandBuffers(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool, 1, &upload.commandBuffer);
+      return false;
+   }
+
+   m_vecTextureUploads.push_back(upload);
+   SubmitUpload(static_cast<uint32_t>(m_vecTextureUploads.size() - 1));
+   return true;
+}
+
+void VulkanRenderer::BeginTextureStream(const LoadedTexture& texture)
+{
+   TextureUpload upload = {};
+   upload.texId = texture.texId;
+   upload.texture = m_textureCache.GetHandle(texture.texId);
+
+   // Staging stays with the stream as the CPU copy of every level.
+   upload.staging = texture.staging;
+
+   upload.format = texture.format;
+   upload.width = texture.width;
+   upload.height = texture.height;
+   upload.mipLevels = static_cast<uint32_t>(texture.levels.size());
+   upload.levels = texture.levels;
+   upload.streamed = true;
+   upload.imageBaseLevel = upload.mipLevels;
+   upload.recordedLevel = upload.mipLevels;
+   upload.residentLevel = upload.mipLevels;
+
+   // No image yet, the first batch creates one just big enough for its levels.
+   m_vecTextureUploads.push_back(upload);
+}
+
+VkDeviceSize VulkanRenderer::RecordStreamBatch(uint32_t uploadIndex, uint32_t wantedLevel, VkDeviceSize budget, bool firstThisFrame)
+{
+   TextureUpload& upload = m_vecTextureUploads[uploadIndex];
+
+   // Work up from the smallest level not yet sent towards wantedLevel for as long as the budget lasts.
+   // An existing image can't take levels below the one it starts at, that needs a rebase.
+   uint32_t floorLevel = upload.image != VK_NULL_HANDLE ? std::max(wantedLevel, upload.imageBaseLevel) : wantedLevel;
+   uint32_t lowLevel = upload.recordedLevel;
+   VkDeviceSize used = 0;
+   while (lowLevel > floorLevel)
+   {
+      VkDeviceSize levelSize = upload.levels[lowLevel - 1].size;
+      if (used + levelSize > budget && (used > 0 || !firstThisFrame))
+      {
+         break;
+      }
+
+      used += levelSize;
+      lowLevel--;
+   }
+
+   if (lowLevel == upload.recordedLevel)
+   {
+      return 0;
+   }
+
+   // First batch of a stream, the image holds exactly its levels. (transfer source for moving to a different sized image)
+   if (upload.image == VK_NULL_HANDLE)
+   {
+      if (!ReserveDeviceMemory(used))
+      {
+         return 0;
+      }
+
+      const TextureLevel& baseLevel = upload.levels[lowLevel];
+      upload.image = CreateImage(baseLevel.width, baseLevel.height, upload.mipLevels - lowLevel, upload.format, VK_IMAGE_TILING_OPTIMAL,
+         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+         &upload.imageMemory, true);
+      if (upload.image == VK_NULL_HANDLE)
+      {
+         return 0;
+      }
+      upload.imageBaseLevel = lowLevel;
+   }
+
+   // Only this batch's levels change layout, resident ones stay shader readable for the frames sampling them.
+   uint32_t levelCount = upload.recordedLevel - lowLevel;
+   upload.commandBuffer = BeginCommandBuffer(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool);
+   RecordImageBarrier(upload.commandBuffer, upload.image, lowLevel - upload.imageBaseLevel, levelCount,
+      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+   for (uint32_t i = lowLevel; i < upload.recordedLevel; i++)
+   {
+      const TextureLevel& level = upload.levels[i];
+      RecordCopyImageBuffer(upload.commandBuffer, upload.staging.buffer, upload.image, level.width, level.height, level.offset,
+         i - upload.imageBaseLevel);
+   }
+
+   RecordImageBarrier(upload.commandBuffer, upload.image, lowLevel - upload.imageBaseLevel, levelCount,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+   upload.recordedLevel = lowLevel;
+   SubmitUpload(uploadIndex);
+
+   return used;
+}
+
+VkDeviceSize VulkanRenderer::RecordStreamRebase(uint32_t uploadIndex, uint32_t imageBaseLevel, VkDeviceSize budget, bool firstThisFrame)
+{
+   TextureUpload& upload = m_vecTextureUploads[uploadIndex];
+
+   // The new image holds every level from imageBaseLevel down, the resident ones among them are copied across on the GPU.
+   uint32_t firstLevel = std::max(upload.residentLevel, imageBaseLevel);
+   VkDeviceSize used = 0;
+   for (uint32_t i = firstLevel; i < upload.mipLevels; i++)
+   {
+      used += upload.levels[i].size;
+   }
+
+   if (used > budget && !firstThisFrame)
+   {
+      return 0;
+   }
+
+   // A bigger image has to fit in the budget next to the old one. A smaller one frees memory once it's in, so it always goes.
+   if (imageBaseLevel < upload.imageBaseLevel)
+   {
+      VkDeviceSize imageSize = 0;
+      for (uint32_t i = imageBaseLevel; i < upload.mipLevels; i++)
+      {
+         imageSize += upload.levels[i].size;
+      }
+
+      if (!ReserveDeviceMemory(imageSize))
+      {
+         return 0;
+      }
+   }
+
+   const TextureLevel& baseLevel = upload.levels[imageBaseLevel];
+   upload.rebaseImage = CreateImage(baseLevel.width, baseLevel.height, upload.mipLevels - imageBaseLevel, upload.format, VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      &upload.rebaseImageMemory, true);
+   if (upload.rebaseImage == VK_NULL_HANDLE)
+   {
+      return 0;
+   }
+   upload.rebaseLevel = imageBaseLevel;
+
+   // The old levels are read in place. Frames already submitted sample them before the copy, later ones after it.
+   uint32_t levelCount = upload.mipLevels - firstLevel;
+   upload.commandBuffer = BeginCommandBuffer(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool);
+   RecordImageBarrier(upload.commandBuffer, upload.image, firstLevel - upload.imageBaseLevel, levelCount,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+   RecordImageBarrier(upload.commandBuffer, upload.rebaseImage, firstLevel - imageBaseLevel, levelCount,
+      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+   for (uint32_t i = firstLevel; i < upload.mipLevels; i++)
+   {
+      VkImageCopy region = {};
+      region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - upload.imageBaseLevel, 0, 1 };
+      region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - imageBaseLevel, 0, 1 };
+      region.extent = { upload.levels[i].width, upload.levels[i].height, 1 };
+      vkCmdCopyImage(upload.commandBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+         upload.rebaseImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+   }
+
+   RecordImageBarrier(upload.commandBuffer, upload.image, firstLevel - upload.imageBaseLevel, levelCount,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+   RecordImageBarrier(upload.commandBuffer, upload.rebaseImage, firstLevel - imageBaseLevel, levelCount,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+   upload.recordedLevel = firstLevel;
+   SubmitUpload(uploadIndex);
+
+   return used;
+}
+
+void VulkanRenderer::SubmitUpload(uint32_t uploadIndex)
+{
+   TextureUpload& upload = m_vecTextureUploads[uploadIndex];
+   CREATION_SUCCEEDED(vkEndCommandBuffer(upload.commandBuffer), "Failed to end texture upload command buffer!");
+
+   // Fence is polled at later frame boundaries instead of waiting on the queue here.
+   VkFenceCreateInfo fenceInfo = {};
+   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+   CREATION_SUCCEEDED(vkCreateFence(m_vkMainDevice.logicalDevice, &fenceInfo, nullptr, &upload.fence), "Failed to create a texture upload fence!");
+
+   VkSubmitInfo submitInfo = {};
+   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+   submitInfo.commandBufferCount = 1;
+   submitInfo.pCommandBuffers = &upload.commandBuffer;
+   CREATION_SUCCEEDED(vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, upload.fence), "Failed to submit texture upload!");
+}
+
+void VulkanRenderer::ShowResidentLevels(uint32_t uploadIndex)
+{
+   TextureUpload& upload = m_vecTextureUploads[uploadIndex];
+   if (!upload.shown)
+   {
+      // First levels are in, the image takes over the slot from the placeholder. (whose set is shared and stays alive)
+      m_vkTextureImages[upload.texId] = upload.image;
+      m_vkTextureImageMemory[upload.texId] = upload.imageMemory;
+      upload.shown = true;
+   }
+   else
+   {
+      // Frames in flight may still sample through the old view, it goes the way of a released texture but the image stays.
+      m_vecRetiredTextures.push_back({ VK_NULL_HANDLE, VK_NULL_HANDLE, m_vkTextureImageViews[upload.texId],
+         m_vkSamplerDescriptorSets[upload.texId], m_iFrameNumber });
+   }
+
+   // View starts at the lowest resident level, so sampling never reaches one that hasn't arrived.
+   VkImageView imageView = CreateImageView(upload.image, upload.format, VK_IMAGE_ASPECT_COLOR_BIT,
+      upload.mipLevels - upload.residentLevel, upload.residentLevel - upload.imageBaseLevel);
+   m_vkTextureImageViews[upload.texId] = imageView;
+   m_vecTextureBaseLevels[upload.texId] = upload.residentLevel;
+
+   // Command buffers are re-recorded every frame, so the new set is picked up from this frame on.
+   m_vkSamplerDescriptorSets[upload.texId] = CreateTextureDescriptorSet(imageView);
+
+   ShowSharers(upload.texId);
+}
+
+void VulkanRenderer::ShowSharers(uint32_t pixelOwner)
+{
+   // Textures that turned out to hold the same pixels show whatever the owner shows.
+   for (uint32_t texId = 0; texId < m_textureCache.GetCapacity(); texId++)
+   {
+      if (texId != pixelOwner && m_textureCache.GetRefCount(texId) > 0 && m_textureCache.GetPixelOwner(texId) == pixelOwner)
+      {
+         ShowSharedTexture(texId);
+      }
+   }
+}
+
+StagingTarget VulkanRenderer::AllocateStaging(VkDeviceSize size)
+{
+   // Called from asset worker threads. Only creates and maps its own objects, so it needs no locking.
+   StagingTarget staging = {};
+   CreateBuffer(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      &staging.buffer, &staging.memory);
+
+   // Stays mapped until released, decoders write into it directly.
+   if (vkMapMemory(m_vkMainDevice.logicalDevice, staging.memory, 0, size, 0, &staging.mappedData) != VK_SUCCESS)
+   {
+      ReleaseStaging(staging);
+      throw std::runtime_error("Failed to map staging buffer memory!");
+   }
+
+   return staging;
+}
+
+void VulkanRenderer::ReleaseStaging(const StagingTarget& staging)
+{
+   if (staging.mappedData)
+   {
+      vkUnmapMemory(m_vkMainDevice.logicalDevice, staging.memory);
+   }
+   vkDestroyBuffer(m_vkMainDevice.logicalDevice, staging.buffer, nullptr);
+   vkFreeMemory(m_vkMainDevice.logicalDevice, staging.memory, nullptr);
+}
+
+bool VulkanRenderer::BeginMeshUpload(MeshHandle meshHandle)
+{
+   // Room is made the way it is for textures. If there isn't enough yet, the next frame asks again.
+   Mesh& mesh = m_meshes.Get(meshHandle)->mesh;
+   if (!ReserveDeviceMemory(mesh.GetMemorySize()))
+   {
+      return false;
+   }
+
+   MeshUpload upload = {};
+   upload.mesh = meshHandle;
+   upload.staging = AllocateStaging(mesh.GetUploadSize());
+
+   upload.commandBuffer = BeginCommandBuffer(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool);
+   mesh.RecordUpload(upload.commandBuffer, upload.staging.buffer, upload.staging.mappedData);
+   CREATION_SUCCEEDED(vkEndCommandBuffer(upload.commandBuffer), "Failed to end mesh upload command buffer!");
+
+   // Fence is polled at later frame boundaries, like a texture upload's.
+   VkFenceCreateInfo fenceInfo = {};
+   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+   CREATION_SUCCEEDED(vkCreateFence(m_vkMainDevice.logicalDevice, &fenceInfo, nullptr, &upload.fence), "Failed to create a mesh upload fence!");
+
+   VkSubmitInfo submitInfo = {};
+   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+   submitInfo.commandBufferCount = 1;
+   submitInfo.pCommandBuffers = &upload.commandBuffer;
+   CREATION_SUCCEEDED(vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, upload.fence), "Failed to submit mesh upload!");
+
+   m_vecMeshUploads.push_back(upload);
+   return true;
+}
+
+void VulkanRenderer::ProcessMeshUploads()
+{
+   // Meshes whose copies the GPU has finished are drawn again from this frame on.
+   for (size_t i = 0; i < m_vecMeshUploads.size();)
+   {
+      if (vkGetFenceStatus(m_vkMainDevice.logicalDevice, m_vecMeshUploads[i].fence) != VK_SUCCESS)
+      {
+         i++;
+         continue;
+      }
+
+      FinishMeshUpload(i);
+   }
+}
+
+void VulkanRenderer::FinishMeshUpload(size_t uploadIndex)
+{
+   // Only waits when called for an upload that isn't done yet.
+   MeshUpload& upload = m_vecMeshUploads[uploadIndex];
+   vkWaitForFences(m_vkMainDevice.logicalDevice, 1, &upload.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+   vkFreeCommandBuffers(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool, 1, &upload.commandBuffer);
+   vkDestroyFence(m_vkMainDevice.logicalDevice, upload.fence, nullptr);
+   ReleaseStaging(upload.staging);
+
+   SceneMesh* sceneMesh = m_meshes.Get(upload.mesh);
+   if (sceneMesh != nullptr)
+   {
+      sceneMesh->mesh.FinishUpload();
+      WriteMeshletCullSet(sceneMesh);
+   }
+
+   m_vecMeshUploads.erase(m_vecMeshUploads.begin() + uploadIndex);
+}
+
+void VulkanRenderer::EnforceMemoryBudget()
+{
+   // Driver numbers are refreshed once a frame, allocations in between are counted as they happen.
+   m_memoryBudget.Update();
+
+   // Say so when uploads start being turned down for good, not every frame they keep being.
+   VkDeviceSize shortfall = m_memoryBudget.GetShortfall();
+   if (shortfall > 0 && !m_bOverBudget)
+   {
+      printf("WARNING: No room for %.2f MB in the device memory budget, drawing with less detail until there is.\n",
+         static_cast<double>(shortfall) / (1024.0 * 1024.0));
+   }
+   m_bOverBudget = shortfall > 0;
+
+   VkDeviceSize usage = m_memoryBudget.GetUsage();
+   VkDeviceSize budget = m_memoryBudget.GetBudget();
+   if (usage <= budget)
+   {
+      return;
+   }
+
+   // Memory already on its way out counts, only evict for the rest.
+   VkDeviceSize excess = usage - budget;
+   VkDeviceSize pending = PendingFreeBytes();
+   if (excess > pending)
+   {
+      EvictLeastRecentlyUsed(excess - pending);
+   }
+}
+
+bool VulkanRenderer::ReserveDeviceMemory(VkDeviceSize size)
+{
+   VkDeviceSize headroom = m_memoryBudget.GetHeadroom();
+   if (size <= headroom)
+   {
+      return true;
+   }
+
+   // Memory on its way out covers it, wait for that rather than evict more.
+   VkDeviceSize pending = PendingFreeBytes();
+   if (size <= headroom + pending)
+   {
+      return false;
+   }
+
+   // Evicted meshes free their memory at once, textures once their smaller image is in. Either way try again next frame if it's not enough.
+   if (EvictLeastRecentlyUsed(size - headroom - pending) > 0 || pending > 0)
+   {
+      return size <= m_memoryBudget.GetHeadroom();
+   }
+
+   // Nothing left to evict, everything in memory is in use. Callers keep what they have, a smaller level or the placeholder,
+   // and ask again later, by when something may have gone out of view.
+   m_memoryBudget.ReportShortfall(size);
+   return false;
+}
+
+VkDeviceSize VulkanRenderer::EvictLeastRecentlyUsed(VkDeviceSize bytes)
+{
+   // Anything used by a frame that may still be in flight stays, and so does anything on screen right now.
+   uint64_t usedBefore = m_iFrameNumber > MAX_FRAME_DRAWS ? m_iFrameNumber - MAX_FRAME_DRAWS : 0;
+
+   VkDeviceSize freed = 0;
+   while (freed < bytes)
+   {
+      // Oldest of the streamed textures whose finest level the shaders last asked for, and of the meshes last drawn.
+      uint64_t oldest = usedBefore;
+      uint32_t uploadIndex = UINT32_MAX;
+      size_t meshIndex = m_meshes.GetSize();
+
+      for (uint32_t i = 0; i < m_vecTextureUploads.size(); i++)
+      {
+         const TextureUpload& upload = m_vecTextureUploads[i];
+         if (!upload.streamed || !upload.shown || upload.fence != VK_NULL_HANDLE || !m_textureCache.IsCurrent(upload.texture) ||
+            upload.residentLevel + 1 >= upload.mipLevels)
+         {
+            continue;
+         }
+
+         const TextureDemand& demand = m_vecTextureDemand[upload.texId];
+         if (demand.sampled && demand.frameNumber < oldest)
+         {
+            oldest = demand.frameNumber;
+            uploadIndex = i;
+         }
+      }
+
+      for (size_t i = 0; i < m_meshes.GetSize(); i++)
+      {
+         if (m_meshes[i].mesh.IsResident() && m_meshes[i].mesh.GetLastDrawnFrame() < oldest)
+         {
+            oldest = m_meshes[i].mesh.GetLastDrawnFrame();
+            meshIndex = i;
+            uploadIndex = UINT32_MAX;
+         }
+      }
+
+      if (meshIndex < m_meshes.GetSize())
+      {
+         // Vertices and indices stay on the CPU, the mesh uploads them again when it's next drawn.
+         freed += m_meshes[meshIndex].mesh.GetMemorySize();
+         m_meshes[meshIndex].mesh.Evict();
+      }
+      else if (uploadIndex != UINT32_MAX)
+      {
+         // A texture loses its finest level. Staging still holds it, feedback streams it back in if the shaders ask again.
+         TextureUpload& upload = m_vecTextureUploads[uploadIndex];
+         uint32_t droppedLevel = upload.residentLevel;
+         if (RecordStreamRebase(uploadIndex, droppedLevel + 1, UINT64_MAX, true) == 0)
+         {
+            break;
+         }
+
+         TextureDemand& demand = m_vecTextureDemand[upload.texId];
+         demand.level = std::max(demand.level, droppedLevel + 1);
+         freed += upload.levels[droppedLevel].size;
+      }
+      else
+      {
+         break;
+      }
+   }
+
+   return freed;
+}
+
+VkDeviceSize VulkanRenderer::PendingFreeBytes()
+{
+   // Retired images go once the frames sampling them are done, images being rebased once the copy has landed.
+   VkDeviceSize pending = 0;
+   for (const auto& retired : m_vecRetiredTextures)
+   {
+      pending += m_memoryBudget.GetAllocationSize(retired.imageMemory);
+   }
+   for (const auto& upload : m_vecTextureUploads)
+   {
+      if (upload.rebaseImage != VK_NULL_HANDLE)
+      {
+         pending += m_memoryBudget.GetAllocationSize(upload.imageMemory);
+      }
+   }
+
+   return pending;
+}
+
+void VulkanRenderer::FreeImageMemory(VkDeviceMemory imageMemory)
+{
+   m_memoryBudget.Untrack(imageMemory);
+   vkFreeMemory(m_vkMainDevice.logicalDevice, imageMemory, nullptr);
+}
+
+VkImage VulkanRenderer::RecordTextureUpload(VkCommandBuffer commandBuffer, const LoadedTexture& texture, uint32_t mipLevels,
+   VkDeviceMemory* imageMemory, MipgenScratch* scratch)
+{
+   // Pre-compressed files bring their own chain, anything else only has level 0 and the rest is generated here.
+   bool generateMips = mipLevels > texture.levels.size();
+
+   // Blit is the cheap path, formats without linear blit filtering need the compute shader and storage usage.
+   bool useCompute = generateMips && !SupportsLinearBlit(texture.format);
+
+   VkImageUsageFlags useFlags = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+   if (useCompute)
+   {
+      useFlags |= VK_IMAGE_USAGE_STORAGE_BIT;
+   }
+
+   // Create image to hold final texture. Nothing is recorded if there's no memory for it.
+   VkImage image = CreateImage(texture.width, texture.height, mipLevels, texture.format, VK_IMAGE_TILING_OPTIMAL,
+      useFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, imageMemory, true);
+   if (image == VK_NULL_HANDLE)
+   {
+      return VK_NULL_HANDLE;
+   }
+
+   // Every level becomes a transfer destination, the ones in staging are copied straight in.
+   RecordImageLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+   for (uint32_t i = 0; i < texture.levels.size(); i++)
+   {
+      const TextureLevel& level = texture.levels[i];
+      RecordCopyImageBuffer(commandBuffer, texture.staging.buffer, image, level.width, level.height, level.offset, i);
+   }
+
+   // Fill the rest of the chain, both paths leave every level shader readable.
+   if (!generateMips)
+   {
+      RecordImageLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+   }
+   else if (useCompute)
+   {
+      RecordComputeMipChain(commandBuffer, image, texture.width, texture.height, mipLevels, scratch);
+   }
+   else
+   {
+      RecordBlitMipChain(commandBuffer, image, texture.width, texture.height, mipLevels);
+   }
+
+   return image;
+}
+
+void VulkanRenderer::RecordComputeMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+   MipgenScratch* scratch)
+{
+   if (m_vkMipgenPipeline == VK_NULL_HANDLE)
+   {
+      CreateMipgenPipeline();
+   }
+
+   // One view per level, dispatch i reads view i and writes view i + 1.
+   std::vector<VkImageView> levelViews(mipLevels);
+   for (uint32_t i = 0; i < mipLevels; i++)
+   {
+      levelViews[i] = CreateImageView(image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1, i);
+      scratch->levelViews.push_back(levelViews[i]);
+   }
+
+   std::vector<VkDescriptorSetLayout> setLayouts(mipLevels - 1, m_vkMipgenSetLayout);
+   std::vector<VkDescriptorSet> sets(mipLevels - 1);
+
+   VkDescriptorSetAllocateInfo setAllocInfo = {};
+   setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+   setAllocInfo.descriptorPool = m_vkMipgenDescriptorPool;
+   setAllocInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+   setAllocInfo.pSetLayouts = setLayouts.data();
+
+   CREATION_SUCCEEDED(vkAllocateDescriptorSets(m_vkMainDevice.logicalDevice, &setAllocInfo, sets.data()), "Failed to allocate mipmap descriptor sets!");
+   scratch->descriptorSets.insert(scratch->descriptorSets.end(), sets.begin(), sets.end());
+
+   for (uint32_t i = 0; i < mipLevels - 1; i++)
+   {
+      // Storage images are accessed in GENERAL layout.
+      VkDescriptorImageInfo imageInfos[2] = {};
+      imageInfos[0].imageView = levelViews[i];
+      imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+      imageInfos[1].imageView = levelViews[i + 1];
+      imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+      VkWriteDescriptorSet descriptorWrite = {};
+      descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptorWrite.dstSet = sets[i];
+      descriptorWrite.dstBinding = 0;
+      descriptorWrite.dstArrayElement = 0;
+      descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+      descriptorWrite.descriptorCount = 2;                                             // Binding 0 and 1 are consecutive.
+      descriptorWrite.pImageInfo = imageInfos;
+
+      vkUpdateDescriptorSets(m_vkMainDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
+   }
+
+   // Whole chain to GENERAL. Level 0 holds the copied image, the others are written below.
+   RecordImageBarrier(commandBuffer, image, 0, mipLevels,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkMipgenPipeline);
+
+   for (uint32_t i = 0; i < mipLevels - 1; i++)
+   {
+      uint32_t dstWidth = std::max(width >> (i + 1), 1u);
+      uint32_t dstHeight = std::max(height >> (i + 1), 1u);
+
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkMipgenPipelineLayout, 0, 1, &sets[i], 0, nullptr);
+      vkCmdDispatch(commandBuffer, (dstWidth + 7) / 8, (dstHeight + 7) / 8, 1);      // 8x8 local size in shader.
+
+      // Next dispatch reads the level this one wrote.
+      RecordImageBarrier(commandBuffer, image, i + 1, 1,
+         VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+         VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+   }
+
+   // Hand the finished chain over to the fragment shader.
+   RecordImageBarrier(commandBuffer, image, 0, mipLevels,
+      VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void VulkanRenderer::CreateMipgenPipeline()
+{
+   // Source and destination level, both storage images.
+   VkDescriptorSetLayoutBinding levelBindings[2] = {};
+   for (uint32_t i = 0; i < 2; i++)
+   {
+      levelBindings[i].binding = i;
+      levelBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+      levelBindings[i].descriptorCount = 1;
+      levelBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+      levelBindings[i].pImmutableSamplers = nullptr;
+   }
+
+   VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+   layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+   layoutCreateInfo.bindingCount = 2;
+   layoutCreateInfo.pBindings = levelBindings;
+
+   CREATION_SUCCEEDED(vkCreateDescriptorSetLayout(m_vkMainDevice.logicalDevice, &layoutCreateInfo, nullptr, &m_vkMipgenSetLayout), "Failed to create a mipmap descriptor set layout!");
+
+   // Sets are freed individually once their upload retires.
+   VkDescriptorPoolSize poolSize = {};
+   poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+   poolSize.descriptorCount = MAX_MIPGEN_SETS * 2;
+
+   VkDescriptorPoolCreateInfo poolCreateInfo = {};
+   poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+   poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+   poolCreateInfo.maxSets = MAX_MIPGEN_SETS;
+   poolCreateInfo.poolSizeCount = 1;
+   poolCreateInfo.pPoolSizes = &poolSize;
+
+   CREATION_SUCCEEDED(vkCreateDescriptorPool(m_vkMainDevice.logicalDevice, &poolCreateInfo, nullptr, &m_vkMipgenDescriptorPool), "Failed to create a mipmap descriptor pool!");
+
+   VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+   pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   pipelineLayoutCreateInfo.setLayoutCount = 1;
+   pipelineLayoutCreateInfo.pSetLayouts = &m_vkMipgenSetLayout;
+
+   CREATION_SUCCEEDED(vkCreatePipelineLayout(m_vkMainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_vkMipgenPipelineLayout), "Failed to create a mipmap pipeline layout!");
+
+   // Read in SPIR-V code of shader.
+   AssetBytes computeShaderCode = m_assetPack.Read("Shaders/mipgen.spv");
+   VkShaderModule computeShaderModule = CreateShaderModule(computeShaderCode);
+
+   VkComputePipelineCreateInfo pipelineCreateInfo = {};
+   pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+   pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+   pipelineCreateInfo.stage.module = computeShaderModule;
+   pipelineCreateInfo.stage.pName = "main";
+   pipelineCreateInfo.layout = m_vkMipgenPipelineLayout;
+
+   CREATION_SUCCEEDED(vkCreateComputePipelines(m_vkMainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_vkMipgenPipeline), "Failed to create the mipmap pipeline!");
+
+   vkDestroyShaderModule(m_vkMainDevice.logicalDevice, computeShaderModule, nullptr);
+}
+
+void VulkanRenderer::FreeMipgenScratch(MipgenScratch* scratch)
+{
+   if (!scratch->descriptorSets.empty())
+   {
+      vkFreeDescriptorSets(m_vkMainDevice.logicalDevice, m_vkMipgenDescriptorPool,
+         static_cast<uint32_t>(scratch->descriptorSets.size()), scratch->descriptorSets.data());
+   }
+   for (auto view : scratch->levelViews)
+   {
+      vkDestroyImageView(m_vkMainDevice.logicalDevice, view, nullptr);
+   }
+
+   scratch->descriptorSets.clear();
+   scratch->levelViews.clear();
+}
+
+bool VulkanRenderer::SupportsLinearBlit(VkFormat format)
+{
+   VkFormatProperties properties;
+   vkGetPhysicalDeviceFormatProperties(m_vkMainDevice.physicalDevice, format, &properties);
+
+   // Blitting a chain needs the format as both source and destination, with linear filtering.
+   VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+   return (properties.optimalTilingFeatures & required) == required;
+}
+
+uint32_t VulkanRenderer::TextureMipLevels(const LoadedTexture& texture)
+{
+   // A chain from the file is used as it is.
+   if (texture.levels.size() > 1 || IsBlockFormat(texture.format))
+   {
+      return static_cast<uint32_t>(texture.levels.size());
+   }
+
+   // Compute path writes rgba8 storage images, which sRGB formats can't be. Such textures go without mips.
+   if (texture.format != VK_FORMAT_R8G8B8A8_UNORM && !SupportsLinearBlit(texture.format))
+   {
+      return 1;
+   }
+
+   return MipLevelCount(texture.width, texture.height);
+}
+
+bool VulkanRenderer::IsTextureFormatSupported(VkFormat format)
+{
+   // BC formats need the device feature on top of the format's own support.
+   if (IsBlockFormat(format) && !m_bTextureCompressionBC)
+   {
+      return false;
+   }
+
+   // A format ChooseSupportedFormat can't find falls back to CPU decompression, so its failure is an answer here.
+   try
+   {
+      ChooseSupportedFormat({ format }, VK_IMAGE_TILING_OPTIMAL,
+         VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+   }
+   catch (const std::runtime_error&)
+   {
+      return false;
+   }
+
+   return true;
+}
+
+void VulkanRenderer::GetPhysicalDevice()
+{
+   // Enumerate physical device that the vkIOnstance can access.
+   uint32_t deviceCount = 0;
+   vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, nullptr);
+
+   // If no devices available, then none support Vulkan!
+   if (deviceCount == 0)
+   {
+      throw std::runtime_error("Can't find GPUs that support Vulkan Instance!");
+   }
+
+   // Get list of physical devices.
+   std::vector<VkPhysicalDevice> deviceList(deviceCount);
+   vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, deviceList.data());
+
+   // TODO: Just picking first device currently.
+   m_vkMainDevice.physicalDevice = VK_NULL_HANDLE;
+   for (const auto& device : deviceList)
+   {
+      if (CheckDeviceSuitable(device))
+      {
+         m_vkMainDevice.physicalDevice = device;
+         break;
+      }
+   }
+
+   if (m_vkMainDevice.physicalDevice == VK_NULL_HANDLE)
+   {
+      throw std::runtime_error("Can't find a GPU that has everything the renderer needs!");
+   }
+
+   // Get properties of our new device.
+   VkPhysicalDeviceProperties deviceProperties;
+   vkGetPhysicalDeviceProperties(m_vkMainDevice.physicalDevice, &deviceProperties);
+
+   //m_vkMinUniformBufferOffset = deviceProperties.limits.minUniformBufferOffsetAlignment;
+}
+
+void VulkanRenderer::AllocateDynamicBufferTransferSpace()
+{
+   //// Calculate alignment of model data.
+   //m_vkModelUniformAlignment = (sizeof(Model) + (size_t)m_vkMinUniformBufferOffset -1) & ~(m_vkMinUniformBufferOffset - 1);
+
+   //// Create space in memory to hold dynamic buffer that is aligned to our required alignment and holds MAX_OBJECTS.
+   //m_uboModelTransferSpace = (Model *)_aligned_malloc(m_vkModelUniformAlignment * MAX_OBJECTS, m_vkModelUniformAlignment);
+}
+
+bool VulkanRenderer::CheckInstanceExtensionSupport(std::vector<const char*>* checkExtensions)
+{
+   // Need to get number of extensions to create array of correct size to hold extensions.
+   uint32_t extensionCount = 0;
+   vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+   if (extensionCount == 0)
+   {
+      return false;
+   }
+
+   // Create a list of VkExtensionProperties using count.
+   std::vector<VkExtensionProperties> extensions(extensionCount);
+   vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+   // Check if given extensions are in list of available extensions.
+   for (const auto& checkExtension : *checkExtensions)
+   {
+      bool hasExtension = false;
+
+      for (const auto& extension : extensions)
+      {
+         if (strcmp(checkExtension, extension.extensionName) == 0)
+         {
+            hasExtension = true;
+            break;
+         }
+      }
+
+      // Problem, extension doesn't exist.
+      if (!hasExtension)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
+{
+   // Get device extension count.
+   uint32_t extensionCount = 0;
+   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+   if (extensionCount == 0)
+   {
+      return false;
+   }
+
+   // Populate list of extensions.
+   std::vector<VkExtensionProperties> extensions(extensionCount);
+   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+   // Check for extension.
+   for (const auto& deviceExtension : deviceExtensions)
+   {
+      bool hasExtension = false;
+      for (const auto& extension : extensions)
+      {
+         if (strcmp(deviceExtension, extension.extensionName) == 0)
+         {
+            hasExtension = true;
+            break;
+         }
+      }
+
+      if (!hasExtension)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool VulkanRenderer::CheckDeviceExtension(VkPhysicalDevice device, const char* extensionName)
+{
+   // Optional extensions, enabled only if this device has them.
+   uint32_t extensionCount = 0;
+   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+   std::vector<VkExtensionProperties> extensions(extensionCount);
+   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+   for (const auto& extension : extensions)
+   {
+      if (strcmp(extensionName, extension.extensionName) == 0)
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device)
+{
+   //// Information about the device itself (ID, name, type, vendor, etc)
+   //VkPhysicalDeviceProperties deviceProperties;
+   //vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+   // Information about what the device can do (geo shader, tess shader, wide lines, etc)
+   VkPhysicalDeviceFeatures deviceFeatures;
+   vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+   QueueFamilyIndices indices = GetQueueFamilies(device);
+
+   bool extensionsSupported = CheckDeviceExtensionSupport(device);
+
+   bool swapchainValid = false;
+   if (extensionsSupported)
+   {
+      SwapchainDetails swapchainDetails = GetSwapchainDetails(device);
+      swapchainValid = !swapchainDetails.presentationModes.empty() && !swapchainDetails.formats.empty();
+   }
+
+   // Texture feedback's fragment stores are optional, see CreateLogicalDevice.
+   return indices.isValid() && extensionsSupported && swapchainValid && deviceFeatures.samplerAnisotropy;
+}
+
+QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device)
+{
+   QueueFamilyIndices indices;
+
+   // Get all Queue Family Property info for the given device.
+   uint32_t queueFamilyCount = 0;
    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
    std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
@@ -1379,8 +3003,8 @@ VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat>& form
    throw std::runtime_error("Failed to find a matching format!");
 }
 
-VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
-   VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory)
+VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
+   VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory, bool mayFail)
 {
    // CREATE IMAGE.
    // Image creation info.
@@ -1390,7 +3014,7 @@ VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat fo
    imageCreateInfo.extent.width = width;                             // Width of image extent.
    imageCreateInfo.extent.height = height;                           // Height of image extent.
    imageCreateInfo.extent.depth = 1;                                 // Depth of image extent.
-   imageCreateInfo.mipLevels = 1;                                    // Number of mipmap levels.
+   imageCreateInfo.mipLevels = mipLevels;                            // Number of mipmap levels.
    imageCreateInfo.arrayLayers = 1;                                  // Number of levels in image array.
    imageCreateInfo.format = format;                                  // Format type of image.
    imageCreateInfo.tiling = tiling;                                  // How image data should be tiled.
@@ -1415,7 +3039,30 @@ VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat fo
    memoryAllocInfo.allocationSize = memoryRequirements.size;
    memoryAllocInfo.memoryTypeIndex = FindMemoryTypeIndex(m_vkMainDevice.physicalDevice, memoryRequirements.memoryTypeBits, propFlags);
 
-   CREATION_SUCCEEDED(vkAllocateMemory(m_vkMainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageMemory), "Failed to allocate memory for image!");
+   VkResult result = vkAllocateMemory(m_vkMainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageMemory);
+
+   // Out of device memory. Retired textures may make room, once the frames still sampling them have finished.
+   if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && !m_vecRetiredTextures.empty())
+   {
+      vkDeviceWaitIdle(m_vkMainDevice.logicalDevice);
+      DestroyRetiredTextures(true);
+      result = vkAllocateMemory(m_vkMainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageMemory);
+   }
+
+   if (result != VK_SUCCESS)
+   {
+      vkDestroyImage(m_vkMainDevice.logicalDevice, image, nullptr);
+      *imageMemory = VK_NULL_HANDLE;
+
+      // Streamed textures can wait for memory, everything else needs its image.
+      if (mayFail)
+      {
+         return VK_NULL_HANDLE;
+      }
+      throw std::runtime_error("Failed to allocate memory for image!");
+   }
+
+   m_memoryBudget.Track(*imageMemory, memoryAllocInfo.memoryTypeIndex, memoryAllocInfo.allocationSize);
 
    // Connect memory to image.
    CREATION_SUCCEEDED(vkBindImageMemory(m_vkMainDevice.logicalDevice, image, *imageMemory, 0), "Failed to bind image memory!");
@@ -1423,7 +3070,7 @@ VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat fo
    return image;
 }
 
-VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t baseMipLevel)
 {
    VkImageViewCreateInfo viewCreateInfo = {};
    viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1437,8 +3084,8 @@ VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkIm
 
    // Subresources allow the view to view only a part of an image.
    viewCreateInfo.subresourceRange.aspectMask = aspectFlags;      // Which aspect of image to view (e.g. COLOR_BIT for viewing color)
-   viewCreateInfo.subresourceRange.baseMipLevel = 0;              // Start mipmap level to view from.
-   viewCreateInfo.subresourceRange.levelCount = 1;                // Number of mipmap levels to view.
+   viewCreateInfo.subresourceRange.baseMipLevel = baseMipLevel;   // Start mipmap level to view from.
+   viewCreateInfo.subresourceRange.levelCount = mipLevels;        // Number of mipmap levels to view.
    viewCreateInfo.subresourceRange.baseArrayLayer = 0;            // Start array level to view from.
    viewCreateInfo.subresourceRange.layerCount = 1;                // Number of array levels to view.
 
@@ -1449,13 +3096,13 @@ VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkIm
    return imageView;
 }
 
-VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char>& code)
+VkShaderModule VulkanRenderer::CreateShaderModule(const AssetBytes& code)
 {
-   // Shader Module creation information.
+   // Shader Module creation information. Packed code is read straight from the mapping. (payloads are 16 byte aligned)
    VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-   shaderModuleCreateInfo.codeSize = code.size();
-   shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+   shaderModuleCreateInfo.codeSize = static_cast<size_t>(code.size);
+   shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t *>(code.Data());
 
    VkShaderModule shaderModule;
    CREATION_SUCCEEDED(vkCreateShaderModule(m_vkMainDevice.logicalDevice, &shaderModuleCreateInfo, nullptr, &shaderModule), "Failed to create a shader module!");
@@ -1463,13 +3110,8 @@ VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char>& code)
    return shaderModule;
 }
 
-uint32_t VulkanRenderer::CreateTextureImage(std::string fileName)
+VkImage VulkanRenderer::CreateTextureImage(const stbi_uc* imageData, int width, int height, VkDeviceSize imageSize, VkDeviceMemory* imageMemory)
 {
-   // Load image file.
-   int width, height;
-   VkDeviceSize imageSize;
-   stbi_uc* imageData = LoadTextureFile(fileName, &width, &height, &imageSize);
-
    // Create staging buffer to hold loaded data, ready to copy to device.
    VkBuffer imageStagingBuffer;
    VkDeviceMemory imageStagingBufferMemory;
@@ -1483,15 +3125,11 @@ uint32_t VulkanRenderer::CreateTextureImage(std::string fileName)
    memcpy(data, imageData, static_cast<size_t>(imageSize));
    vkUnmapMemory(m_vkMainDevice.logicalDevice, imageStagingBufferMemory);
 
-   // Free original image data.
-   stbi_image_free(imageData);
-
    // Create image to hold final texture.
    VkImage texImage;
-   VkDeviceMemory texImageMemory;
-   texImage = CreateImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+   texImage = CreateImage(width, height, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-      &texImageMemory);
+      imageMemory);
 
 
    // COPY DATA TO IMAGE.
@@ -1504,34 +3142,370 @@ uint32_t VulkanRenderer::CreateTextureImage(std::string fileName)
    // Transition image to be shader readable for shader usage.
    TransitionImageLayout(m_vkMainDevice.logicalDevice, m_vkGraphicsQueue, m_vkGraphicsCommandPool, texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-   // Add texture data to vector for reference.
-   m_vkTextureImages.push_back(texImage);
-   m_vkTextureImageMemory.push_back(texImageMemory);
-
    // Destroy staging buffers.
    vkDestroyBuffer(m_vkMainDevice.logicalDevice, imageStagingBuffer, nullptr);
    vkFreeMemory(m_vkMainDevice.logicalDevice, imageStagingBufferMemory, nullptr);
 
-   // Return index of new texture image.
-   return m_vkTextureImages.size() - 1;
+   return texImage;
+}
+
+TextureHandle VulkanRenderer::CreateTexture(const std::string& fileName)
+{
+   // The reference CreateTextureAsync took is the caller's.
+   return m_textureCache.GetHandle(CreateTextureAsync(fileName));
+}
+
+bool VulkanRenderer::DestroyTexture(TextureHandle texture)
+{
+   if (!m_textureCache.IsCurrent(texture))
+   {
+      return false;
+   }
+
+   ReleaseTexture(texture.index);
+   return true;
+}
+
+std::vector<uint32_t> VulkanRenderer::CreateTextures(const std::vector<std::string>& fileNames)
+{
+   // Files already loaded or on their way (repeats within this batch too) only gain a reference.
+   std::vector<uint32_t> texIds(fileNames.size());
+   std::vector<std::string> loadNames;
+   std::vector<uint32_t> loadIds;
+   for (size_t i = 0; i < fileNames.size(); i++)
+   {
+      texIds[i] = m_textureCache.Acquire(fileNames[i]);
+      if (texIds[i] == INVALID_TEXTURE_ID)
+      {
+         texIds[i] = AllocateTextureSlot(fileNames[i]);
+         loadNames.push_back(fileNames[i]);
+         loadIds.push_back(texIds[i]);
+      }
+   }
+
+   if (loadNames.empty())
+   {
+      return texIds;
+   }
+
+   // Decode every new file at once across the worker threads, straight into one shared staging buffer.
+   std::vector<LoadedTexture> textures;
+   try
+   {
+      textures = m_assetLoader.LoadTextures(loadNames);
+   }
+   catch (const std::runtime_error&)
+   {
+      // Nothing was uploaded, hand back every reference this call took before passing the failure on.
+      for (uint32_t texId : loadIds)
+      {
+         m_textureCache.SetContent(texId, TextureContent());
+      }
+      for (uint32_t texId : texIds)
+      {
+         ReleaseTexture(texId);
+      }
+      throw;
+   }
+   StagingTarget staging = textures[0].staging;
+
+   // Record every texture's upload into a single command buffer.
+   VkCommandBuffer commandBuffer = BeginCommandBuffer(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool);
+
+   MipgenScratch mipgenScratch;
+   for (size_t i = 0; i < textures.size(); i++)
+   {
+      // Pixels identical to a loaded texture (or one earlier in the batch) show that image instead of uploading a copy.
+      uint32_t texId = loadIds[i];
+      if (m_textureCache.SetContent(texId, textures[i].content) != texId)
+      {
+         continue;
+      }
+
+      // Create image to hold final texture and record its copy and mip chain.
+      uint32_t mipLevels = TextureMipLevels(textures[i]);
+      m_vkTextureImages[texId] = RecordTextureUpload(commandBuffer, textures[i], mipLevels, &m_vkTextureImageMemory[texId], &mipgenScratch);
+
+      // Views and descriptors only reference the image, so they can be made before the copy has run.
+      m_vkTextureImageViews[texId] = CreateImageView(m_vkTextureImages[texId], textures[i].format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+      m_vkSamplerDescriptorSets[texId] = CreateTextureDescriptorSet(m_vkTextureImageViews[texId]);
+      m_vecTextureBaseLevels[texId] = 0;
+   }
+
+   // One submit and one wait for the whole batch.
+   EndSubmitDestroyCommandBuffer(m_vkMainDevice.logicalDevice, m_vkGraphicsCommandPool, m_vkGraphicsQueue, commandBuffer);
+
+   // Destroy staging buffers.
+   ReleaseStaging(staging);
+   FreeMipgenScratch(&mipgenScratch);
+
+   // Every image in the batch exists now, point the sharers at theirs.
+   for (uint32_t texId : loadIds)
+   {
+      ShowSharedTexture(texId);
+   }
+
+   return texIds;
+}
+
+uint32_t VulkanRenderer::CreateTextureAsync(std::string fileName)
+{
+   // Files already loaded or on their way only gain a reference.
+   uint32_t texId = m_textureCache.Acquire(fileName);
+   if (texId != INVALID_TEXTURE_ID)
+   {
+      return texId;
+   }
+
+   // Reserve a texture slot that shows the placeholder until the real image arrives.
+   texId = AllocateTextureSlot(fileName);
+
+   // Read and decode on a worker, upload happens at a later frame boundary.
+   m_assetLoader.QueueTexture(texId, fileName);
+
+   return texId;
+}
+
+std::vector<MeshHandle> VulkanRenderer::CreateMeshes(const std::vector<std::string>& fileNames)
+{
+   // Read and parse every file at once across the worker threads.
+   ImportedScene scene = m_assetLoader.LoadModels(fileNames);
+   std::vector<uint32_t> texIds = CreateSceneTextures(scene);
+
+   // Upload each imported mesh, in file order so callers can tell them apart.
+   std::vector<MeshHandle> meshHandles;
+   for (ImportedModel& model : scene.models)
+   {
+      for (ImportedMesh& importedMesh : model.meshes)
+      {
+         meshHandles.push_back(AddSceneMesh(CreateImportedMesh(&importedMesh, texIds)));
+      }
+   }
+
+   // Every mesh holds its own reference on its texture, the ones taken for the import go.
+   for (uint32_t texId : texIds)
+   {
+      ReleaseTexture(texId);
+   }
+
+   PrintImportStats(scene, meshHandles.size());
+
+   return meshHandles;
+}
+
+MeshHandle VulkanRenderer::CreateMeshAsync(const std::string& fileName)
+{
+   std::vector<Vertex> vertices = m_vecPlaceholderVertices;
+   std::vector<uint32_t> indices = m_vecPlaceholderIndices;
+   MeshHandle meshHandle = AddSceneMesh(Mesh(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice, m_vkGraphicsQueue,
+      m_vkGraphicsCommandPool, &vertices, &indices, ReferenceTexture(m_iPlaceholderTexId), &m_memoryBudget));
+
+   uint32_t importId = m_iNextImportId++;
+   m_mapPendingImports[importId].meshes.push_back(meshHandle);
+   m_assetLoader.QueueModels(importId, { fileName });
+
+   return meshHandle;
+}
+
+void VulkanRenderer::CreateStaticMeshes(const std::vector<StaticPlacement>& placements)
+{
+   // Each file is imported once however often it's placed.
+   std::vector<std::string> fileNames;
+   std::vector<uint32_t> modelOfPlacement;
+   for (const StaticPlacement& placement : placements)
+   {
+      auto found = std::find(fileNames.begin(), fileNames.end(), placement.fileName);
+      modelOfPlacement.push_back(static_cast<uint32_t>(found - fileNames.begin()));
+      if (found == fileNames.end())
+      {
+         fileNames.push_back(placement.fileName);
+      }
+   }
+
+   // Nothing stands in for them meanwhile, how many batches there will be is only known once every model is in.
+   uint32_t importId = m_iNextImportId++;
+   PendingImport& pending = m_mapPendingImports[importId];
+   pending.placements = placements;
+   pending.modelOfPlacement = modelOfPlacement;
+   m_assetLoader.QueueModels(importId, fileNames);
+}
+
+void VulkanRenderer::AddStaticBatches(const ImportedScene& scene, const std::vector<StaticPlacement>& placements,
+   const std::vector<uint32_t>& modelOfPlacement, const std::vector<uint32_t>& texIds)
+{
+   // Transforms are baked into the vertices, a batch is drawn with the identity and should never be moved.
+   std::vector<StaticBatch> batches = BuildStaticBatches(scene, placements, modelOfPlacement);
+
+   uint32_t sourceMeshCount = 0;
+   for (StaticBatch& batch : batches)
+   {
+      uint32_t texId = batch.textureIndex != UINT32_MAX ? texIds[batch.textureIndex] : m_iPlaceholderTexId;
+
+      AddSceneMesh(Mesh(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice,
+         m_vkGraphicsQueue, m_vkGraphicsCommandPool, &batch.vertices, &batch.indices, ReferenceTexture(texId), &m_memoryBudget,
+         &batch.meshlets));
+      sourceMeshCount += batch.sourceMeshCount;
+   }
+
+   printf("Batched %u static meshes from %zu placements into %zu draws\n", sourceMeshCount, placements.size(), batches.size());
+}
+
+Mesh VulkanRenderer::CreateImportedMesh(ImportedMesh* importedMesh, const std::vector<uint32_t>& texIds)
+{
+   uint32_t texId = importedMesh->textureIndex != UINT32_MAX ? texIds[importedMesh->textureIndex] : m_iPlaceholderTexId;
+
+   return Mesh(m_vkMainDevice.physicalDevice, m_vkMainDevice.logicalDevice, m_vkGraphicsQueue, m_vkGraphicsCommandPool,
+      &importedMesh->vertices, &importedMesh->indices, ReferenceTexture(texId), &m_memoryBudget, &importedMesh->meshlets,
+      &importedMesh->lods);
+}
+
+MeshHandle VulkanRenderer::AddSceneMesh(Mesh&& mesh, uint32_t parentNode)
+{
+   MeshHandle meshHandle = m_meshes.Insert({ std::move(mesh), m_sceneGraph.AddNode(parentNode), VK_NULL_HANDLE, VK_NULL_HANDLE, false, {} });
+   WriteMeshletCullSet(m_meshes.Get(meshHandle));
+
+   return meshHandle;
+}
+
+void VulkanRenderer::ProcessModelImports()
+{
+   for (LoadedScene& loaded : m_assetLoader.TakeCompletedScenes())
+   {
+      auto found = m_mapPendingImports.find(loaded.requestId);
+      PendingImport pending = std::move(found->second);
+      m_mapPendingImports.erase(found);
+
+      // A failed import keeps its placeholders, the loader has said why.
+      if (loaded.scene.models.empty())
+      {
+         continue;
+      }
+
+      std::vector<uint32_t> texIds = CreateSceneTextures(loaded.scene);
+
+      size_t meshCount = 0;
+      if (pending.placements.empty())
+      {
+         for (size_t i = 0; i < pending.meshes.size(); i++)
+         {
+            SwapInModel(pending.meshes[i], &loaded.scene.models[i], texIds);
+            meshCount += loaded.scene.models[i].meshes.size();
+         }
+      }
+      else
+      {
+         AddStaticBatches(loaded.scene, pending.placements, pending.modelOfPlacement, texIds);
+      }
+
+      for (uint32_t texId : texIds)
+      {
+         ReleaseTexture(texId);
+      }
+
+      if (meshCount > 0)
+      {
+         PrintImportStats(loaded.scene, meshCount);
+      }
+   }
+}
+
+void VulkanRenderer::SwapInModel(MeshHandle meshHandle, ImportedModel* model, const std::vector<uint32_t>& texIds)
+{
+   // Destroyed while it was importing, or nothing in the file to show.
+   if (!m_meshes.Contains(meshHandle) || model->meshes.empty())
+   {
+      return;
+   }
+
+   // The placeholder may still be copying in, that has to finish before it can be retired like a destroyed mesh.
+   for (size_t i = 0; i < m_vecMeshUploads.size(); i++)
+   {
+      if (m_vecMeshUploads[i].mesh == meshHandle)
+      {
+         FinishMeshUpload(i);
+         break;
+      }
+   }
+
+   // Node and handle stay, so anything placing the mesh carries on as it was.
+   SceneMesh* sceneMesh = m_meshes.Get(meshHandle);
+   m_vecRetiredMeshes.push_back({ std::move(sceneMesh->mesh), sceneMesh->meshletCullSet, sceneMesh->meshletCullPool, m_iFrameNumber });
+   sceneMesh->mesh = CreateImportedMesh(&model->meshes[0], texIds);
+   sceneMesh->meshletCullSet = VK_NULL_HANDLE;
+   sceneMesh->meshletCullPool = VK_NULL_HANDLE;
+   WriteMeshletCullSet(sceneMesh);
+
+   // Adding meshes can move this one, it's looked up again for each.
+   uint32_t node = sceneMesh->node;
+   for (size_t i = 1; i < model->meshes.size(); i++)
+   {
+      MeshHandle part = AddSceneMesh(CreateImportedMesh(&model->meshes[i], texIds), node);
+      m_meshes.Get(meshHandle)->parts.push_back(part);
+   }
+}
+
+void VulkanRenderer::PrintImportStats(const ImportedScene& scene, size_t meshCount)
+{
+   double megabytes = scene.bytesRead / (1024.0 * 1024.0);
+   printf("Imported %zu meshes from %zu models (%u from cache), %.2f MB in %.1f ms (%.1f MB/s)\n", meshCount, scene.models.size(),
+      scene.cachedModels, megabytes, scene.seconds * 1000.0, scene.seconds > 0.0 ? megabytes / scene.seconds : 0.0);
+   size_t lodCount = 0;
+   for (const ImportedModel& model : scene.models)
+   {
+      for (const ImportedMesh& importedMesh : model.meshes)
+      {
+         lodCount += importedMesh.lods.size();
+      }
+   }
+   printf("%zu levels of detail across %zu meshes\n", lodCount, meshCount);
+   if (scene.weld.vertexCountBefore > 0)
+   {
+      printf("Welded %llu vertices to %llu, %.2f MB saved in %.1f ms\n", static_cast<unsigned long long>(scene.weld.vertexCountBefore),
+         static_cast<unsigned long long>(scene.weld.vertexCountAfter), scene.weld.GetBytesSaved() / (1024.0 * 1024.0), scene.weld.seconds * 1000.0);
+   }
+   if (scene.vertexCacheBefore.triangleCount > 0)
+   {
+      printf("Vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", scene.vertexCacheBefore.GetAcmr(), scene.vertexCacheAfter.GetAcmr(),
+         scene.vertexCacheBefore.GetAtvr(), scene.vertexCacheAfter.GetAtvr());
+   }
 }
 
-uint32_t VulkanRenderer::CreateTexture(std::string fileName)
+void VulkanRenderer::DestroyRetiredMeshes(bool waitedIdle)
 {
-   // Create texture image and get its location in array.
-   uint32_t textureImageLoc = CreateTextureImage(fileName);
+   // Same wait as for retired textures.
+   for (size_t i = 0; i < m_vecRetiredMeshes.size();)
+   {
+      RetiredMesh& retired = m_vecRetiredMeshes[i];
+      if (!waitedIdle && m_iFrameNumber < retired.frameNumber + MAX_FRAME_DRAWS)
+      {
+         i++;
+         continue;
+      }
+
+      if (retired.meshletCullSet != VK_NULL_HANDLE)
+      {
+         vkFreeDescriptorSets(m_vkMainDevice.logicalDevice, retired.meshletCullPool, 1, &retired.meshletCullSet);
+      }
+      retired.mesh.Deinit();
 
-   // Create image view and add to list.
-   VkImageView imageView = CreateImageView(m_vkTextureImages[textureImageLoc], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-   m_vkTextureImageViews.push_back(imageView);
+      m_vecRetiredMeshes.erase(m_vecRetiredMeshes.begin() + i);
+   }
+}
 
-   // Create texture descriptor.
-   uint32_t descriptorLoc = CreateTextureDescriptor(imageView);
+std::vector<uint32_t> VulkanRenderer::CreateSceneTextures(const ImportedScene& scene)
+{
+   // Textures were deduplicated by the import, each one is requested once and streams in behind the placeholder.
+   std::vector<uint32_t> texIds;
+   texIds.reserve(scene.textureFiles.size());
+   for (const std::string& textureFile : scene.textureFiles)
+   {
+      texIds.push_back(CreateTextureAsync(textureFile));
+   }
 
-   return descriptorLoc;
+   return texIds;
 }
 
-uint32_t VulkanRenderer::CreateTextureDescriptor(VkImageView textureImage)
+VkDescriptorSet VulkanRenderer::CreateTextureDescriptorSet(VkImageView textureImage)
 {
    VkDescriptorSet descriptorSet;
 
@@ -1563,31 +3537,131 @@ uint32_t VulkanRenderer::CreateTextureDescriptor(VkImageView textureImage)
    // Update new descriptor set.
    vkUpdateDescriptorSets(m_vkMainDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
 
-   // Add descriptor set to list.
-   m_vkSamplerDescriptorSets.push_back(descriptorSet);
+   return descriptorSet;
+}
+
+uint32_t VulkanRenderer::AllocateTextureSlot(const std::string& fileName)
+{
+   uint32_t texId = m_textureCache.Insert(fileName);
+   if (texId >= MAX_TEXTURES)
+   {
+      m_textureCache.SetContent(texId, TextureContent());
+      m_textureCache.Release(texId);
+      throw std::runtime_error("Out of texture slots! (" + fileName + ")");
+   }
+
+   // New IDs grow every per texture list, reused ones were emptied when released.
+   size_t capacity = m_textureCache.GetCapacity();
+   m_vkTextureImages.resize(capacity, VK_NULL_HANDLE);
+   m_vkTextureImageMemory.resize(capacity, VK_NULL_HANDLE);
+   m_vkTextureImageViews.resize(capacity, VK_NULL_HANDLE);
+   m_vkSamplerDescriptorSets.resize(capacity, VK_NULL_HANDLE);
+   m_vecTextureBaseLevels.resize(capacity, NO_TEXTURE_FEEDBACK);
+   m_vecTextureDemand.resize(capacity);
+
+   // Nothing has asked for any of its levels yet.
+   m_vecTextureDemand[texId] = { UINT32_MAX, m_iFrameNumber, false };
+
+   // Shows the placeholder until its own image is ready.
+   if (m_iPlaceholderTexId != INVALID_TEXTURE_ID)
+   {
+      m_vkSamplerDescriptorSets[texId] = m_vkSamplerDescriptorSets[m_iPlaceholderTexId];
+   }
+
+   return texId;
+}
+
+TextureHandle VulkanRenderer::ReferenceTexture(uint32_t texId)
+{
+   // Placeholder lives as long as the renderer, nobody counts references on it.
+   if (texId != m_iPlaceholderTexId)
+   {
+      m_textureCache.AddReference(texId);
+   }
 
-   // Return descriptor set location.
-   return m_vkSamplerDescriptorSets.size() - 1;
+   return m_textureCache.GetHandle(texId);
 }
 
-stbi_uc* VulkanRenderer::LoadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize)
+void VulkanRenderer::ReleaseTexture(uint32_t texId)
 {
-   // Number of channels image uses.
-   int channels;
+   // Placeholder lives as long as the renderer.
+   if (texId == m_iPlaceholderTexId)
+   {
+      return;
+   }
 
-   // Load pixel data for image.
-   std::string fileLoc = "Textures/" + fileName;
-   stbi_uc* image = stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha);
+   uint32_t pixelOwner = m_textureCache.GetPixelOwner(texId);
+   bool loading = m_textureCache.IsLoading(texId);
+   if (!m_textureCache.Release(texId))
+   {
+      return;
+   }
 
-   if (!image)
+   // Still on a worker, the cache frees the ID once the result comes back and the result is dropped.
+   if (loading)
    {
-      throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+      return;
    }
 
-   // Calculate image size using given and known data.
-   *imageSize = (*width) * (*height) * 4;
+   // The ID is free now, so the handles queued and uploading work hold are stale. Queued pixels are dropped at the next frame
+   // boundary, uploads send no more levels and destroy an image not shown yet once the batch in flight is done.
+   // A shown one is retired with the slot here.
+   RetireTextureImage(texId);
 
-   return image;
+   // A texture sharing another's image held a reference on it.
+   if (pixelOwner != texId)
+   {
+      ReleaseTexture(pixelOwner);
+   }
+}
+
+void VulkanRenderer::ShowSharedTexture(uint32_t texId)
+{
+   // Only once the owner's image is ready, until then it keeps the placeholder.
+   uint32_t pixelOwner = m_textureCache.GetPixelOwner(texId);
+   if (pixelOwner != texId && m_vkTextureImageViews[pixelOwner] != VK_NULL_HANDLE)
+   {
+      m_vkSamplerDescriptorSets[texId] = m_vkSamplerDescriptorSets[pixelOwner];
+      m_vecTextureBaseLevels[texId] = m_vecTextureBaseLevels[pixelOwner];
+   }
+}
+
+void VulkanRenderer::RetireTextureImage(uint32_t texId)
+{
+   // Frames already submitted may still sample the image, so it's destroyed a few frames from now.
+   // Sharers never owned the image or set, they just stop pointing at it.
+   if (m_vkTextureImages[texId] != VK_NULL_HANDLE)
+   {
+      m_vecRetiredTextures.push_back({ m_vkTextureImages[texId], m_vkTextureImageMemory[texId], m_vkTextureImageViews[texId],
+         m_vkSamplerDescriptorSets[texId], m_iFrameNumber });
+   }
+
+   m_vkTextureImages[texId] = VK_NULL_HANDLE;
+   m_vkTextureImageMemory[texId] = VK_NULL_HANDLE;
+   m_vkTextureImageViews[texId] = VK_NULL_HANDLE;
+   m_vkSamplerDescriptorSets[texId] = m_vkSamplerDescriptorSets[m_iPlaceholderTexId];
+   m_vecTextureBaseLevels[texId] = NO_TEXTURE_FEEDBACK;
+}
+
+void VulkanRenderer::DestroyRetiredTextures(bool waitedIdle)
+{
+   // Every frame submitted before the release has had its fence waited on once MAX_FRAME_DRAWS more frames have started.
+   for (size_t i = 0; i < m_vecRetiredTextures.size();)
+   {
+      RetiredTexture& retired = m_vecRetiredTextures[i];
+      if (!waitedIdle && m_iFrameNumber < retired.frameNumber + MAX_FRAME_DRAWS)
+      {
+         i++;
+         continue;
+      }
+
+      vkFreeDescriptorSets(m_vkMainDevice.logicalDevice, m_vkSamplerDescriptorPool, 1, &retired.descriptorSet);
+      vkDestroyImageView(m_vkMainDevice.logicalDevice, retired.imageView, nullptr);
+      vkDestroyImage(m_vkMainDevice.logicalDevice, retired.image, nullptr);
+      FreeImageMemory(retired.imageMemory);
+
+      m_vecRetiredTextures.erase(m_vecRetiredTextures.begin() + i);
+   }
 }
 
 #ifdef VK_DEBUG
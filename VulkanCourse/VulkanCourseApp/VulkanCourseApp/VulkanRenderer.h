@@ -9,11 +9,29 @@
 #include <set>
 #include <algorithm>
 #include <array>
+#include <unordered_map>
 
 #include "stb_image.h"
 
 #include "Mesh.h"
 #include "Utilities.h"
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "StaticBatch.h"
+#include "SceneGraph.h"
+#include "TransformMath.h"
+#include "SlotMap.h"
+
+// A mesh in the scene, with what the renderer keeps alongside it.
+struct SceneMesh
+{
+   Mesh mesh;
+   uint32_t node;                      // Scene graph node, its world matrix is the mesh's model matrix.
+   VkDescriptorSet meshletCullSet;     // Meshlet cull pass bindings, VK_NULL_HANDLE for meshes without meshlets.
+   VkDescriptorPool meshletCullPool;   // Pool the set came from.
+   bool visible;                       // Bounds are in the view of the frame being recorded, only then is it drawn.
+   std::vector<MeshHandle> parts;      // Further meshes of the same model, their nodes are children of this one's.
+};
 
 class VulkanRenderer
 {
@@ -24,7 +42,23 @@ public:
    int32_t Init(GLFWwindow* newWindow);
    void Deinit();
 
-   void UpdateModel(uint32_t modelId, glm::mat4 newModel);
+   // Every material of a model becomes its own mesh. Handles come back in file order.
+   std::vector<MeshHandle> CreateMeshes(const std::vector<std::string>& fileNames);
+   // Same without waiting. The model is imported on a worker and shows as a placeholder until a frame boundary after that.
+   // Its first material then takes the handle's place, any others become meshes below it that move and go with it.
+   MeshHandle CreateMeshAsync(const std::string& fileName);
+   // Takes the mesh out of the scene and drops its reference on its texture. False if it was already destroyed.
+   bool DestroyMesh(MeshHandle meshHandle);
+   // Meshes Init loaded, in file order.
+   const std::vector<MeshHandle>& GetStartupMeshes() const;
+
+   // Texture of a file, shared with anything else using the file. It shows the placeholder until its image has streamed in.
+   TextureHandle CreateTexture(const std::string& fileName);
+   // Drops the reference CreateTexture gave. False if the handle was already stale.
+   bool DestroyTexture(TextureHandle texture);
+
+   // Place a mesh relative to its parent in the scene graph. Takes effect at the next Draw.
+   void UpdateModel(MeshHandle meshHandle, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale = glm::vec3(1.0f));
 
    void Draw();
 
@@ -47,8 +81,11 @@ private:
    void CreateCommandBuffers();
    void CreateSynchronization();
    void CreateTextureSampler();
+   void CreatePlaceholderTexture();
+   void CreatePlaceholderMesh();
 
    void CreateUniformBuffers();
+   void CreateFeedbackBuffers();
    void CreateDescriptorPool();
    void CreateDescriptorSets();
 
@@ -57,6 +94,49 @@ private:
    // - Record Functions
    void RecordCommands(uint32_t currentImage);
 
+   // - Meshlet Functions.
+   void CreateMeshletCullPipeline();
+   void CreateMeshletCullPool();
+   void WriteMeshletCullSet(SceneMesh* sceneMesh);
+   void RecordMeshletCulling(VkCommandBuffer commandBuffer);
+
+   // - Streaming Functions.
+   void ReadTextureFeedback();
+   void ProcessTextureUploads();
+   void StreamTextureLevels();
+   bool BeginTextureUpload(const LoadedTexture& texture);
+   void BeginTextureStream(const LoadedTexture& texture);
+   VkDeviceSize RecordStreamBatch(uint32_t uploadIndex, uint32_t wantedLevel, VkDeviceSize budget, bool firstThisFrame);
+   VkDeviceSize RecordStreamRebase(uint32_t uploadIndex, uint32_t imageBaseLevel, VkDeviceSize budget, bool firstThisFrame);
+   void SubmitUpload(uint32_t uploadIndex);
+   void ShowResidentLevels(uint32_t uploadIndex);
+   void ShowSharers(uint32_t pixelOwner);
+   StagingTarget AllocateStaging(VkDeviceSize size);
+   void ReleaseStaging(const StagingTarget& staging);
+   bool BeginMeshUpload(MeshHandle meshHandle);
+   void ProcessMeshUploads();
+   void FinishMeshUpload(size_t uploadIndex);
+
+   // - Memory Functions.
+   void EnforceMemoryBudget();
+   bool ReserveDeviceMemory(VkDeviceSize size);
+   VkDeviceSize EvictLeastRecentlyUsed(VkDeviceSize bytes);
+   VkDeviceSize PendingFreeBytes();
+   void FreeImageMemory(VkDeviceMemory imageMemory);
+
+   // - Mipmap Functions.
+   VkImage RecordTextureUpload(VkCommandBuffer commandBuffer, const LoadedTexture& texture, uint32_t mipLevels,
+      VkDeviceMemory* imageMemory, MipgenScratch* scratch);
+   void RecordComputeMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+      MipgenScratch* scratch);
+   void CreateMipgenPipeline();
+   void FreeMipgenScratch(MipgenScratch* scratch);
+   bool SupportsLinearBlit(VkFormat format);
+   uint32_t TextureMipLevels(const LoadedTexture& texture);
+
+   // - Format Functions.
+   bool IsTextureFormatSupported(VkFormat format);
+
    // - Get Functions.
    void GetPhysicalDevice();
 
@@ -67,6 +147,7 @@ private:
    // -- Checker Functions.
    bool CheckInstanceExtensionSupport(std::vector<const char*>* checkExtensions);
    bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+   bool CheckDeviceExtension(VkPhysicalDevice device, const char* extensionName);
    bool CheckDeviceSuitable(VkPhysicalDevice device);
 
    // -- Getter Functions.
@@ -80,17 +161,39 @@ private:
    VkFormat ChooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
 
    // -- Create Functions.
-   VkImage CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
-      VkMemoryPropertyFlags propFlags, VkDeviceMemory * imageMemory);
-   VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-   VkShaderModule CreateShaderModule(const std::vector<char>& code);
-
-   uint32_t CreateTextureImage(std::string fileName);
-   uint32_t CreateTexture(std::string fileName);
-   uint32_t CreateTextureDescriptor(VkImageView textureImage);
-
-   // -- Loader Functions.
-   stbi_uc* LoadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize);
+   VkImage CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
+      VkMemoryPropertyFlags propFlags, VkDeviceMemory * imageMemory, bool mayFail = false);
+   VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1, uint32_t baseMipLevel = 0);
+   VkShaderModule CreateShaderModule(const AssetBytes& code);
+
+   VkImage CreateTextureImage(const stbi_uc* imageData, int width, int height, VkDeviceSize imageSize, VkDeviceMemory* imageMemory);
+   std::vector<uint32_t> CreateTextures(const std::vector<std::string>& fileNames);
+   uint32_t CreateTextureAsync(std::string fileName);
+   // Models that never move, merged into one mesh per texture. Imported on a worker, the batches appear at a frame boundary after.
+   void CreateStaticMeshes(const std::vector<StaticPlacement>& placements);
+   void AddStaticBatches(const ImportedScene& scene, const std::vector<StaticPlacement>& placements,
+      const std::vector<uint32_t>& modelOfPlacement, const std::vector<uint32_t>& texIds);
+   // Mesh of an imported one, holding a reference on its texture. texIds come from CreateSceneTextures.
+   Mesh CreateImportedMesh(ImportedMesh* importedMesh, const std::vector<uint32_t>& texIds);
+   // Put a mesh in the scene with a node of its own.
+   MeshHandle AddSceneMesh(Mesh&& mesh, uint32_t parentNode = SCENE_NO_PARENT);
+   // Swap finished imports in for their placeholders.
+   void ProcessModelImports();
+   void SwapInModel(MeshHandle meshHandle, ImportedModel* model, const std::vector<uint32_t>& texIds);
+   void PrintImportStats(const ImportedScene& scene, size_t meshCount);
+   void DestroyRetiredMeshes(bool waitedIdle);
+   std::vector<uint32_t> CreateSceneTextures(const ImportedScene& scene);
+   VkDescriptorSet CreateTextureDescriptorSet(VkImageView textureImage);
+
+   // -- Texture Cache Functions.
+   uint32_t AllocateTextureSlot(const std::string& fileName);
+   // One more reference on a texture, for a mesh to hold.
+   TextureHandle ReferenceTexture(uint32_t texId);
+   // Drop one reference. Queued and uploading work for a texture whose last one went sees its handle go stale and stops.
+   void ReleaseTexture(uint32_t texId);
+   void ShowSharedTexture(uint32_t texId);
+   void RetireTextureImage(uint32_t texId);
+   void DestroyRetiredTextures(bool waitedIdle);
 
    /***********************************************************
    ** Variable Declarations.
@@ -100,12 +203,30 @@ private:
    uint32_t m_iCurrentFrame = 0;
 
    // Scene Objects.
-   std::vector<Mesh> m_vecMesh;
+   // Packed so the per frame loops walk contiguous memory, whatever was added and destroyed along the way.
+   SlotMap<SceneMesh, MeshTag> m_meshes;
+   std::vector<MeshHandle> m_vecStartupMeshes;
+   // Transforms of everything drawn.
+   SceneGraph m_sceneGraph;
+
+   // Destroyed mesh waiting for the frames that may still draw it to finish.
+   struct RetiredMesh {
+      Mesh mesh;
+      VkDescriptorSet meshletCullSet;
+      VkDescriptorPool meshletCullPool;
+      uint64_t frameNumber;         // Frame it was destroyed in.
+   };
+   std::vector<RetiredMesh> m_vecRetiredMeshes;
 
    // Scene Settings.
-   struct UboViewProjection {
+   struct {
       glm::mat4 projection;
       glm::mat4 view;
+      glm::vec3 position;        // World space, worked out from the view once a frame.
+   } m_camera;
+   // The camera's matrices combined once a frame on the CPU, rather than for every vertex.
+   struct UboViewProjection {
+      glm::mat4 viewProjection;
    } m_uboViewProjection;
 
    // Vulkan Components.
@@ -134,12 +255,20 @@ private:
    VkDescriptorSetLayout m_vkDescriptorSetLayout;
    VkDescriptorSetLayout m_vkSamplerSetLayout;
    VkPushConstantRange m_vkPushConstantRange;
+   VkPushConstantRange m_vkFeedbackPushConstantRange;
 
    VkDescriptorPool m_vkDescriptorPool;
    VkDescriptorPool m_vkSamplerDescriptorPool;
    std::vector<VkDescriptorSet> m_vecDescriptorSets;
    std::vector< VkDescriptorSet> m_vkSamplerDescriptorSets;
 
+   // Texture feedback, one buffer per frame in flight. Read back once that frame's fence has been waited on.
+   VkDescriptorSetLayout m_vkFeedbackSetLayout;
+   std::vector<VkDescriptorSet> m_vecFeedbackDescriptorSets;
+   std::vector<VkBuffer> m_vecFeedbackBuffer;
+   std::vector<VkDeviceMemory> m_vecFeedbackBufferMemory;
+   std::vector<uint32_t*> m_vecFeedbackMapped;
+
    std::vector<VkBuffer> m_vecVpUniformBuffer;
    std::vector<VkDeviceMemory> m_vecVpUniformBufferMemory;
 
@@ -151,13 +280,121 @@ private:
    //Model* m_uboModelTransferSpace;
 
    // - Assets.
+   // Indexed by texture ID like the sampler descriptor sets. VK_NULL_HANDLE while loading or when sharing another's image.
    std::vector<VkImage> m_vkTextureImages;
    std::vector<VkDeviceMemory> m_vkTextureImageMemory;
    std::vector<VkImageView> m_vkTextureImageViews;
+   // Level of the full chain each texture's view starts at, pushed with draws so feedback counts from the full size.
+   std::vector<uint32_t> m_vecTextureBaseLevels;
+
+   // Finest level the shaders have asked for, per pixel owner. Only rises again once it went unused for TEXTURE_EVICT_FRAMES.
+   struct TextureDemand {
+      uint32_t level;
+      uint64_t frameNumber;         // Last frame that asked for level or finer.
+      bool sampled;                 // Nothing is known until a frame samples the real image.
+   };
+   std::vector<TextureDemand> m_vecTextureDemand;
+
+   // Which texture IDs hold which file and pixels, and how many users each has.
+   TextureCache m_textureCache;
+
+   // Released texture waiting for the frames that may still sample it to finish.
+   struct RetiredTexture {
+      VkImage image;
+      VkDeviceMemory imageMemory;
+      VkImageView imageView;
+      VkDescriptorSet descriptorSet;
+      uint64_t frameNumber;         // Frame it was released in.
+   };
+   std::vector<RetiredTexture> m_vecRetiredTextures;
+   uint64_t m_iFrameNumber = 0;
+
+   // Device local memory in use against what the driver allows, textures and meshes are evicted to stay within it.
+   MemoryBudget m_memoryBudget;
+   bool m_bOverBudget = false;         // Uploads were turned down last frame for want of memory.
+
+   // - Streaming.
+   AssetPack m_assetPack;
+   AssetLoader m_assetLoader;
+   uint32_t m_iPlaceholderTexId = INVALID_TEXTURE_ID;
+   // Cube shown for a model that is still importing, every one gets its own copy.
+   std::vector<Vertex> m_vecPlaceholderVertices;
+   std::vector<uint32_t> m_vecPlaceholderIndices;
+
+   // Model imports on the asset loader's workers, by request.
+   struct PendingImport {
+      std::vector<MeshHandle> meshes;              // Placeholder of every file, empty for static placements.
+      std::vector<StaticPlacement> placements;     // Static placements, modelOfPlacement says which file each one uses.
+      std::vector<uint32_t> modelOfPlacement;
+   };
+   std::unordered_map<uint32_t, PendingImport> m_mapPendingImports;
+   uint32_t m_iNextImportId = 0;
+
+   // Device can sample BC1-7 images, set when the logical device is created.
+   bool m_bTextureCompressionBC = false;
+   // Fragment shader can write texture feedback, set with the above. Without it every texture streams in whole.
+   bool m_bTextureFeedback = false;
+
+   // Texture whose levels are on their way to the GPU. Files with a full chain stream it smallest level first,
+   // a batch per frame within TEXTURE_UPLOAD_BUDGET, and the texture shows whatever is resident in the meantime.
+   // Such streams last as long as the texture. Staging is kept as the CPU copy, levels follow the shader feedback in and out,
+   // and the image only ever holds the levels that are wanted. Images that need their chain generated go up in one batch.
+   struct TextureUpload {
+      uint32_t texId;
+      TextureHandle texture;        // Texture the upload is for, stale once its last reference is gone.
+      VkImage image;                // VK_NULL_HANDLE until a stream's first batch.
+      VkDeviceMemory imageMemory;
+      VkFormat format;
+      uint32_t width;
+      uint32_t height;
+      uint32_t mipLevels;
+      std::vector<TextureLevel> levels;   // Levels in staging, largest first.
+      bool streamed;                // Levels come and go with demand, false for one batch uploads.
+      uint32_t imageBaseLevel;      // Level the image starts at, finer ones were dropped to save VRAM.
+      VkImage rebaseImage;          // Image the resident levels are being copied into, VK_NULL_HANDLE if none.
+      VkDeviceMemory rebaseImageMemory;
+      uint32_t rebaseLevel;         // Level rebaseImage starts at.
+      uint32_t recordedLevel;       // Lowest level submitted so far, mipLevels before the first batch.
+      uint32_t residentLevel;       // Lowest level the GPU has finished copying, mipLevels before the first batch.
+      StagingTarget staging;
+      MipgenScratch mipgenScratch;
+      VkCommandBuffer commandBuffer;   // Batch in flight, VK_NULL_HANDLE between batches.
+      VkFence fence;
+      bool shown;                   // Image sits in the texture slot, it belongs to the slot from then on.
+   };
+   std::vector<TextureUpload> m_vecTextureUploads;
+   // Decoded texture waiting for upload budget. Dropped when its handle goes stale, nothing of it is on the GPU yet.
+   struct QueuedTexture {
+      LoadedTexture loaded;
+      TextureHandle texture;
+   };
+   // In the order they finished.
+   std::vector<QueuedTexture> m_vecQueuedTextures;
+
+   // Evicted mesh on its way back to the GPU. It's left out of every frame until the fence says the copies are done.
+   struct MeshUpload {
+      MeshHandle mesh;
+      StagingTarget staging;
+      VkCommandBuffer commandBuffer;
+      VkFence fence;
+   };
+   std::vector<MeshUpload> m_vecMeshUploads;
 
    // - Pipeline.
    VkPipeline m_vkGraphicsPipeline;
    VkPipelineLayout m_vkPipelineLayout;
+
+   // Compute mip generation, only created if a texture format can't be linearly blitted.
+   VkPipeline m_vkMipgenPipeline = VK_NULL_HANDLE;
+   VkPipelineLayout m_vkMipgenPipelineLayout = VK_NULL_HANDLE;
+   VkDescriptorSetLayout m_vkMipgenSetLayout = VK_NULL_HANDLE;
+   VkDescriptorPool m_vkMipgenDescriptorPool = VK_NULL_HANDLE;
+
+   // Compute meshlet culling, run before the render pass to build each meshlet mesh's index list for the frame.
+   VkPipeline m_vkMeshletCullPipeline = VK_NULL_HANDLE;
+   VkPipelineLayout m_vkMeshletCullPipelineLayout = VK_NULL_HANDLE;
+   VkDescriptorSetLayout m_vkMeshletCullSetLayout = VK_NULL_HANDLE;
+   std::vector<VkDescriptorPool> m_vecMeshletCullDescriptorPools;     // Grows by a pool whenever every set is taken.
    VkRenderPass m_vkRenderPass;
 
    // - Pools.
@@ -1,4 +1,3 @@
-#define STB_IMAGE_IMPLEMENTATION
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #define GLFW_INCLUDE_VULKAN
@@ -36,6 +35,9 @@ int main()
       return EXIT_FAILURE;
    }
 
+   // The first two meshes of the scene spin.
+   const std::vector<MeshHandle>& meshes = g_vkRenderer.GetStartupMeshes();
+
    float angle = 0.0f;
    float deltaTime = 0.0f;
    double lastTime = 0.0f;
@@ -56,17 +58,11 @@ int main()
          angle -= 360.0f;
       }
 
-      glm::mat4 firstModel(1.0f);
-      glm::mat4 secondModel(1.0f);
-
-      firstModel = glm::translate(firstModel, glm::vec3(-1.0f, 0.0f, -1.0f));
-      firstModel = glm::rotate(firstModel, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
-
-      secondModel = glm::translate(secondModel, glm::vec3(1.0f, 0.0f, -3.0f));
-      secondModel = glm::rotate(secondModel, glm::radians(-angle*10), glm::vec3(0.0f, 0.0f, 1.0f));
+      glm::quat firstRotation = glm::angleAxis(glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+      glm::quat secondRotation = glm::angleAxis(glm::radians(-angle*10), glm::vec3(0.0f, 0.0f, 1.0f));
 
-      g_vkRenderer.UpdateModel(0, firstModel);
-      g_vkRenderer.UpdateModel(1, secondModel);
+      g_vkRenderer.UpdateModel(meshes[0], glm::vec3(-1.0f, 0.0f, -1.0f), firstRotation);
+      g_vkRenderer.UpdateModel(meshes[1], glm::vec3(1.0f, 0.0f, -3.0f), secondRotation);
 
       g_vkRenderer.Draw();
    }